@@ -2,20 +2,71 @@
 #include <functional>
 #include <string>
 #include <vector>
+#include <deque>
 #include <iostream>
+#include <memory>
 #include "request.hpp"
 #include "response.hpp"
+#include "handler.hpp"
+#include "async.hpp"
+#include "websocket.hpp"
 
 namespace xpresspp
 {
 
-    using Handler = std::function<void(Request &, Response &)>;
+    // Handlers and middleware accept any callable; small captures are stored
+    // inline and a call is one indirect jump (see handler.hpp)
+    using Handler = InlineFunction<void(Request &, Response &)>;
+    using StaticHandler = void (*)(Request &, Response &); // app.get<fn>(path)
+
+    class Next;
+    using Middleware = InlineFunction<void(Request &, Response &, Next &)>;
+
+    using WebSocket = websocket::WebSocket;
+    using WebSocketBehavior = websocket::Behavior;
 
     struct Route
     {
         std::string method;
         std::string path;
         Handler handler;
+        std::vector<const Middleware *> chain; // filled by App::compile()
+        bool async;                            // handler from fromAsync (may suspend)
+    };
+
+    // 🔥 Cursor over a route's compiled middleware chain
+    // Lives on the stack for one request. next() runs the following
+    // middleware (or the handler after the last one); code after next()
+    // returns is post-processing, and not calling next() short-circuits.
+    class Next
+    {
+    public:
+        Next(const Route &route, Request &req, Response &res)
+            : chain_(route.chain.data()), size_(route.chain.size()), handler_(route.handler), req_(req), res_(res) {}
+
+        // Runs the route's chain in front of another handler (the server's
+        // cache and coalescing replays)
+        Next(const Route &route, const Handler &handler, Request &req, Response &res)
+            : chain_(route.chain.data()), size_(route.chain.size()), handler_(handler), req_(req), res_(res) {}
+
+        void operator()()
+        {
+            if (index_ < size_)
+            {
+                (*chain_[index_++])(req_, res_, *this);
+                return;
+            }
+            if (index_++ == size_)
+                handler_(req_, res_); // once, even if next() is called twice
+        }
+
+    private:
+        const Middleware *const *chain_;
+        size_t size_;
+        size_t index_ = 0;
+        const Handler &handler_;
+        Request &req_;
+        Response &res_;
     };
 
     class App
@@ -37,13 +88,74 @@ namespace xpresspp
         void all(const std::string &path, Handler handler);
         void options(const std::string &path, Handler handler);
 
+        // Static routes: the handler is a function fixed at compile time,
+        // e.g. app.get<listUsers>("/users"). Its thunk calls it directly, so
+        // it can be inlined; app.get("/users", listUsers) stores a function
+        // pointer and pays a second indirect call per request.
+        template <StaticHandler Fn>
+        void get(const std::string &path) { addRoute("GET", path, staticHandler<Fn>()); }
+        template <StaticHandler Fn>
+        void post(const std::string &path) { addRoute("POST", path, staticHandler<Fn>()); }
+        template <StaticHandler Fn>
+        void put(const std::string &path) { addRoute("PUT", path, staticHandler<Fn>()); }
+        template <StaticHandler Fn>
+        void patch(const std::string &path) { addRoute("PATCH", path, staticHandler<Fn>()); }
+        template <StaticHandler Fn>
+        void del(const std::string &path) { addRoute("DELETE", path, staticHandler<Fn>()); }
+        template <StaticHandler Fn>
+        void all(const std::string &path) { addRoute("ALL", path, staticHandler<Fn>()); }
+        template <StaticHandler Fn>
+        void options(const std::string &path) { addRoute("OPTIONS", path, staticHandler<Fn>()); }
+
+        // Async routes: (req, res, done), finished later from any thread by
+        // calling done(); C++20 builds can pass co(<lambda returning Task>)
+        void get(const std::string &path, AsyncHandler handler);
+        void post(const std::string &path, AsyncHandler handler);
+        void put(const std::string &path, AsyncHandler handler);
+        void patch(const std::string &path, AsyncHandler handler);
+        void del(const std::string &path, AsyncHandler handler);
+        void all(const std::string &path, AsyncHandler handler);
+        void options(const std::string &path, AsyncHandler handler);
+
+        // WebSocket routes: the handshake is a GET that runs the middleware,
+        // then the connection moves to an event loop (see websocket.hpp)
+        void ws(const std::string &path, WebSocketBehavior behavior);
+
+        // Sends to every WebSocket subscribed to topic; returns how many
+        size_t publish(const std::string &topic, std::string_view message, bool binary = false);
+
+        websocket::Hub &webSockets() { return *hub; }
+
+        // Middleware, run in registration order before every matching route
+        void use(Middleware middleware);
+        void use(const std::string &prefix, Middleware middleware); // "/api" covers /api and /api/...
+
+        // Flattens the matching middleware into each route's chain (called by Server)
+        void compile();
+
         // Start server
         void listen(int port, std::function<void()> callback);
 
     private:
         std::vector<Route> routes;
 
-        void addRoute(const std::string &method, const std::string &path, Handler handler);
+        struct Layer
+        {
+            std::string prefix; // "" = every route
+            Middleware middleware;
+        };
+        std::deque<Layer> layers; // stable addresses: chains point into it
+
+        std::shared_ptr<websocket::Hub> hub; // WebSocket loops and topics
+
+        void addRoute(const std::string &method, const std::string &path, Handler handler, bool async = false);
+
+        template <StaticHandler Fn>
+        static Handler staticHandler()
+        {
+            return [](Request &req, Response &res)
+            { Fn(req, res); };
+        }
         void handleRequest(const std::string &method, const std::string &path);
     };
 }
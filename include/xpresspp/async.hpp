@@ -0,0 +1,442 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "handler.hpp"
+#include "request.hpp"
+#include "response.hpp"
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#include <coroutine>
+#define XPRESSPP_COROUTINES 1
+#endif
+
+namespace xpresspp
+{
+    namespace async_detail
+    {
+        // Implemented by the server's worker pool: a worker about to block on
+        // an async handler lets the pool start a replacement
+        struct Parker
+        {
+            virtual ~Parker() = default;
+            virtual void park() = 0;
+            virtual void unpark() = 0;
+        };
+
+        inline Parker *&currentParker()
+        {
+            thread_local Parker *parker = nullptr;
+            return parker;
+        }
+
+        struct Completion
+        {
+            std::mutex mutex;
+            std::condition_variable cv;
+            bool done = false;
+            std::exception_ptr error;
+            std::function<void()> continuation; // see then()
+
+            void finish(std::exception_ptr e)
+            {
+                std::function<void()> next;
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (done)
+                        return;
+                    done = true;
+                    error = std::move(e);
+                    next = std::move(continuation);
+                }
+                cv.notify_all();
+                if (next)
+                    next();
+            }
+
+            // Runs f once: now if already done, else on the thread that
+            // finishes (the one calling done())
+            void then(std::function<void()> f)
+            {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (!done)
+                    {
+                        continuation = std::move(f);
+                        return;
+                    }
+                }
+                f();
+            }
+
+            bool isDone()
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                return done;
+            }
+
+            void abandon()
+            {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (done)
+                        return;
+                }
+                finish(std::make_exception_ptr(std::runtime_error("Async handler dropped done() without calling it")));
+            }
+
+            void wait()
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                if (done)
+                    return; // completed before returning: nothing to park for
+
+                Parker *parker = currentParker();
+                if (parker)
+                {
+                    lock.unlock();
+                    parker->park();
+                    lock.lock();
+                }
+                cv.wait(lock, [this]
+                        { return done; });
+                lock.unlock();
+                if (parker)
+                    parker->unpark();
+            }
+        };
+
+        // Shared by every copy of a Done; the last copy gone without a call
+        // completes the request with an error instead of hanging it
+        struct Token
+        {
+            explicit Token(std::shared_ptr<Completion> c) : completion(std::move(c)) {}
+            Token(const Token &) = delete;
+            Token &operator=(const Token &) = delete;
+            ~Token() { completion->abandon(); }
+
+            std::shared_ptr<Completion> completion;
+        };
+
+        // Set by the server around an async route when it can suspend the
+        // connection: fromAsync leaves its completion here instead of
+        // waiting, and the server finishes the response once it is done
+        struct Suspension
+        {
+            std::shared_ptr<Completion> completion;
+        };
+
+        inline Suspension *&currentSuspension()
+        {
+            thread_local Suspension *suspension = nullptr;
+            return suspension;
+        }
+
+        class SuspensionScope
+        {
+        public:
+            explicit SuspensionScope(Suspension *suspension) : previous_(currentSuspension())
+            {
+                currentSuspension() = suspension;
+            }
+            ~SuspensionScope() { currentSuspension() = previous_; }
+
+            SuspensionScope(const SuspensionScope &) = delete;
+            SuspensionScope &operator=(const SuspensionScope &) = delete;
+
+        private:
+            Suspension *previous_;
+        };
+    }
+
+    // 🔥 Completion handle for async handlers
+    // Copyable and callable from any thread; req/res stay valid until it is
+    // called (or its last copy is gone), even if the handler itself threw.
+    // done.fail(std::current_exception()) reports an error (500).
+    class Done
+    {
+    public:
+        explicit Done(std::shared_ptr<async_detail::Completion> completion)
+            : token_(std::make_shared<async_detail::Token>(std::move(completion))) {}
+
+        void operator()() const { token_->completion->finish(nullptr); }
+        void fail(std::exception_ptr error) const { token_->completion->finish(std::move(error)); }
+
+    private:
+        std::shared_ptr<async_detail::Token> token_;
+    };
+
+    using AsyncHandler = InlineFunction<void(Request &, Response &, Done)>;
+
+    // 🔥 Runs an async handler behind the synchronous route interface
+    // On plain HTTP/1.x connections the server suspends the request: the
+    // handler returns, its worker goes back to the pool, and the response
+    // is written by a worker once done() is called. Middleware code after
+    // next() runs when the handler returns, before done().
+    // Elsewhere (HTTP/2 streams, HTTPS) the worker blocks until done(): it
+    // is parked, so the pool starts a replacement (see WorkerPool) and
+    // maxThreads caps how many of those requests can wait at once.
+    inline InlineFunction<void(Request &, Response &)> fromAsync(AsyncHandler handler)
+    {
+        return [handler = std::move(handler)](Request &req, Response &res)
+        {
+            auto completion = std::make_shared<async_detail::Completion>();
+
+            auto *suspension = async_detail::currentSuspension();
+            if (suspension && !suspension->completion)
+            {
+                // The server keeps req/res alive until done, even if this throws
+                suspension->completion = completion;
+                handler(req, res, Done(completion));
+                return;
+            }
+
+            std::exception_ptr thrown;
+            try
+            {
+                handler(req, res, Done(completion));
+            }
+            catch (...)
+            {
+                // A timer or thread may still hold done and write to res:
+                // wait for it (or its last copy to go) before unwinding
+                thrown = std::current_exception();
+            }
+            completion->wait();
+            if (thrown)
+                std::rethrow_exception(thrown);
+            if (completion->error)
+                std::rethrow_exception(completion->error);
+        };
+    }
+
+    // 🔥 Timers for async handlers (one thread; callbacks run on it)
+    class TimerService
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        static TimerService &shared()
+        {
+            static TimerService service;
+            return service;
+        }
+
+        TimerService() : thread_([this]
+                                 { run(); }) {}
+
+        TimerService(const TimerService &) = delete;
+        TimerService &operator=(const TimerService &) = delete;
+
+        ~TimerService()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                stop_ = true;
+            }
+            cv_.notify_all();
+            thread_.join();
+        }
+
+        void after(std::chrono::milliseconds delay, std::function<void()> callback)
+        {
+            at(Clock::now() + delay, std::move(callback));
+        }
+
+        void at(Clock::time_point when, std::function<void()> callback)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                timers_.push({when, sequence_++, std::move(callback)});
+            }
+            cv_.notify_one();
+        }
+
+    private:
+        struct Timer
+        {
+            Clock::time_point when;
+            uint64_t sequence; // FIFO among equal deadlines
+            std::function<void()> callback;
+
+            bool operator>(const Timer &other) const
+            {
+                return when != other.when ? when > other.when : sequence > other.sequence;
+            }
+        };
+
+        std::mutex mutex_;
+        std::condition_variable cv_;
+        std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> timers_;
+        uint64_t sequence_ = 0;
+        bool stop_ = false;
+        std::thread thread_; // last: started once everything above exists
+
+        void run()
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            while (!stop_)
+            {
+                if (timers_.empty())
+                {
+                    cv_.wait(lock);
+                    continue;
+                }
+                auto when = timers_.top().when;
+                if (Clock::now() < when)
+                {
+                    cv_.wait_until(lock, when);
+                    continue;
+                }
+
+                auto callback = std::move(const_cast<Timer &>(timers_.top()).callback);
+                timers_.pop();
+                lock.unlock();
+                try
+                {
+                    callback();
+                }
+                catch (const std::exception &e)
+                {
+                    std::cerr << "[Timer Error] " << e.what() << std::endl;
+                }
+                lock.lock();
+            }
+        }
+    };
+
+#ifdef XPRESSPP_COROUTINES
+    // 🔥 C++20: handlers as coroutines
+    // app.get("/x", co([](Request &req, Response &res) -> Task {
+    //     co_await sleepFor(std::chrono::milliseconds(100));
+    //     res.json(...);
+    // }));
+    // A Task starts when awaited (or when its route runs) and can co_await
+    // other Tasks; code after co_await resumes on the thread that completed
+    // the wait (the timer thread for sleepFor).
+    class Task
+    {
+    public:
+        struct promise_type
+        {
+            std::coroutine_handle<> continuation;
+            std::exception_ptr error;
+
+            struct FinalAwaiter
+            {
+                bool await_ready() noexcept { return false; }
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> h) noexcept
+                {
+                    auto continuation = h.promise().continuation;
+                    return continuation ? continuation : std::noop_coroutine();
+                }
+                void await_resume() noexcept {}
+            };
+
+            Task get_return_object() { return Task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+            std::suspend_always initial_suspend() noexcept { return {}; }
+            FinalAwaiter final_suspend() noexcept { return {}; }
+            void return_void() {}
+            void unhandled_exception() { error = std::current_exception(); }
+        };
+
+        Task(Task &&other) noexcept : handle_(std::exchange(other.handle_, {})) {}
+        Task(const Task &) = delete;
+        Task &operator=(const Task &) = delete;
+
+        ~Task()
+        {
+            if (handle_)
+                handle_.destroy();
+        }
+
+        bool await_ready() const noexcept { return !handle_ || handle_.done(); }
+
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+        {
+            handle_.promise().continuation = awaiting;
+            return handle_;
+        }
+
+        void await_resume()
+        {
+            if (handle_ && handle_.promise().error)
+                std::rethrow_exception(handle_.promise().error);
+        }
+
+    private:
+        explicit Task(std::coroutine_handle<promise_type> handle) : handle_(handle) {}
+
+        std::coroutine_handle<promise_type> handle_;
+    };
+
+    namespace async_detail
+    {
+        // Fire-and-forget driver: owns the Task, reports to Done
+        struct Detached
+        {
+            struct promise_type
+            {
+                Detached get_return_object() { return {}; }
+                std::suspend_never initial_suspend() noexcept { return {}; }
+                std::suspend_never final_suspend() noexcept { return {}; }
+                void return_void() {}
+                void unhandled_exception() { std::terminate(); }
+            };
+        };
+
+        inline Detached drive(Task task, Done done)
+        {
+            std::exception_ptr error;
+            try
+            {
+                co_await task;
+            }
+            catch (...)
+            {
+                error = std::current_exception();
+            }
+            if (error)
+                done.fail(error);
+            else
+                done();
+        }
+    }
+
+    template <typename F>
+    AsyncHandler co(F handler)
+    {
+        return [handler = std::move(handler)](Request &req, Response &res, Done done)
+        {
+            async_detail::drive(handler(req, res), std::move(done));
+        };
+    }
+
+    struct SleepAwaiter
+    {
+        std::chrono::milliseconds delay;
+
+        bool await_ready() const noexcept { return delay.count() <= 0; }
+        void await_suspend(std::coroutine_handle<> handle)
+        {
+            TimerService::shared().after(delay, [handle]
+                                         { handle.resume(); });
+        }
+        void await_resume() noexcept {}
+    };
+
+    inline SleepAwaiter sleepFor(std::chrono::milliseconds delay)
+    {
+        return {delay};
+    }
+#endif
+}
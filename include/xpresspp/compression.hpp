@@ -0,0 +1,483 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <cstdlib>
+#include <cctype>
+#include <memory>
+
+// Codecs are opt-in like cpp-httplib's: define XPRESSPP_ZLIB_SUPPORT (-lz)
+// and/or XPRESSPP_ZSTD_SUPPORT (-lzstd). httplib's own flags imply ours.
+#if defined(CPPHTTPLIB_ZLIB_SUPPORT) && !defined(XPRESSPP_ZLIB_SUPPORT)
+#define XPRESSPP_ZLIB_SUPPORT
+#endif
+#if defined(CPPHTTPLIB_ZSTD_SUPPORT) && !defined(XPRESSPP_ZSTD_SUPPORT)
+#define XPRESSPP_ZSTD_SUPPORT
+#endif
+
+#ifdef XPRESSPP_ZLIB_SUPPORT
+#include <zlib.h>
+#endif
+#ifdef XPRESSPP_ZSTD_SUPPORT
+#include <zstd.h>
+#endif
+
+namespace xpresspp
+{
+    // 🔥 Content-Encoding produced by the compression stage
+    enum class ContentEncoding
+    {
+        Identity,
+        Gzip,
+        Deflate,
+        Zstd
+    };
+
+    // 🔥 Trained zstd dictionaries for small bodies (see zstd_dictionary.hpp)
+    // Clients opt in with the "zdict" Accept-Encoding token.
+    struct DictionaryPolicy
+    {
+        bool enabled = false;
+        size_t maxBodySize = 4 * 1024;     // bodies up to this are sampled / dictionary-compressed
+        size_t sampleCount = 256;          // samples per route before background training
+        size_t dictionarySize = 16 * 1024; // upper bound; shrinks with little sample data
+        int level = 3;
+
+        // Route template -> dictionary trained offline (`zstd --train`)
+        std::unordered_map<std::string, std::string> files;
+    };
+
+    // 🔥 When and how responses are compressed (ServerConfig::compression)
+    struct CompressionPolicy
+    {
+        size_t minSize = 1024; // buffered bodies below this go out as-is
+        int level = 6;         // gzip / deflate
+        int zstdLevel = 3;
+
+        // Content types (prefix match) compressed by default
+        std::vector<std::string> types = {
+            "text/",
+            "application/json",
+            "application/javascript",
+            "application/xml",
+            "application/xhtml+xml",
+            "application/x-ndjson",
+            "application/wasm",
+            "image/svg+xml"};
+
+        // Already-compressed entries of Response::getMimeType's table; never
+        // recompressed, even when a response forces compression on
+        std::vector<std::string> compressedTypes = {
+            "image/jpeg",
+            "image/png",
+            "image/gif",
+            "image/webp",
+            "font/woff",
+            "font/woff2",
+            "audio/mpeg",
+            "audio/ogg",
+            "video/mp4",
+            "video/webm",
+            "application/pdf",
+            "application/zip",
+            "application/gzip",
+            "application/msgpack",
+            "application/cbor"};
+
+        // Per-route override keyed by route template ("/api/users/:id")
+        std::unordered_map<std::string, bool> routes;
+
+        DictionaryPolicy dictionary;
+
+        static std::string_view mediaType(std::string_view contentType)
+        {
+            auto semi = contentType.find(';');
+            if (semi != std::string_view::npos)
+                contentType = contentType.substr(0, semi);
+            while (!contentType.empty() && contentType.back() == ' ')
+                contentType.remove_suffix(1);
+            return contentType;
+        }
+
+        bool isCompressedType(std::string_view contentType) const
+        {
+            auto mime = mediaType(contentType);
+            return std::find(compressedTypes.begin(), compressedTypes.end(), mime) != compressedTypes.end();
+        }
+
+        bool isCompressibleType(std::string_view contentType) const
+        {
+            auto mime = mediaType(contentType);
+            for (auto &prefix : types)
+            {
+                if (mime.compare(0, prefix.size(), prefix) == 0)
+                    return true;
+            }
+            return false;
+        }
+    };
+
+    namespace compression_detail
+    {
+        // Reusable encoder state. Each worker thread keeps one per codec and
+        // resets it between responses instead of re-running deflateInit2 /
+        // ZSTD_createCCtx; a nested user on the same thread gets its own.
+#ifdef XPRESSPP_ZLIB_SUPPORT
+        struct ZlibContext
+        {
+            z_stream strm{};
+            bool ready = false;
+            bool busy = false;
+            int level = 0;
+            int windowBits = 0;
+
+            ~ZlibContext()
+            {
+                if (ready)
+                    deflateEnd(&strm);
+            }
+
+            bool reset(int lvl, int bits)
+            {
+                if (ready && level == lvl && windowBits == bits)
+                    return deflateReset(&strm) == Z_OK;
+
+                if (ready)
+                    deflateEnd(&strm);
+                strm = z_stream{};
+                ready = deflateInit2(&strm, lvl, Z_DEFLATED, bits, 8, Z_DEFAULT_STRATEGY) == Z_OK;
+                level = lvl;
+                windowBits = bits;
+                return ready;
+            }
+        };
+
+        inline ZlibContext &threadZlib(bool gzip)
+        {
+            thread_local ZlibContext gzipContext, deflateContext;
+            return gzip ? gzipContext : deflateContext;
+        }
+#endif
+
+#ifdef XPRESSPP_ZSTD_SUPPORT
+        struct ZstdContext
+        {
+            ZSTD_CCtx *cctx = nullptr;
+            bool busy = false;
+
+            ~ZstdContext()
+            {
+                ZSTD_freeCCtx(cctx);
+            }
+
+            bool reset(int level)
+            {
+                if (!cctx)
+                    cctx = ZSTD_createCCtx();
+                if (!cctx)
+                    return false;
+                ZSTD_CCtx_reset(cctx, ZSTD_reset_session_only);
+                return !ZSTD_isError(ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel, level));
+            }
+        };
+
+        inline ZstdContext &threadZstd()
+        {
+            thread_local ZstdContext context;
+            return context;
+        }
+#endif
+    }
+
+    // 🔥 One compressed stream (buffered body or chunked provider output)
+    class StreamCompressor
+    {
+    public:
+        StreamCompressor(ContentEncoding encoding, const CompressionPolicy &policy)
+            : encoding_(encoding)
+        {
+            switch (encoding_)
+            {
+#ifdef XPRESSPP_ZLIB_SUPPORT
+            case ContentEncoding::Gzip:
+            case ContentEncoding::Deflate:
+            {
+                bool gzip = encoding_ == ContentEncoding::Gzip;
+                auto &shared = compression_detail::threadZlib(gzip);
+                if (shared.busy)
+                {
+                    owned_ = std::make_unique<compression_detail::ZlibContext>();
+                    zlib_ = owned_.get();
+                }
+                else
+                {
+                    zlib_ = &shared;
+                }
+                zlib_->busy = true;
+                // 15 + 16 = gzip wrapper, 15 = zlib wrapper (HTTP "deflate")
+                valid_ = zlib_->reset(policy.level, gzip ? 15 + 16 : 15);
+                break;
+            }
+#endif
+#ifdef XPRESSPP_ZSTD_SUPPORT
+            case ContentEncoding::Zstd:
+            {
+                auto &shared = compression_detail::threadZstd();
+                if (shared.busy)
+                {
+                    ownedZstd_ = std::make_unique<compression_detail::ZstdContext>();
+                    zstd_ = ownedZstd_.get();
+                }
+                else
+                {
+                    zstd_ = &shared;
+                }
+                zstd_->busy = true;
+                valid_ = zstd_->reset(policy.zstdLevel);
+                break;
+            }
+#endif
+            default:
+                (void)policy;
+                break;
+            }
+        }
+
+        ~StreamCompressor()
+        {
+#ifdef XPRESSPP_ZLIB_SUPPORT
+            if (zlib_)
+                zlib_->busy = false;
+#endif
+#ifdef XPRESSPP_ZSTD_SUPPORT
+            if (zstd_)
+                zstd_->busy = false;
+#endif
+        }
+
+        StreamCompressor(const StreamCompressor &) = delete;
+        StreamCompressor &operator=(const StreamCompressor &) = delete;
+
+        bool valid() const { return valid_; }
+
+        // Compresses and flushes, so every streamed chunk reaches the client
+        template <typename Sink>
+        bool write(const char *data, size_t length, Sink &&sink)
+        {
+            return run(data, length, false, sink);
+        }
+
+        // Ends the stream; a buffered body goes through here in one call
+        template <typename Sink>
+        bool finish(Sink &&sink)
+        {
+            return run(nullptr, 0, true, sink);
+        }
+
+        template <typename Sink>
+        bool finish(const char *data, size_t length, Sink &&sink)
+        {
+            return run(data, length, true, sink);
+        }
+
+    private:
+        static constexpr size_t chunkSize = 16 * 1024;
+
+        ContentEncoding encoding_;
+        bool valid_ = false;
+#ifdef XPRESSPP_ZLIB_SUPPORT
+        compression_detail::ZlibContext *zlib_ = nullptr;
+        std::unique_ptr<compression_detail::ZlibContext> owned_;
+#endif
+#ifdef XPRESSPP_ZSTD_SUPPORT
+        compression_detail::ZstdContext *zstd_ = nullptr;
+        std::unique_ptr<compression_detail::ZstdContext> ownedZstd_;
+#endif
+
+        template <typename Sink>
+        bool run(const char *data, size_t length, bool last, Sink &sink)
+        {
+            if (!valid_)
+                return false;
+
+            char out[chunkSize];
+
+#ifdef XPRESSPP_ZLIB_SUPPORT
+            if (zlib_)
+            {
+                auto &strm = zlib_->strm;
+                strm.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+                strm.avail_in = static_cast<uInt>(length);
+                int flush = last ? Z_FINISH : Z_SYNC_FLUSH;
+
+                int ret;
+                do
+                {
+                    strm.next_out = reinterpret_cast<Bytef *>(out);
+                    strm.avail_out = chunkSize;
+                    ret = deflate(&strm, flush);
+                    if (ret == Z_STREAM_ERROR)
+                        return valid_ = false;
+
+                    size_t produced = chunkSize - strm.avail_out;
+                    if (produced && !sink(out, produced))
+                        return valid_ = false;
+                } while (strm.avail_out == 0 || (last && ret != Z_STREAM_END));
+
+                return true;
+            }
+#endif
+
+#ifdef XPRESSPP_ZSTD_SUPPORT
+            if (zstd_)
+            {
+                ZSTD_inBuffer in = {data, length, 0};
+                ZSTD_EndDirective mode = last ? ZSTD_e_end : ZSTD_e_flush;
+
+                size_t remaining;
+                do
+                {
+                    ZSTD_outBuffer outBuf = {out, chunkSize, 0};
+                    remaining = ZSTD_compressStream2(zstd_->cctx, &outBuf, &in, mode);
+                    if (ZSTD_isError(remaining))
+                        return valid_ = false;
+
+                    if (outBuf.pos && !sink(out, outBuf.pos))
+                        return valid_ = false;
+                } while (remaining != 0 || in.pos < in.size);
+
+                return true;
+            }
+#endif
+
+            (void)out;
+            (void)data;
+            (void)length;
+            (void)last;
+            (void)sink;
+            return false;
+        }
+    };
+
+    // 🔥 Negotiation + one-shot helpers used by the server
+    namespace compression
+    {
+        inline const char *token(ContentEncoding encoding)
+        {
+            switch (encoding)
+            {
+            case ContentEncoding::Gzip:
+                return "gzip";
+            case ContentEncoding::Deflate:
+                return "deflate";
+            case ContentEncoding::Zstd:
+                return "zstd";
+            default:
+                return "identity";
+            }
+        }
+
+        inline bool supported(ContentEncoding encoding)
+        {
+            switch (encoding)
+            {
+#ifdef XPRESSPP_ZLIB_SUPPORT
+            case ContentEncoding::Gzip:
+            case ContentEncoding::Deflate:
+                return true;
+#endif
+#ifdef XPRESSPP_ZSTD_SUPPORT
+            case ContentEncoding::Zstd:
+                return true;
+#endif
+            default:
+                return false;
+            }
+        }
+
+        // q-value of one coding in an Accept-Encoding list, -1 if not listed
+        inline double qValue(const std::string &acceptEncoding, std::string_view coding)
+        {
+            size_t pos = 0;
+            while (pos < acceptEncoding.size())
+            {
+                size_t comma = acceptEncoding.find(',', pos);
+                if (comma == std::string::npos)
+                    comma = acceptEncoding.size();
+                std::string_view item(acceptEncoding.data() + pos, comma - pos);
+                pos = comma + 1;
+
+                double weight = 1.0;
+                auto semi = item.find(';');
+                if (semi != std::string_view::npos)
+                {
+                    auto qpos = item.find("q=", semi);
+                    if (qpos != std::string_view::npos)
+                        weight = std::strtod(std::string(item.substr(qpos + 2)).c_str(), nullptr);
+                    item = item.substr(0, semi);
+                }
+                while (!item.empty() && (item.front() == ' ' || item.front() == '\t'))
+                    item.remove_prefix(1);
+                while (!item.empty() && (item.back() == ' ' || item.back() == '\t'))
+                    item.remove_suffix(1);
+
+                if (item.size() == coding.size() &&
+                    std::equal(item.begin(), item.end(), coding.begin(), [](char a, char b)
+                               { return std::tolower(static_cast<unsigned char>(a)) == b; }))
+                    return weight;
+            }
+            return -1;
+        }
+
+        // Accept-Encoding with q-values; "*" covers codings not listed and
+        // q=0 rules a coding out. Ties prefer zstd, then gzip, then deflate.
+        inline ContentEncoding negotiate(const std::string &acceptEncoding)
+        {
+            static constexpr ContentEncoding order[] = {
+                ContentEncoding::Zstd, ContentEncoding::Gzip, ContentEncoding::Deflate};
+
+            double wildcard = qValue(acceptEncoding, "*");
+            ContentEncoding best = ContentEncoding::Identity;
+            double bestQ = 0;
+
+            for (auto encoding : order)
+            {
+                if (!supported(encoding))
+                    continue;
+                double weight = qValue(acceptEncoding, token(encoding));
+                if (weight < 0)
+                    weight = wildcard;
+                if (weight > bestQ)
+                {
+                    best = encoding;
+                    bestQ = weight;
+                }
+            }
+            return best;
+        }
+
+        // Compresses a whole body in place; leaves it untouched on failure
+        inline bool compressBody(ContentEncoding encoding, const CompressionPolicy &policy, std::string &body)
+        {
+            StreamCompressor compressor(encoding, policy);
+            if (!compressor.valid())
+                return false;
+
+            std::string compressed;
+            compressed.reserve(body.size() / 3 + 64);
+            auto append = [&compressed](const char *data, size_t length)
+            {
+                compressed.append(data, length);
+                return true;
+            };
+
+            if (!compressor.finish(body.data(), body.size(), append))
+                return false;
+
+            body.swap(compressed);
+            return true;
+        }
+    }
+}
@@ -0,0 +1,358 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <cstring>
+#include <cctype>
+#include <ctime>
+
+#include "simd.hpp"
+
+namespace xpresspp
+{
+    // 🔥 128-bit non-cryptographic hash (used for automatic ETags)
+    struct Hash128
+    {
+        uint64_t lo = 0;
+        uint64_t hi = 0;
+
+        bool operator==(const Hash128 &other) const { return lo == other.lo && hi == other.hi; }
+
+        std::string hex() const
+        {
+            static const char digits[] = "0123456789abcdef";
+            std::string out(32, '0');
+            for (int i = 0; i < 16; i++)
+            {
+                out[15 - i] = digits[(hi >> (i * 4)) & 0xf];
+                out[31 - i] = digits[(lo >> (i * 4)) & 0xf];
+            }
+            return out;
+        }
+    };
+
+    namespace hash_detail
+    {
+        // XXH3-style layout: 8 x 64-bit accumulators fed 64-byte stripes with
+        // a 32x32->64 multiply per lane, scrambled every 512-byte block. The
+        // scalar, SSE2 and AVX2 paths are bit-identical, so ETags do not
+        // depend on the build's instruction set.
+        alignas(64) static constexpr uint64_t secret[16] = {
+            0xc8764d7edb5586aeULL, 0x5457da22336da9d8ULL, 0x1053383ac7ec2c92ULL, 0x7513bda5dd0fc8a0ULL,
+            0xf3cb002680986de3ULL, 0xca8b43828b863916ULL, 0xd53c68db1d969e0eULL, 0xe042d32c3886b777ULL,
+            0x9e1165c60e56ecf8ULL, 0x41902d7745cbf51eULL, 0xfb5fdd8e9365339dULL, 0xecb1488cd9cf7d3cULL,
+            0xbb4e152c2f89a2adULL, 0x820e815b8a28448eULL, 0x0c91c843ec327e9cULL, 0xdd5600ca3d550f38ULL};
+
+        static constexpr uint64_t prime32 = 0x9E3779B1ULL;
+        static constexpr uint64_t prime64a = 0x9E3779B185EBCA87ULL;
+        static constexpr uint64_t prime64b = 0xC2B2AE3D27D4EB4FULL;
+        static constexpr size_t stripeSize = 64;
+        static constexpr size_t stripesPerBlock = 8;
+
+        inline uint64_t read64(const unsigned char *p)
+        {
+            uint64_t v;
+            std::memcpy(&v, p, sizeof(v));
+            return v; // little-endian hosts (x86 / ARM64)
+        }
+
+        inline uint64_t mulFold64(uint64_t a, uint64_t b)
+        {
+#if defined(__SIZEOF_INT128__)
+            __uint128_t product = static_cast<__uint128_t>(a) * b;
+            return static_cast<uint64_t>(product) ^ static_cast<uint64_t>(product >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+            uint64_t high;
+            uint64_t low = _umul128(a, b, &high);
+            return low ^ high;
+#else
+            uint64_t aLo = a & 0xffffffff, aHi = a >> 32, bLo = b & 0xffffffff, bHi = b >> 32;
+            uint64_t ll = aLo * bLo, lh = aLo * bHi, hl = aHi * bLo, hh = aHi * bHi;
+            uint64_t cross = (ll >> 32) + (lh & 0xffffffff) + hl;
+            uint64_t high = hh + (lh >> 32) + (cross >> 32);
+            uint64_t low = (cross << 32) | (ll & 0xffffffff);
+            return low ^ high;
+#endif
+        }
+
+        inline uint64_t avalanche(uint64_t h)
+        {
+            h ^= h >> 37;
+            h *= 0x165667919E3779F9ULL;
+            h ^= h >> 32;
+            return h;
+        }
+
+        inline void accumulate(uint64_t *acc, const unsigned char *p, const uint64_t *key)
+        {
+#if defined(XPRESSPP_AVX2)
+            for (int i = 0; i < 2; i++)
+            {
+                __m256i a = _mm256_loadu_si256(reinterpret_cast<__m256i *>(acc) + i);
+                __m256i data = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p) + i);
+                __m256i k = _mm256_xor_si256(data, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(key) + i));
+                __m256i product = _mm256_mul_epu32(k, _mm256_shuffle_epi32(k, _MM_SHUFFLE(0, 3, 0, 1)));
+                __m256i swapped = _mm256_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2));
+                a = _mm256_add_epi64(a, _mm256_add_epi64(product, swapped));
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(acc) + i, a);
+            }
+#elif defined(XPRESSPP_SSE2)
+            for (int i = 0; i < 4; i++)
+            {
+                __m128i a = _mm_loadu_si128(reinterpret_cast<__m128i *>(acc) + i);
+                __m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p) + i);
+                __m128i k = _mm_xor_si128(data, _mm_loadu_si128(reinterpret_cast<const __m128i *>(key) + i));
+                __m128i product = _mm_mul_epu32(k, _mm_shuffle_epi32(k, _MM_SHUFFLE(0, 3, 0, 1)));
+                __m128i swapped = _mm_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2));
+                a = _mm_add_epi64(a, _mm_add_epi64(product, swapped));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(acc) + i, a);
+            }
+#else
+            for (int i = 0; i < 8; i++)
+            {
+                uint64_t data = read64(p + i * 8);
+                uint64_t k = data ^ key[i];
+                acc[i ^ 1] += data;
+                acc[i] += (k & 0xffffffff) * (k >> 32);
+            }
+#endif
+        }
+
+        inline void scramble(uint64_t *acc)
+        {
+#if defined(XPRESSPP_AVX2)
+            const __m256i prime = _mm256_set1_epi32(static_cast<int>(prime32));
+            for (int i = 0; i < 2; i++)
+            {
+                __m256i a = _mm256_loadu_si256(reinterpret_cast<__m256i *>(acc) + i);
+                a = _mm256_xor_si256(a, _mm256_srli_epi64(a, 47));
+                a = _mm256_xor_si256(a, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(secret + 8) + i));
+                __m256i lo = _mm256_mul_epu32(a, prime);
+                __m256i hi = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), prime);
+                a = _mm256_add_epi64(lo, _mm256_slli_epi64(hi, 32));
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(acc) + i, a);
+            }
+#elif defined(XPRESSPP_SSE2)
+            const __m128i prime = _mm_set1_epi32(static_cast<int>(prime32));
+            for (int i = 0; i < 4; i++)
+            {
+                __m128i a = _mm_loadu_si128(reinterpret_cast<__m128i *>(acc) + i);
+                a = _mm_xor_si128(a, _mm_srli_epi64(a, 47));
+                a = _mm_xor_si128(a, _mm_loadu_si128(reinterpret_cast<const __m128i *>(secret + 8) + i));
+                __m128i lo = _mm_mul_epu32(a, prime);
+                __m128i hi = _mm_mul_epu32(_mm_srli_epi64(a, 32), prime);
+                a = _mm_add_epi64(lo, _mm_slli_epi64(hi, 32));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(acc) + i, a);
+            }
+#else
+            for (int i = 0; i < 8; i++)
+            {
+                uint64_t a = acc[i];
+                a ^= a >> 47;
+                a ^= secret[8 + i];
+                acc[i] = a * prime32;
+            }
+#endif
+        }
+
+        inline uint64_t merge(const uint64_t *acc, const uint64_t *key, uint64_t start)
+        {
+            uint64_t result = start;
+            for (int i = 0; i < 4; i++)
+                result += mulFold64(acc[2 * i] ^ key[2 * i], acc[2 * i + 1] ^ key[2 * i + 1]);
+            return avalanche(result);
+        }
+    }
+
+    inline Hash128 fastHash128(const void *data, size_t length)
+    {
+        using namespace hash_detail;
+
+        alignas(32) uint64_t acc[8] = {
+            0xC2B2AE3DULL, prime64a, prime64b, 0x165667B19E3779F9ULL,
+            0x85EBCA77C2B2AE63ULL, 0x85EBCA77ULL, 0x27D4EB2F165667C5ULL, prime32};
+
+        auto p = static_cast<const unsigned char *>(data);
+
+        if (length <= stripeSize)
+        {
+            // Short input: one zero-padded stripe; the length goes into the merge
+            alignas(32) unsigned char stripe[stripeSize] = {};
+            if (length)
+                std::memcpy(stripe, p, length);
+            accumulate(acc, stripe, secret);
+        }
+        else
+        {
+            size_t stripes = (length - 1) / stripeSize; // the last stripe is handled below
+            size_t n = 0;
+            for (; n + stripesPerBlock <= stripes; n += stripesPerBlock)
+            {
+                for (size_t s = 0; s < stripesPerBlock; s++)
+                    accumulate(acc, p + (n + s) * stripeSize, secret + s);
+                scramble(acc);
+            }
+            for (size_t s = 0; n + s < stripes; s++)
+                accumulate(acc, p + (n + s) * stripeSize, secret + s);
+
+            // Final (possibly overlapping) stripe ending exactly at the input end
+            accumulate(acc, p + length - stripeSize, secret + 7);
+        }
+
+        Hash128 h;
+        h.lo = merge(acc, secret, static_cast<uint64_t>(length) * prime64a);
+        h.hi = merge(acc, secret + 8, ~(static_cast<uint64_t>(length) * prime64b));
+        return h;
+    }
+
+    inline Hash128 fastHash128(std::string_view data)
+    {
+        return fastHash128(data.data(), data.size());
+    }
+
+    // 🔥 ETag / conditional request helpers (RFC 9110 §8.8.3, §13.1)
+    namespace etag
+    {
+        // Strong validator for a representation: "<128-bit hash>"
+        inline std::string strong(std::string_view body)
+        {
+            return "\"" + fastHash128(body).hex() + "\"";
+        }
+
+        // Opaque part of an entity-tag (no W/, no quotes)
+        inline std::string_view opaque(std::string_view tag, bool *weak = nullptr)
+        {
+            bool isWeak = tag.size() >= 2 && tag[0] == 'W' && tag[1] == '/';
+            if (isWeak)
+                tag.remove_prefix(2);
+            if (weak)
+                *weak = isWeak;
+            if (tag.size() >= 2 && tag.front() == '"' && tag.back() == '"')
+                tag = tag.substr(1, tag.size() - 2);
+            return tag;
+        }
+
+        // Compressed variants carry "-gzip" etc. (see the compression stage);
+        // a client holding one still validates against the base tag
+        inline std::string_view withoutEncoding(std::string_view tag)
+        {
+            for (std::string_view suffix : {"-gzip", "-deflate", "-zstd", "-zdict"})
+            {
+                if (tag.size() > suffix.size() && tag.substr(tag.size() - suffix.size()) == suffix)
+                    return tag.substr(0, tag.size() - suffix.size());
+            }
+            return tag;
+        }
+
+        // If-None-Match uses weak comparison over a list; "*" matches anything
+        inline bool noneMatch(std::string_view ifNoneMatch, std::string_view current)
+        {
+            if (current.empty())
+                return false;
+
+            auto target = withoutEncoding(opaque(current));
+            size_t pos = 0;
+            while (pos < ifNoneMatch.size())
+            {
+                size_t comma = ifNoneMatch.find(',', pos);
+                if (comma == std::string_view::npos)
+                    comma = ifNoneMatch.size();
+                auto item = ifNoneMatch.substr(pos, comma - pos);
+                pos = comma + 1;
+
+                while (!item.empty() && (item.front() == ' ' || item.front() == '\t'))
+                    item.remove_prefix(1);
+                while (!item.empty() && (item.back() == ' ' || item.back() == '\t'))
+                    item.remove_suffix(1);
+
+                if (item == "*" || (!item.empty() && withoutEncoding(opaque(item)) == target))
+                    return true;
+            }
+            return false;
+        }
+
+        // IMF-fixdate, RFC 850 and asctime formats; false if unparseable
+        inline bool parseHttpDate(std::string_view text, std::time_t &out)
+        {
+            static const char *months[] = {"jan", "feb", "mar", "apr", "may", "jun",
+                                           "jul", "aug", "sep", "oct", "nov", "dec"};
+            int day = -1, month = -1, year = -1, hh = -1, mm = -1, ss = -1;
+
+            size_t i = 0;
+            auto number = [&](int &value)
+            {
+                size_t start = i;
+                value = 0;
+                while (i < text.size() && std::isdigit(static_cast<unsigned char>(text[i])))
+                    value = value * 10 + (text[i++] - '0');
+                return i > start;
+            };
+
+            while (i < text.size())
+            {
+                unsigned char c = static_cast<unsigned char>(text[i]);
+                if (std::isalpha(c))
+                {
+                    size_t start = i;
+                    while (i < text.size() && std::isalpha(static_cast<unsigned char>(text[i])))
+                        i++;
+                    if (i - start == 3)
+                    {
+                        char name[3];
+                        for (int k = 0; k < 3; k++)
+                            name[k] = static_cast<char>(std::tolower(static_cast<unsigned char>(text[start + k])));
+                        for (int m = 0; m < 12; m++)
+                            if (std::memcmp(name, months[m], 3) == 0)
+                                month = m;
+                    }
+                }
+                else if (std::isdigit(c))
+                {
+                    int value;
+                    number(value);
+                    if (i < text.size() && text[i] == ':')
+                    {
+                        hh = value;
+                        i++;
+                        if (!number(mm) || i >= text.size() || text[i] != ':')
+                            return false;
+                        i++;
+                        if (!number(ss))
+                            return false;
+                    }
+                    else if (day < 0)
+                        day = value;
+                    else
+                        year = value;
+                }
+                else
+                    i++;
+            }
+
+            if (day < 1 || day > 31 || month < 0 || year < 0 || hh < 0 || hh > 23 || mm > 59 || ss > 60)
+                return false;
+            if (year < 100)
+                year += year < 70 ? 2000 : 1900; // RFC 850 two-digit years
+
+            // Days from civil (proleptic Gregorian, UTC)
+            int y = year - (month < 2);
+            int era = (y >= 0 ? y : y - 399) / 400;
+            int yoe = y - era * 400;
+            int mp = (month + 10) % 12;
+            int doy = (153 * mp + 2) / 5 + day - 1;
+            int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+            long long days = static_cast<long long>(era) * 146097 + doe - 719468;
+
+            out = static_cast<std::time_t>(days * 86400 + hh * 3600 + mm * 60 + ss);
+            return true;
+        }
+
+        // If-Modified-Since: unchanged when Last-Modified <= the client's date
+        inline bool notModifiedSince(std::string_view lastModified, std::string_view ifModifiedSince)
+        {
+            std::time_t modified, since;
+            return parseHttpDate(lastModified, modified) && parseHttpDate(ifModifiedSince, since) &&
+                   modified <= since;
+        }
+    }
+}
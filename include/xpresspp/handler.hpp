@@ -0,0 +1,195 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace xpresspp
+{
+    template <typename Signature, size_t Capacity = 64>
+    class InlineFunction;
+
+    // 🔥 Type-erased callable with small-buffer storage (route handlers)
+    // Any callable is accepted through the templated constructor. Ones up to
+    // Capacity bytes (lambdas capturing a few references, a shared_ptr or a
+    // string) are stored in the object itself; bigger ones go to the heap.
+    // A call is a single indirect jump into a thunk with the callable
+    // inlined; the empty state is a throwing thunk, so there is no branch.
+    // (libstdc++'s std::function stores only 16 bytes inline.)
+    template <typename R, typename... Args, size_t Capacity>
+    class InlineFunction<R(Args...), Capacity>
+    {
+    public:
+        InlineFunction() noexcept = default;
+        InlineFunction(std::nullptr_t) noexcept {}
+
+        template <typename F, typename D = std::decay_t<F>,
+                  typename = std::enable_if_t<!std::is_same<D, InlineFunction>::value &&
+                                              std::is_invocable_r<R, D &, Args...>::value>>
+        InlineFunction(F &&f)
+        {
+            if constexpr (std::is_pointer<D>::value || std::is_member_pointer<D>::value)
+            {
+                // Through a copy: F may be a function reference, never null
+                D fn = f;
+                if (!fn)
+                    return; // null function pointer = empty, like std::function
+            }
+
+            if constexpr (storedInline<D>())
+            {
+                new (storage_) D(std::forward<F>(f));
+                invoke_ = &invokeInline<D>;
+                manage_ = &manageInline<D>;
+            }
+            else
+            {
+                heapSlot() = new D(std::forward<F>(f));
+                invoke_ = &invokeHeap<D>;
+                manage_ = &manageHeap<D>;
+            }
+        }
+
+        InlineFunction(const InlineFunction &other) { copyFrom(other); }
+        InlineFunction(InlineFunction &&other) noexcept { moveFrom(other); }
+
+        InlineFunction &operator=(const InlineFunction &other)
+        {
+            if (this != &other)
+            {
+                InlineFunction copy(other);
+                reset();
+                moveFrom(copy);
+            }
+            return *this;
+        }
+
+        InlineFunction &operator=(InlineFunction &&other) noexcept
+        {
+            if (this != &other)
+            {
+                reset();
+                moveFrom(other);
+            }
+            return *this;
+        }
+
+        ~InlineFunction() { reset(); }
+
+        explicit operator bool() const noexcept { return manage_ != nullptr; }
+
+        R operator()(Args... args) const
+        {
+            return invoke_(const_cast<unsigned char *>(storage_), std::forward<Args>(args)...);
+        }
+
+        // True when a callable of type F is stored without allocating
+        template <typename F>
+        static constexpr bool storedInline()
+        {
+            return sizeof(F) <= Capacity && alignof(F) <= alignof(std::max_align_t) &&
+                   std::is_nothrow_move_constructible<F>::value;
+        }
+
+    private:
+        enum class Op
+        {
+            Copy,
+            Move, // move-construct into dst, destroy src
+            Destroy
+        };
+
+        using Invoke = R (*)(void *, Args &&...);
+        using Manage = void (*)(Op, void *src, void *dst);
+
+        alignas(std::max_align_t) unsigned char storage_[Capacity];
+        Invoke invoke_ = &invokeEmpty;
+        Manage manage_ = nullptr;
+
+        void *&heapSlot() { return *reinterpret_cast<void **>(storage_); }
+
+        static R invokeEmpty(void *, Args &&...)
+        {
+            throw std::bad_function_call();
+        }
+
+        template <typename D>
+        static R invokeInline(void *storage, Args &&...args)
+        {
+            return (*static_cast<D *>(storage))(std::forward<Args>(args)...);
+        }
+
+        template <typename D>
+        static R invokeHeap(void *storage, Args &&...args)
+        {
+            return (**static_cast<D **>(storage))(std::forward<Args>(args)...);
+        }
+
+        template <typename D>
+        static void manageInline(Op op, void *src, void *dst)
+        {
+            auto source = static_cast<D *>(src);
+            switch (op)
+            {
+            case Op::Copy:
+                new (dst) D(*source);
+                break;
+            case Op::Move:
+                new (dst) D(std::move(*source));
+                source->~D();
+                break;
+            case Op::Destroy:
+                source->~D();
+                break;
+            }
+        }
+
+        template <typename D>
+        static void manageHeap(Op op, void *src, void *dst)
+        {
+            auto source = *static_cast<D **>(src);
+            switch (op)
+            {
+            case Op::Copy:
+                *static_cast<D **>(dst) = new D(*source);
+                break;
+            case Op::Move:
+                *static_cast<D **>(dst) = source;
+                break;
+            case Op::Destroy:
+                delete source;
+                break;
+            }
+        }
+
+        void copyFrom(const InlineFunction &other)
+        {
+            if (!other.manage_)
+                return;
+            other.manage_(Op::Copy, const_cast<unsigned char *>(other.storage_), storage_);
+            invoke_ = other.invoke_;
+            manage_ = other.manage_;
+        }
+
+        void moveFrom(InlineFunction &other) noexcept
+        {
+            if (!other.manage_)
+                return;
+            other.manage_(Op::Move, other.storage_, storage_);
+            invoke_ = other.invoke_;
+            manage_ = other.manage_;
+            other.invoke_ = &invokeEmpty;
+            other.manage_ = nullptr;
+        }
+
+        void reset() noexcept
+        {
+            if (!manage_)
+                return;
+            manage_(Op::Destroy, storage_, nullptr);
+            invoke_ = &invokeEmpty;
+            manage_ = nullptr;
+        }
+    };
+}
@@ -0,0 +1,498 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace xpresspp
+{
+    // 🔥 HPACK header compression for HTTP/2 (RFC 7541)
+    namespace hpack
+    {
+        using HeaderField = std::pair<std::string, std::string>;
+        using HeaderList = std::vector<HeaderField>;
+
+        namespace hpack_detail
+        {
+            // Appendix A
+            struct StaticEntry
+            {
+                const char *name;
+                const char *value;
+            };
+
+            static constexpr StaticEntry staticTable[] = {
+                {":authority", ""}, {":method", "GET"}, {":method", "POST"}, {":path", "/"},
+                {":path", "/index.html"}, {":scheme", "http"}, {":scheme", "https"}, {":status", "200"},
+                {":status", "204"}, {":status", "206"}, {":status", "304"}, {":status", "400"},
+                {":status", "404"}, {":status", "500"}, {"accept-charset", ""},
+                {"accept-encoding", "gzip, deflate"}, {"accept-language", ""}, {"accept-ranges", ""},
+                {"accept", ""}, {"access-control-allow-origin", ""}, {"age", ""}, {"allow", ""},
+                {"authorization", ""}, {"cache-control", ""}, {"content-disposition", ""},
+                {"content-encoding", ""}, {"content-language", ""}, {"content-length", ""},
+                {"content-location", ""}, {"content-range", ""}, {"content-type", ""}, {"cookie", ""},
+                {"date", ""}, {"etag", ""}, {"expect", ""}, {"expires", ""}, {"from", ""}, {"host", ""},
+                {"if-match", ""}, {"if-modified-since", ""}, {"if-none-match", ""}, {"if-range", ""},
+                {"if-unmodified-since", ""}, {"last-modified", ""}, {"link", ""}, {"location", ""},
+                {"max-forwards", ""}, {"proxy-authenticate", ""}, {"proxy-authorization", ""},
+                {"range", ""}, {"referer", ""}, {"refresh", ""}, {"retry-after", ""}, {"server", ""},
+                {"set-cookie", ""}, {"strict-transport-security", ""}, {"transfer-encoding", ""},
+                {"user-agent", ""}, {"vary", ""}, {"via", ""}, {"www-authenticate", ""}};
+
+            static constexpr size_t staticSize = sizeof(staticTable) / sizeof(staticTable[0]);
+
+            // Appendix B, as code lengths: the code is canonical (codes of one
+            // length are consecutive in symbol order), so the lengths define it
+            static constexpr uint8_t huffmanLengths[257] = {
+                13, 23, 28, 28, 28, 28, 28, 28, 28, 24, 30, 28, 28, 30, 28, 28, // 0-15
+                28, 28, 28, 28, 28, 28, 30, 28, 28, 28, 28, 28, 28, 28, 28, 28, // 16-31
+                6, 10, 10, 12, 13, 6, 8, 11, 10, 10, 8, 11, 8, 6, 6, 6,         // ' '-'/'
+                5, 5, 5, 6, 6, 6, 6, 6, 6, 6, 7, 8, 15, 6, 12, 10,              // '0'-'?'
+                13, 6, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,                // '@'-'O'
+                7, 7, 7, 7, 7, 7, 7, 7, 8, 7, 8, 13, 19, 13, 14, 6,             // 'P'-'_'
+                15, 5, 6, 5, 6, 5, 6, 6, 6, 5, 7, 7, 6, 6, 6, 5,                // '`'-'o'
+                6, 7, 6, 5, 5, 6, 7, 7, 7, 7, 7, 15, 11, 14, 13, 28,            // 'p'-127
+                20, 22, 20, 20, 22, 22, 22, 23, 22, 23, 23, 23, 23, 23, 24, 23, // 128-143
+                24, 24, 22, 23, 24, 23, 23, 23, 23, 21, 22, 23, 22, 23, 23, 24, // 144-159
+                22, 21, 20, 22, 22, 23, 23, 21, 23, 22, 22, 24, 21, 22, 23, 23, // 160-175
+                21, 21, 22, 21, 23, 22, 23, 23, 20, 22, 22, 22, 23, 22, 22, 23, // 176-191
+                26, 26, 20, 19, 22, 23, 22, 25, 26, 26, 26, 27, 27, 26, 24, 25, // 192-207
+                19, 21, 26, 27, 27, 26, 27, 24, 21, 21, 26, 26, 28, 27, 27, 27, // 208-223
+                20, 24, 20, 21, 22, 21, 21, 23, 22, 22, 25, 25, 24, 24, 26, 23, // 224-239
+                26, 27, 26, 26, 27, 27, 27, 27, 27, 28, 27, 27, 27, 27, 27, 26, // 240-255
+                30};                                                            // EOS
+
+            static constexpr int maxCodeLength = 30;
+
+            struct HuffmanCode
+            {
+                uint32_t code[257] = {};
+                // Canonical decoding: codes of length L are firstCode[L] ...
+                // firstCode[L] + count[L] - 1, for symbols[offset[L]...]
+                uint32_t firstCode[maxCodeLength + 2] = {};
+                uint16_t count[maxCodeLength + 2] = {};
+                uint16_t offset[maxCodeLength + 2] = {};
+                uint16_t symbols[257] = {};
+
+                constexpr HuffmanCode()
+                {
+                    for (int s = 0; s < 257; s++)
+                        count[huffmanLengths[s]]++;
+
+                    uint32_t next = 0;
+                    uint16_t index = 0;
+                    for (int len = 1; len <= maxCodeLength; len++)
+                    {
+                        firstCode[len] = next;
+                        offset[len] = index;
+                        for (int s = 0; s < 257; s++)
+                        {
+                            if (huffmanLengths[s] != len)
+                                continue;
+                            code[s] = next++;
+                            symbols[index++] = static_cast<uint16_t>(s);
+                        }
+                        next <<= 1;
+                    }
+                }
+            };
+
+            static constexpr HuffmanCode huffman{};
+
+            inline size_t entrySize(std::string_view name, std::string_view value)
+            {
+                return name.size() + value.size() + 32;
+            }
+        }
+
+        // 🔥 Huffman-coded length of a string, in bytes
+        inline size_t huffmanLength(std::string_view s)
+        {
+            size_t bits = 0;
+            for (unsigned char c : s)
+                bits += hpack_detail::huffmanLengths[c];
+            return (bits + 7) / 8;
+        }
+
+        inline void huffmanEncode(std::string_view s, std::string &out)
+        {
+            using namespace hpack_detail;
+            uint64_t acc = 0;
+            int bits = 0;
+            for (unsigned char c : s)
+            {
+                acc = (acc << huffmanLengths[c]) | huffman.code[c];
+                bits += huffmanLengths[c];
+                while (bits >= 8)
+                {
+                    bits -= 8;
+                    out += static_cast<char>(acc >> bits);
+                }
+            }
+            if (bits > 0) // pad with the most significant bits of EOS (all ones)
+                out += static_cast<char>((acc << (8 - bits)) | (0xffu >> bits));
+        }
+
+        // False on an invalid code, EOS in the data or bad padding
+        inline bool huffmanDecode(std::string_view in, std::string &out)
+        {
+            using namespace hpack_detail;
+            uint32_t code = 0;
+            int len = 0;
+            for (unsigned char byte : in)
+            {
+                for (int bit = 7; bit >= 0; bit--)
+                {
+                    code = (code << 1) | ((byte >> bit) & 1);
+                    len++;
+                    if (len < 5)
+                        continue;
+                    uint32_t index = code - huffman.firstCode[len];
+                    if (code >= huffman.firstCode[len] && index < huffman.count[len])
+                    {
+                        uint16_t symbol = huffman.symbols[huffman.offset[len] + index];
+                        if (symbol == 256)
+                            return false;
+                        out += static_cast<char>(symbol);
+                        code = 0;
+                        len = 0;
+                    }
+                    else if (len == maxCodeLength)
+                    {
+                        return false;
+                    }
+                }
+            }
+            // Padding: fewer than 8 bits, all ones
+            return len < 8 && code == (1u << len) - 1;
+        }
+
+        // 🔥 Prefix-coded integers (5.1)
+        inline void encodeInteger(uint64_t value, int prefixBits, uint8_t firstByteFlags, std::string &out)
+        {
+            uint64_t max = (1u << prefixBits) - 1;
+            if (value < max)
+            {
+                out += static_cast<char>(firstByteFlags | value);
+                return;
+            }
+            out += static_cast<char>(firstByteFlags | max);
+            value -= max;
+            while (value >= 128)
+            {
+                out += static_cast<char>((value & 0x7f) | 0x80);
+                value >>= 7;
+            }
+            out += static_cast<char>(value);
+        }
+
+        inline bool decodeInteger(const uint8_t *&p, const uint8_t *end, int prefixBits, uint64_t &value)
+        {
+            if (p == end)
+                return false;
+            uint64_t max = (1u << prefixBits) - 1;
+            value = *p++ & max;
+            if (value < max)
+                return true;
+            for (int shift = 0; p < end; shift += 7)
+            {
+                if (shift > 56)
+                    return false;
+                uint8_t b = *p++;
+                value += static_cast<uint64_t>(b & 0x7f) << shift;
+                if (!(b & 0x80))
+                    return true;
+            }
+            return false;
+        }
+
+        // 🔥 Dynamic table (2.3.2): newest entry first, bounded by octet size
+        class DynamicTable
+        {
+        public:
+            explicit DynamicTable(size_t maxSize = 4096) : maxSize_(maxSize) {}
+
+            size_t size() const { return size_; }
+            size_t maxSize() const { return maxSize_; }
+            size_t count() const { return entries_.size(); }
+            const HeaderField &at(size_t i) const { return entries_[i]; }
+
+            void setMaxSize(size_t maxSize)
+            {
+                maxSize_ = maxSize;
+                evict(0);
+            }
+
+            void add(std::string name, std::string value)
+            {
+                size_t needed = hpack_detail::entrySize(name, value);
+                evict(needed);
+                if (needed > maxSize_)
+                    return; // too big: the table is now empty (4.4)
+                size_ += needed;
+                entries_.emplace_front(std::move(name), std::move(value));
+            }
+
+        private:
+            std::deque<HeaderField> entries_;
+            size_t size_ = 0;
+            size_t maxSize_;
+
+            void evict(size_t incoming)
+            {
+                while (!entries_.empty() && size_ + incoming > maxSize_)
+                {
+                    size_ -= hpack_detail::entrySize(entries_.back().first, entries_.back().second);
+                    entries_.pop_back();
+                }
+            }
+        };
+
+        // 🔥 Header block encoder (one per connection direction)
+        // Exact matches are sent as an index. Other fields are added to the
+        // dynamic table, except values that change on every response (sent
+        // without indexing) and credentials (never indexed). Strings are
+        // Huffman-coded when that is shorter.
+        class Encoder
+        {
+        public:
+            // The peer's SETTINGS_HEADER_TABLE_SIZE
+            void setMaxTableSize(size_t size)
+            {
+                size_t capped = std::min(size, maxTableSize);
+                if (capped == table_.maxSize())
+                    return;
+                table_.setMaxSize(capped);
+                pendingSizeUpdate_ = true;
+            }
+
+            void encode(const HeaderList &headers, std::string &out)
+            {
+                if (pendingSizeUpdate_)
+                {
+                    encodeInteger(table_.maxSize(), 5, 0x20, out);
+                    pendingSizeUpdate_ = false;
+                }
+                for (auto &h : headers)
+                    encodeField(h.first, h.second, out);
+            }
+
+            void encodeField(const std::string &name, const std::string &value, std::string &out)
+            {
+                size_t nameIndex = 0;
+                size_t index = find(name, value, nameIndex);
+                if (index)
+                {
+                    encodeInteger(index, 7, 0x80, out);
+                    return;
+                }
+
+                Indexing mode = indexing(name);
+                if (mode == Indexing::Incremental)
+                    encodeInteger(nameIndex, 6, 0x40, out);
+                else
+                    encodeInteger(nameIndex, 4, mode == Indexing::Never ? 0x10 : 0x00, out);
+                if (!nameIndex)
+                    encodeString(name, out);
+                encodeString(value, out);
+
+                if (mode == Indexing::Incremental)
+                    table_.add(name, value);
+            }
+
+        private:
+            static constexpr size_t maxTableSize = 4096; // our own memory bound
+
+            enum class Indexing
+            {
+                Incremental,
+                None,
+                Never
+            };
+
+            DynamicTable table_{maxTableSize};
+            bool pendingSizeUpdate_ = false;
+
+            static Indexing indexing(const std::string &name)
+            {
+                static const std::unordered_map<std::string, Indexing> special = {
+                    {"authorization", Indexing::Never}, {"proxy-authorization", Indexing::Never},
+                    {"set-cookie", Indexing::Never}, {"cookie", Indexing::Never},
+                    {"content-length", Indexing::None}, {"etag", Indexing::None},
+                    {"age", Indexing::None}, {"date", Indexing::None},
+                    {"last-modified", Indexing::None}, {"x-request-id", Indexing::None},
+                    {"x-response-time", Indexing::None}, {"server-timing", Indexing::None},
+                    {"x-ratelimit-remaining", Indexing::None}, {"x-ratelimit-reset", Indexing::None},
+                    {":path", Indexing::None}};
+                auto it = special.find(name);
+                return it == special.end() ? Indexing::Incremental : it->second;
+            }
+
+            // Full match index, else 0 with nameIndex set to any name match
+            size_t find(const std::string &name, const std::string &value, size_t &nameIndex) const
+            {
+                using namespace hpack_detail;
+                static const std::unordered_multimap<std::string_view, size_t> names = []
+                {
+                    std::unordered_multimap<std::string_view, size_t> m;
+                    for (size_t i = 0; i < staticSize; i++)
+                        m.emplace(staticTable[i].name, i + 1);
+                    return m;
+                }();
+
+                auto range = names.equal_range(name);
+                for (auto it = range.first; it != range.second; ++it)
+                {
+                    if (staticTable[it->second - 1].value == value)
+                        return it->second;
+                    if (!nameIndex || it->second < nameIndex)
+                        nameIndex = it->second;
+                }
+
+                for (size_t i = 0; i < table_.count(); i++)
+                {
+                    auto &entry = table_.at(i);
+                    if (entry.first != name)
+                        continue;
+                    if (entry.second == value)
+                        return staticSize + 1 + i;
+                    if (!nameIndex)
+                        nameIndex = staticSize + 1 + i;
+                }
+                return 0;
+            }
+
+            static void encodeString(const std::string &s, std::string &out)
+            {
+                size_t huffmanSize = huffmanLength(s);
+                if (huffmanSize < s.size())
+                {
+                    encodeInteger(huffmanSize, 7, 0x80, out);
+                    huffmanEncode(s, out);
+                }
+                else
+                {
+                    encodeInteger(s.size(), 7, 0x00, out);
+                    out += s;
+                }
+            }
+        };
+
+        // 🔥 Header block decoder
+        class Decoder
+        {
+        public:
+            // SETTINGS_HEADER_TABLE_SIZE we advertised: the peer may not exceed it
+            explicit Decoder(size_t maxTableSize = 4096)
+                : table_(maxTableSize), settingsLimit_(maxTableSize) {}
+
+            // False on a malformed block: a COMPRESSION_ERROR for the connection.
+            // Fields beyond maxListSize (RFC 9113 size: name + value + 32 each)
+            // are decoded but dropped, with tooLarge set.
+            bool decode(std::string_view block, HeaderList &headers, size_t maxListSize, bool &tooLarge)
+            {
+                auto p = reinterpret_cast<const uint8_t *>(block.data());
+                auto end = p + block.size();
+                size_t listSize = 0;
+                bool fieldSeen = false;
+                tooLarge = false;
+
+                while (p < end)
+                {
+                    uint8_t b = *p;
+                    std::string name, value;
+
+                    if (b & 0x80) // indexed field
+                    {
+                        uint64_t index;
+                        if (!decodeInteger(p, end, 7, index) || !lookup(index, name, value))
+                            return false;
+                    }
+                    else if ((b & 0xe0) == 0x20) // dynamic table size update
+                    {
+                        uint64_t size;
+                        if (fieldSeen || !decodeInteger(p, end, 5, size) || size > settingsLimit_)
+                            return false;
+                        table_.setMaxSize(static_cast<size_t>(size));
+                        continue;
+                    }
+                    else // literal: incremental (01), without (0000) or never (0001) indexing
+                    {
+                        bool incremental = (b & 0xc0) == 0x40;
+                        uint64_t index;
+                        if (!decodeInteger(p, end, incremental ? 6 : 4, index))
+                            return false;
+                        if (index)
+                        {
+                            std::string ignored;
+                            if (!lookup(index, name, ignored))
+                                return false;
+                        }
+                        else if (!decodeString(p, end, name))
+                        {
+                            return false;
+                        }
+                        if (!decodeString(p, end, value))
+                            return false;
+                        if (incremental)
+                            table_.add(name, value);
+                    }
+
+                    fieldSeen = true;
+                    listSize += hpack_detail::entrySize(name, value);
+                    if (listSize > maxListSize)
+                        tooLarge = true;
+                    else
+                        headers.emplace_back(std::move(name), std::move(value));
+                }
+                return true;
+            }
+
+        private:
+            DynamicTable table_;
+            size_t settingsLimit_;
+
+            bool lookup(uint64_t index, std::string &name, std::string &value) const
+            {
+                using namespace hpack_detail;
+                if (index == 0)
+                    return false;
+                if (index <= staticSize)
+                {
+                    name = staticTable[index - 1].name;
+                    value = staticTable[index - 1].value;
+                    return true;
+                }
+                index -= staticSize + 1;
+                if (index >= table_.count())
+                    return false;
+                name = table_.at(index).first;
+                value = table_.at(index).second;
+                return true;
+            }
+
+            static bool decodeString(const uint8_t *&p, const uint8_t *end, std::string &out)
+            {
+                if (p == end)
+                    return false;
+                bool huffman = *p & 0x80;
+                uint64_t length;
+                if (!decodeInteger(p, end, 7, length) || length > static_cast<uint64_t>(end - p))
+                    return false;
+                std::string_view raw(reinterpret_cast<const char *>(p), static_cast<size_t>(length));
+                p += length;
+                if (!huffman)
+                {
+                    out.assign(raw.data(), raw.size());
+                    return true;
+                }
+                out.reserve(raw.size() * 8 / 5);
+                return huffmanDecode(raw, out);
+            }
+        };
+    }
+}
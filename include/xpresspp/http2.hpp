@@ -0,0 +1,1884 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "hpack.hpp"
+#include "httplib.h"
+
+namespace xpresspp
+{
+    // 🔥 HTTP/2 over cleartext TCP (RFC 9113): h2c upgrade and prior knowledge
+    // Every stream of a connection becomes its own HTTP/1.1 exchange for
+    // httplib (see ServerStream), dispatched as a separate task, so one slow
+    // route no longer holds up the requests behind it.
+    namespace http2
+    {
+        namespace frame
+        {
+            constexpr uint8_t data = 0x0;
+            constexpr uint8_t headers = 0x1;
+            constexpr uint8_t priority = 0x2;
+            constexpr uint8_t rstStream = 0x3;
+            constexpr uint8_t settings = 0x4;
+            constexpr uint8_t pushPromise = 0x5;
+            constexpr uint8_t ping = 0x6;
+            constexpr uint8_t goaway = 0x7;
+            constexpr uint8_t windowUpdate = 0x8;
+            constexpr uint8_t continuation = 0x9;
+
+            constexpr size_t headerSize = 9;
+        }
+
+        namespace flag
+        {
+            constexpr uint8_t endStream = 0x1;
+            constexpr uint8_t ack = 0x1;
+            constexpr uint8_t endHeaders = 0x4;
+            constexpr uint8_t padded = 0x8;
+            constexpr uint8_t priority = 0x20;
+        }
+
+        namespace setting
+        {
+            constexpr uint16_t headerTableSize = 0x1;
+            constexpr uint16_t enablePush = 0x2;
+            constexpr uint16_t maxConcurrentStreams = 0x3;
+            constexpr uint16_t initialWindowSize = 0x4;
+            constexpr uint16_t maxFrameSize = 0x5;
+            constexpr uint16_t maxHeaderListSize = 0x6;
+        }
+
+        enum class ErrorCode : uint32_t
+        {
+            NoError = 0x0,
+            ProtocolError = 0x1,
+            InternalError = 0x2,
+            FlowControlError = 0x3,
+            StreamClosed = 0x5,
+            FrameSizeError = 0x6,
+            RefusedStream = 0x7,
+            Cancel = 0x8,
+            CompressionError = 0x9,
+            EnhanceYourCalm = 0xb
+        };
+
+        constexpr std::string_view clientPreface{"PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n", 24};
+        constexpr uint32_t defaultWindowSize = 65535;
+        constexpr uint32_t defaultMaxFrameSize = 16384;
+        constexpr int64_t maxWindowSize = 0x7fffffff;
+
+        struct Options
+        {
+            uint32_t maxConcurrentStreams = 100;
+            uint32_t initialWindowSize = 256 * 1024;           // per stream, request bodies
+            uint32_t connectionWindowSize = 16 * 1024 * 1024;
+            size_t maxHeaderListSize = 16 * 1024;              // larger request heads get 431
+            time_t idleTimeoutSec = 60;                        // no open streams: GOAWAY
+            time_t readTimeoutSec = 30;                        // a handler waiting for body bytes
+            time_t writeTimeoutSec = 30;                       // a handler waiting for window
+        };
+
+        namespace http2_detail
+        {
+            inline void putUint16(std::string &out, uint16_t v)
+            {
+                out += static_cast<char>(v >> 8);
+                out += static_cast<char>(v);
+            }
+
+            inline void putUint32(std::string &out, uint32_t v)
+            {
+                out += static_cast<char>(v >> 24);
+                out += static_cast<char>(v >> 16);
+                out += static_cast<char>(v >> 8);
+                out += static_cast<char>(v);
+            }
+
+            inline uint32_t getUint32(const uint8_t *p)
+            {
+                return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | p[3];
+            }
+
+            inline void appendFrameHeader(std::string &out, size_t length, uint8_t type, uint8_t flags,
+                                          uint32_t streamId)
+            {
+                out += static_cast<char>(length >> 16);
+                out += static_cast<char>(length >> 8);
+                out += static_cast<char>(length);
+                out += static_cast<char>(type);
+                out += static_cast<char>(flags);
+                putUint32(out, streamId & 0x7fffffff);
+            }
+
+            inline void appendFrame(std::string &out, uint8_t type, uint8_t flags, uint32_t streamId,
+                                    std::string_view payload = {})
+            {
+                appendFrameHeader(out, payload.size(), type, flags, streamId);
+                out.append(payload.data(), payload.size());
+            }
+
+            inline void appendWindowUpdate(std::string &out, uint32_t streamId, uint32_t increment)
+            {
+                appendFrameHeader(out, 4, frame::windowUpdate, 0, streamId);
+                putUint32(out, increment);
+            }
+
+            inline void appendRstStream(std::string &out, uint32_t streamId, ErrorCode code)
+            {
+                appendFrameHeader(out, 4, frame::rstStream, 0, streamId);
+                putUint32(out, static_cast<uint32_t>(code));
+            }
+
+            // A header block as HEADERS + CONTINUATION frames of at most maxFrame bytes
+            inline void appendHeaderBlock(std::string &out, uint32_t streamId, std::string_view block,
+                                          bool endStream, size_t maxFrame)
+            {
+                uint8_t type = frame::headers;
+                uint8_t flags = endStream ? flag::endStream : 0;
+                do
+                {
+                    auto n = std::min(block.size(), maxFrame);
+                    appendFrame(out, type, flags | (n == block.size() ? flag::endHeaders : 0), streamId,
+                                block.substr(0, n));
+                    block.remove_prefix(n);
+                    type = frame::continuation;
+                    flags = 0;
+                } while (!block.empty());
+            }
+
+            inline bool writeAll(httplib::Stream &strm, const char *p, size_t n)
+            {
+                while (n > 0)
+                {
+                    auto written = strm.write(p, n);
+                    if (written <= 0)
+                        return false;
+                    p += written;
+                    n -= static_cast<size_t>(written);
+                }
+                return true;
+            }
+
+            // HTTP2-Settings carries a SETTINGS payload as unpadded base64url
+            inline bool base64UrlDecode(std::string_view in, std::string &out)
+            {
+                uint32_t acc = 0;
+                int bits = 0;
+                for (char c : in)
+                {
+                    int v;
+                    if (c >= 'A' && c <= 'Z')
+                        v = c - 'A';
+                    else if (c >= 'a' && c <= 'z')
+                        v = c - 'a' + 26;
+                    else if (c >= '0' && c <= '9')
+                        v = c - '0' + 52;
+                    else if (c == '-' || c == '+')
+                        v = 62;
+                    else if (c == '_' || c == '/')
+                        v = 63;
+                    else if (c == '=')
+                        break;
+                    else
+                        return false;
+                    acc = (acc << 6) | static_cast<uint32_t>(v);
+                    bits += 6;
+                    if (bits >= 8)
+                    {
+                        bits -= 8;
+                        out += static_cast<char>(acc >> bits);
+                    }
+                }
+                return true;
+            }
+
+            // content-type -> Content-Type, for code that looks headers up by
+            // their usual spelling
+            inline void appendTitleCase(std::string &out, std::string_view name)
+            {
+                bool upper = true;
+                for (char c : name)
+                {
+                    out += upper && c >= 'a' && c <= 'z' ? static_cast<char>(c - 32) : c;
+                    upper = c == '-';
+                }
+            }
+
+            inline bool hasToken(const std::string &list, std::string_view token)
+            {
+                size_t pos = 0;
+                while (pos <= list.size())
+                {
+                    auto end = list.find(',', pos);
+                    if (end == std::string::npos)
+                        end = list.size();
+                    auto item = std::string_view(list).substr(pos, end - pos);
+                    while (!item.empty() && (item.front() == ' ' || item.front() == '\t'))
+                        item.remove_prefix(1);
+                    while (!item.empty() && (item.back() == ' ' || item.back() == '\t'))
+                        item.remove_suffix(1);
+                    if (item.size() == token.size() &&
+                        httplib::detail::case_ignore::equal(std::string(item), std::string(token)))
+                        return true;
+                    pos = end + 1;
+                }
+                return false;
+            }
+
+            // Hop-by-hop fields: meaningless (and forbidden) inside HTTP/2
+            inline bool isConnectionSpecific(std::string_view lowerName)
+            {
+                return lowerName == "connection" || lowerName == "keep-alive" ||
+                       lowerName == "proxy-connection" || lowerName == "transfer-encoding" ||
+                       lowerName == "upgrade" || lowerName == "http2-settings" || lowerName == "te";
+            }
+
+            inline std::string toLower(std::string_view s)
+            {
+                std::string out(s);
+                for (auto &c : out)
+                    if (c >= 'A' && c <= 'Z')
+                        c = static_cast<char>(c + 32);
+                return out;
+            }
+        }
+
+        // "PRI * HTTP/2.0" followed by an empty header section: the start of
+        // the connection preface, "SM\r\n\r\n" is still to come
+        inline bool isPriorKnowledge(const httplib::Request &req)
+        {
+            return req.method == "PRI" && req.target == "*" && req.version == "HTTP/2.0" &&
+                   req.headers.empty();
+        }
+
+        // An HTTP/1.1 request asking to continue in h2c. Requests with a body
+        // are served over HTTP/1.1 instead (the upgrade is optional).
+        inline bool isUpgrade(const httplib::Request &req)
+        {
+            if (req.version != "HTTP/1.1" || req.get_header_value_count("HTTP2-Settings") != 1 ||
+                !http2_detail::hasToken(req.get_header_value("Upgrade"), "h2c"))
+                return false;
+            auto length = req.get_header_value("Content-Length");
+            return !req.has_header("Transfer-Encoding") && (length.empty() || length == "0");
+        }
+
+        class ServerConnection;
+
+        // 🔥 One HTTP/2 stream seen by httplib as an HTTP/1.1 connection
+        // Reading yields the request as HTTP/1.1 bytes: a head built from the
+        // decoded header block, then the DATA payloads (chunk-encoded when the
+        // length is unknown). What httplib writes back is parsed as an
+        // HTTP/1.1 response and sent as HEADERS and DATA frames, within the
+        // flow-control windows. Writes are collected until the stream blocks,
+        // finishes or streams (batching off): a small response is one write
+        // holding HEADERS + DATA.
+        class ServerStream final : public httplib::Stream
+        {
+        public:
+            ServerStream(ServerConnection &conn, uint32_t id, std::string head, bool chunkedBody,
+                         bool endStream, bool headRequest, int64_t recvWindow)
+                : conn_(conn), id_(id), chunkedBody_(chunkedBody), headRequest_(headRequest),
+                  incoming_(std::move(head)), remoteClosed_(endStream), recvWindow_(recvWindow) {}
+
+            // httplib::Stream
+            bool is_readable() const override { return bufferPos_ < buffer_.size(); }
+            bool wait_readable() const override { return true; } // read() waits itself
+            bool wait_writable() const override;
+            ssize_t read(char *ptr, size_t size) override;
+            ssize_t write(const char *ptr, size_t size) override;
+            void get_remote_ip_and_port(std::string &ip, int &port) const override;
+            void get_local_ip_and_port(std::string &ip, int &port) const override;
+            socket_t socket() const override;
+            time_t duration() const override;
+
+            bool has_read_buffer() const override { return true; }
+            ssize_t fill_read_buffer(size_t max_size) override;
+            const char *read_buffer_data() const override { return buffer_.data() + bufferPos_; }
+            size_t read_buffer_size() const override { return buffer_.size() - bufferPos_; }
+            void consume_read_buffer(size_t n) override { bufferPos_ += n; }
+
+            bool set_write_batching(bool on) override
+            {
+                batching_ = on;
+                return on || flush();
+            }
+            bool flush_writes() override { return flush(); }
+            bool is_http2() const override { return true; }
+
+            uint32_t id() const { return id_; }
+
+        private:
+            friend class ServerConnection;
+
+            enum class Output
+            {
+                Head,    // response head not complete yet
+                Length,  // Content-Length body
+                Chunked, // decoding chunked framing
+                Raw,     // body runs until the handler finishes
+                Done
+            };
+
+            enum class Chunk
+            {
+                Size,
+                Data,
+                DataEnd,
+                Trailers
+            };
+
+            struct PendingHeaders
+            {
+                hpack::HeaderList fields;
+                bool endStream;
+            };
+
+            ServerConnection &conn_;
+            const uint32_t id_;
+            const bool chunkedBody_;
+            const bool headRequest_;
+
+            // Input: the reader thread appends to incoming_, the handler
+            // moves it into buffer_ (which only it touches)
+            std::mutex mutex_;
+            std::condition_variable cv_;
+            std::string incoming_;
+            size_t incomingCredit_ = 0; // DATA bytes in incoming_, not yet given back
+            bool remoteClosed_;
+            int64_t recvWindow_;
+            std::atomic<bool> reset_{false};
+
+            std::string buffer_;
+            size_t bufferPos_ = 0;
+            size_t unackedCredit_ = 0;
+
+            // Output (handler thread only, except sendWindow_: stateMutex_)
+            int64_t sendWindow_ = 0;
+            Output output_ = Output::Head;
+            Chunk chunk_ = Chunk::Size;
+            std::string head_;  // partial response head or chunk-size line
+            uint64_t remaining_ = 0;
+            bool endSent_ = false;
+            bool released_ = false; // no longer counted against maxConcurrentStreams
+            bool batching_ = true;
+            std::vector<PendingHeaders> pendingHeaders_;
+            std::string pendingData_;
+
+            // Reader thread: false when the peer overran the stream window
+            bool push(const char *data, size_t length, size_t flowLength, bool endStream)
+            {
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    recvWindow_ -= static_cast<int64_t>(flowLength);
+                    if (recvWindow_ < 0)
+                        return false;
+                    if (chunkedBody_ && length > 0)
+                    {
+                        char size[20];
+                        int n = snprintf(size, sizeof(size), "%zx\r\n", length);
+                        incoming_.append(size, static_cast<size_t>(n));
+                        incoming_.append(data, length);
+                        incoming_ += "\r\n";
+                    }
+                    else
+                    {
+                        incoming_.append(data, length);
+                    }
+                    if (endStream)
+                    {
+                        if (chunkedBody_)
+                            incoming_ += "0\r\n\r\n";
+                        remoteClosed_ = true;
+                    }
+                    incomingCredit_ += flowLength;
+                }
+                cv_.notify_one();
+                return true;
+            }
+
+            void abort()
+            {
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    reset_ = true;
+                }
+                cv_.notify_one();
+            }
+
+            bool remoteClosed()
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                return remoteClosed_;
+            }
+
+            ssize_t pull();
+            bool writeResponse(const char *p, size_t n);
+            bool parseHead(const std::string &head, int &status, hpack::HeaderList &fields, Output &next);
+            bool sendData(const char *p, size_t n, bool endStream);
+            bool flush();
+            void finish();
+        };
+
+        // 🔥 Server side of one HTTP/2 connection
+        // The thread that accepted the connection reads and answers frames;
+        // each request stream runs dispatch() on a task from enqueue().
+        // Frame writes are serialised (and HPACK-encoded) under writeMutex_.
+        class ServerConnection
+        {
+        public:
+            using Dispatch = std::function<bool(httplib::Stream &)>;
+            using Enqueue = std::function<bool(std::function<void()>)>;
+
+            ServerConnection(httplib::Stream &conn, Dispatch dispatch, Enqueue enqueue, Options options = {})
+                : conn_(conn), dispatch_(std::move(dispatch)), enqueue_(std::move(enqueue)), options_(options),
+                  decoder_(4096), connRecvWindow_(options.connectionWindowSize) {}
+
+            ServerConnection(const ServerConnection &) = delete;
+            ServerConnection &operator=(const ServerConnection &) = delete;
+
+            // Serves the connection until it closes. req started it: the
+            // prior-knowledge preface (isPriorKnowledge) or an Upgrade: h2c
+            // request (isUpgrade), which becomes stream 1.
+            void run(const httplib::Request &req)
+            {
+                conn_.set_write_batching(false); // frames are written whole, under writeMutex_
+                lastActivity_ = std::chrono::steady_clock::now();
+
+                std::string out;
+                size_t prefaceLeft = clientPreface.size() - 18; // "SM\r\n\r\n"
+                if (!isPriorKnowledge(req))
+                {
+                    std::string settings;
+                    if (!http2_detail::base64UrlDecode(req.get_header_value("HTTP2-Settings"), settings) ||
+                        !applySettings(reinterpret_cast<const uint8_t *>(settings.data()), settings.size()))
+                        return;
+                    out = "HTTP/1.1 101 Switching Protocols\r\nConnection: Upgrade\r\nUpgrade: h2c\r\n\r\n";
+                    prefaceLeft = clientPreface.size();
+                }
+                appendServerPreface(out);
+                if (!send(out))
+                    return;
+                started_ = true;
+                if (draining_)
+                    goaway(ErrorCode::NoError);
+
+                if (!isPriorKnowledge(req))
+                    openUpgradeStream(req);
+
+                // The rest of the client preface
+                if (fill(prefaceLeft) &&
+                    std::string_view(conn_.read_buffer_data(), prefaceLeft) ==
+                        clientPreface.substr(clientPreface.size() - prefaceLeft))
+                {
+                    conn_.consume_read_buffer(prefaceLeft);
+                    serve();
+                }
+                shutdown();
+            }
+
+            // Graceful stop, from any thread: GOAWAY sends new requests
+            // elsewhere, streams already open finish, then the connection
+            // closes
+            void drain()
+            {
+                if (draining_.exchange(true))
+                    return;
+                if (started_)
+                    goaway(ErrorCode::NoError);
+                closeIfDrained();
+            }
+
+        private:
+            friend class ServerStream;
+
+            static constexpr size_t readBufferSize = 64 * 1024;
+
+            httplib::Stream &conn_;
+            Dispatch dispatch_;
+            Enqueue enqueue_;
+            const Options options_;
+
+            std::mutex writeMutex_;
+            hpack::Encoder encoder_; // writeMutex_: blocks are encoded in send order
+
+            std::mutex stateMutex_;
+            std::condition_variable windowCv_;
+            std::condition_variable drainedCv_;
+            std::unordered_map<uint32_t, std::shared_ptr<ServerStream>> streams_;
+            size_t running_ = 0; // stream tasks not finished
+            size_t open_ = 0;    // streams whose END_STREAM (or RST) is not written yet
+            int64_t connSendWindow_ = defaultWindowSize;
+            int64_t peerInitialWindow_ = defaultWindowSize;
+            size_t peerMaxFrameSize_ = defaultMaxFrameSize;
+            std::atomic<bool> dead_{false};
+            std::atomic<bool> started_{false};  // server preface written
+            std::atomic<bool> draining_{false};
+            std::atomic<uint32_t> lastStreamId_{0}; // written by the reader, read by drain()
+
+            // Reader thread only
+            hpack::Decoder decoder_;
+            int64_t connRecvWindow_;
+            size_t connUnacked_ = 0;
+            uint32_t continuationStream_ = 0;
+            bool continuationEnd_ = false;
+            std::string headerBlock_;
+            std::chrono::steady_clock::time_point lastActivity_;
+
+            void appendServerPreface(std::string &out) const
+            {
+                using namespace http2_detail;
+                appendFrameHeader(out, 18, frame::settings, 0, 0);
+                putUint16(out, setting::maxConcurrentStreams);
+                putUint32(out, options_.maxConcurrentStreams);
+                putUint16(out, setting::initialWindowSize);
+                putUint32(out, options_.initialWindowSize);
+                putUint16(out, setting::maxHeaderListSize);
+                putUint32(out, static_cast<uint32_t>(options_.maxHeaderListSize));
+                if (options_.connectionWindowSize > defaultWindowSize)
+                    appendWindowUpdate(out, 0, options_.connectionWindowSize - defaultWindowSize);
+            }
+
+            bool send(const std::string &frames)
+            {
+                if (dead_)
+                    return false;
+                std::lock_guard<std::mutex> lock(writeMutex_);
+                if (!http2_detail::writeAll(conn_, frames.data(), frames.size()))
+                {
+                    dead_ = true;
+                    return false;
+                }
+                return true;
+            }
+
+            void resetStream(uint32_t id, ErrorCode code)
+            {
+                std::string out;
+                http2_detail::appendRstStream(out, id, code);
+                send(out);
+            }
+
+            void goaway(ErrorCode code)
+            {
+                std::string out;
+                http2_detail::appendFrameHeader(out, 8, frame::goaway, 0, 0);
+                http2_detail::putUint32(out, lastStreamId_);
+                http2_detail::putUint32(out, static_cast<uint32_t>(code));
+                send(out);
+            }
+
+            // Until at least `needed` bytes are buffered. False when the
+            // connection closed, failed or sat idle with no open stream.
+            bool fill(size_t needed)
+            {
+                while (conn_.read_buffer_size() < needed)
+                {
+                    if (dead_)
+                        return false;
+                    auto n = conn_.fill_read_buffer(std::max(needed, readBufferSize));
+                    if (n > 0)
+                    {
+                        lastActivity_ = std::chrono::steady_clock::now();
+                        continue;
+                    }
+                    if (n == 0 || !httplib::detail::is_socket_alive(conn_.socket()))
+                        return false;
+
+                    // Read timeout: only an idle connection is closed
+                    bool idle;
+                    {
+                        std::lock_guard<std::mutex> lock(stateMutex_);
+                        idle = streams_.empty();
+                    }
+                    if (idle && std::chrono::steady_clock::now() - lastActivity_ >=
+                                    std::chrono::seconds(options_.idleTimeoutSec))
+                    {
+                        goaway(ErrorCode::NoError);
+                        return false;
+                    }
+                }
+                return true;
+            }
+
+            void serve()
+            {
+                for (;;)
+                {
+                    if (!fill(frame::headerSize))
+                        return;
+                    auto p = reinterpret_cast<const uint8_t *>(conn_.read_buffer_data());
+                    size_t length = (size_t(p[0]) << 16) | (size_t(p[1]) << 8) | p[2];
+                    uint8_t type = p[3];
+                    uint8_t flags = p[4];
+                    uint32_t streamId = http2_detail::getUint32(p + 5) & 0x7fffffff;
+
+                    if (length > defaultMaxFrameSize) // we never raise SETTINGS_MAX_FRAME_SIZE
+                        return goaway(ErrorCode::FrameSizeError);
+                    if (!fill(frame::headerSize + length))
+                        return;
+                    p = reinterpret_cast<const uint8_t *>(conn_.read_buffer_data()) + frame::headerSize;
+
+                    auto error = handleFrame(type, flags, streamId, p, length);
+                    conn_.consume_read_buffer(frame::headerSize + length);
+                    if (error != ErrorCode::NoError)
+                        return goaway(error);
+                    if (dead_)
+                        return;
+                }
+            }
+
+            // NoError, or a connection error to end with
+            ErrorCode handleFrame(uint8_t type, uint8_t flags, uint32_t streamId, const uint8_t *p, size_t length)
+            {
+                if (continuationStream_ && (type != frame::continuation || streamId != continuationStream_))
+                    return ErrorCode::ProtocolError;
+
+                switch (type)
+                {
+                case frame::data:
+                    return onData(flags, streamId, p, length);
+                case frame::headers:
+                    return onHeaders(flags, streamId, p, length);
+                case frame::continuation:
+                    if (!continuationStream_)
+                        return ErrorCode::ProtocolError;
+                    headerBlock_.append(reinterpret_cast<const char *>(p), length);
+                    if (headerBlock_.size() > options_.maxHeaderListSize * 2 + 4096)
+                        return ErrorCode::EnhanceYourCalm;
+                    if (flags & flag::endHeaders)
+                    {
+                        continuationStream_ = 0;
+                        return onHeaderBlock(streamId, continuationEnd_);
+                    }
+                    return ErrorCode::NoError;
+                case frame::priority:
+                    return streamId == 0 || length != 5 ? ErrorCode::ProtocolError : ErrorCode::NoError;
+                case frame::rstStream:
+                    if (streamId == 0 || length != 4)
+                        return ErrorCode::ProtocolError;
+                    if (auto stream = find(streamId))
+                        cancel(*stream);
+                    return ErrorCode::NoError;
+                case frame::settings:
+                    if (streamId != 0 || length % 6 != 0 || ((flags & flag::ack) && length != 0))
+                        return ErrorCode::ProtocolError;
+                    if (flags & flag::ack)
+                        return ErrorCode::NoError;
+                    if (!applySettings(p, length))
+                        return ErrorCode::ProtocolError;
+                    {
+                        std::string ack;
+                        http2_detail::appendFrame(ack, frame::settings, flag::ack, 0);
+                        send(ack);
+                    }
+                    return ErrorCode::NoError;
+                case frame::ping:
+                    if (streamId != 0 || length != 8)
+                        return ErrorCode::ProtocolError;
+                    if (!(flags & flag::ack))
+                    {
+                        std::string pong;
+                        http2_detail::appendFrame(pong, frame::ping, flag::ack, 0,
+                                                  std::string_view(reinterpret_cast<const char *>(p), 8));
+                        send(pong);
+                    }
+                    return ErrorCode::NoError;
+                case frame::goaway:
+                    return streamId == 0 ? ErrorCode::NoError : ErrorCode::ProtocolError;
+                case frame::windowUpdate:
+                    return onWindowUpdate(streamId, p, length);
+                case frame::pushPromise:
+                    return ErrorCode::ProtocolError; // clients never push
+                default:
+                    return ErrorCode::NoError; // unknown frame types are ignored
+                }
+            }
+
+            // Strips padding; false when the padding is longer than the frame
+            static bool unpad(uint8_t flags, const uint8_t *&p, size_t &length)
+            {
+                if (!(flags & flag::padded))
+                    return true;
+                if (length < 1 || p[0] >= length)
+                    return false;
+                length -= 1 + p[0];
+                p++;
+                return true;
+            }
+
+            ErrorCode onData(uint8_t flags, uint32_t streamId, const uint8_t *p, size_t length)
+            {
+                if (streamId == 0)
+                    return ErrorCode::ProtocolError;
+
+                // The whole frame counts against the windows, padding included
+                size_t flowLength = length;
+                connRecvWindow_ -= static_cast<int64_t>(flowLength);
+                if (connRecvWindow_ < 0)
+                    return ErrorCode::FlowControlError;
+                // Buffered bytes are bounded by the stream windows: give
+                // connection credit back as soon as it is worth a frame
+                connUnacked_ += flowLength;
+                if (connUnacked_ >= options_.connectionWindowSize / 2)
+                {
+                    std::string out;
+                    http2_detail::appendWindowUpdate(out, 0, static_cast<uint32_t>(connUnacked_));
+                    connRecvWindow_ += static_cast<int64_t>(connUnacked_);
+                    connUnacked_ = 0;
+                    send(out);
+                }
+
+                if (!unpad(flags, p, length))
+                    return ErrorCode::ProtocolError;
+
+                auto stream = find(streamId);
+                if (!stream)
+                {
+                    if (streamId > lastStreamId_)
+                        return ErrorCode::ProtocolError; // idle stream
+                    return ErrorCode::NoError;           // finished or refused: drop
+                }
+                if (stream->remoteClosed())
+                {
+                    resetStream(streamId, ErrorCode::StreamClosed);
+                    cancel(*stream);
+                    return ErrorCode::NoError;
+                }
+                if (!stream->push(reinterpret_cast<const char *>(p), length, flowLength, flags & flag::endStream))
+                {
+                    resetStream(streamId, ErrorCode::FlowControlError);
+                    cancel(*stream);
+                }
+                return ErrorCode::NoError;
+            }
+
+            ErrorCode onHeaders(uint8_t flags, uint32_t streamId, const uint8_t *p, size_t length)
+            {
+                if (streamId == 0 || !(streamId & 1))
+                    return ErrorCode::ProtocolError;
+                if (!unpad(flags, p, length))
+                    return ErrorCode::ProtocolError;
+                if (flags & flag::priority)
+                {
+                    if (length < 5)
+                        return ErrorCode::ProtocolError;
+                    p += 5;
+                    length -= 5;
+                }
+
+                headerBlock_.assign(reinterpret_cast<const char *>(p), length);
+                bool endStream = flags & flag::endStream;
+                if (!(flags & flag::endHeaders))
+                {
+                    continuationStream_ = streamId;
+                    continuationEnd_ = endStream;
+                    return ErrorCode::NoError;
+                }
+                return onHeaderBlock(streamId, endStream);
+            }
+
+            ErrorCode onHeaderBlock(uint32_t streamId, bool endStream)
+            {
+                hpack::HeaderList fields;
+                bool tooLarge = false;
+                if (!decoder_.decode(headerBlock_, fields, options_.maxHeaderListSize, tooLarge))
+                    return ErrorCode::CompressionError;
+
+                if (streamId <= lastStreamId_)
+                {
+                    // Trailers end an open request body; anything else is an error
+                    auto stream = find(streamId);
+                    if (!stream)
+                        return ErrorCode::NoError;
+                    if (!endStream || stream->remoteClosed())
+                        return ErrorCode::ProtocolError;
+                    stream->push(nullptr, 0, 0, true);
+                    return ErrorCode::NoError;
+                }
+                lastStreamId_ = streamId;
+
+                bool full;
+                {
+                    std::lock_guard<std::mutex> lock(stateMutex_);
+                    full = open_ >= options_.maxConcurrentStreams;
+                }
+                if (full || draining_)
+                {
+                    resetStream(streamId, ErrorCode::RefusedStream);
+                    return ErrorCode::NoError;
+                }
+                if (tooLarge)
+                {
+                    respondDirectly(streamId, "431", endStream);
+                    return ErrorCode::NoError;
+                }
+
+                std::string head;
+                bool headRequest = false;
+                bool chunked = false;
+                if (!buildRequestHead(fields, endStream, head, headRequest, chunked))
+                {
+                    resetStream(streamId, ErrorCode::ProtocolError);
+                    return ErrorCode::NoError;
+                }
+                open(streamId, std::move(head), chunked, endStream, headRequest);
+                return ErrorCode::NoError;
+            }
+
+            // The request as HTTP/1.1 for httplib: false when malformed (8.2, 8.3)
+            static bool buildRequestHead(const hpack::HeaderList &fields, bool endStream, std::string &head,
+                                         bool &headRequest, bool &chunked)
+            {
+                std::string_view method, path, authority, scheme;
+                std::string cookie;
+                bool pseudoDone = false;
+                bool hasLength = false;
+                std::string regular;
+                regular.reserve(fields.size() * 32);
+
+                for (auto &field : fields)
+                {
+                    const auto &name = field.first;
+                    const auto &value = field.second;
+                    if (value.find_first_of(std::string_view("\r\n\0", 3)) != std::string::npos)
+                        return false;
+
+                    if (!name.empty() && name[0] == ':')
+                    {
+                        if (pseudoDone)
+                            return false;
+                        std::string_view *slot = name == ":method"      ? &method
+                                                 : name == ":path"      ? &path
+                                                 : name == ":authority" ? &authority
+                                                 : name == ":scheme"    ? &scheme
+                                                                        : nullptr;
+                        if (!slot || !slot->empty() || value.empty())
+                            return false;
+                        *slot = value;
+                        continue;
+                    }
+                    pseudoDone = true;
+
+                    for (char c : name)
+                        if ((c >= 'A' && c <= 'Z') || !http::parser_detail::isToken(c))
+                            return false;
+                    if (name.empty() || http2_detail::isConnectionSpecific(name))
+                    {
+                        if (name == "te" && value == "trailers")
+                            continue;
+                        return false;
+                    }
+                    if (name == "cookie") // crumbs are joined back into one field (8.2.3)
+                    {
+                        if (!cookie.empty())
+                            cookie += "; ";
+                        cookie += value;
+                        continue;
+                    }
+                    if (name == "host" && !authority.empty())
+                        continue;
+                    if (name == "content-length")
+                        hasLength = true;
+
+                    http2_detail::appendTitleCase(regular, name);
+                    regular += ": ";
+                    regular += value;
+                    regular += "\r\n";
+                }
+
+                if (method.empty() || path.empty() || method == "CONNECT")
+                    return false;
+
+                head.reserve(method.size() + path.size() + authority.size() + regular.size() + cookie.size() + 64);
+                head.append(method.data(), method.size());
+                head += ' ';
+                head.append(path.data(), path.size());
+                head += " HTTP/1.1\r\n";
+                if (!authority.empty())
+                {
+                    head += "Host: ";
+                    head.append(authority.data(), authority.size());
+                    head += "\r\n";
+                }
+                head += regular;
+                if (!cookie.empty())
+                {
+                    head += "Cookie: ";
+                    head += cookie;
+                    head += "\r\n";
+                }
+                chunked = !endStream && !hasLength;
+                if (chunked)
+                    head += "Transfer-Encoding: chunked\r\n";
+                head += "\r\n";
+                headRequest = method == "HEAD";
+                return true;
+            }
+
+            // Stream 1 of an upgraded connection: the HTTP/1.1 request itself
+            void openUpgradeStream(const httplib::Request &req)
+            {
+                std::string head = req.method + ' ' + req.target + " HTTP/1.1\r\n";
+                for (auto &h : req.headers)
+                {
+                    auto lower = http2_detail::toLower(h.first);
+                    if (http2_detail::isConnectionSpecific(lower) || lower == "content-length")
+                        continue;
+                    head += h.first + ": " + h.second + "\r\n";
+                }
+                head += "\r\n";
+                lastStreamId_ = 1;
+                open(1, std::move(head), false, true, req.method == "HEAD");
+            }
+
+            void open(uint32_t id, std::string head, bool chunked, bool endStream, bool headRequest)
+            {
+                auto stream = std::make_shared<ServerStream>(*this, id, std::move(head), chunked, endStream,
+                                                             headRequest, options_.initialWindowSize);
+                {
+                    std::lock_guard<std::mutex> lock(stateMutex_);
+                    stream->sendWindow_ = peerInitialWindow_;
+                    streams_.emplace(id, stream);
+                    running_++;
+                    open_++;
+                }
+
+                bool queued = enqueue_([this, stream]
+                                       {
+                                           try
+                                           {
+                                               dispatch_(*stream);
+                                           }
+                                           catch (...)
+                                           {
+                                           }
+                                           stream->finish();
+                                       });
+                if (!queued)
+                {
+                    resetStream(id, ErrorCode::RefusedStream);
+                    finished(*stream);
+                }
+            }
+
+            // The peer may open another stream once it sees our END_STREAM:
+            // the slot is freed just before that is written, not when the
+            // task returns
+            void release(ServerStream &stream)
+            {
+                std::lock_guard<std::mutex> lock(stateMutex_);
+                if (!stream.released_)
+                {
+                    stream.released_ = true;
+                    open_--;
+                }
+            }
+
+            // Reset by either side: the handler's reads and writes now fail
+            void cancel(ServerStream &stream)
+            {
+                stream.abort();
+                release(stream);
+                windowCv_.notify_all();
+            }
+
+            // Called by a stream's task once its response is complete
+            void finished(ServerStream &stream)
+            {
+                release(stream);
+                {
+                    std::lock_guard<std::mutex> lock(stateMutex_);
+                    streams_.erase(stream.id_);
+                    running_--;
+                }
+                drainedCv_.notify_all();
+                closeIfDrained();
+            }
+
+            // Wakes the reader once a draining connection has nothing left
+            void closeIfDrained()
+            {
+                if (!draining_)
+                    return;
+                {
+                    std::lock_guard<std::mutex> lock(stateMutex_);
+                    if (!streams_.empty())
+                        return;
+                }
+                httplib::detail::shutdown_socket(conn_.socket());
+            }
+
+            std::shared_ptr<ServerStream> find(uint32_t id)
+            {
+                std::lock_guard<std::mutex> lock(stateMutex_);
+                auto it = streams_.find(id);
+                return it == streams_.end() ? nullptr : it->second;
+            }
+
+            // A response made here, without a handler (431 for oversized heads)
+            void respondDirectly(uint32_t id, const char *status, bool endStream)
+            {
+                std::string block, out;
+                auto maxFrame = peerMaxFrameSize();
+                std::lock_guard<std::mutex> lock(writeMutex_);
+                encoder_.encode({{":status", status}, {"content-length", "0"}}, block);
+                http2_detail::appendHeaderBlock(out, id, block, true, maxFrame);
+                if (!endStream)
+                    http2_detail::appendRstStream(out, id, ErrorCode::NoError);
+                if (!dead_ && !http2_detail::writeAll(conn_, out.data(), out.size()))
+                    dead_ = true;
+            }
+
+            bool applySettings(const uint8_t *p, size_t length)
+            {
+                for (size_t i = 0; i + 6 <= length; i += 6)
+                {
+                    uint16_t id = static_cast<uint16_t>((p[i] << 8) | p[i + 1]);
+                    uint32_t value = http2_detail::getUint32(p + i + 2);
+                    switch (id)
+                    {
+                    case setting::headerTableSize:
+                    {
+                        std::lock_guard<std::mutex> lock(writeMutex_);
+                        encoder_.setMaxTableSize(value);
+                        break;
+                    }
+                    case setting::enablePush:
+                        if (value > 1)
+                            return false;
+                        break;
+                    case setting::initialWindowSize:
+                    {
+                        if (value > maxWindowSize)
+                            return false;
+                        std::lock_guard<std::mutex> lock(stateMutex_);
+                        int64_t delta = static_cast<int64_t>(value) - peerInitialWindow_;
+                        peerInitialWindow_ = value;
+                        for (auto &entry : streams_)
+                            entry.second->sendWindow_ += delta;
+                        break;
+                    }
+                    case setting::maxFrameSize:
+                    {
+                        if (value < defaultMaxFrameSize || value > 0xffffff)
+                            return false;
+                        std::lock_guard<std::mutex> lock(stateMutex_);
+                        peerMaxFrameSize_ = value;
+                        break;
+                    }
+                    default:
+                        break;
+                    }
+                }
+                windowCv_.notify_all();
+                return true;
+            }
+
+            ErrorCode onWindowUpdate(uint32_t streamId, const uint8_t *p, size_t length)
+            {
+                if (length != 4)
+                    return ErrorCode::FrameSizeError;
+                uint32_t increment = http2_detail::getUint32(p) & 0x7fffffff;
+                if (increment == 0)
+                {
+                    if (streamId == 0)
+                        return ErrorCode::ProtocolError;
+                    resetStream(streamId, ErrorCode::ProtocolError);
+                    if (auto stream = find(streamId))
+                        cancel(*stream);
+                    return ErrorCode::NoError;
+                }
+
+                std::shared_ptr<ServerStream> overflowed;
+                {
+                    std::lock_guard<std::mutex> lock(stateMutex_);
+                    if (streamId == 0)
+                    {
+                        connSendWindow_ += increment;
+                        if (connSendWindow_ > maxWindowSize)
+                            return ErrorCode::FlowControlError;
+                    }
+                    else
+                    {
+                        auto it = streams_.find(streamId);
+                        if (it != streams_.end())
+                        {
+                            it->second->sendWindow_ += increment;
+                            if (it->second->sendWindow_ > maxWindowSize)
+                                overflowed = it->second;
+                        }
+                    }
+                }
+                if (overflowed)
+                {
+                    resetStream(streamId, ErrorCode::FlowControlError);
+                    cancel(*overflowed);
+                }
+                windowCv_.notify_all();
+                return ErrorCode::NoError;
+            }
+
+            // Handler thread: the request body consumed `credit` DATA bytes
+            void consumed(ServerStream &stream, size_t credit)
+            {
+                stream.unackedCredit_ += credit;
+                if (stream.unackedCredit_ < options_.initialWindowSize / 2 || stream.remoteClosed())
+                    return;
+                std::string out;
+                http2_detail::appendWindowUpdate(out, stream.id_, static_cast<uint32_t>(stream.unackedCredit_));
+                {
+                    std::lock_guard<std::mutex> lock(stream.mutex_);
+                    stream.recvWindow_ += static_cast<int64_t>(stream.unackedCredit_);
+                }
+                stream.unackedCredit_ = 0;
+                send(out);
+            }
+
+            size_t peerMaxFrameSize()
+            {
+                std::lock_guard<std::mutex> lock(stateMutex_);
+                return peerMaxFrameSize_;
+            }
+
+            // Up to `wanted` bytes of send window for a DATA frame; 0 when the
+            // stream or connection is gone or the wait timed out
+            size_t reserveWindow(ServerStream &stream, size_t wanted, bool &flushed)
+            {
+                std::unique_lock<std::mutex> lock(stateMutex_);
+                auto available = [&]
+                {
+                    return std::min<int64_t>({connSendWindow_, stream.sendWindow_,
+                                              static_cast<int64_t>(peerMaxFrameSize_)});
+                };
+                if (available() <= 0 && !flushed)
+                {
+                    // About to wait: what is queued must go out first
+                    lock.unlock();
+                    flushed = true;
+                    if (!stream.flush())
+                        return 0;
+                    lock.lock();
+                }
+                if (!windowCv_.wait_for(lock, std::chrono::seconds(options_.writeTimeoutSec), [&]
+                                        { return available() > 0 || stream.reset_ || dead_; }) ||
+                    stream.reset_ || dead_)
+                    return 0;
+                auto n = std::min(wanted, static_cast<size_t>(available()));
+                connSendWindow_ -= static_cast<int64_t>(n);
+                stream.sendWindow_ -= static_cast<int64_t>(n);
+                return n;
+            }
+
+            void shutdown()
+            {
+                std::unique_lock<std::mutex> lock(stateMutex_);
+                dead_ = true;
+                for (auto &entry : streams_)
+                    entry.second->abort();
+                windowCv_.notify_all();
+                drainedCv_.wait(lock, [this]
+                                { return running_ == 0; });
+            }
+        };
+
+        inline bool ServerStream::wait_writable() const
+        {
+            return !reset_ && !conn_.dead_;
+        }
+
+        inline void ServerStream::get_remote_ip_and_port(std::string &ip, int &port) const
+        {
+            conn_.conn_.get_remote_ip_and_port(ip, port);
+        }
+
+        inline void ServerStream::get_local_ip_and_port(std::string &ip, int &port) const
+        {
+            conn_.conn_.get_local_ip_and_port(ip, port);
+        }
+
+        inline socket_t ServerStream::socket() const { return conn_.conn_.socket(); }
+
+        inline time_t ServerStream::duration() const { return conn_.conn_.duration(); }
+
+        // Moves what the reader received into buffer_. > 0 = bytes added,
+        // 0 = request complete, < 0 = reset or timed out.
+        inline ssize_t ServerStream::pull()
+        {
+            if (!flush())
+                return -1;
+
+            size_t credit;
+            size_t added;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                if (!cv_.wait_for(lock, std::chrono::seconds(conn_.options_.readTimeoutSec), [this]
+                                  { return !incoming_.empty() || remoteClosed_ || reset_; }))
+                    return -1;
+                if (reset_)
+                    return -1;
+                if (incoming_.empty())
+                    return 0;
+
+                if (bufferPos_ == buffer_.size())
+                {
+                    buffer_.swap(incoming_);
+                    incoming_.clear();
+                }
+                else
+                {
+                    buffer_.erase(0, bufferPos_);
+                    buffer_ += incoming_;
+                    incoming_.clear();
+                }
+                bufferPos_ = 0;
+                added = buffer_.size();
+                credit = incomingCredit_;
+                incomingCredit_ = 0;
+            }
+            if (credit > 0)
+                conn_.consumed(*this, credit);
+            return static_cast<ssize_t>(added);
+        }
+
+        inline ssize_t ServerStream::fill_read_buffer(size_t max_size)
+        {
+            if (read_buffer_size() >= max_size)
+                return -1;
+            auto before = read_buffer_size();
+            auto n = pull();
+            return n <= 0 ? n : static_cast<ssize_t>(read_buffer_size() - before);
+        }
+
+        inline ssize_t ServerStream::read(char *ptr, size_t size)
+        {
+            if (bufferPos_ == buffer_.size())
+            {
+                auto n = pull();
+                if (n <= 0)
+                    return n;
+            }
+            auto n = std::min(size, buffer_.size() - bufferPos_);
+            memcpy(ptr, buffer_.data() + bufferPos_, n);
+            bufferPos_ += n;
+            return static_cast<ssize_t>(n);
+        }
+
+        inline ssize_t ServerStream::write(const char *ptr, size_t size)
+        {
+            if (reset_ || conn_.dead_)
+                return -1;
+            if (!writeResponse(ptr, size))
+                return -1;
+            if (!batching_ && !flush())
+                return -1;
+            return static_cast<ssize_t>(size);
+        }
+
+        // Status line + fields of an HTTP/1.1 response head, as HTTP/2 fields
+        inline bool ServerStream::parseHead(const std::string &head, int &status, hpack::HeaderList &fields,
+                                            Output &next)
+        {
+            // "HTTP/1.1 200 OK\r\n"
+            if (head.size() < 12 || head.compare(0, 5, "HTTP/") != 0)
+                return false;
+            auto sp = head.find(' ');
+            if (sp == std::string::npos || sp + 4 > head.size())
+                return false;
+            status = std::atoi(head.c_str() + sp + 1);
+            if (status < 100 || status > 999)
+                return false;
+            fields.emplace_back(":status", head.substr(sp + 1, 3));
+
+            bool chunked = false;
+            bool hasLength = false;
+            uint64_t length = 0;
+            size_t pos = head.find("\r\n") + 2;
+            while (pos < head.size())
+            {
+                auto end = head.find("\r\n", pos);
+                if (end == std::string::npos || end == pos)
+                    break;
+                auto colon = head.find(':', pos);
+                if (colon == std::string::npos || colon > end)
+                    return false;
+                auto name = http2_detail::toLower(std::string_view(head).substr(pos, colon - pos));
+                auto valueStart = head.find_first_not_of(" \t", colon + 1);
+                auto value = valueStart < end ? head.substr(valueStart, end - valueStart) : std::string();
+                pos = end + 2;
+
+                if (name == "transfer-encoding")
+                    chunked = http2_detail::hasToken(value, "chunked");
+                if (http2_detail::isConnectionSpecific(name))
+                    continue;
+                if (name == "content-length")
+                {
+                    hasLength = true;
+                    length = std::strtoull(value.c_str(), nullptr, 10);
+                }
+                fields.emplace_back(std::move(name), std::move(value));
+            }
+
+            if (status < 200)
+                next = Output::Head;
+            else if (headRequest_ || status == 204 || status == 304 || (hasLength && length == 0 && !chunked))
+                next = Output::Done;
+            else if (chunked)
+                next = Output::Chunked;
+            else if (hasLength)
+                next = Output::Length;
+            else
+                next = Output::Raw;
+            remaining_ = length;
+            return true;
+        }
+
+        // One more piece of the HTTP/1.1 response httplib is writing
+        inline bool ServerStream::writeResponse(const char *p, size_t n)
+        {
+            while (n > 0)
+            {
+                switch (output_)
+                {
+                case Output::Head:
+                {
+                    auto before = head_.size();
+                    head_.append(p, n);
+                    auto end = head_.find("\r\n\r\n", before > 3 ? before - 3 : 0);
+                    if (end == std::string::npos)
+                        return head_.size() <= 64 * 1024;
+
+                    size_t used = end + 4 - before;
+                    head_.resize(end + 4);
+                    p += used;
+                    n -= used;
+
+                    int status = 0;
+                    PendingHeaders headers;
+                    Output next = Output::Head;
+                    if (!parseHead(head_, status, headers.fields, next))
+                        return false;
+                    head_.clear();
+                    headers.endStream = next == Output::Done;
+                    pendingHeaders_.push_back(std::move(headers));
+                    if (next == Output::Done)
+                        endSent_ = true;
+                    output_ = next;
+                    break;
+                }
+                case Output::Length:
+                {
+                    auto take = static_cast<size_t>(std::min<uint64_t>(n, remaining_));
+                    remaining_ -= take;
+                    if (!sendData(p, take, remaining_ == 0))
+                        return false;
+                    if (remaining_ == 0)
+                        output_ = Output::Done;
+                    p += take;
+                    n -= take;
+                    break;
+                }
+                case Output::Chunked:
+                    if (chunk_ == Chunk::Data)
+                    {
+                        auto take = static_cast<size_t>(std::min<uint64_t>(n, remaining_));
+                        if (!sendData(p, take, false))
+                            return false;
+                        remaining_ -= take;
+                        p += take;
+                        n -= take;
+                        if (remaining_ == 0)
+                            chunk_ = Chunk::DataEnd;
+                        break;
+                    }
+                    else
+                    {
+                        // Size lines, the CRLF after data and trailers: line by line
+                        auto nl = static_cast<const char *>(memchr(p, '\n', n));
+                        size_t take = nl ? static_cast<size_t>(nl - p) + 1 : n;
+                        head_.append(p, take);
+                        p += take;
+                        n -= take;
+                        if (!nl)
+                        {
+                            if (head_.size() > 4096)
+                                return false;
+                            break;
+                        }
+
+                        if (chunk_ == Chunk::DataEnd)
+                        {
+                            chunk_ = Chunk::Size;
+                        }
+                        else if (chunk_ == Chunk::Size)
+                        {
+                            remaining_ = std::strtoull(head_.c_str(), nullptr, 16);
+                            chunk_ = remaining_ ? Chunk::Data : Chunk::Trailers;
+                        }
+                        else if (head_ == "\r\n" || head_ == "\n")
+                        {
+                            // Last chunk; trailers are dropped
+                            output_ = Output::Done;
+                            if (!sendData(nullptr, 0, true))
+                                return false;
+                        }
+                        head_.clear();
+                        break;
+                    }
+                case Output::Raw:
+                    if (!sendData(p, n, false))
+                        return false;
+                    n = 0;
+                    break;
+                case Output::Done:
+                    return true; // nothing may follow the response
+                }
+            }
+            return true;
+        }
+
+        inline bool ServerStream::sendData(const char *p, size_t n, bool endStream)
+        {
+            if (n == 0 && !endStream)
+                return true;
+
+            bool flushed = false;
+            do
+            {
+                size_t take = n > 0 ? conn_.reserveWindow(*this, n, flushed) : 0;
+                if (n > 0 && take == 0)
+                    return false;
+                bool last = endStream && take == n;
+                http2_detail::appendFrameHeader(pendingData_, take, frame::data, last ? flag::endStream : 0, id_);
+                pendingData_.append(p, take);
+                p += take;
+                n -= take;
+                endSent_ = endSent_ || last;
+                if (pendingData_.size() >= 64 * 1024 && !flush())
+                    return false;
+            } while (n > 0);
+            return true;
+        }
+
+        inline bool ServerStream::flush()
+        {
+            if (pendingHeaders_.empty() && pendingData_.empty())
+                return true;
+            if (reset_ || conn_.dead_)
+                return false;
+
+            auto maxFrame = conn_.peerMaxFrameSize();
+            if (endSent_)
+                conn_.release(*this);
+            std::lock_guard<std::mutex> lock(conn_.writeMutex_);
+            std::string out;
+            if (!pendingHeaders_.empty())
+            {
+                std::string block;
+                for (auto &headers : pendingHeaders_)
+                {
+                    block.clear();
+                    conn_.encoder_.encode(headers.fields, block);
+                    http2_detail::appendHeaderBlock(out, id_, block, headers.endStream, maxFrame);
+                }
+                pendingHeaders_.clear();
+                out += pendingData_;
+            }
+            else
+            {
+                out.swap(pendingData_);
+            }
+            pendingData_.clear();
+
+            if (!http2_detail::writeAll(conn_.conn_, out.data(), out.size()))
+            {
+                conn_.dead_ = true;
+                return false;
+            }
+            return true;
+        }
+
+        // After dispatch returns: end our side and leave the connection
+        inline void ServerStream::finish()
+        {
+            if (!reset_ && !conn_.dead_)
+            {
+                if (output_ == Output::Head)
+                {
+                    // No (final) response was produced
+                    flush();
+                    conn_.release(*this);
+                    conn_.resetStream(id_, ErrorCode::InternalError);
+                }
+                else if (output_ == Output::Length && remaining_ > 0)
+                {
+                    // Shorter than its Content-Length: the response is broken
+                    flush();
+                    conn_.release(*this);
+                    conn_.resetStream(id_, ErrorCode::InternalError);
+                }
+                else
+                {
+                    if (!endSent_)
+                        sendData(nullptr, 0, true);
+                    flush();
+                    // The request body was not read to the end: stop the peer sending it
+                    if (!remoteClosed())
+                        conn_.resetStream(id_, ErrorCode::NoError);
+                }
+            }
+            conn_.finished(*this);
+        }
+
+        // 🔥 HTTP/2 client over cleartext TCP (prior knowledge)
+        // For tests and benchmarks against the server above: requests passed
+        // to send() are multiplexed on one connection, as far as the server's
+        // SETTINGS_MAX_CONCURRENT_STREAMS allows.
+        //   http2::Client client("127.0.0.1", 5000);
+        //   auto responses = client.send({{"GET", "/slow"}, {"GET", "/health"}});
+        class Client
+        {
+        public:
+            struct Request
+            {
+                std::string method = "GET";
+                std::string path = "/";
+                hpack::HeaderList headers; // lowercase names
+                std::string body;
+            };
+
+            struct Response
+            {
+                int status = 0; // 0 = no response (reset or connection lost)
+                hpack::HeaderList headers;
+                std::string body;
+                std::chrono::steady_clock::duration elapsed{}; // from send() to END_STREAM
+
+                std::string header(const std::string &name) const
+                {
+                    for (auto &h : headers)
+                        if (h.first == name)
+                            return h.second;
+                    return "";
+                }
+            };
+
+            Client(std::string host, int port, time_t timeoutSec = 30)
+                : host_(std::move(host)), port_(port), timeoutSec_(timeoutSec) {}
+
+            Client(const Client &) = delete;
+            Client &operator=(const Client &) = delete;
+
+            ~Client() { close(); }
+
+            bool isOpen() const { return stream_ != nullptr; }
+
+            void close()
+            {
+                stream_.reset();
+                if (sock_ != INVALID_SOCKET)
+                {
+                    httplib::detail::close_socket(sock_);
+                    sock_ = INVALID_SOCKET;
+                }
+            }
+
+            Response get(const std::string &path)
+            {
+                Request req;
+                req.path = path;
+                return send({req})[0];
+            }
+
+            // Responses in request order
+            std::vector<Response> send(const std::vector<Request> &requests)
+            {
+                std::vector<Response> responses(requests.size());
+                if (!isOpen() && !connect())
+                    return responses;
+
+                auto start = std::chrono::steady_clock::now();
+                std::deque<size_t> queued;
+                for (size_t i = 0; i < requests.size(); i++)
+                    queued.push_back(i);
+                active_.clear();
+                size_t done = 0;
+
+                while (done < requests.size())
+                {
+                    std::string out;
+                    while (!queued.empty() && active_.size() < peerMaxStreams_)
+                    {
+                        auto index = queued.front();
+                        queued.pop_front();
+                        openStream(requests[index], index, out);
+                    }
+                    sendBodies(requests, out);
+                    if (!out.empty() && !http2_detail::writeAll(*stream_, out.data(), out.size()))
+                        break;
+
+                    if (!readFrame(responses, start, done))
+                        break;
+                }
+
+                if (done < requests.size())
+                    close(); // lost: the remaining responses stay at status 0
+                return responses;
+            }
+
+        private:
+            struct Active
+            {
+                size_t index;
+                size_t bodySent = 0;
+                int64_t window;
+                bool endSent;
+                bool remoteEnd = false; // END_STREAM seen on HEADERS awaiting CONTINUATION
+                std::string block;      // header block being received
+            };
+
+            std::string host_;
+            int port_;
+            time_t timeoutSec_;
+            socket_t sock_ = INVALID_SOCKET;
+            std::unique_ptr<httplib::detail::SocketStream> stream_;
+
+            hpack::Encoder encoder_;
+            hpack::Decoder decoder_;
+            uint32_t nextStreamId_ = 1;
+            int64_t connWindow_ = defaultWindowSize;
+            int64_t peerInitialWindow_ = defaultWindowSize;
+            size_t peerMaxFrameSize_ = defaultMaxFrameSize;
+            size_t peerMaxStreams_ = 100;
+            size_t connUnacked_ = 0;
+            std::unordered_map<uint32_t, Active> active_;
+
+            static constexpr uint32_t receiveWindow = 1u << 30;
+
+            bool connect()
+            {
+                httplib::Error error = httplib::Error::Success;
+                sock_ = httplib::detail::create_client_socket(host_, std::string(), port_, AF_UNSPEC, true, false,
+                                                               nullptr, timeoutSec_, 0, timeoutSec_, 0,
+                                                               timeoutSec_, 0, std::string(), error);
+                if (sock_ == INVALID_SOCKET)
+                    return false;
+                stream_ = std::make_unique<httplib::detail::SocketStream>(sock_, timeoutSec_, 0, timeoutSec_, 0);
+
+                using namespace http2_detail;
+                std::string out(clientPreface);
+                appendFrameHeader(out, 12, frame::settings, 0, 0);
+                putUint16(out, setting::enablePush);
+                putUint32(out, 0);
+                putUint16(out, setting::initialWindowSize);
+                putUint32(out, receiveWindow);
+                appendWindowUpdate(out, 0, receiveWindow - defaultWindowSize);
+                nextStreamId_ = 1;
+                connWindow_ = defaultWindowSize;
+                if (!writeAll(*stream_, out.data(), out.size()))
+                {
+                    close();
+                    return false;
+                }
+                return true;
+            }
+
+            void openStream(const Request &req, size_t index, std::string &out)
+            {
+                hpack::HeaderList fields = {{":method", req.method},
+                                            {":scheme", "http"},
+                                            {":authority", host_ + ":" + std::to_string(port_)},
+                                            {":path", req.path}};
+                fields.insert(fields.end(), req.headers.begin(), req.headers.end());
+                if (!req.body.empty())
+                    fields.emplace_back("content-length", std::to_string(req.body.size()));
+
+                std::string block;
+                encoder_.encode(fields, block);
+                auto id = nextStreamId_;
+                nextStreamId_ += 2;
+                http2_detail::appendHeaderBlock(out, id, block, req.body.empty(), peerMaxFrameSize_);
+                active_.emplace(id, Active{index, 0, peerInitialWindow_, req.body.empty(), false, {}});
+            }
+
+            void sendBodies(const std::vector<Request> &requests, std::string &out)
+            {
+                for (auto &entry : active_)
+                {
+                    auto &a = entry.second;
+                    auto &body = requests[a.index].body;
+                    while (!a.endSent)
+                    {
+                        auto n = std::min<int64_t>({static_cast<int64_t>(body.size() - a.bodySent), a.window,
+                                                    connWindow_, static_cast<int64_t>(peerMaxFrameSize_)});
+                        if (n <= 0 && a.bodySent < body.size())
+                            break;
+                        bool last = a.bodySent + static_cast<size_t>(n) == body.size();
+                        http2_detail::appendFrame(out, frame::data, last ? flag::endStream : 0, entry.first,
+                                                  std::string_view(body).substr(a.bodySent, static_cast<size_t>(n)));
+                        a.bodySent += static_cast<size_t>(n);
+                        a.window -= n;
+                        connWindow_ -= n;
+                        a.endSent = last;
+                    }
+                }
+            }
+
+            bool fill(size_t needed)
+            {
+                while (stream_->read_buffer_size() < needed)
+                    if (stream_->fill_read_buffer(std::max<size_t>(needed, 64 * 1024)) <= 0)
+                        return false;
+                return true;
+            }
+
+            void complete(uint32_t id, std::vector<Response> &responses,
+                          std::chrono::steady_clock::time_point start, size_t &done)
+            {
+                auto it = active_.find(id);
+                if (it == active_.end())
+                    return;
+                responses[it->second.index].elapsed = std::chrono::steady_clock::now() - start;
+                active_.erase(it);
+                done++;
+            }
+
+            bool readFrame(std::vector<Response> &responses,
+                           std::chrono::steady_clock::time_point start, size_t &done)
+            {
+                using namespace http2_detail;
+                if (!fill(frame::headerSize))
+                    return false;
+                auto p = reinterpret_cast<const uint8_t *>(stream_->read_buffer_data());
+                size_t length = (size_t(p[0]) << 16) | (size_t(p[1]) << 8) | p[2];
+                uint8_t type = p[3];
+                uint8_t flags = p[4];
+                uint32_t id = getUint32(p + 5) & 0x7fffffff;
+                if (!fill(frame::headerSize + length))
+                    return false;
+                p = reinterpret_cast<const uint8_t *>(stream_->read_buffer_data()) + frame::headerSize;
+
+                std::string out;
+                bool ok = true;
+                auto it = active_.find(id);
+                switch (type)
+                {
+                case frame::settings:
+                    if (flags & flag::ack)
+                        break;
+                    for (size_t i = 0; i + 6 <= length; i += 6)
+                    {
+                        uint16_t setting = static_cast<uint16_t>((p[i] << 8) | p[i + 1]);
+                        uint32_t value = getUint32(p + i + 2);
+                        if (setting == setting::initialWindowSize)
+                        {
+                            for (auto &entry : active_)
+                                entry.second.window += static_cast<int64_t>(value) - peerInitialWindow_;
+                            peerInitialWindow_ = value;
+                        }
+                        else if (setting == setting::maxFrameSize)
+                            peerMaxFrameSize_ = value;
+                        else if (setting == setting::maxConcurrentStreams)
+                            peerMaxStreams_ = std::max<uint32_t>(value, 1);
+                        else if (setting == setting::headerTableSize)
+                            encoder_.setMaxTableSize(value);
+                    }
+                    appendFrame(out, frame::settings, flag::ack, 0);
+                    break;
+                case frame::ping:
+                    if (!(flags & flag::ack))
+                        appendFrame(out, frame::ping, flag::ack, 0,
+                                    std::string_view(reinterpret_cast<const char *>(p), length));
+                    break;
+                case frame::windowUpdate:
+                {
+                    auto increment = static_cast<int64_t>(getUint32(p) & 0x7fffffff);
+                    if (id == 0)
+                        connWindow_ += increment;
+                    else if (it != active_.end())
+                        it->second.window += increment;
+                    break;
+                }
+                case frame::headers:
+                case frame::continuation:
+                {
+                    if (it == active_.end())
+                        break;
+                    size_t skip = 0;
+                    size_t padding = 0;
+                    if (type == frame::headers)
+                    {
+                        if (flags & flag::padded)
+                        {
+                            padding = p[0];
+                            skip = 1;
+                        }
+                        if (flags & flag::priority)
+                            skip += 5;
+                        it->second.block.clear();
+                        it->second.remoteEnd = flags & flag::endStream;
+                    }
+                    it->second.block.append(reinterpret_cast<const char *>(p) + skip, length - skip - padding);
+                    if (flags & flag::endHeaders)
+                    {
+                        hpack::HeaderList fields;
+                        bool tooLarge = false;
+                        ok = decoder_.decode(it->second.block, fields, SIZE_MAX, tooLarge);
+                        auto &res = responses[it->second.index];
+                        auto status = fields.empty() ? 0 : std::atoi(fields[0].second.c_str());
+                        if (status >= 200 || res.status == 0)
+                        {
+                            res.status = status;
+                            res.headers = std::move(fields);
+                        }
+                    }
+                    if ((flags & flag::endHeaders) && it->second.remoteEnd)
+                        complete(id, responses, start, done);
+                    break;
+                }
+                case frame::data:
+                {
+                    size_t skip = (flags & flag::padded) ? 1 : 0;
+                    size_t padding = skip ? p[0] : 0;
+                    if (it != active_.end())
+                        responses[it->second.index].body.append(reinterpret_cast<const char *>(p) + skip,
+                                                                 length - skip - padding);
+                    // Credit back at once: the window never limits the server
+                    connUnacked_ += length;
+                    if (connUnacked_ >= receiveWindow / 2)
+                    {
+                        appendWindowUpdate(out, 0, static_cast<uint32_t>(connUnacked_));
+                        connUnacked_ = 0;
+                    }
+                    if (flags & flag::endStream)
+                        complete(id, responses, start, done);
+                    break;
+                }
+                case frame::rstStream:
+                    complete(id, responses, start, done);
+                    break;
+                case frame::goaway:
+                    ok = false;
+                    break;
+                default:
+                    break;
+                }
+
+                stream_->consume_read_buffer(frame::headerSize + length);
+                if (!out.empty() && !writeAll(*stream_, out.data(), out.size()))
+                    return false;
+                return ok;
+            }
+        };
+    }
+}
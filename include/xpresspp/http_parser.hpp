@@ -0,0 +1,215 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+#include "simd.hpp"
+
+namespace xpresspp
+{
+    namespace http
+    {
+        // 🔥 One header field of a parsed request head
+        // Views into the receive buffer: valid until the buffer is consumed.
+        struct HeaderView
+        {
+            std::string_view name;
+            std::string_view value; // without surrounding whitespace
+        };
+
+        // 🔥 Request line + headers, parsed in place
+        struct RequestHead
+        {
+            static constexpr size_t maxHeaders = 100;
+
+            std::string_view method;
+            std::string_view target;
+            std::string_view version;
+            HeaderView headers[maxHeaders];
+            size_t headerCount = 0;
+        };
+
+        // parseRequestHead() results other than a head length
+        constexpr long parseError = -1;          // malformed: 400
+        constexpr long parseIncomplete = -2;     // need more bytes
+        constexpr long parseTooManyHeaders = -3; // more than RequestHead::maxHeaders: 431
+
+        namespace parser_detail
+        {
+            // RFC 9110 tchar: the bytes allowed in methods and field names
+            struct TokenTable
+            {
+                bool token[256] = {};
+
+                constexpr TokenTable()
+                {
+                    for (int c = '0'; c <= '9'; c++)
+                        token[c] = true;
+                    for (int c = 'a'; c <= 'z'; c++)
+                        token[c] = true;
+                    for (int c = 'A'; c <= 'Z'; c++)
+                        token[c] = true;
+                    for (char c : {'!', '#', '$', '%', '&', '\'', '*', '+', '-', '.', '^', '_', '`', '|', '~'})
+                        token[static_cast<unsigned char>(c)] = true;
+                }
+            };
+
+            static constexpr TokenTable tokens{};
+
+            inline bool isToken(char c) { return tokens.token[static_cast<unsigned char>(c)]; }
+
+            // First byte that cannot continue a field value (a control
+            // character other than HT, or DEL) — or, with stopAtSpace, a
+            // request-target (which also ends at SP). Bytes >= 0x80 pass.
+            // Returns end when the run reaches it.
+            inline const char *findDelimiter(const char *p, const char *end, bool stopAtSpace)
+            {
+#if defined(XPRESSPP_AVX2)
+                // Unsigned x < limit as a signed compare after flipping the top bit
+                const __m256i flip = _mm256_set1_epi8(static_cast<char>(0x80));
+                const __m256i limit = _mm256_set1_epi8(static_cast<char>((stopAtSpace ? 0x21 : 0x20) ^ 0x80));
+                const __m256i del = _mm256_set1_epi8(0x7f);
+                while (end - p >= 32)
+                {
+                    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+                    __m256i low = _mm256_cmpgt_epi8(limit, _mm256_xor_si256(v, flip));
+                    __m256i hit = _mm256_or_si256(low, _mm256_cmpeq_epi8(v, del));
+                    uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(hit));
+                    if (mask)
+                        return p + simd::lowestBit(mask);
+                    p += 32;
+                }
+#endif
+#if defined(XPRESSPP_SSE2)
+                const __m128i flip16 = _mm_set1_epi8(static_cast<char>(0x80));
+                const __m128i limit16 = _mm_set1_epi8(static_cast<char>((stopAtSpace ? 0x21 : 0x20) ^ 0x80));
+                const __m128i del16 = _mm_set1_epi8(0x7f);
+                while (end - p >= 16)
+                {
+                    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+                    __m128i low = _mm_cmplt_epi8(_mm_xor_si128(v, flip16), limit16);
+                    __m128i hit = _mm_or_si128(low, _mm_cmpeq_epi8(v, del16));
+                    uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(hit));
+                    if (mask)
+                        return p + simd::lowestBit(mask);
+                    p += 16;
+                }
+#endif
+                const unsigned char limitByte = stopAtSpace ? 0x21 : 0x20;
+                for (; p < end; p++)
+                {
+                    auto c = static_cast<unsigned char>(*p);
+                    if (c < limitByte || c == 0x7f)
+                        return p;
+                }
+                return end;
+            }
+
+            inline bool isSpaceOrTab(char c) { return c == ' ' || c == '\t'; }
+        }
+
+        // 🔥 Parses an HTTP/1.x request head (request line + header fields)
+        // picohttpparser-style: one pass over the bytes received so far,
+        // scanning request targets and field values 16/32 bytes at a time
+        // (SSE2/AVX2, scalar elsewhere) and recording views, never copies.
+        // Returns the head length including the blank line, parseIncomplete
+        // when the buffer ends first (call again once more bytes arrive), or
+        // parseError / parseTooManyHeaders. Lines must end in CRLF; obsolete
+        // line folding and whitespace before the colon are rejected.
+        inline long parseRequestHead(const char *buf, size_t len, RequestHead &head)
+        {
+            using namespace parser_detail;
+            const char *p = buf;
+            const char *end = buf + len;
+            head.headerCount = 0;
+
+            // Empty lines before the request line are ignored (RFC 9112 2.2)
+            while (end - p >= 2 && p[0] == '\r' && p[1] == '\n')
+                p += 2;
+            if (end - p == 1 && *p == '\r')
+                return parseIncomplete; // its LF is still to come
+
+            // method SP request-target SP HTTP-version CRLF
+            const char *start = p;
+            while (p < end && isToken(*p))
+                p++;
+            if (p == end)
+                return parseIncomplete;
+            if (p == start || *p != ' ')
+                return parseError;
+            head.method = std::string_view(start, static_cast<size_t>(p - start));
+
+            start = ++p;
+            p = findDelimiter(p, end, true);
+            if (p == end)
+                return parseIncomplete;
+            if (p == start || *p != ' ')
+                return parseError;
+            head.target = std::string_view(start, static_cast<size_t>(p - start));
+
+            start = ++p;
+            p = findDelimiter(p, end, true);
+            if (end - p < 2)
+                return parseIncomplete;
+            if (p == start || p[0] != '\r' || p[1] != '\n')
+                return parseError;
+            head.version = std::string_view(start, static_cast<size_t>(p - start));
+            p += 2;
+
+            for (;;)
+            {
+                if (p == end)
+                    return parseIncomplete;
+                if (*p == '\r')
+                {
+                    if (end - p < 2)
+                        return parseIncomplete;
+                    if (p[1] != '\n')
+                        return parseError;
+                    return static_cast<long>(p + 2 - buf);
+                }
+                if (head.headerCount == RequestHead::maxHeaders)
+                    return parseTooManyHeaders;
+
+                // field-name ":" OWS field-value OWS CRLF
+                start = p;
+                while (p < end && isToken(*p))
+                    p++;
+                if (p == end)
+                    return parseIncomplete;
+                if (p == start || *p != ':')
+                    return parseError;
+                auto &field = head.headers[head.headerCount];
+                field.name = std::string_view(start, static_cast<size_t>(p - start));
+
+                p++;
+                while (p < end && isSpaceOrTab(*p))
+                    p++;
+                start = p;
+                for (;;)
+                {
+                    p = findDelimiter(p, end, false);
+                    if (p == end)
+                        return parseIncomplete;
+                    if (*p != '\t')
+                        break;
+                    p++;
+                }
+                if (*p != '\r')
+                    return parseError; // bare LF or a control character
+                if (end - p < 2)
+                    return parseIncomplete;
+                if (p[1] != '\n')
+                    return parseError;
+
+                const char *valueEnd = p;
+                while (valueEnd > start && isSpaceOrTab(valueEnd[-1]))
+                    valueEnd--;
+                field.value = std::string_view(start, static_cast<size_t>(valueEnd - start));
+                head.headerCount++;
+                p += 2;
+            }
+        }
+    }
+}
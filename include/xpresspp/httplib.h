@@ -157,6 +157,12 @@
 #define CPPHTTPLIB_RECV_BUFSIZ size_t(16384u)
 #endif
 
+// xpresspp: idle bytes detail::BufferPool keeps in buffers above 16 KB
+// (smaller ones live in slabs and always stay pooled)
+#ifndef CPPHTTPLIB_BUFFER_POOL_MAX_BYTES
+#define CPPHTTPLIB_BUFFER_POOL_MAX_BYTES size_t(16u * 1024u * 1024u)
+#endif
+
 #ifndef CPPHTTPLIB_SEND_BUFSIZ
 #define CPPHTTPLIB_SEND_BUFSIZ size_t(16384u)
 #endif
@@ -181,7 +187,9 @@
 #endif
 
 #ifndef CPPHTTPLIB_LISTEN_BACKLOG
-#define CPPHTTPLIB_LISTEN_BACKLOG 5
+// xpresspp: connection bursts (WebSocket clients reconnecting) overflow a
+// backlog of 5; the kernel caps this at net.core.somaxconn
+#define CPPHTTPLIB_LISTEN_BACKLOG 4096
 #endif
 
 #ifndef CPPHTTPLIB_MAX_LINE_LENGTH
@@ -267,6 +275,7 @@ using socklen_t = int;
 #include <pthread.h>
 #include <sys/mman.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <sys/un.h>
 #include <unistd.h>
 
@@ -309,6 +318,8 @@ using socket_t = int;
 #include <unordered_set>
 #include <utility>
 
+#include "http_parser.hpp" // xpresspp: bulk request-head parser
+
 #if defined(CPPHTTPLIB_USE_NON_BLOCKING_GETADDRINFO) || \
     defined(CPPHTTPLIB_USE_CERTS_FROM_MACOSX_KEYCHAIN)
 #if TARGET_OS_MAC
@@ -847,6 +858,7 @@ namespace httplib
   using UploadProgress = std::function<bool(size_t current, size_t total)>;
 
   struct Response;
+  class Stream;
   using ResponseHandler = std::function<bool(const Response &response)>;
 
   struct FormData
@@ -963,9 +975,14 @@ namespace httplib
     using FormDataReader =
         std::function<bool(FormDataHeader header, ContentReceiver receiver)>;
 
-    ContentReader(Reader reader, FormDataReader multipart_reader)
+    // xpresspp: reads the body the way a plain handler gets it
+    using BodyReader = std::function<bool()>;
+
+    ContentReader(Reader reader, FormDataReader multipart_reader,
+                  BodyReader body_reader = nullptr)
         : reader_(std::move(reader)),
-          formdata_reader_(std::move(multipart_reader)) {}
+          formdata_reader_(std::move(multipart_reader)),
+          body_reader_(std::move(body_reader)) {}
 
     bool operator()(FormDataHeader header, ContentReceiver receiver) const
     {
@@ -977,13 +994,23 @@ namespace httplib
       return reader_(std::move(receiver));
     }
 
+    // xpresspp: into Request::body (or Request::spilled_body), with the
+    // fast paths of read_content
+    bool read_body() const { return body_reader_ && body_reader_(); }
+
     Reader reader_;
     FormDataReader formdata_reader_;
+    BodyReader body_reader_;
   };
 
   using Range = std::pair<ssize_t, ssize_t>;
   using Ranges = std::vector<Range>;
 
+  namespace detail
+  {
+    class SpilledBody;
+  }
+
   struct Request
   {
     std::string method;
@@ -994,11 +1021,26 @@ namespace httplib
     Headers trailers;
     std::string body;
 
+    // xpresspp: set instead of `body` for a body over
+    // Server::set_body_spill_threshold; freed with the last reference
+    std::shared_ptr<detail::SpilledBody> spilled_body;
+
     std::string remote_addr;
     int remote_port = -1;
     std::string local_addr;
     int local_port = -1;
 
+    // xpresspp: the client process of a Unix-socket connection
+    // (Server::set_peer_credentials)
+    bool has_peer_credentials = false;
+    long peer_pid = -1;
+    long peer_uid = -1;
+    long peer_gid = -1;
+
+    // xpresspp: the handler may suspend the response
+    // (Response::suspend_handler): set on plain HTTP/1.x connections
+    bool suspendable = false;
+
     // for server
     std::string version;
     std::string target;
@@ -1090,6 +1132,20 @@ namespace httplib
                           const std::string &content_type);
     void set_file_content(const std::string &path);
 
+    // xpresspp: with status 101, runs once the response head is written and
+    // owns the connection from then on (WebSocket). The socket is released
+    // first, so it stays open after the handler returns.
+    std::function<void(Stream &strm)> upgrade_handler;
+
+    // xpresspp: set by a handler that finishes the response later, and
+    // only when Request::suspendable. Nothing is written when the handler
+    // returns: the worker goes back to the pool and the connection waits
+    // on no thread. suspend_handler receives `resume`, callable once from
+    // any thread; a worker then runs resume_handler (the rest of the
+    // response, if set), writes the response and serves the connection on.
+    std::function<void(std::function<void()> resume)> suspend_handler;
+    std::function<void(const Request &req, Response &res)> resume_handler;
+
     Response() = default;
     Response(const Response &) = default;
     Response &operator=(const Response &) = default;
@@ -1130,6 +1186,35 @@ namespace httplib
 
     virtual time_t duration() const = 0;
 
+    // xpresspp: direct access to the receive buffer, so a request head is
+    // parsed in bulk (xpresspp::http::parseRequestHead) instead of line by
+    // line. Streams without one (SSL) keep the line reader.
+    virtual bool has_read_buffer() const { return false; }
+    // Appends received bytes; grows the buffer only while fewer than
+    // max_size bytes are buffered. > 0 = bytes added, 0 = closed, < 0 = error
+    virtual ssize_t fill_read_buffer(size_t /*max_size*/) { return -1; }
+    virtual const char *read_buffer_data() const { return nullptr; }
+    virtual size_t read_buffer_size() const { return 0; }
+    virtual void consume_read_buffer(size_t /*n*/) {}
+
+    // xpresspp: while batching, writes are collected and sent together by
+    // flush_writes() (one sendmsg for pipelined responses). Turning
+    // batching off flushes. Streams without support write through.
+    virtual bool set_write_batching(bool /*on*/) { return true; }
+    virtual bool flush_writes() { return true; }
+
+    // xpresspp: between keep-alive requests: gives an empty receive buffer
+    // back to detail::BufferPool, so an idle connection holds none
+    virtual void release_buffers() {}
+
+    // xpresspp: one stream of an HTTP/2 connection (xpresspp/http2.hpp)
+    virtual bool is_http2() const { return false; }
+
+    // xpresspp: hands the socket over (protocol upgrades): the server no
+    // longer closes it when the connection ends. False where it cannot (SSL).
+    virtual bool release_socket() { return false; }
+    virtual bool socket_released() const { return false; }
+
     ssize_t write(const char *ptr);
     ssize_t write(const std::string &s);
   };
@@ -1373,6 +1458,13 @@ namespace httplib
     using Expect100ContinueHandler =
         std::function<int(const Request &, Response &)>;
 
+    // xpresspp: takes over a connection that starts HTTP/2 (h2c). Returns
+    // false to serve the request as HTTP/1.1. dispatch() runs one request
+    // read from the given stream, like a request of the connection.
+    using H2cHandler = std::function<bool(
+        Stream &conn, const Request &req,
+        const std::function<bool(Stream &)> &dispatch)>;
+
     Server();
 
     virtual ~Server();
@@ -1416,6 +1508,7 @@ namespace httplib
     Server &set_pre_request_handler(HandlerWithResponse handler);
 
     Server &set_expect_100_continue_handler(Expect100ContinueHandler handler);
+    Server &set_h2c_handler(H2cHandler handler);
     Server &set_logger(Logger logger);
     Server &set_pre_compression_logger(Logger logger);
     Server &set_error_logger(ErrorLogger error_logger);
@@ -1424,6 +1517,8 @@ namespace httplib
     Server &set_tcp_nodelay(bool on);
     Server &set_ipv6_v6only(bool on);
     Server &set_socket_options(SocketOptions socket_options);
+    // xpresspp: fill Request::peer_* from SO_PEERCRED on Unix sockets
+    Server &set_peer_credentials(bool on);
 
     Server &set_default_headers(Headers headers);
     Server &
@@ -1445,6 +1540,11 @@ namespace httplib
     Server &set_idle_interval(const std::chrono::duration<Rep, Period> &duration);
 
     Server &set_payload_max_length(size_t length);
+    Server &set_header_max_length(size_t length);
+    // xpresspp: bodies over `threshold` bytes go to a temp file in `dir`
+    // (Request::spilled_body) instead of Request::body; 0 = never
+    Server &set_body_spill_threshold(size_t threshold,
+                                     std::string dir = "/tmp");
 
     bool bind_to_port(const std::string &host, int port, int socket_flags = 0);
     int bind_to_any_port(const std::string &host, int socket_flags = 0);
@@ -1457,14 +1557,43 @@ namespace httplib
     void stop();
     void decommission();
 
+    // xpresspp: graceful stop and hot restart. listen_on() serves on a socket
+    // that is already bound and listening (handed over by another process).
+    // stop_accepting() leaves that socket open for whoever else holds it: the
+    // accept loop must poll (set_idle_interval) and the socket be
+    // non-blocking to notice. While stopped, keep-alive connections finish
+    // their current request with "Connection: close";
+    // close_connections() cuts off the ones still open after a deadline.
+    bool listen_on(socket_t sock);
+    socket_t listening_socket() const;
+    void stop_accepting();
+    // xpresspp: more bound, listening sockets for the same accept loop
+    // (TCP and Unix alike). Added before listen; the loop closes them once
+    // the main socket is stopped. They must be non-blocking.
+    void add_listening_socket(socket_t sock);
+    size_t connection_count() const;
+    void close_connections();
+
     std::function<TaskQueue *(void)> new_task_queue;
 
   protected:
+    // xpresspp: a response left to finish later (Response::suspend_handler)
+    // and the connection waiting for it
+    struct Suspended
+    {
+      socket_t sock = INVALID_SOCKET;
+      Request req;
+      Response res;
+      bool close_connection = false;
+      std::string buffered; // read past the request: pipelined requests
+    };
+
     bool process_request(Stream &strm, const std::string &remote_addr,
                          int remote_port, const std::string &local_addr,
                          int local_port, bool close_connection,
                          bool &connection_closed,
-                         const std::function<void(Request &)> &setup_request);
+                         const std::function<void(Request &)> &setup_request,
+                         std::shared_ptr<Suspended> *suspended = nullptr);
 
     std::atomic<socket_t> svr_sock_{INVALID_SOCKET};
     size_t keep_alive_max_count_ = CPPHTTPLIB_KEEPALIVE_MAX_COUNT;
@@ -1476,6 +1605,9 @@ namespace httplib
     time_t idle_interval_sec_ = CPPHTTPLIB_IDLE_INTERVAL_SECOND;
     time_t idle_interval_usec_ = CPPHTTPLIB_IDLE_INTERVAL_USECOND;
     size_t payload_max_length_ = CPPHTTPLIB_PAYLOAD_MAX_LENGTH;
+    size_t header_max_length_ = CPPHTTPLIB_HEADER_MAX_LENGTH;
+    size_t body_spill_threshold_ = 0;
+    std::string body_spill_dir_ = "/tmp";
 
   private:
     using Handlers =
@@ -1505,12 +1637,17 @@ namespace httplib
         const HandlersForContentReader &handlers) const;
 
     bool parse_request_line(const char *s, Request &req) const;
+    bool check_request_line(Request &req) const;
+    int read_request_head(Stream &strm, Request &req) const;
     void apply_ranges(const Request &req, Response &res,
                       std::string &content_type, std::string &boundary) const;
     bool write_response(Stream &strm, bool close_connection, Request &req,
                         Response &res);
     bool write_response_with_content(Stream &strm, bool close_connection,
                                      const Request &req, Response &res);
+    bool write_routed_response(Stream &strm, bool close_connection,
+                               bool &connection_closed, Request &req,
+                               Response &res);
     bool write_response_core(Stream &strm, bool close_connection,
                              const Request &req, Response &res,
                              bool need_apply_ranges);
@@ -1518,6 +1655,8 @@ namespace httplib
                                      Response &res, const std::string &boundary,
                                      const std::string &content_type);
     bool read_content(Stream &strm, Request &req, Response &res);
+    bool read_fixed_length_body(Stream &strm, Request &req, Response &res,
+                                bool &ok) const;
     bool read_content_with_content_receiver(Stream &strm, Request &req,
                                             Response &res,
                                             ContentReceiver receiver,
@@ -1529,6 +1668,9 @@ namespace httplib
                            ContentReceiver multipart_receiver) const;
 
     virtual bool process_and_close_socket(socket_t sock);
+    bool serve_connection(socket_t sock, std::shared_ptr<Suspended> resumed);
+    void resume_connection(std::shared_ptr<Suspended> suspended);
+    void wait_suspended();
 
     void output_log(const Request &req, const Response &res) const;
     void output_pre_compression_log(const Request &req,
@@ -1538,6 +1680,22 @@ namespace httplib
     std::atomic<bool> is_running_{false};
     std::atomic<bool> is_decommissioned{false};
 
+    // xpresspp: sockets being served, for drain and close_connections()
+    mutable std::mutex connections_mutex_;
+    std::unordered_set<socket_t> connections_;
+    std::vector<socket_t> extra_socks_;
+    size_t next_listener_ = 0;
+    bool peer_credentials_ = false;
+
+    // xpresspp: suspended connections resume on listen's task queue, which
+    // stays up until none is left
+    std::mutex suspended_mutex_;
+    std::condition_variable suspended_cv_;
+    size_t suspended_count_ = 0; // suspended, or resumed and still served
+    TaskQueue *task_queue_ = nullptr;
+
+    socket_t wait_listening_sockets();
+
     struct MountPointEntry
     {
       std::string mount_point;
@@ -1566,6 +1724,7 @@ namespace httplib
     Handler post_routing_handler_;
     HandlerWithResponse pre_request_handler_;
     Expect100ContinueHandler expect_100_continue_handler_;
+    H2cHandler h2c_handler_;
 
     mutable std::mutex logger_mutex_;
     Logger logger_;
@@ -4019,6 +4178,249 @@ namespace httplib
       return detail::read_socket(sock, &buf[0], sizeof(buf), MSG_PEEK) > 0;
     }
 
+    // xpresspp: receive and send buffers shared by every connection. A
+    // connection holds one only while bytes are in flight: the receive
+    // buffer goes back between keep-alive requests, batched writes once
+    // sent. Sizes are powers of two from 4 KB to 1 MB. Up to 16 KB they are
+    // carved from 64 KB slabs that stay with the pool; larger ones are kept
+    // up to CPPHTTPLIB_BUFFER_POOL_MAX_BYTES, beyond that freed.
+    class BufferPool
+    {
+    public:
+      static const size_t min_size = 4096;
+      static const size_t class_count = 9;      // 4 KB .. 1 MB
+      static const size_t slab_classes = 3;     // 4, 8 and 16 KB
+      static const size_t slab_size = 64 * 1024;
+
+      struct Stats
+      {
+        size_t in_use = 0;
+        size_t in_use_bytes = 0;
+        size_t free_bytes = 0; // pooled, ready for reuse
+        size_t slab_bytes = 0; // held by slabs, in use or not
+        size_t allocations = 0;
+        size_t reuses = 0;
+      };
+
+      static BufferPool &instance()
+      {
+        // Never destroyed: connection threads may still release at exit
+        static auto *pool = new BufferPool;
+        return *pool;
+      }
+
+      // At least `size` bytes; `capacity` is set to what was handed out
+      char *acquire(size_t size, size_t &capacity)
+      {
+        auto index = class_of(size);
+        capacity = index < class_count ? min_size << index : size;
+        in_use_++;
+        in_use_bytes_ += capacity;
+        if (index == class_count)
+        {
+          allocations_++;
+          return new char[capacity];
+        }
+
+        {
+          std::lock_guard<std::mutex> guard(mutex_[index]);
+          auto &list = free_[index];
+          if (list.empty() && index < slab_classes)
+          {
+            // Carve a slab: one heap allocation for several buffers
+            auto *slab = new char[slab_size];
+            allocations_++;
+            slab_bytes_ += slab_size;
+            for (size_t off = capacity; off < slab_size; off += capacity)
+            {
+              list.push_back(slab + off);
+            }
+            free_bytes_ += slab_size - capacity;
+            return slab;
+          }
+          if (!list.empty())
+          {
+            auto *data = list.back();
+            list.pop_back();
+            free_bytes_ -= capacity;
+            reuses_++;
+            return data;
+          }
+        }
+        allocations_++;
+        return new char[capacity];
+      }
+
+      void release(char *data, size_t capacity)
+      {
+        if (!data)
+        {
+          return;
+        }
+        in_use_--;
+        in_use_bytes_ -= capacity;
+
+        auto index = class_of(capacity);
+        if (index < slab_classes ||
+            (index < class_count &&
+             free_bytes_ + capacity <= CPPHTTPLIB_BUFFER_POOL_MAX_BYTES))
+        {
+          std::lock_guard<std::mutex> guard(mutex_[index]);
+          free_[index].push_back(data);
+          free_bytes_ += capacity;
+          return;
+        }
+        delete[] data;
+      }
+
+      Stats stats() const
+      {
+        Stats stats;
+        stats.in_use = in_use_;
+        stats.in_use_bytes = in_use_bytes_;
+        stats.free_bytes = free_bytes_;
+        stats.slab_bytes = slab_bytes_;
+        stats.allocations = allocations_;
+        stats.reuses = reuses_;
+        return stats;
+      }
+
+    private:
+      BufferPool() = default;
+
+      // Smallest class that fits; class_count = too big to pool
+      static size_t class_of(size_t size)
+      {
+        size_t index = 0;
+        while (index < class_count && (min_size << index) < size)
+        {
+          index++;
+        }
+        return index;
+      }
+
+      std::mutex mutex_[class_count];
+      std::vector<char *> free_[class_count];
+      std::atomic<size_t> in_use_{0};
+      std::atomic<size_t> in_use_bytes_{0};
+      std::atomic<size_t> free_bytes_{0};
+      std::atomic<size_t> slab_bytes_{0};
+      std::atomic<size_t> allocations_{0};
+      std::atomic<size_t> reuses_{0};
+    };
+
+    // xpresspp: a request body over Server::set_body_spill_threshold. It
+    // is written to an unlinked temp file (O_TMPFILE where the filesystem
+    // has it, so the file never has a name) and mapped read-only once
+    // complete: its pages belong to the page cache, not the heap, and the
+    // kernel can write them out under pressure. Unmapped and closed with
+    // the last reference. Not on Windows: create() fails, bodies stay in
+    // memory.
+    class SpilledBody
+    {
+    public:
+      static std::shared_ptr<SpilledBody> create(const std::string &dir)
+      {
+#ifdef _WIN32
+        (void)dir;
+        return nullptr;
+#else
+        int fd = -1;
+#ifdef O_TMPFILE
+        fd = ::open(dir.c_str(), O_TMPFILE | O_RDWR | O_CLOEXEC, 0600);
+#endif
+        if (fd < 0)
+        {
+          // No O_TMPFILE here: a named file, unlinked at once
+          auto path = dir + "/httplib-body-XXXXXX";
+          fd = ::mkstemp(&path[0]);
+          if (fd < 0)
+          {
+            return nullptr;
+          }
+          ::unlink(path.c_str());
+          ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+        }
+        std::shared_ptr<SpilledBody> body(new SpilledBody);
+        body->fd_ = fd;
+        return body;
+#endif
+      }
+
+      SpilledBody(const SpilledBody &) = delete;
+      SpilledBody &operator=(const SpilledBody &) = delete;
+
+      ~SpilledBody()
+      {
+#ifndef _WIN32
+        if (data_)
+        {
+          ::munmap(data_, size_);
+        }
+        if (fd_ >= 0)
+        {
+          ::close(fd_);
+        }
+#endif
+      }
+
+      bool write(const char *data, size_t n)
+      {
+#ifndef _WIN32
+        while (n > 0)
+        {
+          auto written = ::write(fd_, data, n);
+          if (written < 0 && errno == EINTR)
+          {
+            continue;
+          }
+          if (written <= 0)
+          {
+            return false;
+          }
+          data += written;
+          n -= static_cast<size_t>(written);
+          size_ += static_cast<size_t>(written);
+        }
+        return true;
+#else
+        (void)data;
+        return n == 0;
+#endif
+      }
+
+      // After the last write
+      bool map()
+      {
+#ifndef _WIN32
+        if (size_ == 0)
+        {
+          return true;
+        }
+        auto *addr = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd_, 0);
+        if (addr == MAP_FAILED)
+        {
+          return false;
+        }
+        data_ = static_cast<char *>(addr);
+        return true;
+#else
+        return false;
+#endif
+      }
+
+      const char *data() const { return data_; }
+      size_t size() const { return size_; }
+      int fd() const { return fd_; }
+
+    private:
+      SpilledBody() = default;
+
+      int fd_ = -1;
+      char *data_ = nullptr;
+      size_t size_ = 0;
+    };
+
     class SocketStream final : public Stream
     {
     public:
@@ -4039,8 +4441,27 @@ namespace httplib
       socket_t socket() const override;
       time_t duration() const override;
 
+      bool has_read_buffer() const override { return true; }
+      ssize_t fill_read_buffer(size_t max_size) override;
+      const char *read_buffer_data() const override;
+      size_t read_buffer_size() const override;
+      void consume_read_buffer(size_t n) override;
+      void prime_read_buffer(const std::string &data);
+
+      bool set_write_batching(bool on) override;
+      bool flush_writes() override;
+      void release_buffers() override;
+
+      bool release_socket() override
+      {
+        released_ = true;
+        return true;
+      }
+      bool socket_released() const override { return released_; }
+
     private:
       socket_t sock_;
+      bool released_ = false;
       time_t read_timeout_sec_;
       time_t read_timeout_usec_;
       time_t write_timeout_sec_;
@@ -4048,11 +4469,36 @@ namespace httplib
       time_t max_timeout_msec_;
       const std::chrono::time_point<std::chrono::steady_clock> start_time_;
 
-      std::vector<char> read_buff_;
+      // From BufferPool: taken on the first read, given back when empty
+      // between requests (release_buffers)
+      char *read_buff_ = nullptr;
+      size_t read_buff_capacity_ = 0;
       size_t read_buff_off_ = 0;
       size_t read_buff_content_size_ = 0;
 
       static const size_t read_buff_size_ = 1024l * 4;
+
+      // Batched writes: one iovec per segment. Small writes (a response
+      // head, a JSON body) share a segment; segments come from BufferPool
+      // and go back once sent.
+      struct Segment
+      {
+        char *data;
+        size_t size;
+        size_t capacity;
+      };
+      static constexpr size_t segment_size_ = 1024l * 4;
+      static constexpr size_t batch_max_bytes_ = 1024l * 64;
+      static constexpr size_t batch_max_segments_ = 64;
+
+      bool batching_ = false;
+      Segment segments_[batch_max_segments_] = {};
+      size_t segment_count_ = 0;
+      size_t pending_bytes_ = 0;
+
+      void acquire_read_buffer(size_t size);
+      bool send_segments(size_t count);
+      void release_segments(size_t count);
     };
 
 #ifdef CPPHTTPLIB_OPENSSL_SUPPORT
@@ -4090,7 +4536,8 @@ namespace httplib
 #endif
 
     inline bool keep_alive(const std::atomic<socket_t> &svr_sock, socket_t sock,
-                           time_t keep_alive_timeout_sec)
+                           time_t keep_alive_timeout_sec,
+                           bool first_request = false)
     {
       using namespace std::chrono;
 
@@ -4108,7 +4555,10 @@ namespace httplib
 
       while (true)
       {
-        if (svr_sock == INVALID_SOCKET)
+        // xpresspp: a connection accepted just before the stop gets a
+        // moment to send its first request
+        if (svr_sock == INVALID_SOCKET &&
+            !(first_request && steady_clock::now() - start < seconds{1}))
         {
           break; // Server socket is closed
         }
@@ -4134,18 +4584,23 @@ namespace httplib
       return false;
     }
 
-    template <typename T>
+    template <typename T, typename B>
     inline bool
     process_server_socket_core(const std::atomic<socket_t> &svr_sock, socket_t sock,
                                size_t keep_alive_max_count,
-                               time_t keep_alive_timeout_sec, T callback)
+                               time_t keep_alive_timeout_sec, T callback,
+                               B has_buffered_input)
     {
       assert(keep_alive_max_count > 0);
       auto ret = false;
       auto count = keep_alive_max_count;
-      while (count > 0 && keep_alive(svr_sock, sock, keep_alive_timeout_sec))
+      while (count > 0 && (has_buffered_input() ||
+                           keep_alive(svr_sock, sock, keep_alive_timeout_sec,
+                                      count == keep_alive_max_count)))
       {
-        auto close_connection = count == 1;
+        // xpresspp: a stopped server answers what it already received and
+        // tells the client to reconnect (to its successor)
+        auto close_connection = count == 1 || svr_sock == INVALID_SOCKET;
         auto connection_closed = false;
         ret = callback(close_connection, connection_closed);
         if (!ret || connection_closed)
@@ -4157,22 +4612,53 @@ namespace httplib
       return ret;
     }
 
-    template <typename T>
+    template <typename T, typename R>
     inline bool
     process_server_socket(const std::atomic<socket_t> &svr_sock, socket_t sock,
                           size_t keep_alive_max_count,
                           time_t keep_alive_timeout_sec, time_t read_timeout_sec,
                           time_t read_timeout_usec, time_t write_timeout_sec,
-                          time_t write_timeout_usec, T callback)
+                          time_t write_timeout_usec, T callback, R resume)
     {
+      // One stream per connection: bytes of pipelined requests stay in its
+      // buffer, and their responses go out in one batch once it runs dry
+      SocketStream strm(sock, read_timeout_sec, read_timeout_usec,
+                        write_timeout_sec, write_timeout_usec);
+
+      // xpresspp: a resumed connection first answers the request it was
+      // suspended on (no-op otherwise)
+      {
+        strm.set_write_batching(true);
+        auto connection_closed = false;
+        auto ret = resume(strm, connection_closed);
+        if (!ret || connection_closed || strm.read_buffer_size() == 0)
+        {
+          ret = strm.flush_writes() && ret;
+        }
+        if (!ret || connection_closed)
+        {
+          return ret;
+        }
+        strm.release_buffers();
+      }
+
       return process_server_socket_core(
           svr_sock, sock, keep_alive_max_count, keep_alive_timeout_sec,
           [&](bool close_connection, bool &connection_closed)
           {
-            SocketStream strm(sock, read_timeout_sec, read_timeout_usec,
-                              write_timeout_sec, write_timeout_usec);
-            return callback(strm, close_connection, connection_closed);
-          });
+            strm.set_write_batching(true);
+            auto ret = callback(strm, close_connection, connection_closed);
+            if (!ret || connection_closed || close_connection ||
+                strm.read_buffer_size() == 0)
+            {
+              ret = strm.flush_writes() && ret;
+            }
+            // Idle until the next request: buffers go back to the pool
+            strm.release_buffers();
+            return ret;
+          },
+          [&]
+          { return strm.read_buffer_size() > 0; });
     }
 
     inline bool process_client_socket(
@@ -5052,6 +5538,57 @@ namespace httplib
       }
     }
 
+    // xpresspp: pid / uid / gid of the process at the other end of a Unix
+    // socket; false for other families
+    inline bool get_peer_credentials(socket_t sock, long &pid, long &uid,
+                                     long &gid)
+    {
+#ifndef _WIN32
+      struct sockaddr_storage addr;
+      socklen_t addr_len = sizeof(addr);
+      if (getsockname(sock, reinterpret_cast<struct sockaddr *>(&addr),
+                      &addr_len) != 0 ||
+          addr.ss_family != AF_UNIX)
+      {
+        return false;
+      }
+#if defined(__linux__)
+      struct ucred ucred;
+      socklen_t len = sizeof(ucred);
+      if (getsockopt(sock, SOL_SOCKET, SO_PEERCRED, &ucred, &len) == 0)
+      {
+        pid = ucred.pid;
+        uid = ucred.uid;
+        gid = ucred.gid;
+        return true;
+      }
+#elif defined(__APPLE__) || defined(__FreeBSD__) || defined(__OpenBSD__) || \
+    defined(__NetBSD__)
+      uid_t euid;
+      gid_t egid;
+      if (getpeereid(sock, &euid, &egid) == 0)
+      {
+        uid = static_cast<long>(euid);
+        gid = static_cast<long>(egid);
+#if defined(SOL_LOCAL) && defined(LOCAL_PEERPID)
+        pid_t peer;
+        socklen_t len = sizeof(peer);
+        if (getsockopt(sock, SOL_LOCAL, LOCAL_PEERPID, &peer, &len) == 0)
+        {
+          pid = peer;
+        }
+#endif
+        return true;
+      }
+#endif
+#endif
+      (void)sock;
+      (void)pid;
+      (void)uid;
+      (void)gid;
+      return false;
+    }
+
     inline constexpr unsigned int str2tag_core(const char *s, size_t l,
                                                unsigned int h)
     {
@@ -5218,6 +5755,12 @@ namespace httplib
 
     inline EncodingType encoding_type(const Request &req, const Response &res)
     {
+      // Already encoded upstream (xpresspp compression stage)
+      if (res.has_header("Content-Encoding"))
+      {
+        return EncodingType::None;
+      }
+
       auto ret =
           detail::can_compress_content_type(res.get_header_value("Content-Type"));
       if (!ret)
@@ -8700,10 +9243,42 @@ namespace httplib
           read_timeout_usec_(read_timeout_usec),
           write_timeout_sec_(write_timeout_sec),
           write_timeout_usec_(write_timeout_usec),
-          max_timeout_msec_(max_timeout_msec), start_time_(start_time),
-          read_buff_(read_buff_size_, 0) {}
+          max_timeout_msec_(max_timeout_msec), start_time_(start_time) {}
+
+    inline SocketStream::~SocketStream()
+    {
+      flush_writes();
+      BufferPool::instance().release(read_buff_, read_buff_capacity_);
+    }
 
-    inline SocketStream::~SocketStream() = default;
+    // Swaps in a buffer of at least `size`, keeping the unconsumed bytes
+    inline void SocketStream::acquire_read_buffer(size_t size)
+    {
+      size_t capacity;
+      auto *data = BufferPool::instance().acquire(size, capacity);
+      auto remaining = read_buff_content_size_ - read_buff_off_;
+      if (remaining > 0)
+      {
+        memcpy(data, read_buff_ + read_buff_off_, remaining);
+      }
+      BufferPool::instance().release(read_buff_, read_buff_capacity_);
+      read_buff_ = data;
+      read_buff_capacity_ = capacity;
+      read_buff_off_ = 0;
+      read_buff_content_size_ = remaining;
+    }
+
+    inline void SocketStream::release_buffers()
+    {
+      if (read_buff_ && read_buff_off_ == read_buff_content_size_)
+      {
+        BufferPool::instance().release(read_buff_, read_buff_capacity_);
+        read_buff_ = nullptr;
+        read_buff_capacity_ = 0;
+        read_buff_off_ = 0;
+        read_buff_content_size_ = 0;
+      }
+    }
 
     inline bool SocketStream::is_readable() const
     {
@@ -8746,19 +9321,20 @@ namespace httplib
         auto remaining_size = read_buff_content_size_ - read_buff_off_;
         if (size <= remaining_size)
         {
-          memcpy(ptr, read_buff_.data() + read_buff_off_, size);
+          memcpy(ptr, read_buff_ + read_buff_off_, size);
           read_buff_off_ += size;
           return static_cast<ssize_t>(size);
         }
         else
         {
-          memcpy(ptr, read_buff_.data() + read_buff_off_, remaining_size);
+          memcpy(ptr, read_buff_ + read_buff_off_, remaining_size);
           read_buff_off_ += remaining_size;
           return static_cast<ssize_t>(remaining_size);
         }
       }
 
-      if (!wait_readable())
+      // The peer may be waiting for responses still batched here
+      if (!flush_writes() || !wait_readable())
       {
         return -1;
       }
@@ -8768,7 +9344,11 @@ namespace httplib
 
       if (size < read_buff_size_)
       {
-        auto n = read_socket(sock_, read_buff_.data(), read_buff_size_,
+        if (!read_buff_)
+        {
+          acquire_read_buffer(read_buff_size_);
+        }
+        auto n = read_socket(sock_, read_buff_, read_buff_capacity_,
                              CPPHTTPLIB_RECV_FLAGS);
         if (n <= 0)
         {
@@ -8776,12 +9356,12 @@ namespace httplib
         }
         else if (n <= static_cast<ssize_t>(size))
         {
-          memcpy(ptr, read_buff_.data(), static_cast<size_t>(n));
+          memcpy(ptr, read_buff_, static_cast<size_t>(n));
           return n;
         }
         else
         {
-          memcpy(ptr, read_buff_.data(), size);
+          memcpy(ptr, read_buff_, size);
           read_buff_off_ = size;
           read_buff_content_size_ = static_cast<size_t>(n);
           return static_cast<ssize_t>(size);
@@ -8793,64 +9373,254 @@ namespace httplib
       }
     }
 
-    inline ssize_t SocketStream::write(const char *ptr, size_t size)
+
+    inline ssize_t SocketStream::fill_read_buffer(size_t max_size)
     {
-      if (!wait_writable())
+      // Keep the unconsumed bytes at the front, then make room if full
+      if (!read_buff_)
+      {
+        acquire_read_buffer(read_buff_size_);
+      }
+      if (read_buff_off_ > 0)
+      {
+        auto remaining = read_buff_content_size_ - read_buff_off_;
+        memmove(read_buff_, read_buff_ + read_buff_off_, remaining);
+        read_buff_off_ = 0;
+        read_buff_content_size_ = remaining;
+      }
+      if (read_buff_content_size_ == read_buff_capacity_)
+      {
+        if (read_buff_capacity_ >= max_size)
+        {
+          return -1;
+        }
+        acquire_read_buffer((std::min)(read_buff_capacity_ * 2, max_size));
+      }
+
+      if (!flush_writes() || !wait_readable())
       {
         return -1;
       }
 
-#if defined(_WIN32) && !defined(_WIN64)
-      size =
-          (std::min)(size, static_cast<size_t>((std::numeric_limits<int>::max)()));
-#endif
+      auto n = read_socket(sock_, read_buff_ + read_buff_content_size_,
+                           read_buff_capacity_ - read_buff_content_size_,
+                           CPPHTTPLIB_RECV_FLAGS);
+      if (n > 0)
+      {
+        read_buff_content_size_ += static_cast<size_t>(n);
+      }
+      return n;
+    }
 
-      return send_socket(sock_, ptr, size, CPPHTTPLIB_SEND_FLAGS);
+    inline const char *SocketStream::read_buffer_data() const
+    {
+      return read_buff_ + read_buff_off_;
     }
 
-    inline void SocketStream::get_remote_ip_and_port(std::string &ip,
-                                                     int &port) const
+    inline size_t SocketStream::read_buffer_size() const
     {
-      return detail::get_remote_ip_and_port(sock_, ip, port);
+      return read_buff_content_size_ - read_buff_off_;
     }
 
-    inline void SocketStream::get_local_ip_and_port(std::string &ip,
-                                                    int &port) const
+    inline void SocketStream::consume_read_buffer(size_t n)
     {
-      return detail::get_local_ip_and_port(sock_, ip, port);
+      read_buff_off_ += (std::min)(n, read_buffer_size());
     }
 
-    inline socket_t SocketStream::socket() const { return sock_; }
+    // Bytes read from this socket by an earlier stream, served first
+    inline void SocketStream::prime_read_buffer(const std::string &data)
+    {
+      if (data.empty())
+      {
+        return;
+      }
+      size_t size = read_buff_size_;
+      acquire_read_buffer(data.size() > size ? data.size() : size);
+      memcpy(read_buff_ + read_buff_content_size_, data.data(), data.size());
+      read_buff_content_size_ += data.size();
+    }
 
-    inline time_t SocketStream::duration() const
+    inline bool SocketStream::set_write_batching(bool on)
     {
-      return std::chrono::duration_cast<std::chrono::milliseconds>(
-                 std::chrono::steady_clock::now() - start_time_)
-          .count();
+      batching_ = on;
+      return on || flush_writes();
     }
 
-    // Buffer stream implementation
-    inline bool BufferStream::is_readable() const { return true; }
+    inline void SocketStream::release_segments(size_t count)
+    {
+      for (size_t i = 0; i < count; i++)
+      {
+        BufferPool::instance().release(segments_[i].data, segments_[i].capacity);
+        segments_[i].data = nullptr;
+      }
+    }
 
-    inline bool BufferStream::wait_readable() const { return true; }
+    inline bool SocketStream::flush_writes()
+    {
+      if (pending_bytes_ == 0)
+      {
+        return true;
+      }
 
-    inline bool BufferStream::wait_writable() const { return true; }
+      auto count = segment_count_;
+      segment_count_ = 0;
+      pending_bytes_ = 0;
 
-    inline ssize_t BufferStream::read(char *ptr, size_t size)
-    {
-#if defined(_MSC_VER) && _MSC_VER < 1910
-      auto len_read = buffer._Copy_s(ptr, size, size, position);
-#else
-      auto len_read = buffer.copy(ptr, size, position);
-#endif
-      position += static_cast<size_t>(len_read);
-      return static_cast<ssize_t>(len_read);
+      auto ok = wait_writable() && send_segments(count);
+      release_segments(count);
+      return ok;
     }
 
-    inline ssize_t BufferStream::write(const char *ptr, size_t size)
+    inline bool SocketStream::send_segments(size_t count)
     {
-      buffer.append(ptr, size);
-      return static_cast<ssize_t>(size);
+#ifdef _WIN32
+      for (size_t i = 0; i < count; i++)
+      {
+        const auto &segment = segments_[i];
+        size_t offset = 0;
+        while (offset < segment.size)
+        {
+          auto n = send_socket(sock_, segment.data + offset,
+                               segment.size - offset, CPPHTTPLIB_SEND_FLAGS);
+          if (n <= 0)
+          {
+            return false;
+          }
+          offset += static_cast<size_t>(n);
+        }
+      }
+      return true;
+#else
+      struct iovec iov[batch_max_segments_];
+      for (size_t i = 0; i < count; i++)
+      {
+        iov[i].iov_base = segments_[i].data;
+        iov[i].iov_len = segments_[i].size;
+      }
+
+      // One sendmsg for the whole batch; partial sends resume mid-iovec
+      size_t first = 0;
+      while (first < count)
+      {
+        msghdr msg{};
+        msg.msg_iov = iov + first;
+        msg.msg_iovlen = count - first;
+        auto n = handle_EINTR([&]()
+                              { return sendmsg(sock_, &msg, CPPHTTPLIB_SEND_FLAGS); });
+        if (n <= 0)
+        {
+          return false;
+        }
+
+        auto sent = static_cast<size_t>(n);
+        while (first < count && sent >= iov[first].iov_len)
+        {
+          sent -= iov[first].iov_len;
+          first++;
+        }
+        if (sent > 0)
+        {
+          iov[first].iov_base = static_cast<char *>(iov[first].iov_base) + sent;
+          iov[first].iov_len -= sent;
+        }
+      }
+      return true;
+#endif
+    }
+    inline ssize_t SocketStream::write(const char *ptr, size_t size)
+    {
+      if (batching_ && size < batch_max_bytes_)
+      {
+        if (size == 0)
+        {
+          return 0;
+        }
+        if (segment_count_ > 0 &&
+            segments_[segment_count_ - 1].size + size <=
+                segments_[segment_count_ - 1].capacity)
+        {
+          auto &segment = segments_[segment_count_ - 1];
+          memcpy(segment.data + segment.size, ptr, size);
+          segment.size += size;
+        }
+        else
+        {
+          auto &segment = segments_[segment_count_++];
+          segment.data = BufferPool::instance().acquire(
+              (std::max)(size, segment_size_), segment.capacity);
+          memcpy(segment.data, ptr, size);
+          segment.size = size;
+        }
+        pending_bytes_ += size;
+
+        if (pending_bytes_ >= batch_max_bytes_ ||
+            segment_count_ == batch_max_segments_)
+        {
+          if (!flush_writes())
+          {
+            return -1;
+          }
+        }
+        return static_cast<ssize_t>(size);
+      }
+
+      // Too big to be worth copying: send what is queued, then this directly
+      if (!flush_writes() || !wait_writable())
+      {
+        return -1;
+      }
+
+#if defined(_WIN32) && !defined(_WIN64)
+      size =
+          (std::min)(size, static_cast<size_t>((std::numeric_limits<int>::max)()));
+#endif
+
+      return send_socket(sock_, ptr, size, CPPHTTPLIB_SEND_FLAGS);
+    }
+
+    inline void SocketStream::get_remote_ip_and_port(std::string &ip,
+                                                     int &port) const
+    {
+      return detail::get_remote_ip_and_port(sock_, ip, port);
+    }
+
+    inline void SocketStream::get_local_ip_and_port(std::string &ip,
+                                                    int &port) const
+    {
+      return detail::get_local_ip_and_port(sock_, ip, port);
+    }
+
+    inline socket_t SocketStream::socket() const { return sock_; }
+
+    inline time_t SocketStream::duration() const
+    {
+      return std::chrono::duration_cast<std::chrono::milliseconds>(
+                 std::chrono::steady_clock::now() - start_time_)
+          .count();
+    }
+
+    // Buffer stream implementation
+    inline bool BufferStream::is_readable() const { return true; }
+
+    inline bool BufferStream::wait_readable() const { return true; }
+
+    inline bool BufferStream::wait_writable() const { return true; }
+
+    inline ssize_t BufferStream::read(char *ptr, size_t size)
+    {
+#if defined(_MSC_VER) && _MSC_VER < 1910
+      auto len_read = buffer._Copy_s(ptr, size, size, position);
+#else
+      auto len_read = buffer.copy(ptr, size, position);
+#endif
+      position += static_cast<size_t>(len_read);
+      return static_cast<ssize_t>(len_read);
+    }
+
+    inline ssize_t BufferStream::write(const char *ptr, size_t size)
+    {
+      buffer.append(ptr, size);
+      return static_cast<ssize_t>(size);
     }
 
     inline void BufferStream::get_remote_ip_and_port(std::string & /*ip*/,
@@ -9201,6 +9971,12 @@ namespace httplib
     return *this;
   }
 
+  inline Server &Server::set_h2c_handler(H2cHandler handler)
+  {
+    h2c_handler_ = std::move(handler);
+    return *this;
+  }
+
   inline Server &Server::set_address_family(int family)
   {
     address_family_ = family;
@@ -9219,6 +9995,12 @@ namespace httplib
     return *this;
   }
 
+  inline Server &Server::set_peer_credentials(bool on)
+  {
+    peer_credentials_ = on;
+    return *this;
+  }
+
   inline Server &Server::set_socket_options(SocketOptions socket_options)
   {
     socket_options_ = std::move(socket_options);
@@ -9277,6 +10059,20 @@ namespace httplib
     return *this;
   }
 
+  inline Server &Server::set_body_spill_threshold(size_t threshold,
+                                                  std::string dir)
+  {
+    body_spill_threshold_ = threshold;
+    body_spill_dir_ = std::move(dir);
+    return *this;
+  }
+
+  inline Server &Server::set_header_max_length(size_t length)
+  {
+    header_max_length_ = length;
+    return *this;
+  }
+
   inline bool Server::bind_to_port(const std::string &host, int port,
                                    int socket_flags)
   {
@@ -9329,6 +10125,86 @@ namespace httplib
 
   inline void Server::decommission() { is_decommissioned = true; }
 
+  inline bool Server::listen_on(socket_t sock)
+  {
+    if (is_decommissioned || sock == INVALID_SOCKET)
+    {
+      return false;
+    }
+    svr_sock_ = sock;
+    return listen_internal();
+  }
+
+  inline socket_t Server::listening_socket() const { return svr_sock_; }
+
+  inline void Server::add_listening_socket(socket_t sock)
+  {
+    if (sock != INVALID_SOCKET)
+    {
+      extra_socks_.push_back(sock);
+    }
+  }
+
+  // A listening socket with a connection waiting, or INVALID_SOCKET on
+  // timeout (idle interval) or when stopped
+  inline socket_t Server::wait_listening_sockets()
+  {
+    std::vector<struct pollfd> fds;
+    fds.reserve(extra_socks_.size() + 1);
+    fds.push_back({svr_sock_, POLLIN, 0});
+    for (auto sock : extra_socks_)
+    {
+      fds.push_back({sock, POLLIN, 0});
+    }
+
+    auto timeout = (idle_interval_sec_ > 0 || idle_interval_usec_ > 0)
+                       ? static_cast<int>(idle_interval_sec_ * 1000 +
+                                          idle_interval_usec_ / 1000)
+                       : -1;
+    auto n = detail::poll_wrapper(fds.data(), static_cast<nfds_t>(fds.size()),
+                                  timeout);
+    if (n <= 0 || svr_sock_ == INVALID_SOCKET)
+    {
+      return INVALID_SOCKET;
+    }
+    // The scan starts after the last one served: a busy listener cannot
+    // starve the others
+    for (size_t i = 0; i < fds.size(); i++)
+    {
+      auto index = (next_listener_ + i) % fds.size();
+      if (fds[index].revents & (POLLIN | POLLERR | POLLHUP))
+      {
+        next_listener_ = index + 1;
+        return fds[index].fd;
+      }
+    }
+    return INVALID_SOCKET;
+  }
+
+  inline void Server::stop_accepting()
+  {
+    auto sock = svr_sock_.exchange(INVALID_SOCKET);
+    if (sock != INVALID_SOCKET)
+    {
+      detail::close_socket(sock);
+    }
+  }
+
+  inline size_t Server::connection_count() const
+  {
+    std::lock_guard<std::mutex> guard(connections_mutex_);
+    return connections_.size();
+  }
+
+  inline void Server::close_connections()
+  {
+    std::lock_guard<std::mutex> guard(connections_mutex_);
+    for (auto sock : connections_)
+    {
+      detail::shutdown_socket(sock); // the serving worker closes it
+    }
+  }
+
   inline bool Server::parse_request_line(const char *s, Request &req) const
   {
     auto len = strlen(s);
@@ -9357,6 +10233,11 @@ namespace httplib
       }
     }
 
+    return check_request_line(req);
+  }
+
+  inline bool Server::check_request_line(Request &req) const
+  {
     thread_local const std::set<std::string> methods{
         "GET", "HEAD", "POST", "PUT", "DELETE",
         "CONNECT", "OPTIONS", "TRACE", "PATCH", "PRI"};
@@ -9397,6 +10278,76 @@ namespace httplib
     return true;
   }
 
+  // xpresspp: request line + headers straight from the stream's receive
+  // buffer. 0 = ok, -1 = closed before a request started, else the error
+  // status to answer with.
+  inline int Server::read_request_head(Stream &strm, Request &req) const
+  {
+    xpresspp::http::RequestHead head;
+    long head_len = xpresspp::http::parseIncomplete;
+
+    for (;;)
+    {
+      auto size = strm.read_buffer_size();
+      if (size > 0)
+      {
+        head_len = xpresspp::http::parseRequestHead(strm.read_buffer_data(), size, head);
+        if (head_len != xpresspp::http::parseIncomplete)
+        {
+          break;
+        }
+      }
+
+      if (size >= header_max_length_)
+      {
+        // Still inside the request line: the target is what is too long
+        auto line_end = memchr(strm.read_buffer_data(), '\n', header_max_length_);
+        return line_end ? StatusCode::RequestHeaderFieldsTooLarge_431
+                        : StatusCode::UriTooLong_414;
+      }
+
+      if (strm.fill_read_buffer(header_max_length_) <= 0)
+      {
+        return size == 0 ? -1 : StatusCode::BadRequest_400;
+      }
+    }
+
+    if (head_len == xpresspp::http::parseError)
+    {
+      return StatusCode::BadRequest_400;
+    }
+    if (head_len == xpresspp::http::parseTooManyHeaders ||
+        static_cast<size_t>(head_len) > header_max_length_)
+    {
+      return StatusCode::RequestHeaderFieldsTooLarge_431;
+    }
+
+    req.method.assign(head.method.data(), head.method.size());
+    req.target.assign(head.target.data(), head.target.size());
+    req.version.assign(head.version.data(), head.version.size());
+
+    // Room for the REMOTE_/LOCAL_ entries added by process_request
+    req.headers.reserve(head.headerCount + 4);
+    for (size_t i = 0; i < head.headerCount; i++)
+    {
+      const auto &field = head.headers[i];
+      std::string key(field.name.data(), field.name.size());
+      std::string val(field.value.data(), field.value.size());
+
+      // Same decoding as parse_header, skipped when there is nothing to decode
+      if (field.value.find('%') != std::string_view::npos &&
+          !detail::case_ignore::equal(key, "Location") &&
+          !detail::case_ignore::equal(key, "Referer"))
+      {
+        val = decode_path_component(val);
+      }
+      req.headers.emplace(std::move(key), std::move(val));
+    }
+
+    strm.consume_read_buffer(static_cast<size_t>(head_len));
+    return 0;
+  }
+
   inline bool Server::write_response(Stream &strm, bool close_connection,
                                      Request &req, Response &res)
   {
@@ -9499,6 +10450,11 @@ namespace httplib
       }
       else if (res.content_provider_)
       {
+        // Streamed bodies (SSE, chunked) must not wait in a write batch
+        if (res.content_length_ == 0 && !strm.set_write_batching(false))
+        {
+          return false;
+        }
         if (write_content_with_provider(strm, req, res, boundary, content_type))
         {
           res.content_provider_success_ = true;
@@ -9591,17 +10547,120 @@ namespace httplib
     }
   }
 
+  // xpresspp: a plain body of known length is read straight into one
+  // allocation of its final size: no bounce through a receive buffer and no
+  // regrowth. false = not such a body (the generic path reads it).
+  inline bool Server::read_fixed_length_body(Stream &strm, Request &req,
+                                             Response &res, bool &ok) const
+  {
+    if (!req.has_header("Content-Length") ||
+        detail::is_chunked_transfer_encoding(req.headers) ||
+        req.has_header("Content-Encoding") || req.is_multipart_form_data())
+    {
+      return false;
+    }
+
+    auto is_invalid_value = false;
+    auto len = detail::get_header_value_u64(
+        req.headers, "Content-Length", (std::numeric_limits<size_t>::max)(), 0,
+        is_invalid_value);
+    if (is_invalid_value || len == 0 || len > payload_max_length_)
+    {
+      return false; // errors and 413 are answered as before
+    }
+
+    if (body_spill_threshold_ > 0 && len > body_spill_threshold_)
+    {
+      auto spilled = detail::SpilledBody::create(body_spill_dir_);
+      if (spilled)
+      {
+        // Through one pooled buffer, however large the body
+        size_t capacity;
+        auto *buf = detail::BufferPool::instance().acquire(64 * 1024, capacity);
+        uint64_t r = 0;
+        ok = true;
+        while (ok && r < len)
+        {
+          auto n = strm.read(
+              buf, static_cast<size_t>((std::min)(uint64_t(capacity), len - r)));
+          if (n <= 0)
+          {
+            res.status = StatusCode::BadRequest_400;
+            ok = false;
+          }
+          else if (!spilled->write(buf, static_cast<size_t>(n)))
+          {
+            res.status = StatusCode::InsufficientStorage_507;
+            ok = false;
+          }
+          r += n > 0 ? static_cast<uint64_t>(n) : 0;
+        }
+        detail::BufferPool::instance().release(buf, capacity);
+
+        if (ok && !spilled->map())
+        {
+          res.status = StatusCode::InternalServerError_500;
+          ok = false;
+        }
+        if (ok)
+        {
+          req.spilled_body = std::move(spilled);
+        }
+        return true;
+      }
+      // No temp file: read into memory as before
+    }
+
+    req.body.resize(static_cast<size_t>(len));
+    size_t r = 0;
+    while (r < len)
+    {
+      auto n = strm.read(&req.body[r], static_cast<size_t>(len) - r);
+      if (n <= 0)
+      {
+        req.body.resize(r);
+        res.status = StatusCode::BadRequest_400;
+        ok = false;
+        return true;
+      }
+      r += static_cast<size_t>(n);
+    }
+    ok = true;
+    return true;
+  }
+
   inline bool Server::read_content(Stream &strm, Request &req, Response &res)
   {
     FormFields::iterator cur_field;
     FormFiles::iterator cur_file;
     auto is_text_field = false;
     size_t count = 0;
-    if (read_content_core(
+    auto ok = false;
+    if (!read_fixed_length_body(strm, req, res, ok))
+    {
+      ok = read_content_core(
             strm, req, res,
             // Regular
             [&](const char *buf, size_t n)
             {
+              if (body_spill_threshold_ > 0 && !req.spilled_body &&
+                  req.body.size() + n > body_spill_threshold_)
+              {
+                // Over the threshold: what is buffered moves to a temp file
+                req.spilled_body = detail::SpilledBody::create(body_spill_dir_);
+                if (req.spilled_body)
+                {
+                  if (!req.spilled_body->write(req.body.data(), req.body.size()))
+                  {
+                    return false;
+                  }
+                  std::string().swap(req.body);
+                }
+              }
+              if (req.spilled_body)
+              {
+                return req.spilled_body->write(buf, n);
+              }
               if (req.body.size() + n > req.body.max_size())
               {
                 return false;
@@ -9652,12 +10711,22 @@ namespace httplib
                 content.append(buf, n);
               }
               return true;
-            }))
+            });
+      if (ok && req.spilled_body && !req.spilled_body->map())
+      {
+        res.status = StatusCode::InternalServerError_500;
+        ok = false;
+      }
+    }
+
+    if (ok)
     {
       const auto &content_type = req.get_header_value("Content-Type");
       if (!content_type.find("application/x-www-form-urlencoded"))
       {
-        if (req.body.size() > CPPHTTPLIB_FORM_URL_ENCODED_PAYLOAD_MAX_LENGTH)
+        auto size =
+            req.spilled_body ? req.spilled_body->size() : req.body.size();
+        if (size > CPPHTTPLIB_FORM_URL_ENCODED_PAYLOAD_MAX_LENGTH)
         {
           res.status = StatusCode::PayloadTooLarge_413; // NOTE: should be 414?
           output_error_log(Error::ExceedMaxPayloadSize, &req);
@@ -9686,7 +10755,9 @@ namespace httplib
     detail::FormDataParser multipart_form_data_parser;
     ContentReceiverWithProgress out;
 
-    if (req.is_multipart_form_data())
+    // xpresspp: without FormData callbacks a multipart body is passed
+    // through as is (xpresspp/multipart.hpp parses it)
+    if (req.is_multipart_form_data() && multipart_header)
     {
       const auto &content_type = req.get_header_value("Content-Type");
       std::string boundary;
@@ -9722,7 +10793,7 @@ namespace httplib
       return false;
     }
 
-    if (req.is_multipart_form_data())
+    if (req.is_multipart_form_data() && multipart_header)
     {
       if (!multipart_form_data_parser.is_valid())
       {
@@ -9887,32 +10958,50 @@ namespace httplib
 
     {
       std::unique_ptr<TaskQueue> task_queue(new_task_queue());
+      {
+        std::lock_guard<std::mutex> guard(suspended_mutex_);
+        task_queue_ = task_queue.get();
+      }
 
       while (svr_sock_ != INVALID_SOCKET)
       {
-#ifndef _WIN32
-        if (idle_interval_sec_ > 0 || idle_interval_usec_ > 0)
+        socket_t listener = svr_sock_;
+        if (!extra_socks_.empty())
         {
-#endif
-          auto val = detail::select_read(svr_sock_, idle_interval_sec_,
-                                         idle_interval_usec_);
-          if (val == 0)
-          { // Timeout
+          // xpresspp: several listeners, one loop
+          listener = wait_listening_sockets();
+          if (listener == INVALID_SOCKET)
+          {
             task_queue->on_idle();
             continue;
           }
-#ifndef _WIN32
         }
+        else
+        {
+#ifndef _WIN32
+          if (idle_interval_sec_ > 0 || idle_interval_usec_ > 0)
+          {
+#endif
+            auto val = detail::select_read(svr_sock_, idle_interval_sec_,
+                                           idle_interval_usec_);
+            if (val == 0)
+            { // Timeout
+              task_queue->on_idle();
+              continue;
+            }
+#ifndef _WIN32
+          }
 #endif
+        }
 
 #if defined _WIN32
         // sockets connected via WASAccept inherit flags NO_HANDLE_INHERIT,
         // OVERLAPPED
-        socket_t sock = WSAAccept(svr_sock_, nullptr, nullptr, nullptr, 0);
+        socket_t sock = WSAAccept(listener, nullptr, nullptr, nullptr, 0);
 #elif defined SOCK_CLOEXEC
-        socket_t sock = accept4(svr_sock_, nullptr, nullptr, SOCK_CLOEXEC);
+        socket_t sock = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
 #else
-        socket_t sock = accept(svr_sock_, nullptr, nullptr);
+        socket_t sock = accept(listener, nullptr, nullptr);
 #endif
 
         if (sock == INVALID_SOCKET)
@@ -9956,7 +11045,21 @@ namespace httplib
         }
       }
 
+      for (auto sock : extra_socks_)
+      {
+        detail::close_socket(sock);
+      }
+      extra_socks_.clear();
+
+      // xpresspp: suspended responses finish on the queue first. A request
+      // suspended while it shuts down resumes on the thread calling done().
+      wait_suspended();
+      {
+        std::lock_guard<std::mutex> guard(suspended_mutex_);
+        task_queue_ = nullptr;
+      }
       task_queue->shutdown();
+      wait_suspended();
     }
 
     is_decommissioned = !ret;
@@ -9982,6 +11085,13 @@ namespace httplib
     {
       // Content reader handler
       {
+        // xpresspp: a read that stopped part way (an error, or a receiver
+        // that said no) leaves body bytes on the connection: it is closed
+        auto close_after_read = [&]
+        {
+          req.headers.erase("Connection");
+          req.headers.emplace("Connection", "close");
+        };
         ContentReader reader(
             [&](ContentReceiver receiver)
             {
@@ -9989,6 +11099,7 @@ namespace httplib
                   strm, req, res, std::move(receiver), nullptr, nullptr);
               if (!result)
               {
+                close_after_read();
                 output_error_log(Error::Read, &req);
               }
               return result;
@@ -10000,9 +11111,19 @@ namespace httplib
                   std::move(receiver));
               if (!result)
               {
+                close_after_read();
                 output_error_log(Error::Read, &req);
               }
               return result;
+            },
+            [&]
+            {
+              auto result = read_content(strm, req, res);
+              if (!result)
+              {
+                close_after_read();
+              }
+              return result;
             });
 
         if (req.method == "POST")
@@ -10280,61 +11401,132 @@ namespace httplib
                           int remote_port, const std::string &local_addr,
                           int local_port, bool close_connection,
                           bool &connection_closed,
-                          const std::function<void(Request &)> &setup_request)
+                          const std::function<void(Request &)> &setup_request,
+                          std::shared_ptr<Suspended> *suspended)
   {
-    std::array<char, 2048> buf{};
-
-    detail::stream_line_reader line_reader(strm, buf.data(), buf.size());
+    Request req;
+    Response res;
+    req.suspendable = suspended != nullptr;
 
-    // Connection has been closed on client
-    if (!line_reader.getline())
+    if (strm.has_read_buffer())
     {
-      return false;
-    }
+      auto status = read_request_head(strm, req);
 
-    Request req;
-    req.start_time_ = std::chrono::steady_clock::now();
+      // Connection has been closed on client
+      if (status < 0)
+      {
+        return false;
+      }
 
-    Response res;
-    res.version = "HTTP/1.1";
-    res.headers = default_headers_;
+      req.start_time_ = std::chrono::steady_clock::now();
+      res.version = "HTTP/1.1";
+      res.headers = default_headers_;
 
+      // h2c: the prior-knowledge preface ("PRI * HTTP/2.0") or an upgrade
+      if (status == 0 && h2c_handler_ &&
+          (req.method == "PRI" || req.has_header("HTTP2-Settings")))
+      {
+        auto dispatch = [&](Stream &stream)
+        {
+          auto closed = false;
+          return process_request(stream, remote_addr, remote_port, local_addr,
+                                 local_port, false, closed, setup_request);
+        };
+        if (h2c_handler_(strm, req, dispatch))
+        {
+          connection_closed = true;
+          return true;
+        }
+      }
+
+      auto error = status == StatusCode::UriTooLong_414 ? Error::ExceedUriMaxLength
+                                                        : Error::InvalidHeaders;
+      if (status == 0 && !check_request_line(req))
+      {
+        status = StatusCode::BadRequest_400;
+        error = Error::InvalidRequestLine;
+      }
+      else if (status == 0 &&
+               req.target.size() > CPPHTTPLIB_REQUEST_URI_MAX_LENGTH)
+      {
+        status = StatusCode::UriTooLong_414;
+        error = Error::ExceedUriMaxLength;
+      }
 #ifdef __APPLE__
-    // Socket file descriptor exceeded FD_SETSIZE...
-    if (strm.socket() >= FD_SETSIZE)
-    {
-      Headers dummy;
-      detail::read_headers(strm, dummy);
-      res.status = StatusCode::InternalServerError_500;
-      output_error_log(Error::ExceedMaxSocketDescriptorCount, &req);
-      return write_response(strm, close_connection, req, res);
-    }
+      else if (status == 0 && strm.socket() >= FD_SETSIZE)
+      {
+        res.status = StatusCode::InternalServerError_500;
+        output_error_log(Error::ExceedMaxSocketDescriptorCount, &req);
+        return write_response(strm, close_connection, req, res);
+      }
 #endif
 
-    // Request line and headers
-    if (!parse_request_line(line_reader.ptr(), req))
-    {
-      res.status = StatusCode::BadRequest_400;
-      output_error_log(Error::InvalidRequestLine, &req);
-      return write_response(strm, close_connection, req, res);
+      if (status != 0)
+      {
+        res.status = status;
+        output_error_log(error, &req);
+        // The rest of the head was not read: do not try to reuse the connection
+        return write_response(strm, true, req, res);
+      }
     }
-
-    // Request headers
-    if (!detail::read_headers(strm, req.headers))
+    else
     {
-      res.status = StatusCode::BadRequest_400;
-      output_error_log(Error::InvalidHeaders, &req);
-      return write_response(strm, close_connection, req, res);
+      std::array<char, 2048> buf{};
+
+      detail::stream_line_reader line_reader(strm, buf.data(), buf.size());
+
+      // Connection has been closed on client
+      if (!line_reader.getline())
+      {
+        return false;
+      }
+
+      req.start_time_ = std::chrono::steady_clock::now();
+      res.version = "HTTP/1.1";
+      res.headers = default_headers_;
+
+#ifdef __APPLE__
+      // Socket file descriptor exceeded FD_SETSIZE...
+      if (strm.socket() >= FD_SETSIZE)
+      {
+        Headers dummy;
+        detail::read_headers(strm, dummy);
+        res.status = StatusCode::InternalServerError_500;
+        output_error_log(Error::ExceedMaxSocketDescriptorCount, &req);
+        return write_response(strm, close_connection, req, res);
+      }
+#endif
+
+      // Request line and headers
+      if (!parse_request_line(line_reader.ptr(), req))
+      {
+        res.status = StatusCode::BadRequest_400;
+        output_error_log(Error::InvalidRequestLine, &req);
+        return write_response(strm, close_connection, req, res);
+      }
+
+      // Request headers
+      if (!detail::read_headers(strm, req.headers))
+      {
+        res.status = StatusCode::BadRequest_400;
+        output_error_log(Error::InvalidHeaders, &req);
+        return write_response(strm, close_connection, req, res);
+      }
+
+      // Check if the request URI doesn't exceed the limit
+      if (req.target.size() > CPPHTTPLIB_REQUEST_URI_MAX_LENGTH)
+      {
+        Headers dummy;
+        detail::read_headers(strm, dummy);
+        res.status = StatusCode::UriTooLong_414;
+        output_error_log(Error::ExceedUriMaxLength, &req);
+        return write_response(strm, close_connection, req, res);
+      }
     }
 
-    // Check if the request URI doesn't exceed the limit
-    if (req.target.size() > CPPHTTPLIB_REQUEST_URI_MAX_LENGTH)
+    if (strm.is_http2())
     {
-      Headers dummy;
-      detail::read_headers(strm, dummy);
-      res.status = StatusCode::UriTooLong_414;
-      output_error_log(Error::ExceedUriMaxLength, &req);
-      return write_response(strm, close_connection, req, res);
+      req.version = "HTTP/2";
     }
 
     if (req.get_header_value("Connection") == "close")
@@ -10467,70 +11659,173 @@ namespace httplib
       }
     }
 #endif
+    // xpresspp: a content reader that stopped part way marked the
+    // connection for closing (see routing)
+    if (req.get_header_value("Connection") == "close")
+    {
+      connection_closed = true;
+    }
+
     if (routed)
+    {
+      // xpresspp: the handler finishes the response later. The connection
+      // leaves this thread with everything read past the request; the
+      // caller hands `res.suspend_handler` a way to resume it.
+      if (res.suspend_handler)
+      {
+        if (suspended && strm.release_socket())
+        {
+          auto s = std::make_shared<Suspended>();
+          s->buffered.assign(strm.read_buffer_data(), strm.read_buffer_size());
+          strm.consume_read_buffer(strm.read_buffer_size());
+          s->close_connection = close_connection || connection_closed;
+          s->req = std::move(req);
+          s->res = std::move(res);
+          *suspended = std::move(s);
+          connection_closed = true;
+          return true;
+        }
+
+        // Not suspendable here: wait on this thread
+        std::mutex mutex;
+        std::condition_variable cv;
+        auto resumed = false;
+        auto suspend = std::move(res.suspend_handler);
+        suspend([&]()
+                {
+          std::lock_guard<std::mutex> guard(mutex);
+          resumed = true;
+          cv.notify_one(); });
+        {
+          std::unique_lock<std::mutex> lock(mutex);
+          cv.wait(lock, [&]
+                  { return resumed; });
+        }
+        auto resume = std::move(res.resume_handler);
+        if (resume)
+        {
+          resume(req, res);
+        }
+      }
+
+      return write_routed_response(strm, close_connection, connection_closed,
+                                   req, res);
+    }
+    else
     {
       if (res.status == -1)
       {
-        res.status = req.ranges.empty() ? StatusCode::OK_200
-                                        : StatusCode::PartialContent_206;
+        res.status = StatusCode::NotFound_404;
       }
 
-      // Serve file content by using a content provider
-      if (!res.file_content_path_.empty())
+      return write_response(strm, close_connection, req, res);
+    }
+  }
+
+  // The response of a request that found its handler
+  inline bool Server::write_routed_response(Stream &strm, bool close_connection,
+                                            bool &connection_closed,
+                                            Request &req, Response &res)
+  {
+    if (res.status == -1)
+    {
+      res.status = req.ranges.empty() ? StatusCode::OK_200
+                                      : StatusCode::PartialContent_206;
+    }
+
+    // xpresspp: protocol switch. The head goes out as is (no body, no
+    // keep-alive headers), then the upgrade handler takes the connection.
+    if (res.status == StatusCode::SwitchingProtocol_101 && res.upgrade_handler)
+    {
+      if (!strm.release_socket())
       {
-        const auto &path = res.file_content_path_;
-        auto mm = std::make_shared<detail::mmap>(path.c_str());
-        if (!mm->is_open())
-        {
-          res.body.clear();
-          res.content_length_ = 0;
-          res.content_provider_ = nullptr;
-          res.status = StatusCode::NotFound_404;
-          output_error_log(Error::OpenFile, &req);
-          return write_response(strm, close_connection, req, res);
-        }
+        res.upgrade_handler = nullptr;
+        res.headers.clear();
+        res.status = StatusCode::NotImplemented_501;
+        return write_response(strm, close_connection, req, res);
+      }
 
-        auto content_type = res.file_content_content_type_;
-        if (content_type.empty())
-        {
-          content_type = detail::find_content_type(
-              path, file_extension_and_mimetype_map_, default_file_mimetype_);
-        }
+      if (post_routing_handler_)
+      {
+        post_routing_handler_(req, res);
+      }
 
-        res.set_content_provider(
-            mm->size(), content_type,
-            [mm](size_t offset, size_t length, DataSink &sink) -> bool
-            {
-              sink.write(mm->data() + offset, length);
-              return true;
-            });
+      detail::BufferStream bstrm;
+      if (!detail::write_response_line(bstrm, res.status) ||
+          !header_writer_(bstrm, res.headers))
+      {
+        return false;
       }
+      auto &data = bstrm.get_buffer();
+      auto ok = detail::write_data(strm, data.data(), data.size()) &&
+                strm.flush_writes();
+      output_log(req, res);
+      connection_closed = true;
+      if (ok)
+      {
+        res.upgrade_handler(strm);
+      }
+      return ok;
+    }
 
-      if (detail::range_error(req, res))
+    // Serve file content by using a content provider
+    if (!res.file_content_path_.empty())
+    {
+      const auto &path = res.file_content_path_;
+      auto mm = std::make_shared<detail::mmap>(path.c_str());
+      if (!mm->is_open())
       {
         res.body.clear();
         res.content_length_ = 0;
         res.content_provider_ = nullptr;
-        res.status = StatusCode::RangeNotSatisfiable_416;
+        res.status = StatusCode::NotFound_404;
+        output_error_log(Error::OpenFile, &req);
         return write_response(strm, close_connection, req, res);
       }
 
-      return write_response_with_content(strm, close_connection, req, res);
-    }
-    else
-    {
-      if (res.status == -1)
+      auto content_type = res.file_content_content_type_;
+      if (content_type.empty())
       {
-        res.status = StatusCode::NotFound_404;
+        content_type = detail::find_content_type(
+            path, file_extension_and_mimetype_map_, default_file_mimetype_);
       }
 
+      res.set_content_provider(
+          mm->size(), content_type,
+          [mm](size_t offset, size_t length, DataSink &sink) -> bool
+          {
+            sink.write(mm->data() + offset, length);
+            return true;
+          });
+    }
+
+    if (detail::range_error(req, res))
+    {
+      res.body.clear();
+      res.content_length_ = 0;
+      res.content_provider_ = nullptr;
+      res.status = StatusCode::RangeNotSatisfiable_416;
       return write_response(strm, close_connection, req, res);
     }
+
+    return write_response_with_content(strm, close_connection, req, res);
   }
 
   inline bool Server::is_valid() const { return true; }
 
   inline bool Server::process_and_close_socket(socket_t sock)
+  {
+    {
+      std::lock_guard<std::mutex> guard(connections_mutex_);
+      connections_.insert(sock);
+    }
+    return serve_connection(sock, nullptr);
+  }
+
+  // xpresspp: serves a connection until it closes, is handed over, or
+  // suspends a response; `resumed` is the suspended response to write first
+  inline bool Server::serve_connection(socket_t sock,
+                                       std::shared_ptr<Suspended> resumed)
   {
     std::string remote_addr;
     int remote_port = 0;
@@ -10540,22 +11835,120 @@ namespace httplib
     int local_port = 0;
     detail::get_local_ip_and_port(sock, local_addr, local_port);
 
+    // xpresspp: read once per connection, copied into each request
+    std::function<void(Request &)> setup_request;
+    long peer_pid = -1, peer_uid = -1, peer_gid = -1;
+    if (peer_credentials_ &&
+        detail::get_peer_credentials(sock, peer_pid, peer_uid, peer_gid))
+    {
+      setup_request = [&](Request &req)
+      {
+        req.has_peer_credentials = true;
+        req.peer_pid = peer_pid;
+        req.peer_uid = peer_uid;
+        req.peer_gid = peer_gid;
+      };
+    }
+
+    auto released = false;
+    std::shared_ptr<Suspended> suspended;
     auto ret = detail::process_server_socket(
         svr_sock_, sock, keep_alive_max_count_, keep_alive_timeout_sec_,
         read_timeout_sec_, read_timeout_usec_, write_timeout_sec_,
         write_timeout_usec_,
         [&](Stream &strm, bool close_connection, bool &connection_closed)
         {
-          return process_request(strm, remote_addr, remote_port, local_addr,
-                                 local_port, close_connection, connection_closed,
-                                 nullptr);
+          auto ret = process_request(strm, remote_addr, remote_port, local_addr,
+                                     local_port, close_connection, connection_closed,
+                                     setup_request, &suspended);
+          released = released || strm.socket_released();
+          return ret;
+        },
+        [&](detail::SocketStream &strm, bool &connection_closed)
+        {
+          if (!resumed)
+          {
+            return true;
+          }
+          strm.prime_read_buffer(resumed->buffered);
+          auto resume = std::move(resumed->res.resume_handler);
+          if (resume)
+          {
+            resume(resumed->req, resumed->res);
+          }
+          auto close_connection =
+              resumed->close_connection || svr_sock_ == INVALID_SOCKET;
+          connection_closed = close_connection;
+          auto ret = write_routed_response(strm, close_connection,
+                                           connection_closed, resumed->req,
+                                           resumed->res);
+          released = strm.socket_released();
+          return ret;
         });
 
-    detail::shutdown_socket(sock);
-    detail::close_socket(sock);
+    // Still tracked while suspended: drain and close_connections() see it
+    if (suspended)
+    {
+      suspended->sock = sock;
+      if (!resumed)
+      {
+        std::lock_guard<std::mutex> guard(suspended_mutex_);
+        suspended_count_++;
+      }
+      auto suspend = std::move(suspended->res.suspend_handler);
+      suspend([this, suspended]()
+              { resume_connection(suspended); });
+      return ret;
+    }
+    if (resumed)
+    {
+      std::lock_guard<std::mutex> guard(suspended_mutex_);
+      if (--suspended_count_ == 0)
+      {
+        suspended_cv_.notify_all();
+      }
+    }
+
+    // Untracked before the descriptor can be reused by another accept
+    {
+      std::lock_guard<std::mutex> guard(connections_mutex_);
+      connections_.erase(sock);
+    }
+
+    // An upgrade handler that released the socket owns it now
+    if (!released)
+    {
+      detail::shutdown_socket(sock);
+      detail::close_socket(sock);
+    }
     return ret;
   }
 
+  // xpresspp: called once per suspension, from any thread
+  inline void Server::resume_connection(std::shared_ptr<Suspended> suspended)
+  {
+    {
+      std::lock_guard<std::mutex> guard(suspended_mutex_);
+      if (task_queue_ && task_queue_->enqueue([this, suspended]()
+                                              { serve_connection(suspended->sock, suspended); }))
+      {
+        return;
+      }
+    }
+    // Queue full or shut down: answer from this thread, then close
+    suspended->close_connection = true;
+    serve_connection(suspended->sock, suspended);
+  }
+
+  // xpresspp: until no connection is suspended or finishing a resumed
+  // response
+  inline void Server::wait_suspended()
+  {
+    std::unique_lock<std::mutex> lock(suspended_mutex_);
+    suspended_cv_.wait(lock, [this]
+                       { return suspended_count_ == 0; });
+  }
+
   inline void Server::output_log(const Request &req, const Response &res) const
   {
     if (logger_)
@@ -13059,7 +14452,9 @@ namespace httplib
             SSLSocketStream strm(sock, ssl, read_timeout_sec, read_timeout_usec,
                                  write_timeout_sec, write_timeout_usec);
             return callback(strm, close_connection, connection_closed);
-          });
+          },
+          []
+          { return false; });
     }
 
     template <typename T>
@@ -0,0 +1,572 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <optional>
+#include <limits>
+#include <stdexcept>
+#include <charconv>
+#include <cstdint>
+#include <type_traits>
+#include <nlohmann/json.hpp>
+
+namespace xpresspp
+{
+    // 🔥 Body binding error (JSON pointer of the offending value + reason)
+    class BindError : public std::runtime_error
+    {
+    public:
+        BindError(const std::string &pointer, const std::string &message)
+            : std::runtime_error((pointer.empty() ? std::string("(root)") : pointer) + ": " + message),
+              pointer_(pointer), message_(message) {}
+
+        const std::string &pointer() const { return pointer_; }
+        const std::string &message() const { return message_; }
+
+    private:
+        std::string pointer_;
+        std::string message_;
+    };
+
+    struct JsonBindOps;
+
+    // 🔥 Type-erased destination for one JSON value (ops == nullptr skips it)
+    struct JsonBindSlot
+    {
+        void *target = nullptr;
+        const JsonBindOps *ops = nullptr;
+    };
+
+    // Per-type handlers; a null entry means "this JSON type is not accepted"
+    struct JsonBindOps
+    {
+        const char *expected;
+        bool (*null)(void *);
+        bool (*boolean)(void *, bool);
+        bool (*integer)(void *, int64_t);
+        bool (*unsignedInt)(void *, uint64_t);
+        bool (*floating)(void *, double);
+        bool (*string)(void *, std::string &);
+        bool (*beginObject)(void *);
+        JsonBindSlot (*member)(void *, std::string &key);
+        bool (*beginArray)(void *);
+        JsonBindSlot (*element)(void *, size_t index);
+        // Wrappers (std::optional): consume a null or hand out the inner slot
+        JsonBindSlot (*unwrap)(void *, bool isNull);
+        // Subtree captured as a DOM, then converted (json / from_json types)
+        void (*fromDom)(void *, nlohmann::json &);
+    };
+
+    template <typename T, typename = void>
+    struct JsonBind;
+
+    template <typename T>
+    JsonBindSlot bindSlot(T &target)
+    {
+        return {&target, &JsonBind<T>::ops};
+    }
+
+    namespace bind_detail
+    {
+        // bindJsonField(T&, std::string_view) found by ADL (see XPRESSPP_JSON)
+        template <typename T, typename = void>
+        struct has_bind_field : std::false_type
+        {
+        };
+
+        template <typename T>
+        struct has_bind_field<T, std::void_t<decltype(bindJsonField(std::declval<T &>(), std::declval<std::string_view>()))>>
+            : std::true_type
+        {
+        };
+
+        template <typename T>
+        struct is_vector : std::false_type
+        {
+        };
+
+        template <typename T, typename A>
+        struct is_vector<std::vector<T, A>> : std::true_type
+        {
+        };
+
+        template <typename T>
+        struct is_string_map : std::false_type
+        {
+        };
+
+        template <typename V, typename C, typename A>
+        struct is_string_map<std::map<std::string, V, C, A>> : std::true_type
+        {
+        };
+
+        template <typename V, typename H, typename E, typename A>
+        struct is_string_map<std::unordered_map<std::string, V, H, E, A>> : std::true_type
+        {
+        };
+
+        template <typename T, typename V>
+        bool assignInteger(void *target, V v)
+        {
+            if constexpr (std::is_signed<V>::value && std::is_unsigned<T>::value)
+            {
+                if (v < 0)
+                    return false;
+            }
+            if constexpr (std::is_signed<V>::value && std::is_signed<T>::value)
+            {
+                if (v < static_cast<V>(std::numeric_limits<T>::min()))
+                    return false;
+            }
+            if (static_cast<uint64_t>(v) > static_cast<uint64_t>(std::numeric_limits<T>::max()) && !(std::is_signed<V>::value && v < 0))
+                return false;
+
+            *static_cast<T *>(target) = static_cast<T>(v);
+            return true;
+        }
+    }
+
+    // ==========================================
+    // 🔥 Built-in bindings
+    // ==========================================
+
+    template <>
+    struct JsonBind<bool>
+    {
+        static constexpr JsonBindOps ops = {
+            "boolean", nullptr,
+            [](void *t, bool v)
+            { *static_cast<bool *>(t) = v; return true; },
+            nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr};
+    };
+
+    template <typename T>
+    struct JsonBind<T, std::enable_if_t<std::is_integral<T>::value && !std::is_same<T, bool>::value>>
+    {
+        static constexpr JsonBindOps ops = {
+            "integer", nullptr, nullptr,
+            [](void *t, int64_t v)
+            { return bind_detail::assignInteger<T>(t, v); },
+            [](void *t, uint64_t v)
+            { return bind_detail::assignInteger<T>(t, v); },
+            nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr};
+    };
+
+    template <typename T>
+    struct JsonBind<T, std::enable_if_t<std::is_floating_point<T>::value>>
+    {
+        static constexpr JsonBindOps ops = {
+            "number", nullptr, nullptr,
+            [](void *t, int64_t v)
+            { *static_cast<T *>(t) = static_cast<T>(v); return true; },
+            [](void *t, uint64_t v)
+            { *static_cast<T *>(t) = static_cast<T>(v); return true; },
+            [](void *t, double v)
+            { *static_cast<T *>(t) = static_cast<T>(v); return true; },
+            nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr};
+    };
+
+    template <>
+    struct JsonBind<std::string>
+    {
+        // assign() copies out of the lexer's token buffer: one exact-size allocation
+        static constexpr JsonBindOps ops = {
+            "string", nullptr, nullptr, nullptr, nullptr, nullptr,
+            [](void *t, std::string &v)
+            { static_cast<std::string *>(t)->assign(v); return true; },
+            nullptr, nullptr, nullptr, nullptr, nullptr, nullptr};
+    };
+
+    template <typename T>
+    struct JsonBind<std::optional<T>>
+    {
+        static constexpr JsonBindOps ops = {
+            "optional", nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
+            [](void *t, bool isNull) -> JsonBindSlot
+            {
+                auto &opt = *static_cast<std::optional<T> *>(t);
+                if (isNull)
+                {
+                    opt.reset();
+                    return {};
+                }
+                return bindSlot(opt.emplace());
+            },
+            nullptr};
+    };
+
+    template <typename T>
+    struct JsonBind<T, std::enable_if_t<bind_detail::is_vector<T>::value>>
+    {
+        static constexpr JsonBindOps ops = {
+            "array", nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
+            [](void *t)
+            { static_cast<T *>(t)->clear(); return true; },
+            [](void *t, size_t) -> JsonBindSlot
+            { return bindSlot(static_cast<T *>(t)->emplace_back()); },
+            nullptr, nullptr};
+    };
+
+    template <typename T>
+    struct JsonBind<T, std::enable_if_t<bind_detail::is_string_map<T>::value>>
+    {
+        static constexpr JsonBindOps ops = {
+            "object", nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
+            [](void *t)
+            { static_cast<T *>(t)->clear(); return true; },
+            [](void *t, std::string &key) -> JsonBindSlot
+            { return bindSlot((*static_cast<T *>(t))[key]); },
+            nullptr, nullptr, nullptr, nullptr};
+    };
+
+    template <>
+    struct JsonBind<nlohmann::json>
+    {
+        static constexpr JsonBindOps ops = {
+            "any", nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
+            [](void *t, nlohmann::json &dom)
+            { *static_cast<nlohmann::json *>(t) = std::move(dom); }};
+    };
+
+    // Structs declared with XPRESSPP_JSON: members are bound field by field
+    template <typename T>
+    struct JsonBind<T, std::enable_if_t<bind_detail::has_bind_field<T>::value>>
+    {
+        static constexpr JsonBindOps ops = {
+            "object", nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
+            [](void *)
+            { return true; },
+            [](void *t, std::string &key) -> JsonBindSlot
+            { return bindJsonField(*static_cast<T *>(t), std::string_view(key)); },
+            nullptr, nullptr, nullptr, nullptr};
+    };
+
+    // Anything else with a nlohmann from_json: capture that subtree only
+    template <typename T, typename>
+    struct JsonBind
+    {
+        static constexpr JsonBindOps ops = {
+            "value", nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
+            [](void *t, nlohmann::json &dom)
+            { dom.get_to(*static_cast<T *>(t)); }};
+    };
+
+    // ==========================================
+    // 🔥 SAX handler driving the bindings
+    // ==========================================
+    // Unknown keys are skipped by depth counting without touching their
+    // values; the only DOM ever built is for json / from_json-only members.
+    class JsonBinder
+    {
+    public:
+        template <typename T>
+        bool bind(std::string_view input, T &out,
+                  nlohmann::json::input_format_t format = nlohmann::json::input_format_t::json)
+        {
+            root_ = bindSlot(out);
+            frames_.clear();
+            pending_ = {};
+            skipDepth_ = 0;
+            domDepth_ = 0;
+            path_.clear();
+            error_.clear();
+            errorPointer_.clear();
+            failed_ = false;
+
+            bool ok = nlohmann::json::sax_parse(input.begin(), input.end(), this, format);
+            return ok && !failed_;
+        }
+
+        const std::string &errorPointer() const { return errorPointer_; }
+        const std::string &errorMessage() const { return error_; }
+
+        // ------------------------------
+        // SAX interface
+        // ------------------------------
+        bool null()
+        {
+            return value(true, "null", [](JsonBindSlot s)
+                         { return s.ops->null ? s.ops->null(s.target) : -1; }, []
+                         { return nlohmann::json(nullptr); });
+        }
+
+        bool boolean(bool v)
+        {
+            return value(false, "boolean", [v](JsonBindSlot s)
+                         { return s.ops->boolean ? s.ops->boolean(s.target, v) : -1; }, [v]
+                         { return nlohmann::json(v); });
+        }
+
+        bool number_integer(int64_t v)
+        {
+            return value(false, "integer", [v](JsonBindSlot s)
+                         { return s.ops->integer ? s.ops->integer(s.target, v) : -1; }, [v]
+                         { return nlohmann::json(v); });
+        }
+
+        bool number_unsigned(uint64_t v)
+        {
+            return value(false, "integer", [v](JsonBindSlot s)
+                         { return s.ops->unsignedInt ? s.ops->unsignedInt(s.target, v) : -1; }, [v]
+                         { return nlohmann::json(v); });
+        }
+
+        bool number_float(double v, const std::string &)
+        {
+            return value(false, "number", [v](JsonBindSlot s)
+                         { return s.ops->floating ? s.ops->floating(s.target, v) : -1; }, [v]
+                         { return nlohmann::json(v); });
+        }
+
+        bool string(std::string &v)
+        {
+            return value(false, "string", [&v](JsonBindSlot s)
+                         { return s.ops->string ? s.ops->string(s.target, v) : -1; }, [&v]
+                         { return nlohmann::json(v); });
+        }
+
+        bool binary(nlohmann::json::binary_t &)
+        {
+            return fail("binary values are not supported");
+        }
+
+        bool start_object(std::size_t)
+        {
+            return begin(true);
+        }
+
+        bool key(std::string &k)
+        {
+            if (skipDepth_ > 0)
+                return true;
+            if (domDepth_ > 0)
+            {
+                domKey_ = k;
+                return true;
+            }
+
+            Frame &f = frames_.back();
+            path_.resize(f.pathLen);
+            appendPointerToken(k);
+            pending_ = f.slot.ops->member(f.slot.target, k);
+            return true;
+        }
+
+        bool end_object()
+        {
+            return end();
+        }
+
+        bool start_array(std::size_t)
+        {
+            return begin(false);
+        }
+
+        bool end_array()
+        {
+            return end();
+        }
+
+        bool parse_error(std::size_t position, const std::string &, const nlohmann::detail::exception &ex)
+        {
+            error_ = "syntax error at byte " + std::to_string(position) + " (" + ex.what() + ")";
+            errorPointer_ = path_;
+            failed_ = true;
+            return false;
+        }
+
+    private:
+        struct Frame
+        {
+            bool isObject;
+            JsonBindSlot slot;
+            size_t index;
+            size_t pathLen;
+        };
+
+        JsonBindSlot root_;
+        std::vector<Frame> frames_;
+        JsonBindSlot pending_;
+        size_t skipDepth_ = 0;
+        std::string path_;
+        std::string error_;
+        std::string errorPointer_;
+        bool failed_ = false;
+
+        // DOM capture state
+        size_t domDepth_ = 0;
+        JsonBindSlot domTarget_;
+        nlohmann::json dom_;
+        std::vector<nlohmann::json *> domStack_;
+        std::string domKey_;
+
+        bool fail(const std::string &message)
+        {
+            if (!failed_)
+            {
+                error_ = message;
+                errorPointer_ = path_;
+                failed_ = true;
+            }
+            return false;
+        }
+
+        void appendPointerToken(std::string_view token)
+        {
+            path_ += '/';
+            for (char c : token)
+            {
+                if (c == '~')
+                    path_ += "~0";
+                else if (c == '/')
+                    path_ += "~1";
+                else
+                    path_ += c;
+            }
+        }
+
+        // Slot for the value that is about to start
+        JsonBindSlot nextSlot(bool isNull)
+        {
+            JsonBindSlot s;
+            if (frames_.empty())
+            {
+                s = root_;
+            }
+            else if (frames_.back().isObject)
+            {
+                s = pending_;
+            }
+            else
+            {
+                Frame &f = frames_.back();
+                path_.resize(f.pathLen);
+                char buf[24];
+                auto r = std::to_chars(buf, buf + sizeof(buf), f.index);
+                path_ += '/';
+                path_.append(buf, r.ptr);
+                s = f.slot.ops->element(f.slot.target, f.index++);
+            }
+
+            while (s.ops && s.ops->unwrap)
+                s = s.ops->unwrap(s.target, isNull);
+            return s;
+        }
+
+        template <typename Apply, typename ToDom>
+        bool value(bool isNull, const char *kind, Apply apply, ToDom toDom)
+        {
+            if (skipDepth_ > 0)
+                return true;
+            if (domDepth_ > 0)
+            {
+                domInsert(toDom());
+                return true;
+            }
+
+            JsonBindSlot s = nextSlot(isNull);
+            if (!s.ops)
+                return true;
+
+            if (s.ops->fromDom)
+            {
+                nlohmann::json v = toDom();
+                return convert(s, v);
+            }
+
+            // apply: 1 stored, 0 rejected by the target (range), -1 wrong type
+            int applied = apply(s);
+            if (applied < 0)
+                return fail(std::string("expected ") + s.ops->expected + ", got " + kind);
+            if (applied == 0)
+                return fail(std::string(kind) + " out of range");
+            return true;
+        }
+
+        bool begin(bool isObject)
+        {
+            if (skipDepth_ > 0)
+            {
+                skipDepth_++;
+                return true;
+            }
+            if (domDepth_ > 0)
+            {
+                domStack_.push_back(domInsert(isObject ? nlohmann::json::object() : nlohmann::json::array()));
+                domDepth_++;
+                return true;
+            }
+
+            JsonBindSlot s = nextSlot(false);
+            if (!s.ops)
+            {
+                skipDepth_ = 1;
+                return true;
+            }
+
+            if (s.ops->fromDom)
+            {
+                domTarget_ = s;
+                dom_ = isObject ? nlohmann::json::object() : nlohmann::json::array();
+                domStack_.clear();
+                domStack_.push_back(&dom_);
+                domDepth_ = 1;
+                return true;
+            }
+
+            bool accepted = isObject ? (s.ops->beginObject && s.ops->beginObject(s.target))
+                                     : (s.ops->beginArray && s.ops->beginArray(s.target));
+            if (!accepted)
+                return fail(std::string("expected ") + s.ops->expected + ", got " + (isObject ? "object" : "array"));
+
+            frames_.push_back({isObject, s, 0, path_.size()});
+            pending_ = {};
+            return true;
+        }
+
+        bool end()
+        {
+            if (skipDepth_ > 0)
+            {
+                skipDepth_--;
+                return true;
+            }
+            if (domDepth_ > 0)
+            {
+                domStack_.pop_back();
+                if (--domDepth_ == 0)
+                    return convert(domTarget_, dom_);
+                return true;
+            }
+
+            path_.resize(frames_.back().pathLen);
+            frames_.pop_back();
+            return true;
+        }
+
+        nlohmann::json *domInsert(nlohmann::json &&v)
+        {
+            nlohmann::json *parent = domStack_.back();
+            if (parent->is_object())
+                return &((*parent)[domKey_] = std::move(v));
+
+            parent->push_back(std::move(v));
+            return &parent->back();
+        }
+
+        bool convert(JsonBindSlot s, nlohmann::json &dom)
+        {
+            try
+            {
+                s.ops->fromDom(s.target, dom);
+                return true;
+            }
+            catch (const std::exception &e)
+            {
+                return fail(e.what());
+            }
+        }
+    };
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include "json_writer.hpp"
+#include "json_bind.hpp"
+
+// ==========================================
+// 🔥 Reflection macros
+// ==========================================
+// Declare the members once and get nlohmann's to_json/from_json, a DOM-free
+// writeJson used by res.jsonDirect() and a SAX binding used by req.bind<T>():
+//
+//   struct User { int id; std::string name; };
+//   XPRESSPP_JSON(User, id, name)
+//
+// XPRESSPP_JSON goes in the type's namespace, XPRESSPP_JSON_INTRUSIVE inside
+// the class body (for private members).
+
+#define XPRESSPP_JSON_WRITE_FIELD(v1) writer.rawKey("\"" #v1 "\":").value(obj.v1);
+#define XPRESSPP_JSON_BIND_FIELD(v1) \
+    if (key == #v1)                  \
+        return ::xpresspp::bindSlot(obj.v1);
+
+#define XPRESSPP_JSON(Type, ...)                                                         \
+    NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(Type, __VA_ARGS__)                                \
+    inline void writeJson(::xpresspp::JsonWriter &writer, const Type &obj)               \
+    {                                                                                    \
+        writer.beginObject();                                                            \
+        NLOHMANN_JSON_EXPAND(NLOHMANN_JSON_PASTE(XPRESSPP_JSON_WRITE_FIELD, __VA_ARGS__)) \
+        writer.endObject();                                                              \
+    }                                                                                    \
+    inline ::xpresspp::JsonBindSlot bindJsonField(Type &obj, std::string_view key)       \
+    {                                                                                    \
+        NLOHMANN_JSON_EXPAND(NLOHMANN_JSON_PASTE(XPRESSPP_JSON_BIND_FIELD, __VA_ARGS__))  \
+        return {};                                                                       \
+    }
+
+#define XPRESSPP_JSON_INTRUSIVE(Type, ...)                                               \
+    NLOHMANN_DEFINE_TYPE_INTRUSIVE(Type, __VA_ARGS__)                                    \
+    friend void writeJson(::xpresspp::JsonWriter &writer, const Type &obj)               \
+    {                                                                                    \
+        writer.beginObject();                                                            \
+        NLOHMANN_JSON_EXPAND(NLOHMANN_JSON_PASTE(XPRESSPP_JSON_WRITE_FIELD, __VA_ARGS__)) \
+        writer.endObject();                                                              \
+    }                                                                                    \
+    friend ::xpresspp::JsonBindSlot bindJsonField(Type &obj, std::string_view key)       \
+    {                                                                                    \
+        NLOHMANN_JSON_EXPAND(NLOHMANN_JSON_PASTE(XPRESSPP_JSON_BIND_FIELD, __VA_ARGS__))  \
+        return {};                                                                       \
+    }
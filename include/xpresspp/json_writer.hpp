@@ -0,0 +1,458 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <optional>
+#include <charconv>
+#include <cmath>
+#include <type_traits>
+#include <nlohmann/json.hpp>
+
+#include "simd.hpp"
+
+namespace xpresspp
+{
+    class JsonWriter;
+
+    namespace json_detail
+    {
+        // writeJson(JsonWriter&, const T&) found by ADL (see XPRESSPP_JSON)
+        template <typename T, typename = void>
+        struct has_write_json : std::false_type
+        {
+        };
+
+        template <typename T>
+        struct has_write_json<T, std::void_t<decltype(writeJson(std::declval<JsonWriter &>(), std::declval<const T &>()))>>
+            : std::true_type
+        {
+        };
+
+        template <typename T, typename = void>
+        struct is_range : std::false_type
+        {
+        };
+
+        template <typename T>
+        struct is_range<T, std::void_t<decltype(std::declval<const T &>().begin()),
+                                       decltype(std::declval<const T &>().end())>> : std::true_type
+        {
+        };
+
+        template <typename T, typename = void>
+        struct is_string_map : std::false_type
+        {
+        };
+
+        template <typename T>
+        struct is_string_map<T, std::void_t<typename T::key_type, typename T::mapped_type>>
+            : std::is_convertible<typename T::key_type, std::string_view>
+        {
+        };
+
+        template <typename T>
+        struct is_optional : std::false_type
+        {
+        };
+
+        template <typename T>
+        struct is_optional<std::optional<T>> : std::true_type
+        {
+        };
+
+        // 🔥 Skip bytes that can be copied verbatim (printable ASCII other
+        // than '"' and '\\'), 32/16 bytes per step where SIMD is available.
+        // A signed compare against 0x20 catches both control bytes and
+        // bytes >= 0x80 in one instruction.
+        inline const char *skipClean(const char *p, const char *end)
+        {
+#if defined(XPRESSPP_AVX2)
+            const __m256i limit = _mm256_set1_epi8(0x20);
+            const __m256i quote = _mm256_set1_epi8('"');
+            const __m256i bslash = _mm256_set1_epi8('\\');
+            while (end - p >= 32)
+            {
+                __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+                __m256i special = _mm256_or_si256(_mm256_cmpgt_epi8(limit, v),
+                                                  _mm256_or_si256(_mm256_cmpeq_epi8(v, quote), _mm256_cmpeq_epi8(v, bslash)));
+                unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(special));
+                if (mask)
+                    return p + simd::lowestBit(mask);
+                p += 32;
+            }
+#endif
+#if defined(XPRESSPP_SSE2)
+            const __m128i limit16 = _mm_set1_epi8(0x20);
+            const __m128i quote16 = _mm_set1_epi8('"');
+            const __m128i bslash16 = _mm_set1_epi8('\\');
+            while (end - p >= 16)
+            {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+                __m128i special = _mm_or_si128(_mm_cmplt_epi8(v, limit16),
+                                               _mm_or_si128(_mm_cmpeq_epi8(v, quote16), _mm_cmpeq_epi8(v, bslash16)));
+                unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(special));
+                if (mask)
+                    return p + simd::lowestBit(mask);
+                p += 16;
+            }
+#endif
+            while (p < end)
+            {
+                unsigned char c = static_cast<unsigned char>(*p);
+                if (c < 0x20 || c >= 0x80 || c == '"' || c == '\\')
+                    break;
+                p++;
+            }
+            return p;
+        }
+
+        // 🔥 Append `s` as JSON string contents (no quotes), escaped exactly
+        // like nlohmann's dump(): short escapes, \u00XX for other control
+        // characters, UTF-8 passed through. Invalid UTF-8 throws type_error 316.
+        // Clean runs are found with skipClean() and bulk-copied.
+        inline void appendEscaped(std::string &out, std::string_view s)
+        {
+            static const char hex[] = "0123456789abcdef";
+
+            const char *p = s.data();
+            const char *end = p + s.size();
+            const char *run = p; // start of the pending clean run
+
+            while (true)
+            {
+                p = skipClean(p, end);
+                if (p == end)
+                    break;
+
+                unsigned char c = static_cast<unsigned char>(*p);
+
+                if (c >= 0x80)
+                {
+                    // Validate consecutive UTF-8 sequences (RFC 3629) in place
+                    do
+                    {
+                        c = static_cast<unsigned char>(*p);
+                        size_t len = 0;
+                        unsigned char lo = 0x80, hi = 0xBF;
+                        if (c >= 0xC2 && c <= 0xDF)
+                            len = 2;
+                        else if (c >= 0xE0 && c <= 0xEF)
+                        {
+                            len = 3;
+                            if (c == 0xE0)
+                                lo = 0xA0;
+                            else if (c == 0xED)
+                                hi = 0x9F;
+                        }
+                        else if (c >= 0xF0 && c <= 0xF4)
+                        {
+                            len = 4;
+                            if (c == 0xF0)
+                                lo = 0x90;
+                            else if (c == 0xF4)
+                                hi = 0x8F;
+                        }
+
+                        bool valid = len != 0 && static_cast<size_t>(end - p) >= len;
+                        for (size_t i = 1; valid && i < len; i++)
+                        {
+                            unsigned char cc = static_cast<unsigned char>(p[i]);
+                            valid = i == 1 ? (cc >= lo && cc <= hi) : (cc >= 0x80 && cc <= 0xBF);
+                        }
+
+                        if (!valid)
+                        {
+                            throw nlohmann::detail::type_error::create(
+                                316, "invalid UTF-8 byte at index " + std::to_string(p - s.data()), nullptr);
+                        }
+
+                        p += len;
+                    } while (p < end && static_cast<unsigned char>(*p) >= 0x80);
+                    continue;
+                }
+
+                out.append(run, p);
+                switch (c)
+                {
+                case '"':
+                    out += "\\\"";
+                    break;
+                case '\\':
+                    out += "\\\\";
+                    break;
+                case '\b':
+                    out += "\\b";
+                    break;
+                case '\f':
+                    out += "\\f";
+                    break;
+                case '\n':
+                    out += "\\n";
+                    break;
+                case '\r':
+                    out += "\\r";
+                    break;
+                case '\t':
+                    out += "\\t";
+                    break;
+                default:
+                {
+                    char esc[6] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 0x0F]};
+                    out.append(esc, 6);
+                }
+                }
+                run = ++p;
+            }
+
+            out.append(run, end);
+        }
+    }
+
+    // 🔥 Direct JSON writer (no nlohmann::json DOM)
+    // Appends compact JSON to a caller-owned string; output matches dump().
+    class JsonWriter
+    {
+    public:
+        explicit JsonWriter(std::string &out) : out_(out) {}
+
+        JsonWriter &beginObject()
+        {
+            separator();
+            out_ += '{';
+            needComma_ = false;
+            return *this;
+        }
+
+        JsonWriter &endObject()
+        {
+            out_ += '}';
+            needComma_ = true;
+            return *this;
+        }
+
+        JsonWriter &beginArray()
+        {
+            separator();
+            out_ += '[';
+            needComma_ = false;
+            return *this;
+        }
+
+        JsonWriter &endArray()
+        {
+            out_ += ']';
+            needComma_ = true;
+            return *this;
+        }
+
+        JsonWriter &key(std::string_view name)
+        {
+            separator();
+            out_ += '"';
+            json_detail::appendEscaped(out_, name);
+            out_ += "\":";
+            needComma_ = false;
+            return *this;
+        }
+
+        // Pre-quoted key literal, e.g. "\"id\":" (used by XPRESSPP_JSON)
+        JsonWriter &rawKey(std::string_view quotedKey)
+        {
+            separator();
+            out_.append(quotedKey.data(), quotedKey.size());
+            needComma_ = false;
+            return *this;
+        }
+
+        template <typename T>
+        JsonWriter &field(std::string_view name, const T &v)
+        {
+            key(name);
+            return value(v);
+        }
+
+        JsonWriter &null()
+        {
+            separator();
+            out_ += "null";
+            needComma_ = true;
+            return *this;
+        }
+
+        JsonWriter &string(std::string_view s)
+        {
+            separator();
+            out_ += '"';
+            json_detail::appendEscaped(out_, s);
+            out_ += '"';
+            needComma_ = true;
+            return *this;
+        }
+
+        JsonWriter &number(double d)
+        {
+            separator();
+            if (!std::isfinite(d))
+            {
+                out_ += "null";
+            }
+            else
+            {
+                char buf[64];
+                char *end = nlohmann::detail::to_chars(buf, buf + sizeof(buf), d);
+                out_.append(buf, end);
+            }
+            needComma_ = true;
+            return *this;
+        }
+
+        // Already-serialized JSON fragment
+        JsonWriter &raw(std::string_view fragment)
+        {
+            separator();
+            out_.append(fragment.data(), fragment.size());
+            needComma_ = true;
+            return *this;
+        }
+
+        template <typename T>
+        JsonWriter &value(const T &v)
+        {
+            if constexpr (std::is_same<T, bool>::value)
+            {
+                raw(v ? "true" : "false");
+            }
+            else if constexpr (std::is_integral<T>::value)
+            {
+                separator();
+                char buf[24];
+                auto r = std::to_chars(buf, buf + sizeof(buf), v);
+                out_.append(buf, r.ptr);
+                needComma_ = true;
+            }
+            else if constexpr (std::is_floating_point<T>::value)
+            {
+                number(static_cast<double>(v));
+            }
+            else if constexpr (std::is_convertible<const T &, std::string_view>::value)
+            {
+                string(std::string_view(v));
+            }
+            else if constexpr (std::is_same<T, nlohmann::json>::value)
+            {
+                dumpDom(v);
+            }
+            else if constexpr (std::is_same<T, std::nullptr_t>::value)
+            {
+                null();
+            }
+            else if constexpr (json_detail::has_write_json<T>::value)
+            {
+                writeJson(*this, v);
+            }
+            else if constexpr (json_detail::is_optional<T>::value)
+            {
+                if (v)
+                    value(*v);
+                else
+                    null();
+            }
+            else if constexpr (json_detail::is_string_map<T>::value)
+            {
+                beginObject();
+                for (const auto &kv : v)
+                    field(std::string_view(kv.first), kv.second);
+                endObject();
+            }
+            else if constexpr (json_detail::is_range<T>::value)
+            {
+                beginArray();
+                for (const auto &item : v)
+                    value(item);
+                endArray();
+            }
+            else
+            {
+                // Types with only a nlohmann to_json (e.g. NLOHMANN_DEFINE_TYPE_*)
+                dumpDom(nlohmann::json(v));
+            }
+            return *this;
+        }
+
+    private:
+        std::string &out_;
+        bool needComma_ = false;
+
+        void separator()
+        {
+            if (needComma_)
+                out_ += ',';
+        }
+
+        // Walks the DOM directly so strings go through the bulk escaper and
+        // nothing passes through nlohmann's per-character output adapter
+        void dumpDom(const nlohmann::json &j)
+        {
+            using value_t = nlohmann::json::value_t;
+
+            switch (j.type())
+            {
+            case value_t::object:
+                beginObject();
+                for (const auto &kv : j.get_ref<const nlohmann::json::object_t &>())
+                {
+                    key(kv.first);
+                    dumpDom(kv.second);
+                }
+                endObject();
+                break;
+
+            case value_t::array:
+                beginArray();
+                for (const auto &item : j.get_ref<const nlohmann::json::array_t &>())
+                    dumpDom(item);
+                endArray();
+                break;
+
+            case value_t::string:
+                string(j.get_ref<const nlohmann::json::string_t &>());
+                break;
+
+            case value_t::boolean:
+                raw(j.get<bool>() ? "true" : "false");
+                break;
+
+            case value_t::number_integer:
+                value(j.get<nlohmann::json::number_integer_t>());
+                break;
+
+            case value_t::number_unsigned:
+                value(j.get<nlohmann::json::number_unsigned_t>());
+                break;
+
+            case value_t::number_float:
+                number(j.get<nlohmann::json::number_float_t>());
+                break;
+
+            case value_t::null:
+                null();
+                break;
+
+            case value_t::discarded:
+                raw("<discarded>");
+                break;
+
+            case value_t::binary:
+            default:
+            {
+                separator();
+                nlohmann::detail::serializer<nlohmann::json> s(
+                    nlohmann::detail::output_adapter<char, std::string>(out_), ' ');
+                s.dump(j, false, false, 0);
+                needComma_ = true;
+            }
+            }
+        }
+    };
+}
@@ -0,0 +1,859 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <cstdlib>
+#include <type_traits>
+#include <nlohmann/json.hpp>
+
+#include "simd.hpp"
+
+namespace xpresspp
+{
+    // 🔥 Structural index over a JSON document (stage 1 of an on-demand parser)
+    // Records the offsets of every unescaped quote and every {}[]:, outside
+    // strings, processing 64-byte blocks with SIMD compares.
+    class JsonStructuralIndex
+    {
+    public:
+        std::vector<uint32_t> positions;
+
+        bool build(std::string_view doc)
+        {
+            positions.clear();
+            if (doc.size() > UINT32_MAX)
+                return false;
+
+            positions.reserve(doc.size() / 8 + 16);
+
+            bool escapeNext = false;
+            uint64_t prevInString = 0;
+
+            for (size_t offset = 0; offset < doc.size(); offset += 64)
+            {
+                const char *block = doc.data() + offset;
+                char padded[64];
+                size_t len = doc.size() - offset;
+                if (len < 64)
+                {
+                    std::memset(padded, ' ', sizeof(padded));
+                    std::memcpy(padded, block, len);
+                    block = padded;
+                }
+
+                uint64_t quote, backslash, op;
+                classify(block, quote, backslash, op);
+
+                // Characters preceded by an odd run of backslashes are escaped
+                uint64_t escaped = 0;
+                if (backslash || escapeNext)
+                {
+                    for (int i = 0; i < 64; i++)
+                    {
+                        if (escapeNext)
+                        {
+                            escaped |= uint64_t(1) << i;
+                            escapeNext = false;
+                        }
+                        else if (backslash & (uint64_t(1) << i))
+                        {
+                            escapeNext = true;
+                        }
+                    }
+                }
+                quote &= ~escaped;
+
+                // Prefix XOR turns quote bits into an "inside string" mask
+                uint64_t inString = quote;
+                inString ^= inString << 1;
+                inString ^= inString << 2;
+                inString ^= inString << 4;
+                inString ^= inString << 8;
+                inString ^= inString << 16;
+                inString ^= inString << 32;
+                inString ^= prevInString;
+                prevInString = uint64_t(0) - (inString >> 63);
+
+                uint64_t structural = (op & ~inString) | quote;
+                while (structural)
+                {
+                    positions.push_back(static_cast<uint32_t>(offset + simd::lowestBit(structural)));
+                    structural &= structural - 1;
+                }
+            }
+
+            // Unterminated string
+            return prevInString == 0;
+        }
+
+        // Checks `doc` (indexed by build()) against the grammar json::parse
+        // applies: token order and nesting from the index, then the bytes
+        // between tokens (numbers, literals, string contents, UTF-8).
+        // No DOM is built.
+        bool validate(std::string_view doc) const
+        {
+            const auto &pos = positions;
+            const size_t n = pos.size();
+            size_t i = 0;
+            size_t cursor = doc.compare(0, 3, "\xEF\xBB\xBF") == 0 ? 3 : 0; // BOM, skipped by json::parse
+            std::string stack; // '{' / '[' per level (inline for shallow documents)
+
+            enum class Expect
+            {
+                Value,
+                ValueOrClose, // after '['
+                Key,
+                KeyOrClose,   // after '{'
+                Colon,
+                AfterValue
+            } expect = Expect::Value;
+
+            for (;;)
+            {
+                size_t at = i < n ? pos[i] : doc.size();
+                std::string_view gap(doc.data() + cursor, at - cursor);
+                char c = i < n ? doc[at] : '\0';
+
+                switch (expect)
+                {
+                case Expect::Value:
+                case Expect::ValueOrClose:
+                    if (!blank(gap))
+                    {
+                        // A number or literal runs up to the next token
+                        if (!scalar(trim(gap)))
+                            return false;
+                        cursor = at;
+                        expect = Expect::AfterValue;
+                        continue;
+                    }
+                    if (i == n)
+                        return false;
+                    if (c == '"')
+                    {
+                        if (!stringToken(doc, pos, i))
+                            return false;
+                        expect = Expect::AfterValue;
+                    }
+                    else if (c == '{' || c == '[')
+                    {
+                        stack.push_back(c);
+                        expect = c == '{' ? Expect::KeyOrClose : Expect::ValueOrClose;
+                        i++;
+                    }
+                    else if (c == ']' && expect == Expect::ValueOrClose)
+                    {
+                        stack.pop_back();
+                        expect = Expect::AfterValue;
+                        i++;
+                    }
+                    else
+                        return false;
+                    break;
+
+                case Expect::Key:
+                case Expect::KeyOrClose:
+                    if (!blank(gap) || i == n)
+                        return false;
+                    if (c == '"')
+                    {
+                        if (!stringToken(doc, pos, i))
+                            return false;
+                        expect = Expect::Colon;
+                    }
+                    else if (c == '}' && expect == Expect::KeyOrClose)
+                    {
+                        stack.pop_back();
+                        expect = Expect::AfterValue;
+                        i++;
+                    }
+                    else
+                        return false;
+                    break;
+
+                case Expect::Colon:
+                    if (!blank(gap) || c != ':')
+                        return false;
+                    expect = Expect::Value;
+                    i++;
+                    break;
+
+                case Expect::AfterValue:
+                    if (!blank(gap))
+                        return false;
+                    if (stack.empty())
+                        return i == n; // only whitespace after the document
+                    if (c == ',')
+                        expect = stack.back() == '{' ? Expect::Key : Expect::Value;
+                    else if ((c == '}' && stack.back() == '{') || (c == ']' && stack.back() == '['))
+                        stack.pop_back();
+                    else
+                        return false;
+                    i++;
+                    break;
+                }
+                cursor = pos[i - 1] + 1;
+            }
+        }
+
+    private:
+        // JSON whitespace only (not \v or \f)
+        static bool space(char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r'; }
+
+        static bool blank(std::string_view s)
+        {
+            for (char c : s)
+            {
+                if (!space(c))
+                    return false;
+            }
+            return true;
+        }
+
+        static std::string_view trim(std::string_view s)
+        {
+            while (!s.empty() && space(s.front()))
+                s.remove_prefix(1);
+            while (!s.empty() && space(s.back()))
+                s.remove_suffix(1);
+            return s;
+        }
+
+        static bool digit(char c) { return c >= '0' && c <= '9'; }
+
+        // true / false / null, or a number json::parse accepts (no leading
+        // zeros, digits on both sides of '.', finite as a double)
+        static bool scalar(std::string_view s)
+        {
+            if (s == "true" || s == "false" || s == "null")
+                return true;
+
+            size_t k = 0;
+            if (k < s.size() && s[k] == '-')
+                k++;
+            if (k >= s.size() || !digit(s[k]))
+                return false;
+            if (s[k] == '0')
+                k++;
+            else
+                while (k < s.size() && digit(s[k]))
+                    k++;
+
+            if (k < s.size() && s[k] == '.')
+            {
+                size_t first = ++k;
+                while (k < s.size() && digit(s[k]))
+                    k++;
+                if (k == first)
+                    return false;
+            }
+
+            bool exponent = k < s.size() && (s[k] == 'e' || s[k] == 'E');
+            if (exponent)
+            {
+                k++;
+                if (k < s.size() && (s[k] == '+' || s[k] == '-'))
+                    k++;
+                size_t first = k;
+                while (k < s.size() && digit(s[k]))
+                    k++;
+                if (k == first)
+                    return false;
+            }
+            if (k != s.size())
+                return false;
+
+            // json::parse rejects numbers that overflow a double
+            if (exponent || s.size() > 300)
+            {
+                std::string copy(s);
+                return std::isfinite(std::strtod(copy.c_str(), nullptr));
+            }
+            return true;
+        }
+
+        // The string opened by the quote at pos[i]; i moves past its close
+        static bool stringToken(std::string_view doc, const std::vector<uint32_t> &pos, size_t &i)
+        {
+            if (i + 1 >= pos.size() || doc[pos[i + 1]] != '"')
+                return false;
+            const char *p = doc.data() + pos[i] + 1;
+            const char *end = doc.data() + pos[i + 1];
+            i += 2;
+
+            while (p < end)
+            {
+                p = plainRun(p, end);
+                if (p == end)
+                    break;
+
+                auto c = static_cast<unsigned char>(*p);
+                if (c < 0x20)
+                    return false;
+                if (c == '\\')
+                {
+                    if (!escape(p, end))
+                        return false;
+                }
+                else if (!utf8(p, end))
+                    return false;
+            }
+            return true;
+        }
+
+        // Skips bytes that need no checking (printable ASCII but '\\')
+        static const char *plainRun(const char *p, const char *end)
+        {
+#if defined(XPRESSPP_SSE2)
+            // Signed compare: bytes >= 0x80 are negative, so "< 0x20" catches them too
+            const __m128i low = _mm_set1_epi8(0x20);
+            const __m128i backslash = _mm_set1_epi8('\\');
+            while (end - p >= 16)
+            {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+                unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(
+                    _mm_or_si128(_mm_cmplt_epi8(v, low), _mm_cmpeq_epi8(v, backslash))));
+                if (mask)
+                    return p + simd::lowestBit(mask);
+                p += 16;
+            }
+#endif
+            while (p < end)
+            {
+                auto c = static_cast<unsigned char>(*p);
+                if (c < 0x20 || c == '\\' || c >= 0x80)
+                    return p;
+                p++;
+            }
+            return p;
+        }
+
+        static int hex4(const char *p)
+        {
+            int v = 0;
+            for (int k = 0; k < 4; k++)
+            {
+                char c = p[k];
+                v <<= 4;
+                if (c >= '0' && c <= '9')
+                    v |= c - '0';
+                else if (c >= 'a' && c <= 'f')
+                    v |= c - 'a' + 10;
+                else if (c >= 'A' && c <= 'F')
+                    v |= c - 'A' + 10;
+                else
+                    return -1;
+            }
+            return v;
+        }
+
+        // \" \\ \/ \b \f \n \r \t or \uXXXX (surrogates must pair up)
+        static bool escape(const char *&p, const char *end)
+        {
+            if (end - p < 2)
+                return false;
+            char c = p[1];
+            if (c != 'u')
+            {
+                p += 2;
+                return c == '"' || c == '\\' || c == '/' || c == 'b' || c == 'f' ||
+                       c == 'n' || c == 'r' || c == 't';
+            }
+
+            if (end - p < 6)
+                return false;
+            int unit = hex4(p + 2);
+            p += 6;
+            if (unit < 0 || (unit >= 0xDC00 && unit <= 0xDFFF))
+                return false;
+            if (unit >= 0xD800 && unit <= 0xDBFF)
+            {
+                if (end - p < 6 || p[0] != '\\' || p[1] != 'u')
+                    return false;
+                int low = hex4(p + 2);
+                p += 6;
+                return low >= 0xDC00 && low <= 0xDFFF;
+            }
+            return true;
+        }
+
+        // One well-formed UTF-8 sequence (RFC 3629: no overlongs,
+        // surrogates or code points above U+10FFFF)
+        static bool utf8(const char *&p, const char *end)
+        {
+            auto b = [&](ptrdiff_t k)
+            { return static_cast<unsigned char>(p[k]); };
+            auto cont = [&](ptrdiff_t k, unsigned lo = 0x80, unsigned hi = 0xBF)
+            { return end - p > k && b(k) >= lo && b(k) <= hi; };
+
+            unsigned c = b(0);
+            int len;
+            if (c >= 0xC2 && c <= 0xDF)
+                len = cont(1) ? 2 : 0;
+            else if (c == 0xE0)
+                len = cont(1, 0xA0) && cont(2) ? 3 : 0;
+            else if (c == 0xED)
+                len = cont(1, 0x80, 0x9F) && cont(2) ? 3 : 0;
+            else if (c >= 0xE1 && c <= 0xEF)
+                len = cont(1) && cont(2) ? 3 : 0;
+            else if (c == 0xF0)
+                len = cont(1, 0x90) && cont(2) && cont(3) ? 4 : 0;
+            else if (c >= 0xF1 && c <= 0xF3)
+                len = cont(1) && cont(2) && cont(3) ? 4 : 0;
+            else if (c == 0xF4)
+                len = cont(1, 0x80, 0x8F) && cont(2) && cont(3) ? 4 : 0;
+            else
+                len = 0;
+            p += len;
+            return len != 0;
+        }
+
+        static void classify(const char *block, uint64_t &quote, uint64_t &backslash, uint64_t &op)
+        {
+            quote = backslash = op = 0;
+#if defined(XPRESSPP_AVX2)
+            for (int half = 0; half < 2; half++)
+            {
+                __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(block + half * 32));
+                __m256i ops = _mm256_or_si256(
+                    _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('{')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('}'))),
+                                    _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('[')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8(']')))),
+                    _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(':')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8(','))));
+                int shift = half * 32;
+                quote |= uint64_t(uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('"'))))) << shift;
+                backslash |= uint64_t(uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\'))))) << shift;
+                op |= uint64_t(uint32_t(_mm256_movemask_epi8(ops))) << shift;
+            }
+#elif defined(XPRESSPP_SSE2)
+            for (int part = 0; part < 4; part++)
+            {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(block + part * 16));
+                __m128i ops = _mm_or_si128(
+                    _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('{')), _mm_cmpeq_epi8(v, _mm_set1_epi8('}'))),
+                                 _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('[')), _mm_cmpeq_epi8(v, _mm_set1_epi8(']')))),
+                    _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(':')), _mm_cmpeq_epi8(v, _mm_set1_epi8(','))));
+                int shift = part * 16;
+                quote |= uint64_t(uint16_t(_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('"'))))) << shift;
+                backslash |= uint64_t(uint16_t(_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('\\'))))) << shift;
+                op |= uint64_t(uint16_t(_mm_movemask_epi8(ops))) << shift;
+            }
+#else
+            for (int i = 0; i < 64; i++)
+            {
+                uint64_t bit = uint64_t(1) << i;
+                switch (block[i])
+                {
+                case '"':
+                    quote |= bit;
+                    break;
+                case '\\':
+                    backslash |= bit;
+                    break;
+                case '{':
+                case '}':
+                case '[':
+                case ']':
+                case ':':
+                case ',':
+                    op |= bit;
+                    break;
+                }
+            }
+#endif
+        }
+    };
+
+    // 🔥 Lazily materialized JSON body (Request::jsonBody)
+    // In on-demand mode only a structural index and a table of top-level
+    // members are built (after the whole document is validated, so a body
+    // json::parse rejects is {} either way); values are parsed when asked
+    // for (tryGet/contains).
+    // Any DOM-level access (operator[], ->, dump, iteration...) parses the
+    // whole document once and from then on behaves like a plain json value.
+    class LazyJson
+    {
+    public:
+        using json = nlohmann::json;
+
+        LazyJson() : dom_(json::object()) {}
+        LazyJson(const json &j) : dom_(j) {}
+        LazyJson(json &&j) : dom_(std::move(j)) {}
+
+        // Copies/moves own their DOM (the source string belongs to a Request)
+        LazyJson(const LazyJson &other) : dom_(other.dom()) {}
+        LazyJson(LazyJson &&other) : dom_(std::move(other.dom())) {}
+
+        LazyJson &operator=(const LazyJson &other)
+        {
+            if (this != &other)
+                assign(other.dom());
+            return *this;
+        }
+
+        LazyJson &operator=(LazyJson &&other)
+        {
+            if (this != &other)
+                assign(std::move(other.dom()));
+            return *this;
+        }
+
+        LazyJson &operator=(const json &j)
+        {
+            assign(j);
+            return *this;
+        }
+
+        LazyJson &operator=(json &&j)
+        {
+            assign(std::move(j));
+            return *this;
+        }
+
+        // Switch to on-demand mode over `source` (must outlive this object
+        // or be replaced by another defer()/assignment first)
+        void defer(std::string_view source)
+        {
+            source_ = source;
+            dom_ = nullptr;
+            indexed_ = false;
+            valid_ = false;
+            members_.clear();
+        }
+
+        bool isMaterialized() const { return source_.data() == nullptr; }
+
+        // ------------------------------
+        // 🔥 DOM access (materializes)
+        // ------------------------------
+        json &dom()
+        {
+            materialize();
+            return dom_;
+        }
+
+        const json &dom() const
+        {
+            materialize();
+            return dom_;
+        }
+
+        json &operator*() { return dom(); }
+        const json &operator*() const { return dom(); }
+        json *operator->() { return &dom(); }
+        const json *operator->() const { return &dom(); }
+
+        template <typename Key>
+        json &operator[](Key &&key) { return dom()[std::forward<Key>(key)]; }
+
+        template <typename Key>
+        const json &operator[](Key &&key) const { return dom()[std::forward<Key>(key)]; }
+
+        template <typename Key>
+        json &at(Key &&key) { return dom().at(std::forward<Key>(key)); }
+
+        template <typename Key>
+        const json &at(Key &&key) const { return dom().at(std::forward<Key>(key)); }
+
+        template <typename T>
+        T get() const { return dom().template get<T>(); }
+
+        template <typename T>
+        T value(const std::string &key, const T &def) const
+        {
+            T out;
+            return tryGet(key, out) ? out : def;
+        }
+
+        std::string dump(int indent = -1) const { return dom().dump(indent); }
+        json::value_t type() const { return dom().type(); }
+        bool is_null() const { return dom().is_null(); }
+        bool is_array() const { return dom().is_array(); }
+        size_t size() const { return dom().size(); }
+        bool empty() const { return dom().empty(); }
+        json::iterator begin() { return dom().begin(); }
+        json::iterator end() { return dom().end(); }
+        json::const_iterator begin() const { return dom().begin(); }
+        json::const_iterator end() const { return dom().end(); }
+        auto items() { return dom().items(); }
+        auto items() const { return dom().items(); }
+
+        // ------------------------------
+        // 🔥 On-demand access
+        // ------------------------------
+        bool is_object() const
+        {
+            if (isMaterialized())
+                return dom_.is_object();
+            // An invalid document falls back to {} exactly like eager parsing
+            return !index() || source_[firstNonSpace()] == '{';
+        }
+
+        bool contains(std::string_view key) const
+        {
+            if (isMaterialized())
+                return dom_.is_object() && dom_.find(key) != dom_.end();
+            return findMember(key) != nullptr;
+        }
+
+        // Parse just the member `key` into `out`; false if missing or mistyped
+        template <typename T>
+        bool tryGet(std::string_view key, T &out) const
+        {
+            try
+            {
+                if (isMaterialized())
+                {
+                    if (!dom_.is_object())
+                        return false;
+                    auto it = dom_.find(key);
+                    if (it == dom_.end())
+                        return false;
+                    out = it->template get<T>();
+                    return true;
+                }
+
+                const Member *m = findMember(key);
+                if (!m)
+                    return false;
+
+                std::string_view raw(source_.data() + m->valueBegin, m->valueEnd - m->valueBegin);
+                return parseScalar(raw, out) || parseValue(raw, out);
+            }
+            catch (...)
+            {
+                return false;
+            }
+        }
+
+        friend void to_json(json &j, const LazyJson &lazy) { j = lazy.dom(); }
+
+    private:
+        struct Member
+        {
+            std::string_view key; // raw bytes between the quotes
+            bool keyEscaped;
+            size_t valueBegin;
+            size_t valueEnd;
+        };
+
+        mutable json dom_;
+        std::string_view source_;
+        mutable bool indexed_ = false;
+        mutable bool valid_ = false;
+        mutable std::vector<Member> members_;
+
+        template <typename J>
+        void assign(J &&j)
+        {
+            dom_ = std::forward<J>(j);
+            source_ = {};
+            members_.clear();
+        }
+
+        void materialize() const
+        {
+            if (isMaterialized())
+                return;
+
+            json parsed = json::parse(source_, nullptr, false);
+            dom_ = parsed.is_discarded() ? json::object() : std::move(parsed);
+            const_cast<LazyJson *>(this)->source_ = {};
+            members_.clear();
+        }
+
+        size_t firstNonSpace() const
+        {
+            size_t i = 0;
+            while (i < source_.size() && std::isspace(static_cast<unsigned char>(source_[i])))
+                i++;
+            return i;
+        }
+
+        // Stage 2: walk the structural index once and record the top-level
+        // members of an object document
+        bool index() const
+        {
+            if (indexed_)
+                return valid_;
+            indexed_ = true;
+            valid_ = false;
+            members_.clear();
+
+            std::string_view doc(source_);
+            // A body json::parse would reject reads as {} here too, so
+            // getJSON and jsonBody always agree
+            JsonStructuralIndex idx;
+            if (!idx.build(doc) || !idx.validate(doc))
+                return false;
+
+            const auto &pos = idx.positions;
+            size_t n = pos.size();
+            if (n == 0 || pos[0] != firstNonSpace())
+                return false;
+
+            // Nothing but whitespace may follow the closing bracket
+            for (size_t k = pos[n - 1] + 1; k < doc.size(); k++)
+            {
+                if (!std::isspace(static_cast<unsigned char>(doc[k])))
+                    return false;
+            }
+
+            if (doc[pos[0]] != '{')
+            {
+                // Arrays/scalars are valid documents without members
+                valid_ = doc[pos[0]] == '[' && doc[pos[n - 1]] == ']';
+                return valid_;
+            }
+
+            size_t i = 1;
+            if (i < n && doc[pos[i]] == '}')
+            {
+                valid_ = i == n - 1;
+                return valid_;
+            }
+
+            while (i + 2 < n)
+            {
+                if (doc[pos[i]] != '"' || doc[pos[i + 1]] != '"' || doc[pos[i + 2]] != ':')
+                    return false;
+
+                Member m;
+                m.key = doc.substr(pos[i] + 1, pos[i + 1] - pos[i] - 1);
+                m.keyEscaped = m.key.find('\\') != std::string_view::npos;
+                m.valueBegin = pos[i + 2] + 1;
+
+                i += 3;
+                int depth = 0;
+                for (; i < n; i++)
+                {
+                    char c = doc[pos[i]];
+                    if (c == '{' || c == '[')
+                        depth++;
+                    else if (c == '}' || c == ']')
+                    {
+                        if (depth == 0)
+                            break;
+                        depth--;
+                    }
+                    else if (c == ',' && depth == 0)
+                        break;
+                }
+
+                if (i >= n)
+                    return false;
+
+                m.valueEnd = pos[i];
+                while (m.valueBegin < m.valueEnd && std::isspace(static_cast<unsigned char>(doc[m.valueBegin])))
+                    m.valueBegin++;
+                while (m.valueEnd > m.valueBegin && std::isspace(static_cast<unsigned char>(doc[m.valueEnd - 1])))
+                    m.valueEnd--;
+                if (m.valueBegin == m.valueEnd)
+                    return false;
+
+                members_.push_back(m);
+
+                if (doc[pos[i]] == '}')
+                {
+                    valid_ = i == n - 1;
+                    if (!valid_)
+                        members_.clear();
+                    return valid_;
+                }
+                i++; // ','
+            }
+
+            members_.clear();
+            return false;
+        }
+
+        const Member *findMember(std::string_view key) const
+        {
+            if (!index())
+                return nullptr;
+
+            // Last occurrence wins, as with json::parse
+            for (auto it = members_.rbegin(); it != members_.rend(); ++it)
+            {
+                if (!it->keyEscaped)
+                {
+                    if (it->key == key)
+                        return &*it;
+                    continue;
+                }
+
+                std::string quoted;
+                quoted.reserve(it->key.size() + 2);
+                quoted += '"';
+                quoted.append(it->key.data(), it->key.size());
+                quoted += '"';
+                json decoded = json::parse(quoted, nullptr, false);
+                if (decoded.is_string() && decoded.get_ref<const std::string &>() == key)
+                    return &*it;
+            }
+            return nullptr;
+        }
+
+        // Fast paths that skip nlohmann's lexer for the common scalar shapes
+        template <typename T>
+        static bool parseScalar(std::string_view raw, T &out)
+        {
+            if constexpr (std::is_same<T, bool>::value)
+            {
+                if (raw == "true")
+                    out = true;
+                else if (raw == "false")
+                    out = false;
+                else
+                    return false;
+                return true;
+            }
+            else if constexpr (std::is_integral<T>::value)
+            {
+                // JSON forbids leading zeros ("007"); let the full parser reject them
+                size_t digits = !raw.empty() && raw[0] == '-' ? 1 : 0;
+                if (raw.size() > digits + 1 && raw[digits] == '0')
+                    return false;
+
+                T v{};
+                auto r = std::from_chars(raw.data(), raw.data() + raw.size(), v);
+                if (r.ec != std::errc() || r.ptr != raw.data() + raw.size())
+                    return false;
+                out = v;
+                return true;
+            }
+            else if constexpr (std::is_same<T, std::string>::value)
+            {
+                if (raw.size() < 2 || raw.front() != '"' || raw.back() != '"')
+                    return false;
+                std::string_view inner = raw.substr(1, raw.size() - 2);
+                for (char c : inner)
+                {
+                    // Escapes, control bytes and UTF-8 go through the full lexer
+                    if (c == '\\' || static_cast<unsigned char>(c) < 0x20 || static_cast<unsigned char>(c) >= 0x80)
+                        return false;
+                }
+                out.assign(inner.data(), inner.size());
+                return true;
+            }
+            else
+            {
+                return false;
+            }
+        }
+
+        template <typename T>
+        static bool parseValue(std::string_view raw, T &out)
+        {
+            json v = json::parse(raw.begin(), raw.end(), nullptr, false);
+            if (v.is_discarded())
+                return false;
+            out = v.template get<T>();
+            return true;
+        }
+    };
+}
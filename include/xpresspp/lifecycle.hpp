@@ -0,0 +1,402 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#define XPRESSPP_LIFECYCLE_SIGNALS
+extern char **environ;
+#endif
+
+// Re-exec needs /proc/self/exe and /proc/self/cmdline
+#ifdef __linux__
+#define XPRESSPP_HOT_RESTART
+#endif
+
+namespace xpresspp
+{
+    // 🔥 Process lifecycle: stop / restart signals and hot restart
+    // A hot restart starts the binary again (the file on disk, so a deploy
+    // that replaced it runs the new build) and passes it the listening
+    // sockets over a Unix socket (SCM_RIGHTS). Both processes accept from the
+    // same kernel queues, so no connection is refused while the old one
+    // drains; the successor never binds and is serving as soon as its routes
+    // are registered.
+    namespace lifecycle
+    {
+        // Set in the successor's environment: its end of the handoff channel
+        constexpr const char *handoffEnv = "XPRESSPP_HANDOFF_FD";
+        // Listening sockets one handoff carries (one SCM_RIGHTS message)
+        constexpr size_t maxHandoffSockets = 64;
+
+#ifdef XPRESSPP_LIFECYCLE_SIGNALS
+
+        // 🔥 SIGTERM / SIGINT / SIGHUP delivered on a thread of ours
+        // The handler only writes the signal number to a pipe (async-signal
+        // safe); the callback runs on the watcher thread and may block, e.g.
+        // for a whole drain. One watcher per process.
+        class SignalWatcher
+        {
+        public:
+            explicit SignalWatcher(std::function<void(int)> onSignal)
+                : onSignal_(std::move(onSignal))
+            {
+                int fds[2];
+                if (pipe(fds) != 0)
+                    return;
+                for (int fd : fds)
+                    fcntl(fd, F_SETFD, FD_CLOEXEC);
+                readFd_ = fds[0];
+                writeFd() = fds[1];
+
+                struct sigaction action{};
+                action.sa_handler = &SignalWatcher::handler;
+                sigemptyset(&action.sa_mask);
+                action.sa_flags = SA_RESTART;
+                for (size_t i = 0; i < signals.size(); i++)
+                    sigaction(signals[i], &action, &previous_[i]);
+
+                thread_ = std::thread([this]
+                                      { watch(); });
+            }
+
+            SignalWatcher(const SignalWatcher &) = delete;
+            SignalWatcher &operator=(const SignalWatcher &) = delete;
+
+            // Restores the previous handlers; waits for a callback in progress
+            ~SignalWatcher()
+            {
+                if (readFd_ < 0)
+                    return;
+                for (size_t i = 0; i < signals.size(); i++)
+                    sigaction(signals[i], &previous_[i], nullptr);
+
+                unsigned char quit = 0;
+                (void)!write(writeFd(), &quit, 1);
+                if (thread_.joinable())
+                    thread_.join();
+                close(readFd_);
+                close(writeFd());
+                writeFd() = -1;
+            }
+
+        private:
+            static constexpr std::array<int, 3> signals{SIGTERM, SIGINT, SIGHUP};
+
+            std::function<void(int)> onSignal_;
+            int readFd_ = -1;
+            std::thread thread_;
+            struct sigaction previous_[signals.size()] = {};
+
+            static int &writeFd()
+            {
+                static int fd = -1;
+                return fd;
+            }
+
+            static void handler(int signo)
+            {
+                int saved = errno;
+                auto byte = static_cast<unsigned char>(signo);
+                (void)!write(writeFd(), &byte, 1);
+                errno = saved;
+            }
+
+            void watch()
+            {
+                unsigned char signo;
+                for (;;)
+                {
+                    auto n = read(readFd_, &signo, 1);
+                    if (n < 0 && errno == EINTR)
+                        continue;
+                    if (n <= 0 || signo == 0)
+                        return;
+                    onSignal_(signo);
+                }
+            }
+        };
+
+        namespace lifecycle_detail
+        {
+            inline bool sendSockets(int channel, const std::vector<int> &fds)
+            {
+                if (fds.empty() || fds.size() > maxHandoffSockets)
+                    return false;
+
+                char byte = 'L';
+                iovec iov{&byte, 1};
+                alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int) * maxHandoffSockets)] = {};
+
+                msghdr msg{};
+                msg.msg_iov = &iov;
+                msg.msg_iovlen = 1;
+                msg.msg_control = control;
+                msg.msg_controllen = CMSG_SPACE(sizeof(int) * fds.size());
+
+                auto *cmsg = CMSG_FIRSTHDR(&msg);
+                cmsg->cmsg_level = SOL_SOCKET;
+                cmsg->cmsg_type = SCM_RIGHTS;
+                cmsg->cmsg_len = CMSG_LEN(sizeof(int) * fds.size());
+                std::memcpy(CMSG_DATA(cmsg), fds.data(), sizeof(int) * fds.size());
+
+                ssize_t n;
+                do
+                    n = sendmsg(channel, &msg, MSG_NOSIGNAL);
+                while (n < 0 && errno == EINTR);
+                return n == 1;
+            }
+
+            // In the order they were sent
+            inline std::vector<int> receiveSockets(int channel)
+            {
+                char byte;
+                iovec iov{&byte, 1};
+                alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int) * maxHandoffSockets)] = {};
+
+                msghdr msg{};
+                msg.msg_iov = &iov;
+                msg.msg_iovlen = 1;
+                msg.msg_control = control;
+                msg.msg_controllen = sizeof(control);
+
+                ssize_t n;
+                do
+                    n = recvmsg(channel, &msg, MSG_CMSG_CLOEXEC);
+                while (n < 0 && errno == EINTR);
+                std::vector<int> fds;
+                if (n != 1)
+                    return fds;
+
+                for (auto *cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg))
+                {
+                    if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
+                    {
+                        fds.resize((cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int));
+                        std::memcpy(fds.data(), CMSG_DATA(cmsg), sizeof(int) * fds.size());
+                        break;
+                    }
+                }
+                return fds;
+            }
+
+            // Waits for one byte: false on timeout or when the peer went away
+            inline bool waitByte(int channel, int timeoutSec)
+            {
+                auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(timeoutSec);
+                for (;;)
+                {
+                    auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+                                    deadline - std::chrono::steady_clock::now())
+                                    .count();
+                    if (left <= 0)
+                        return false;
+
+                    pollfd pfd{channel, POLLIN, 0};
+                    int n = poll(&pfd, 1, static_cast<int>(left));
+                    if (n < 0 && errno == EINTR)
+                        continue;
+                    if (n <= 0)
+                        return false;
+
+                    char byte;
+                    ssize_t got;
+                    do
+                        got = read(channel, &byte, 1);
+                    while (got < 0 && errno == EINTR);
+                    return got == 1;
+                }
+            }
+        }
+
+        // 🔥 Successor side: the listening sockets handed over by the process
+        // that started us (in its listener order), none on a normal start
+        class Inheritance
+        {
+        public:
+            Inheritance()
+            {
+                const char *value = std::getenv(handoffEnv);
+                if (!value)
+                    return;
+                channel_ = std::atoi(value);
+                unsetenv(handoffEnv); // not for our own successor
+                if (channel_ < 0)
+                    return;
+                fcntl(channel_, F_SETFD, FD_CLOEXEC);
+                listeners_ = lifecycle_detail::receiveSockets(channel_);
+                if (listeners_.empty())
+                    close(channel_), channel_ = -1;
+            }
+
+            Inheritance(const Inheritance &) = delete;
+            Inheritance &operator=(const Inheritance &) = delete;
+
+            ~Inheritance()
+            {
+                if (channel_ >= 0)
+                    close(channel_);
+            }
+
+            const std::vector<int> &listeners() const { return listeners_; }
+
+            // Routes are in place: the predecessor stops accepting
+            void ready()
+            {
+                if (channel_ < 0)
+                    return;
+                char byte = 'R';
+                (void)!write(channel_, &byte, 1);
+                close(channel_);
+                channel_ = -1;
+            }
+
+        private:
+            int channel_ = -1;
+            std::vector<int> listeners_;
+        };
+
+        struct Successor
+        {
+            pid_t pid = -1;
+            bool ready = false;
+            std::string error;
+        };
+
+#ifdef XPRESSPP_HOT_RESTART
+
+        namespace lifecycle_detail
+        {
+            // The binary on disk: after a deploy replaced it, /proc/self/exe
+            // reads "<path> (deleted)" and the path holds the new build
+            inline std::string executablePath()
+            {
+                char buffer[4096];
+                auto n = readlink("/proc/self/exe", buffer, sizeof(buffer) - 1);
+                if (n <= 0)
+                    return {};
+                std::string path(buffer, static_cast<size_t>(n));
+                const std::string deleted = " (deleted)";
+                if (path.size() > deleted.size() &&
+                    path.compare(path.size() - deleted.size(), deleted.size(), deleted) == 0)
+                    path.resize(path.size() - deleted.size());
+                return path;
+            }
+
+            inline std::vector<std::string> commandLine()
+            {
+                std::ifstream file("/proc/self/cmdline", std::ios::binary);
+                std::string all((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+                std::vector<std::string> args;
+                size_t start = 0;
+                while (start < all.size())
+                {
+                    auto end = all.find('\0', start);
+                    if (end == std::string::npos)
+                        end = all.size();
+                    args.emplace_back(all, start, end - start);
+                    start = end + 1;
+                }
+                return args;
+            }
+        }
+
+        // 🔥 Predecessor side: starts the binary again with the same
+        // arguments, hands it `listeners` and waits until it is serving.
+        // Not ready in time (or crashed): it is killed and we carry on.
+        inline Successor spawnSuccessor(const std::vector<int> &listeners, int readyTimeoutSec)
+        {
+            Successor successor;
+
+            auto path = lifecycle_detail::executablePath();
+            auto args = lifecycle_detail::commandLine();
+            if (path.empty() || args.empty())
+            {
+                successor.error = "cannot read /proc/self";
+                return successor;
+            }
+
+            int channel[2];
+            if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, channel) != 0)
+            {
+                successor.error = std::string("socketpair: ") + std::strerror(errno);
+                return successor;
+            }
+
+            // Everything exec needs is built before fork: the child of a
+            // threaded process may only make async-signal-safe calls
+            std::vector<char *> argv;
+            for (auto &arg : args)
+                argv.push_back(&arg[0]);
+            argv.push_back(nullptr);
+
+            std::string handoff = std::string(handoffEnv) + "=" + std::to_string(channel[1]);
+            std::vector<char *> envp;
+            for (char **entry = environ; *entry; entry++)
+                if (std::strncmp(*entry, handoffEnv, std::strlen(handoffEnv)) != 0)
+                    envp.push_back(*entry);
+            envp.push_back(&handoff[0]);
+            envp.push_back(nullptr);
+
+            pid_t pid = fork();
+            if (pid == 0)
+            {
+                fcntl(channel[1], F_SETFD, 0); // survives exec
+                sigset_t none;
+                sigemptyset(&none);
+                sigprocmask(SIG_SETMASK, &none, nullptr);
+                execve(path.c_str(), argv.data(), envp.data());
+                _exit(127);
+            }
+            close(channel[1]);
+            if (pid < 0)
+            {
+                close(channel[0]);
+                successor.error = std::string("fork: ") + std::strerror(errno);
+                return successor;
+            }
+
+            successor.pid = pid;
+            successor.ready = lifecycle_detail::sendSockets(channel[0], listeners) &&
+                              lifecycle_detail::waitByte(channel[0], readyTimeoutSec);
+            close(channel[0]);
+
+            if (!successor.ready)
+            {
+                successor.error = "successor did not start serving";
+                kill(pid, SIGKILL);
+                waitpid(pid, nullptr, 0);
+            }
+            return successor;
+        }
+
+#else
+
+        inline Successor spawnSuccessor(const std::vector<int> &, int)
+        {
+            Successor successor;
+            successor.error = "hot restart needs Linux";
+            return successor;
+        }
+
+#endif
+
+#endif
+    }
+}
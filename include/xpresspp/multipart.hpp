@@ -0,0 +1,753 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+
+#include "simd.hpp"
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace xpresspp
+{
+    // 🔥 Where a file part's bytes go instead of a temp file
+    // Called as they arrive; data == nullptr ends the part. Returning false
+    // stops the upload (400). A part cut short by an error never gets the
+    // end call.
+    using UploadSink = std::function<bool(const char *data, size_t size)>;
+
+    // 🔥 One file part of a multipart/form-data body
+    // On disk at `path` unless config.multipart.sink took it. A file still
+    // at its temp path is removed with the request; moveTo() keeps it.
+    class UploadedFile
+    {
+    public:
+        std::string field;       // form field name
+        std::string filename;    // as the client sent it: not a safe path
+        std::string contentType;
+        size_t size = 0;
+        std::string path; // empty when a sink took the bytes
+
+        // Rename (or copy across filesystems) to `destination`
+        bool moveTo(const std::string &destination)
+        {
+            if (path.empty())
+                return false;
+
+            std::error_code ec;
+            std::filesystem::rename(path, destination, ec);
+            if (ec)
+            {
+                ec.clear();
+                std::filesystem::copy_file(path, destination,
+                                           std::filesystem::copy_options::overwrite_existing, ec);
+                if (ec)
+                    return false;
+                std::filesystem::remove(path, ec);
+            }
+            if (temp_)
+                temp_->keep = true;
+            path = destination;
+            return true;
+        }
+
+        // The whole content (small files)
+        std::string read() const
+        {
+            std::ifstream in(path, std::ios::binary);
+            return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        }
+
+    private:
+        friend class MultipartParser;
+
+        struct TempFile
+        {
+            std::string path;
+            bool keep = false;
+
+            ~TempFile()
+            {
+                if (!keep)
+                    std::remove(path.c_str());
+            }
+        };
+        std::shared_ptr<TempFile> temp_;
+    };
+
+    // 🔥 A parsed multipart/form-data body (req.form)
+    struct MultipartForm
+    {
+        std::unordered_map<std::string, std::string> fields; // text parts; a repeated name keeps the last
+        std::vector<UploadedFile> files;
+
+        const UploadedFile *file(const std::string &field) const
+        {
+            for (auto &f : files)
+                if (f.field == field)
+                    return &f;
+            return nullptr;
+        }
+    };
+
+    // 🔥 Limits and destinations (config.multipart)
+    struct MultipartOptions
+    {
+        size_t maxFieldSize = 64 * 1024;        // a text field, kept in memory
+        size_t maxFileSize = 100 * 1024 * 1024; // a file part
+        size_t maxParts = 1000;
+        size_t maxHeaderSize = 8 * 1024; // the headers of one part
+        std::string uploadDir = "/tmp";  // file parts without a sink
+
+        // Picks a sink for a file part (field, filename and content type
+        // set), given the request path; {} = a temp file in uploadDir
+        std::function<UploadSink(const std::string &path, const UploadedFile &file)> sink;
+    };
+
+    namespace multipart_detail
+    {
+        // First full occurrence of `needle` (at least 2 bytes) in [p, end).
+        // Candidates are the positions where both its first and its last
+        // byte line up, 32/16 at a time (AVX2/SSE2); only those are
+        // compared in full. In file data a candidate is rare, so the scan
+        // runs at memory speed.
+        inline const char *find(const char *p, const char *end, std::string_view needle)
+        {
+            const size_t n = needle.size();
+            if (static_cast<size_t>(end - p) < n)
+                return nullptr;
+            const char *last = end - n; // last possible start
+
+#if defined(XPRESSPP_AVX2)
+            const __m256i first32 = _mm256_set1_epi8(needle[0]);
+            const __m256i final32 = _mm256_set1_epi8(needle[n - 1]);
+            while (last - p >= 31)
+            {
+                __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+                __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + n - 1));
+                uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(
+                    _mm256_and_si256(_mm256_cmpeq_epi8(a, first32), _mm256_cmpeq_epi8(b, final32))));
+                while (mask)
+                {
+                    const char *candidate = p + simd::lowestBit(mask);
+                    if (std::memcmp(candidate + 1, needle.data() + 1, n - 2) == 0)
+                        return candidate;
+                    mask &= mask - 1;
+                }
+                p += 32;
+            }
+#endif
+#if defined(XPRESSPP_SSE2)
+            const __m128i first16 = _mm_set1_epi8(needle[0]);
+            const __m128i final16 = _mm_set1_epi8(needle[n - 1]);
+            while (last - p >= 15)
+            {
+                __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+                __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + n - 1));
+                uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(
+                    _mm_and_si128(_mm_cmpeq_epi8(a, first16), _mm_cmpeq_epi8(b, final16))));
+                while (mask)
+                {
+                    const char *candidate = p + simd::lowestBit(mask);
+                    if (std::memcmp(candidate + 1, needle.data() + 1, n - 2) == 0)
+                        return candidate;
+                    mask &= mask - 1;
+                }
+                p += 16;
+            }
+#endif
+            for (; p <= last; p++)
+            {
+                if (*p == needle[0] && p[n - 1] == needle[n - 1] &&
+                    std::memcmp(p + 1, needle.data() + 1, n - 2) == 0)
+                    return p;
+            }
+            return nullptr;
+        }
+
+        // Start of the longest suffix of [p, end) that is a proper prefix
+        // of `needle` (a delimiter the next read may complete); end if none
+        inline const char *partialTail(const char *p, const char *end, std::string_view needle)
+        {
+            const char *q = end - std::min<size_t>(static_cast<size_t>(end - p), needle.size() - 1);
+            while (q < end)
+            {
+                q = static_cast<const char *>(std::memchr(q, needle[0], static_cast<size_t>(end - q)));
+                if (!q)
+                    return end;
+                if (std::memcmp(q, needle.data(), static_cast<size_t>(end - q)) == 0)
+                    return q;
+                q++;
+            }
+            return end;
+        }
+
+        inline bool equalsNoCase(std::string_view a, std::string_view b)
+        {
+            return a.size() == b.size() &&
+                   std::equal(a.begin(), a.end(), b.begin(), [](char x, char y)
+                              { return std::tolower(static_cast<unsigned char>(x)) ==
+                                       std::tolower(static_cast<unsigned char>(y)); });
+        }
+
+        inline std::string_view trim(std::string_view s)
+        {
+            while (!s.empty() && (s.front() == ' ' || s.front() == '\t'))
+                s.remove_prefix(1);
+            while (!s.empty() && (s.back() == ' ' || s.back() == '\t'))
+                s.remove_suffix(1);
+            return s;
+        }
+
+        // `; key=value` parameters of a header value (quoted or token)
+        inline std::unordered_map<std::string, std::string> parameters(std::string_view value)
+        {
+            std::unordered_map<std::string, std::string> out;
+            size_t i = value.find(';');
+            while (i != std::string_view::npos && i < value.size())
+            {
+                i++;
+                while (i < value.size() && (value[i] == ' ' || value[i] == '\t'))
+                    i++;
+                size_t eq = value.find('=', i);
+                if (eq == std::string_view::npos)
+                    break;
+                std::string key(trim(value.substr(i, eq - i)));
+                std::transform(key.begin(), key.end(), key.begin(),
+                               [](unsigned char c)
+                               { return static_cast<char>(std::tolower(c)); });
+
+                std::string val;
+                i = eq + 1;
+                if (i < value.size() && value[i] == '"')
+                {
+                    for (i++; i < value.size() && value[i] != '"'; i++)
+                    {
+                        if (value[i] == '\\' && i + 1 < value.size())
+                            i++;
+                        val += value[i];
+                    }
+                    i = value.find(';', i);
+                }
+                else
+                {
+                    size_t next = value.find(';', i);
+                    val = std::string(trim(value.substr(i, next == std::string_view::npos ? std::string_view::npos : next - i)));
+                    i = next;
+                }
+                out[key] = std::move(val);
+            }
+            return out;
+        }
+
+        // RFC 5987 ext-value: charset'language'percent-encoded
+        inline std::string decodeExtValue(const std::string &value)
+        {
+            auto quote = value.find('\'');
+            auto second = quote == std::string::npos ? std::string::npos : value.find('\'', quote + 1);
+            if (second == std::string::npos)
+                return value;
+            std::string out;
+            for (size_t i = second + 1; i < value.size(); i++)
+            {
+                if (value[i] == '%' && i + 2 < value.size() &&
+                    std::isxdigit(static_cast<unsigned char>(value[i + 1])) &&
+                    std::isxdigit(static_cast<unsigned char>(value[i + 2])))
+                {
+                    out += static_cast<char>(std::stoi(value.substr(i + 1, 2), nullptr, 16));
+                    i += 2;
+                }
+                else
+                    out += value[i];
+            }
+            return out;
+        }
+
+        inline std::string tempName(const std::string &dir)
+        {
+            static std::atomic<uint64_t> counter{0};
+            thread_local std::mt19937_64 random{std::random_device{}()};
+            char name[64];
+            std::snprintf(name, sizeof(name), "/xpresspp-upload-%016llx%04llx",
+                          static_cast<unsigned long long>(random()),
+                          static_cast<unsigned long long>(counter++ & 0xffff));
+            return dir + name;
+        }
+
+        // An upload's temp file, written through a descriptor. Created with
+        // O_EXCL and mode 0600: a file planted at the path beforehand is
+        // never opened, and other local users cannot read the upload.
+        class TempFileWriter
+        {
+        public:
+            TempFileWriter() = default;
+            TempFileWriter(const TempFileWriter &) = delete;
+            TempFileWriter &operator=(const TempFileWriter &) = delete;
+            ~TempFileWriter() { close(); }
+
+            // A new file in dir: its path, or empty
+            std::string create(const std::string &dir)
+            {
+                close();
+                for (int attempt = 0; attempt < 8; attempt++)
+                {
+                    auto path = tempName(dir);
+#ifdef _WIN32
+                    fd_ = ::_open(path.c_str(), _O_CREAT | _O_EXCL | _O_WRONLY | _O_BINARY | _O_NOINHERIT,
+                                  _S_IREAD | _S_IWRITE);
+#else
+                    fd_ = ::open(path.c_str(), O_CREAT | O_EXCL | O_WRONLY | O_CLOEXEC, 0600);
+#endif
+                    if (fd_ >= 0)
+                        return path;
+                    if (errno != EEXIST)
+                        break;
+                }
+                return std::string();
+            }
+
+            bool write(const char *data, size_t size)
+            {
+                while (size > 0)
+                {
+#ifdef _WIN32
+                    auto n = ::_write(fd_, data, static_cast<unsigned>(std::min<size_t>(size, 1u << 30)));
+#else
+                    auto n = ::write(fd_, data, size);
+#endif
+                    if (n < 0 && errno == EINTR)
+                        continue;
+                    if (n <= 0)
+                        return false;
+                    data += n;
+                    size -= static_cast<size_t>(n);
+                }
+                return true;
+            }
+
+            bool close()
+            {
+                if (fd_ < 0)
+                    return true;
+#ifdef _WIN32
+                bool ok = ::_close(fd_) == 0;
+#else
+                bool ok = ::close(fd_) == 0;
+#endif
+                fd_ = -1;
+                return ok;
+            }
+
+        private:
+            int fd_ = -1;
+        };
+    }
+
+    // 🔥 Streaming multipart/form-data parser
+    // Fed the body as it is read from the connection: nothing is buffered
+    // beyond one part's headers and the few bytes of a delimiter split
+    // across reads. Text fields are collected in memory, file parts are
+    // written to a temp file (or a sink) chunk by chunk, each under its
+    // own size limit.
+    class MultipartParser
+    {
+    public:
+        // The boundary of a multipart/form-data Content-Type; empty for
+        // anything else
+        static std::string boundaryOf(std::string_view contentType)
+        {
+            auto semicolon = contentType.find(';');
+            if (!multipart_detail::equalsNoCase(multipart_detail::trim(contentType.substr(0, semicolon)),
+                                                "multipart/form-data"))
+                return {};
+            auto params = multipart_detail::parameters(contentType);
+            auto it = params.find("boundary");
+            if (it == params.end() || it->second.empty() || it->second.size() > 70)
+                return {};
+            return it->second;
+        }
+
+        MultipartParser(const std::string &boundary, const MultipartOptions &options,
+                        std::string requestPath, MultipartForm &form)
+            : delimiter_("\r\n--" + boundary), options_(options),
+              requestPath_(std::move(requestPath)), form_(form)
+        {
+            // A body opens with "--boundary": the CRLF of the first
+            // delimiter is implied
+            carry_ = "\r\n";
+        }
+
+        // false: stop reading (status() says why)
+        bool feed(const char *data, size_t size)
+        {
+            const char *p = data;
+            const char *end = data + size;
+            while (p < end)
+            {
+                switch (state_)
+                {
+                case State::Preamble:
+                case State::Body:
+                    p = body(p, end);
+                    break;
+                case State::AfterDelimiter:
+                    p = afterDelimiter(p, end);
+                    break;
+                case State::Headers:
+                    p = headers(p, end);
+                    break;
+                case State::Done:
+                    return true; // epilogue: ignored
+                case State::Failed:
+                    return false;
+                }
+            }
+            return state_ != State::Failed;
+        }
+
+        // After the last byte: true if the body was complete
+        bool finish()
+        {
+            if (state_ == State::Done)
+                return true;
+            if (state_ != State::Failed)
+                fail(400, "incomplete multipart body");
+            return false;
+        }
+
+        int status() const { return status_; }
+        const std::string &error() const { return error_; }
+
+    private:
+        enum class State
+        {
+            Preamble,       // before the first delimiter: discarded
+            AfterDelimiter, // "--" (the last) or CRLF (a part follows)
+            Headers,
+            Body,
+            Done,
+            Failed
+        };
+
+        std::string delimiter_; // CRLF "--" boundary
+        const MultipartOptions &options_;
+        std::string requestPath_;
+        MultipartForm &form_;
+
+        State state_ = State::Preamble;
+        int status_ = 0;
+        std::string error_;
+
+        std::string carry_;  // a delimiter prefix at the end of the last read
+        std::string header_; // headers of the part being started
+        bool closing_ = false; // saw '-' after a delimiter
+        bool sawCR_ = false;
+        size_t parts_ = 0;
+
+        // The part being read
+        bool isFile_ = false;
+        std::string name_;
+        std::string value_;
+        UploadedFile file_;
+        UploadSink sink_;
+        multipart_detail::TempFileWriter out_;
+
+        void fail(int status, std::string message)
+        {
+            state_ = State::Failed;
+            status_ = status;
+            error_ = std::move(message);
+        }
+
+        // Body bytes (or preamble) up to the next delimiter
+        const char *body(const char *p, const char *end)
+        {
+            const auto &delimiter = delimiter_;
+
+            if (!carry_.empty())
+            {
+                // A delimiter may have begun at the end of the last read:
+                // decide with up to one delimiter's worth of new bytes
+                size_t carried = carry_.size();
+                size_t take = std::min<size_t>(static_cast<size_t>(end - p), delimiter.size());
+                carry_.append(p, take);
+
+                for (size_t i = 0; i < carried; i++)
+                {
+                    size_t have = carry_.size() - i;
+                    size_t need = std::min(have, delimiter.size());
+                    if (std::memcmp(carry_.data() + i, delimiter.data(), need) != 0)
+                        continue;
+                    if (have >= delimiter.size())
+                    {
+                        // Complete: the part ends
+                        if (!content(carry_.data(), i) || !endPart())
+                            return end;
+                        p += i + delimiter.size() - carried;
+                        carry_.clear();
+                        return p;
+                    }
+                    // Still only a prefix (this read was short): keep it
+                    if (!content(carry_.data(), i))
+                        return end;
+                    carry_.erase(0, i);
+                    return end;
+                }
+
+                // No delimiter starts in the carried bytes: they are content
+                if (!content(carry_.data(), carried))
+                    return end;
+                carry_.clear();
+            }
+
+            const char *hit = multipart_detail::find(p, end, delimiter);
+            if (hit)
+            {
+                if (!content(p, static_cast<size_t>(hit - p)) || !endPart())
+                    return end;
+                return hit + delimiter.size();
+            }
+
+            const char *tail = multipart_detail::partialTail(p, end, delimiter);
+            if (!content(p, static_cast<size_t>(tail - p)))
+                return end;
+            carry_.assign(tail, static_cast<size_t>(end - tail));
+            return end;
+        }
+
+        // "--" ends the body; CRLF (after optional padding) starts a part
+        const char *afterDelimiter(const char *p, const char *end)
+        {
+            while (p < end)
+            {
+                char c = *p++;
+                if (closing_)
+                {
+                    if (c != '-')
+                    {
+                        fail(400, "malformed multipart delimiter");
+                        return end;
+                    }
+                    state_ = State::Done;
+                    return p;
+                }
+                if (c == '-' && !sawCR_)
+                    closing_ = true;
+                else if ((c == ' ' || c == '\t') && !sawCR_)
+                    continue; // transport padding
+                else if (c == '\r' && !sawCR_)
+                    sawCR_ = true;
+                else if (c == '\n' && sawCR_)
+                {
+                    sawCR_ = false;
+                    header_.clear();
+                    state_ = State::Headers;
+                    return p;
+                }
+                else
+                {
+                    fail(400, "malformed multipart delimiter");
+                    return end;
+                }
+            }
+            return p;
+        }
+
+        // Part headers up to the blank line
+        const char *headers(const char *p, const char *end)
+        {
+            size_t before = header_.size();
+            size_t room = options_.maxHeaderSize + 4 - before;
+            size_t take = std::min<size_t>(static_cast<size_t>(end - p), room);
+            header_.append(p, take);
+
+            size_t blank;
+            if (header_.compare(0, 2, "\r\n") == 0)
+                blank = 0; // no headers at all
+            else
+            {
+                blank = header_.find("\r\n\r\n", before > 3 ? before - 3 : 0);
+                if (blank == std::string::npos)
+                {
+                    if (header_.size() >= options_.maxHeaderSize + 4)
+                    {
+                        fail(413, "multipart part headers too large");
+                        return end;
+                    }
+                    return p + take;
+                }
+                blank += 2;
+            }
+
+            const char *next = p + (blank + 2 - before);
+            if (!beginPart(std::string_view(header_).substr(0, blank)))
+                return end;
+            state_ = State::Body;
+            return next;
+        }
+
+        bool beginPart(std::string_view block)
+        {
+            if (++parts_ > options_.maxParts)
+            {
+                fail(413, "too many multipart parts");
+                return false;
+            }
+
+            std::string disposition, contentType;
+            while (!block.empty())
+            {
+                auto eol = block.find("\r\n");
+                auto line = block.substr(0, eol);
+                block = eol == std::string_view::npos ? std::string_view() : block.substr(eol + 2);
+
+                auto colon = line.find(':');
+                if (colon == std::string_view::npos)
+                    continue;
+                auto key = multipart_detail::trim(line.substr(0, colon));
+                auto value = multipart_detail::trim(line.substr(colon + 1));
+                if (multipart_detail::equalsNoCase(key, "Content-Disposition"))
+                    disposition = std::string(value);
+                else if (multipart_detail::equalsNoCase(key, "Content-Type"))
+                    contentType = std::string(value);
+            }
+
+            auto params = multipart_detail::parameters(disposition);
+            auto name = params.find("name");
+            if (name == params.end())
+            {
+                fail(400, "multipart part without a name");
+                return false;
+            }
+
+            name_ = name->second;
+            value_.clear();
+            auto filenameExt = params.find("filename*");
+            auto filename = params.find("filename");
+            isFile_ = filenameExt != params.end() || filename != params.end();
+            if (!isFile_)
+                return true;
+
+            file_ = UploadedFile();
+            file_.field = name_;
+            file_.filename = filenameExt != params.end()
+                                 ? multipart_detail::decodeExtValue(filenameExt->second)
+                                 : filename->second;
+            file_.contentType = contentType.empty() ? "application/octet-stream" : contentType;
+
+            sink_ = options_.sink ? options_.sink(requestPath_, file_) : UploadSink();
+            if (sink_)
+                return true;
+
+            auto path = out_.create(options_.uploadDir);
+            if (path.empty())
+            {
+                fail(500, "cannot create upload file in " + options_.uploadDir);
+                return false;
+            }
+            file_.temp_ = std::make_shared<UploadedFile::TempFile>();
+            file_.temp_->path = path;
+            file_.path = path;
+            return true;
+        }
+
+        bool content(const char *data, size_t size)
+        {
+            if (size == 0 || state_ == State::Preamble)
+                return true;
+
+            if (!isFile_)
+            {
+                if (value_.size() + size > options_.maxFieldSize)
+                {
+                    fail(413, "multipart field \"" + name_ + "\" too large");
+                    return false;
+                }
+                value_.append(data, size);
+                return true;
+            }
+
+            if (file_.size + size > options_.maxFileSize)
+            {
+                fail(413, "multipart file \"" + name_ + "\" too large");
+                return false;
+            }
+            file_.size += size;
+            if (sink_)
+            {
+                if (!sink_(data, size))
+                {
+                    fail(400, "upload rejected");
+                    return false;
+                }
+                return true;
+            }
+            if (!out_.write(data, size))
+            {
+                fail(500, "cannot write upload file");
+                return false;
+            }
+            return true;
+        }
+
+        bool endPart()
+        {
+            if (state_ == State::Preamble)
+            {
+                state_ = State::AfterDelimiter;
+                return true;
+            }
+            state_ = State::AfterDelimiter;
+
+            if (!isFile_)
+            {
+                form_.fields[name_] = std::move(value_);
+                return true;
+            }
+
+            if (sink_)
+            {
+                bool accepted = sink_(nullptr, 0);
+                sink_ = nullptr;
+                if (!accepted)
+                {
+                    fail(400, "upload rejected");
+                    return false;
+                }
+            }
+            else
+            {
+                if (!out_.close())
+                {
+                    fail(500, "cannot write upload file");
+                    return false;
+                }
+            }
+            form_.files.push_back(std::move(file_));
+            file_ = UploadedFile();
+            return true;
+        }
+    };
+}
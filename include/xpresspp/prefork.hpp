@@ -0,0 +1,346 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <functional>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+// Prefork needs fork, a shared anonymous mapping, sigtimedwait and
+// PR_SET_PDEATHSIG
+#ifdef __linux__
+#include <csignal>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#define XPRESSPP_PREFORK
+#endif
+
+namespace xpresspp
+{
+    // 🔥 Instance-wide metrics for prefork workers
+    // One MAP_SHARED block, mapped by the master before it forks: every
+    // worker adds to the same lock-free counters and histogram, so /metrics
+    // on any worker reports the whole instance. Lock-free atomics are
+    // address-free, which is what makes them valid across processes.
+    struct SharedMetrics
+    {
+        static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared counters must be lock-free");
+
+        static constexpr size_t maxWorkers = 256;
+        static constexpr size_t maxStatus = 600;
+        static constexpr std::array<const char *, 7> methodNames{"GET", "POST", "PUT", "DELETE", "PATCH", "HEAD", "OPTIONS"};
+        // Bucket i counts responses faster than latencyBounds[i] ms; the last
+        // bucket is everything slower
+        static constexpr std::array<double, 16> latencyBounds{0.1, 0.25, 0.5, 1, 2.5, 5, 10, 25, 50,
+                                                              100, 250, 500, 1000, 2500, 5000, 10000};
+
+        struct Worker
+        {
+            std::atomic<int32_t> pid{0}; // 0: not running
+            std::atomic<int64_t> startedAt{0}; // unix seconds
+            std::atomic<uint64_t> requests{0};
+            std::atomic<uint32_t> restarts{0};
+            std::atomic<int32_t> lastExit{0}; // wait status of the slot's previous process
+        };
+
+        std::atomic<uint64_t> total{0};
+        std::atomic<uint64_t> success{0};
+        std::atomic<uint64_t> error{0};
+        std::atomic<uint64_t> active{0};
+        std::atomic<uint64_t> durationMicros{0};
+        std::atomic<uint64_t> status[maxStatus] = {};
+        std::atomic<uint64_t> methods[methodNames.size() + 1] = {}; // + other
+        std::atomic<uint64_t> latency[latencyBounds.size() + 1] = {};
+        std::atomic<uint32_t> workerCount{0};
+        Worker workers[maxWorkers];
+
+#ifdef XPRESSPP_PREFORK
+        // Zeroed, shared with every process forked after this call. Lives
+        // until the process exits.
+        static SharedMetrics *create()
+        {
+            void *memory = mmap(nullptr, sizeof(SharedMetrics), PROT_READ | PROT_WRITE,
+                                MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+            if (memory == MAP_FAILED)
+                return nullptr;
+            return new (memory) SharedMetrics();
+        }
+#endif
+
+        void record(int slot, const std::string &method, int code, double ms)
+        {
+            total.fetch_add(1, std::memory_order_relaxed);
+            (code >= 200 && code < 400 ? success : error).fetch_add(1, std::memory_order_relaxed);
+            durationMicros.fetch_add(static_cast<uint64_t>(ms * 1000), std::memory_order_relaxed);
+            status[code >= 0 && static_cast<size_t>(code) < maxStatus ? code : 0].fetch_add(1, std::memory_order_relaxed);
+
+            size_t m = 0;
+            while (m < methodNames.size() && method != methodNames[m])
+                m++;
+            methods[m].fetch_add(1, std::memory_order_relaxed);
+
+            size_t b = 0;
+            while (b < latencyBounds.size() && ms >= latencyBounds[b])
+                b++;
+            latency[b].fetch_add(1, std::memory_order_relaxed);
+
+            if (slot >= 0 && static_cast<size_t>(slot) < maxWorkers)
+                workers[slot].requests.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        // Upper bound of the bucket holding quantile q, in ms
+        double quantile(double q) const
+        {
+            uint64_t counts[latencyBounds.size() + 1];
+            uint64_t sum = 0;
+            for (size_t i = 0; i <= latencyBounds.size(); i++)
+                sum += counts[i] = latency[i].load(std::memory_order_relaxed);
+            if (sum == 0)
+                return 0;
+
+            uint64_t rank = static_cast<uint64_t>(q * sum), seen = 0;
+            for (size_t i = 0; i < latencyBounds.size(); i++)
+            {
+                seen += counts[i];
+                if (seen > rank)
+                    return latencyBounds[i];
+            }
+            return latencyBounds.back();
+        }
+
+        // Same keys as the single-process /metrics, plus latency and workers
+        nlohmann::json toJSON() const
+        {
+            auto n = total.load();
+            nlohmann::json statusCodes = nlohmann::json::object();
+            for (size_t code = 0; code < maxStatus; code++)
+                if (auto count = status[code].load())
+                    statusCodes[std::to_string(code)] = count;
+
+            nlohmann::json methodCounts = nlohmann::json::object();
+            for (size_t m = 0; m <= methodNames.size(); m++)
+                if (auto count = methods[m].load())
+                    methodCounts[m < methodNames.size() ? methodNames[m] : "OTHER"] = count;
+
+            nlohmann::json buckets = nlohmann::json::array();
+            for (size_t b = 0; b <= latencyBounds.size(); b++)
+                buckets.push_back({{"lt", b < latencyBounds.size() ? nlohmann::json(latencyBounds[b]) : nlohmann::json("+Inf")},
+                                   {"count", latency[b].load()}});
+
+            nlohmann::json processes = nlohmann::json::array();
+            for (size_t slot = 0; slot < workerCount.load(); slot++)
+            {
+                auto &w = workers[slot];
+                processes.push_back({{"slot", slot},
+                                     {"pid", w.pid.load()},
+                                     {"startedAt", w.startedAt.load()},
+                                     {"requests", w.requests.load()},
+                                     {"restarts", w.restarts.load()}});
+            }
+
+            return {
+                {"requests", {{"total", n}, {"success", success.load()}, {"error", error.load()}, {"active", active.load()}}},
+                {"performance", {{"avgResponseTime", n ? durationMicros.load() / 1000.0 / n : 0.0},
+                                 {"p50", quantile(0.50)},
+                                 {"p99", quantile(0.99)}}},
+                {"statusCodes", statusCodes},
+                {"methods", methodCounts},
+                {"latency", buckets},
+                {"workers", processes}};
+        }
+    };
+
+#ifdef XPRESSPP_PREFORK
+
+    // 🔥 Prefork master: keeps `workers` processes serving and restarts the
+    // ones that die, with exponential backoff for a slot that keeps
+    // crashing. The master stays single-threaded (signals are taken with
+    // sigtimedwait), so forking from it is safe at any time.
+    class Supervisor
+    {
+    public:
+        struct Options
+        {
+            size_t workers = 2;
+            std::chrono::milliseconds backoff{100};     // first restart delay, doubled per crash
+            std::chrono::milliseconds maxBackoff{10000};
+            std::chrono::seconds stableAfter{10};       // a worker up this long resets its backoff
+        };
+
+        // Runs in the child and does not return
+        using Worker = std::function<void(size_t slot)>;
+        // SIGHUP: true once a new instance took over (we then stop)
+        using Handoff = std::function<bool()>;
+
+        Supervisor(Options options, SharedMetrics &metrics, Worker worker)
+            : options_(options), metrics_(metrics), worker_(std::move(worker)),
+              slots_(std::min(options.workers, SharedMetrics::maxWorkers))
+        {
+            metrics_.workerCount = static_cast<uint32_t>(slots_.size());
+        }
+
+        // Until SIGTERM / SIGINT (or a SIGHUP handoff) and every worker has
+        // exited. A second stop signal is forwarded too: workers then cut
+        // their drain short. onStop runs once, before the workers are told.
+        void run(const Handoff &onHangup, const std::function<void()> &onStop = {})
+        {
+            sigset_t signals;
+            sigemptyset(&signals);
+            for (int signo : {SIGTERM, SIGINT, SIGHUP, SIGCHLD})
+                sigaddset(&signals, signo);
+            sigprocmask(SIG_BLOCK, &signals, &previousMask_);
+            master_ = getpid();
+
+            for (size_t slot = 0; slot < slots_.size(); slot++)
+                spawn(slot);
+
+            bool stopping = false;
+            for (;;)
+            {
+                reap(stopping);
+                if (stopping && std::none_of(slots_.begin(), slots_.end(), [](const Slot &s)
+                                             { return s.pid > 0; }))
+                    break;
+
+                auto now = Clock::now();
+                auto wake = now + std::chrono::seconds(1);
+                if (!stopping)
+                {
+                    for (size_t slot = 0; slot < slots_.size(); slot++)
+                    {
+                        if (slots_[slot].pid > 0)
+                            continue;
+                        if (slots_[slot].restartAt <= now)
+                            spawn(slot);
+                        else
+                            wake = std::min(wake, slots_[slot].restartAt);
+                    }
+                }
+
+                auto wait = std::chrono::duration_cast<std::chrono::nanoseconds>(wake - Clock::now());
+                timespec timeout{static_cast<time_t>(std::max<int64_t>(wait.count(), 0) / 1000000000),
+                                 static_cast<long>(std::max<int64_t>(wait.count(), 0) % 1000000000)};
+                int signo = sigtimedwait(&signals, nullptr, &timeout);
+
+                bool stop = signo == SIGTERM || signo == SIGINT ||
+                            (signo == SIGHUP && !stopping && onHangup());
+                if (!stop)
+                    continue;
+                if (!stopping)
+                {
+                    std::cout << "\n🛑 Stopping " << slots_.size() << " workers...\n";
+                    if (onStop)
+                        onStop();
+                }
+                stopping = true;
+                signalAll(SIGTERM);
+            }
+
+            sigprocmask(SIG_SETMASK, &previousMask_, nullptr);
+        }
+
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        struct Slot
+        {
+            pid_t pid = 0;
+            Clock::time_point startedAt;
+            Clock::time_point restartAt;
+            int crashes = 0; // in a row, for the backoff
+        };
+
+        Options options_;
+        SharedMetrics &metrics_;
+        Worker worker_;
+        std::vector<Slot> slots_;
+        sigset_t previousMask_;
+        pid_t master_ = 0;
+
+        void spawn(size_t slot)
+        {
+            // Buffered output would be written again by every child
+            std::cout.flush();
+            std::cerr.flush();
+            std::fflush(nullptr);
+
+            pid_t pid = fork();
+            if (pid == 0)
+            {
+                sigprocmask(SIG_SETMASK, &previousMask_, nullptr);
+                prctl(PR_SET_PDEATHSIG, SIGTERM); // the master died: drain and exit
+                if (getppid() != master_)
+                    _exit(0);
+                setpgid(0, 0); // Ctrl-C reaches the master only; it forwards SIGTERM
+                worker_(slot);
+                _exit(0);
+            }
+            if (pid < 0)
+            {
+                std::cerr << "⚠️  fork failed: " << std::strerror(errno) << "\n";
+                slots_[slot].restartAt = Clock::now() + options_.maxBackoff;
+                return;
+            }
+
+            auto &s = slots_[slot];
+            s.pid = pid;
+            s.startedAt = Clock::now();
+            metrics_.workers[slot].pid = pid;
+            metrics_.workers[slot].startedAt = static_cast<int64_t>(std::time(nullptr));
+        }
+
+        void reap(bool stopping)
+        {
+            int status;
+            pid_t pid;
+            while ((pid = waitpid(-1, &status, WNOHANG)) > 0)
+            {
+                auto it = std::find_if(slots_.begin(), slots_.end(), [pid](const Slot &s)
+                                       { return s.pid == pid; });
+                if (it == slots_.end())
+                    continue; // not a worker (a hot-restart successor that failed)
+
+                size_t slot = static_cast<size_t>(it - slots_.begin());
+                it->pid = 0;
+                metrics_.workers[slot].pid = 0;
+                metrics_.workers[slot].lastExit = status;
+                if (stopping)
+                    continue;
+
+                // Any exit while serving is a crash
+                auto now = Clock::now();
+                if (now - it->startedAt >= options_.stableAfter)
+                    it->crashes = 0;
+                auto delay = std::min<std::chrono::milliseconds>(options_.maxBackoff, options_.backoff * (1LL << std::min(it->crashes, 16)));
+                it->crashes++;
+                it->restartAt = now + delay;
+                metrics_.workers[slot].restarts++;
+
+                std::cerr << "💥 Worker " << slot << " (pid " << pid << ") "
+                          << (WIFSIGNALED(status) ? "killed by signal " + std::to_string(WTERMSIG(status))
+                                                  : "exited with " + std::to_string(WEXITSTATUS(status)))
+                          << "; restarting in " << delay.count() << "ms\n";
+            }
+        }
+
+        void signalAll(int signo)
+        {
+            for (auto &s : slots_)
+                if (s.pid > 0)
+                    kill(s.pid, signo);
+        }
+    };
+
+#endif
+}
@@ -0,0 +1,506 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <cstring>
+#include <cstdlib>
+#include <functional>
+#include <stdexcept>
+#include <unordered_set>
+#include <algorithm>
+#include <nlohmann/json.hpp>
+#include "etag.hpp"
+#include "httplib.h"
+#include "simd.hpp"
+
+#ifdef __linux__
+#include <sys/mman.h>
+#define XPRESSPP_RATE_HUGEPAGES 1
+#endif
+
+namespace xpresspp
+{
+    // 🔥 Rate limiting (ServerConfig::rateLimit)
+    struct RateLimitConfig
+    {
+        enum class Key
+        {
+            IP,          // client address (proxy headers only with trustProxy)
+            BearerToken, // Authorization: Bearer <token>, IP when absent
+            Custom       // keyExtractor
+        };
+
+        bool enabled = false;
+        int limit = 100;        // requests per window
+        int windowSeconds = 60; // the bucket refills fully over one window
+        int burst = 0;          // bucket size, at most 65536; 0 = limit (capped)
+        Key key = Key::IP;
+        std::function<std::string(const httplib::Request &)> keyExtractor; // Key::Custom; "" = not limited
+        std::unordered_set<std::string> routes; // route templates; empty = every route
+        size_t memoryBytes = 8 * 1024 * 1024;   // fixed table size (~4 bytes per key slot)
+    };
+
+    // 🔥 GCRA rate limiter: one 32-bit atomic per key, no locks
+    // Each slot packs a 14-bit key fingerprint with the low 18 bits of the
+    // key's theoretical arrival time (TAT), in units of 2^k nanoseconds
+    // picked so the burst tolerance fits in 16 bits. Fifteen slots and a
+    // last-checked stamp share a 64-byte bucket (one cache line); a key
+    // lives in the bucket its hash selects. A slot whose TAT has passed is a
+    // full bucket — exactly what a brand-new key gets — so idle keys expire
+    // implicitly and are reused in place, and memory never grows past
+    // memoryBytes. The truncated TATs stay unambiguous because every check
+    // clears its bucket's long-expired slots, and a bucket nobody checked
+    // for half the 18-bit range is cleared whole. When all 15 slots of a
+    // bucket are active, the one closest to refilled is evicted (counted in
+    // stats).
+    class RateLimiter
+    {
+    public:
+        struct Decision
+        {
+            bool allowed = true;
+            int limit = 0;
+            int remaining = 0;
+            long long reset = 0;  // epoch seconds when the bucket is full again
+            int retryAfter = 0;   // seconds, when denied
+        };
+
+        // Throws std::invalid_argument for a limit it cannot enforce: a
+        // non-positive limit or window, or a burst past 65536 (a burst
+        // defaulted from a larger limit is capped instead; see burst())
+        explicit RateLimiter(const RateLimitConfig &config)
+            : config_(config), start_(Clock::now())
+        {
+            if (config_.limit <= 0 || config_.windowSeconds <= 0)
+                throw std::invalid_argument("rateLimit: limit and windowSeconds must be positive");
+            if (config_.burst > static_cast<int>(maxAhead))
+                throw std::invalid_argument("rateLimit: burst above " + std::to_string(maxAhead) + " is not supported");
+            burst_ = config_.burst > 0 ? config_.burst : std::min(config_.limit, static_cast<int>(maxAhead));
+
+            // The coarsest units that still split the interval into 64+,
+            // coarser again if the burst tolerance does not fit in maxAhead.
+            // Rounded up: the enforced rate never exceeds the limit, and is
+            // within 2% of it for bursts up to ~800 (see enforcedLimit)
+            double windowNanos = static_cast<double>(config_.windowSeconds) * nanosPerSecond;
+            uint64_t interval = std::max<uint64_t>(1, static_cast<uint64_t>(windowNanos / config_.limit));
+            while ((interval >> (shift_ + 1)) >= 64)
+                shift_++;
+            for (;; shift_++)
+            {
+                interval_ = std::max<uint64_t>(1, (interval + (uint64_t(1) << shift_) - 1) >> shift_);
+                tolerance_ = interval_ * static_cast<uint64_t>(burst_);
+                if (tolerance_ <= maxAhead)
+                    break;
+            }
+
+            size_t buckets = 1;
+            while (buckets * 2 * sizeof(Bucket) <= config_.memoryBytes)
+                buckets *= 2;
+            mask_ = buckets - 1;
+            table_ = allocateTable(buckets);
+
+#ifdef CLOCK_MONOTONIC_COARSE
+            timespec ts;
+            clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+            startNanos_ = static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+#endif
+        }
+
+        // Hashed key for this request (0 = not limited). IPs and bearer
+        // tokens are hashed where they sit in the request: no key string
+        // is built on the hot path.
+        uint64_t keyHash(const httplib::Request &req, bool trustProxy) const
+        {
+            switch (config_.key)
+            {
+            case RateLimitConfig::Key::Custom:
+            {
+                if (!config_.keyExtractor)
+                    return 0;
+                std::string key = config_.keyExtractor(req);
+                return key.empty() ? 0 : keyHash(key);
+            }
+            case RateLimitConfig::Key::BearerToken:
+            {
+                static const std::string authorization = "Authorization";
+                auto it = req.headers.find(authorization);
+                if (it != req.headers.end() && it->second.size() > 7 && it->second.compare(0, 7, "Bearer ") == 0)
+                    return keyHash(std::string_view(it->second).substr(7), tokenSeed);
+                break;
+            }
+            case RateLimitConfig::Key::IP:
+                break;
+            }
+            return keyHash(clientAddress(req, trustProxy), ipSeed);
+        }
+
+        // Keys are mostly short (IPs, tokens): two overlapping fixed-size
+        // reads and two multiply-folds for <= 16 bytes, the full 128-bit
+        // hash beyond that. Never 0.
+        static uint64_t keyHash(std::string_view key, uint64_t seed = 0)
+        {
+            using namespace hash_detail;
+            const auto *p = reinterpret_cast<const unsigned char *>(key.data());
+            size_t n = key.size();
+            uint64_t a = 0, b = 0;
+            if (n > 16)
+            {
+                Hash128 full = fastHash128(key);
+                a = full.lo;
+                b = full.hi;
+            }
+            else if (n >= 8)
+            {
+                a = read64(p);
+                b = read64(p + n - 8);
+            }
+            else if (n >= 4)
+            {
+                uint32_t head, tail;
+                std::memcpy(&head, p, 4);
+                std::memcpy(&tail, p + n - 4, 4);
+                a = head;
+                b = tail;
+            }
+            else if (n > 0)
+            {
+                a = (uint64_t(p[0]) << 16) | (uint64_t(p[n / 2]) << 8) | p[n - 1];
+            }
+            uint64_t h = mulFold64(a ^ secret[0] ^ seed, b ^ secret[1] ^ n);
+            h = mulFold64(h ^ secret[2], prime64a);
+            return h ? h : 1;
+        }
+
+        Decision check(std::string_view key)
+        {
+            return check(keyHash(key));
+        }
+
+        Decision check(uint64_t hash)
+        {
+            uint32_t fingerprint = static_cast<uint32_t>(hash >> (64 - fingerprintBits));
+            if (fingerprint == 0)
+                fingerprint = 1; // 0 marks an empty slot
+            Bucket &bucket = table_[hash & mask_];
+#if defined(__GNUC__) || defined(__clang__)
+            __builtin_prefetch(&bucket, 1); // the clock read overlaps the cache miss
+#endif
+            uint64_t nowUnits = units();
+            uint32_t now = static_cast<uint32_t>(nowUnits) & timeMask;
+
+            // Unchecked for too long: every truncated TAT is ambiguous, and
+            // every key has refilled anyway. (A check racing this clear can
+            // lose its update: one request, once per idle bucket.)
+            uint32_t stamp = static_cast<uint32_t>(nowUnits >> stampShift);
+            uint32_t last = bucket.words[0].load(std::memory_order_acquire);
+            if (stamp - last > staleStamps)
+            {
+                for (int i = 1; i <= slotsPerBucket; i++)
+                    bucket.words[i].store(0, std::memory_order_relaxed);
+                bucket.words[0].store(stamp, std::memory_order_release);
+            }
+            else if (last != stamp)
+            {
+                bucket.words[0].store(stamp, std::memory_order_release);
+            }
+
+            for (;;)
+            {
+                Scan scan = scanBucket(bucket, fingerprint, now);
+                uint32_t *words = scan.words;
+
+                // Expired for a quarter of the range: clear it before its
+                // truncated TAT wraps around to look live again
+                for (unsigned m = scan.expiredLong & ~scan.matches; m; m &= m - 1)
+                {
+                    unsigned i = simd::lowestBit(m);
+                    if (bucket.words[i].compare_exchange_strong(words[i], 0, std::memory_order_acq_rel))
+                        scan.empty |= 1u << i;
+                }
+
+                // This key's slot, else the cheapest one to take over:
+                // empty, then expired, then the closest to refilled
+                unsigned index;
+                uint32_t current = 0, tatAhead = 0;
+                bool evicting = false;
+                if (scan.matches)
+                {
+                    index = simd::lowestBit(scan.matches);
+                    current = words[index];
+                    if (scan.live & (1u << index))
+                        tatAhead = (current - now) & timeMask;
+                }
+                else if (scan.empty)
+                {
+                    index = simd::lowestBit(scan.empty);
+                }
+                else if (unsigned expired = ~scan.live & slotBits)
+                {
+                    index = simd::lowestBit(expired);
+                    current = words[index];
+                }
+                else
+                {
+                    index = 1;
+                    for (unsigned i = 2; i <= slotsPerBucket; i++)
+                        if (((words[i] - now) & timeMask) < ((words[index] - now) & timeMask))
+                            index = i;
+                    current = words[index];
+                    evicting = true;
+                }
+
+                // GCRA: allowed while the new TAT stays within tolerance of now
+                uint64_t newAhead = tatAhead + interval_;
+                Decision d;
+                d.limit = config_.limit;
+
+                if (newAhead > tolerance_)
+                {
+                    uint64_t wait = (newAhead - tolerance_) << shift_;
+                    d.allowed = false;
+                    d.remaining = 0;
+                    d.retryAfter = static_cast<int>((wait + nanosPerSecond - 1) / nanosPerSecond);
+                    d.reset = epochAt(nowUnits + tatAhead);
+                    denied_.fetch_add(1, std::memory_order_relaxed);
+                    return d;
+                }
+
+                uint32_t desired = (fingerprint << timeBits) | ((now + static_cast<uint32_t>(newAhead)) & timeMask);
+                if (!bucket.words[index].compare_exchange_weak(current, desired, std::memory_order_acq_rel))
+                    continue; // another request moved the slot; re-read the bucket
+
+                if (evicting)
+                    evictions_.fetch_add(1, std::memory_order_relaxed);
+
+                d.remaining = static_cast<int>((tolerance_ - newAhead) / interval_);
+                d.reset = epochAt(nowUnits + newAhead);
+                allowed_.fetch_add(1, std::memory_order_relaxed);
+                return d;
+            }
+        }
+
+        // Requests per window actually enforced: at most limit, lower when
+        // a large burst leaves few time units per request
+        double enforcedLimit() const
+        {
+            return static_cast<double>(config_.windowSeconds) * nanosPerSecond /
+                   static_cast<double>(interval_ << shift_);
+        }
+
+        int burst() const { return burst_; }
+
+        bool appliesTo(const std::string &route) const
+        {
+            return config_.routes.empty() || config_.routes.count(route) > 0;
+        }
+
+        // X-RateLimit-* on every limited response, Retry-After + 429 on denial
+        static void apply(const Decision &d, httplib::Response &res)
+        {
+            res.set_header("X-RateLimit-Limit", std::to_string(d.limit));
+            res.set_header("X-RateLimit-Remaining", std::to_string(d.remaining));
+            res.set_header("X-RateLimit-Reset", std::to_string(d.reset));
+            if (d.allowed)
+                return;
+
+            res.status = 429;
+            res.set_header("Retry-After", std::to_string(d.retryAfter));
+            nlohmann::json error = {
+                {"error", true},
+                {"status", 429},
+                {"message", "Too Many Requests"},
+                {"retryAfter", d.retryAfter}};
+            res.set_content(error.dump(), "application/json");
+        }
+
+        nlohmann::json statsJSON() const
+        {
+            return {
+                {"allowed", allowed_.load()},
+                {"denied", denied_.load()},
+                {"evictions", evictions_.load()},
+                {"slots", (mask_ + 1) * slotsPerBucket}};
+        }
+
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        static constexpr int slotsPerBucket = 15;
+        static constexpr int timeBits = 18;
+        static constexpr int fingerprintBits = 32 - timeBits;
+        static constexpr uint32_t timeMask = (uint32_t(1) << timeBits) - 1;
+        static constexpr unsigned slotBits = ((1u << slotsPerBucket) - 1) << 1; // words 1..15
+        static constexpr uint32_t maxAhead = uint32_t(1) << (timeBits - 2); // largest TAT - now
+        static constexpr int stampShift = 10;
+        static constexpr uint32_t staleStamps = ((uint32_t(1) << (timeBits - 1)) >> stampShift) - 1;
+        static constexpr uint64_t nanosPerSecond = 1000000000;
+        static constexpr uint64_t ipSeed = 0x6970;    // keeps IP and token keys apart
+        static constexpr uint64_t tokenSeed = 0x746b;
+
+        struct alignas(64) Bucket
+        {
+            // words[0]: units >> stampShift at the last check; 1..15: slots
+            std::atomic<uint32_t> words[1 + slotsPerBucket] = {};
+        };
+        static_assert(sizeof(Bucket) == 64, "a bucket is one cache line");
+
+        // One pass over a bucket: a copy of its words plus bit masks (bit i
+        // = words[i]) of the slots that hold the key, are empty, hold a
+        // live TAT, or expired over a quarter of the TAT range ago
+        struct Scan
+        {
+            uint32_t words[1 + slotsPerBucket];
+            unsigned matches = 0, empty = 0, live = 0, expiredLong = 0;
+        };
+
+        static Scan scanBucket(const Bucket &bucket, uint32_t fingerprint, uint32_t now)
+        {
+            Scan scan;
+#ifdef XPRESSPP_SSE2
+            // Four 16-byte loads instead of 15 atomic ones: each 32-bit lane
+            // is still read whole, and the CAS that acts on a slot
+            // re-validates it
+            const __m128i *line = reinterpret_cast<const __m128i *>(&bucket);
+            const __m128i key = _mm_set1_epi32(static_cast<int>(fingerprint));
+            const __m128i origin = _mm_set1_epi32(static_cast<int>(now));
+            const __m128i mask = _mm_set1_epi32(static_cast<int>(timeMask));
+            const __m128i ahead1 = _mm_set1_epi32(static_cast<int>(maxAhead));
+            const __m128i ahead3 = _mm_set1_epi32(static_cast<int>(3 * maxAhead + 1));
+            for (int k = 0; k < 4; k++)
+            {
+                __m128i v = _mm_load_si128(line + k);
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(scan.words) + k, v);
+                __m128i ahead = _mm_and_si128(_mm_sub_epi32(v, origin), mask); // TAT - now, mod 2^18
+                unsigned zero = lanes(_mm_cmpeq_epi32(v, _mm_setzero_si128()));
+                unsigned same = lanes(_mm_cmpeq_epi32(_mm_srli_epi32(v, timeBits), key));
+                unsigned past = lanes(_mm_cmpgt_epi32(ahead, ahead1));
+                unsigned recent = lanes(_mm_cmplt_epi32(ahead, ahead3));
+                scan.matches |= same << (4 * k);
+                scan.empty |= zero << (4 * k);
+                scan.live |= (~past & ~zero & 15u) << (4 * k);
+                scan.expiredLong |= (past & recent & ~zero) << (4 * k);
+            }
+            scan.matches &= slotBits;
+            scan.empty &= slotBits;
+            scan.live &= slotBits;
+            scan.expiredLong &= slotBits;
+#else
+            scan.words[0] = 0;
+            for (unsigned i = 1; i <= slotsPerBucket; i++)
+            {
+                uint32_t word = bucket.words[i].load(std::memory_order_acquire);
+                uint32_t ahead = (word - now) & timeMask;
+                scan.words[i] = word;
+                scan.matches |= unsigned((word >> timeBits) == fingerprint) << i;
+                scan.empty |= unsigned(word == 0) << i;
+                scan.live |= unsigned(word != 0 && ahead <= maxAhead) << i;
+                scan.expiredLong |= unsigned(word != 0 && ahead > maxAhead && ahead <= 3 * maxAhead) << i;
+            }
+#endif
+            return scan;
+        }
+
+#ifdef XPRESSPP_SSE2
+        static unsigned lanes(__m128i v)
+        {
+            return static_cast<unsigned>(_mm_movemask_ps(_mm_castsi128_ps(v)));
+        }
+#endif
+
+        RateLimitConfig config_;
+        Clock::time_point start_;
+        int64_t startNanos_ = 0; // CLOCK_MONOTONIC_COARSE origin
+        long long startEpoch_ = static_cast<long long>(std::time(nullptr));
+        int shift_ = 0;           // a unit is 2^shift_ nanoseconds
+        uint64_t interval_ = 1;   // emission interval (units per request)
+        uint64_t tolerance_ = 1;  // burst * interval, <= maxAhead
+        int burst_ = 1;
+        size_t mask_ = 0;
+        struct TableDeleter
+        {
+            bool aligned; // aligned_alloc, else new[]
+            void operator()(Bucket *table) const
+            {
+                if (aligned)
+                    std::free(table);
+                else
+                    delete[] table;
+            }
+        };
+        std::unique_ptr<Bucket[], TableDeleter> table_;
+
+        std::atomic<uint64_t> allowed_{0};
+        std::atomic<uint64_t> denied_{0};
+        std::atomic<uint64_t> evictions_{0};
+
+        // Linux uses the coarse monotonic clock (~4 ms steps, a few ns per
+        // read instead of ~35): plenty for budgets measured in requests per
+        // second or slower
+        uint64_t units() const
+        {
+#ifdef CLOCK_MONOTONIC_COARSE
+            timespec ts;
+            clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+            auto elapsed = (static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec) - startNanos_;
+#else
+            auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start_).count();
+#endif
+            return static_cast<uint64_t>(elapsed) >> shift_;
+        }
+
+        // 2 MB pages where the kernel allows them: an 8 MB table then needs
+        // four TLB entries instead of 2048, which saves a page walk on
+        // most checks
+        static std::unique_ptr<Bucket[], TableDeleter> allocateTable(size_t buckets)
+        {
+#ifdef XPRESSPP_RATE_HUGEPAGES
+            constexpr size_t hugePage = size_t(2) << 20;
+            size_t bytes = buckets * sizeof(Bucket);
+            if (bytes >= hugePage)
+            {
+                if (void *memory = std::aligned_alloc(hugePage, bytes))
+                {
+                    madvise(memory, bytes, MADV_HUGEPAGE);
+                    auto *table = static_cast<Bucket *>(memory);
+                    std::uninitialized_value_construct_n(table, buckets);
+                    return {table, TableDeleter{true}};
+                }
+            }
+#endif
+            return {new Bucket[buckets], TableDeleter{false}};
+        }
+
+        // Epoch seconds (rounded up) at a point on the limiter's clock,
+        // without a wall-clock read per check
+        long long epochAt(uint64_t units) const
+        {
+            uint64_t nanos = units << shift_;
+            return startEpoch_ + static_cast<long long>((nanos + nanosPerSecond - 1) / nanosPerSecond);
+        }
+
+        // Same sources as Request::getRealIP, but only believed behind a proxy
+        static std::string_view clientAddress(const httplib::Request &req, bool trustProxy)
+        {
+            if (trustProxy)
+            {
+                static const std::string headers[] = {"X-Real-IP", "X-Forwarded-For", "CF-Connecting-IP", "True-Client-IP"};
+                for (const auto &header : headers)
+                {
+                    auto it = req.headers.find(header);
+                    if (it == req.headers.end())
+                        continue;
+                    std::string_view ip(it->second);
+                    ip = ip.substr(0, ip.find(','));
+                    ip.remove_prefix(std::min(ip.size(), ip.find_first_not_of(' ')));
+                    ip = ip.substr(0, ip.find_last_not_of(' ') + 1);
+                    if (!ip.empty())
+                        return ip;
+                }
+            }
+            return req.remote_addr;
+        }
+    };
+}
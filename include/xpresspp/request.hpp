@@ -7,6 +7,13 @@
 #include <nlohmann/json.hpp>
 #include <chrono>
 #include <regex>
+#include <optional>
+#include <memory>
+#include <string_view>
+#include "lazy_json.hpp"
+#include "multipart.hpp"
+#include "json_reflect.hpp"
+#include "etag.hpp"
 
 namespace xpresspp
 {
@@ -18,8 +25,12 @@ namespace xpresspp
         std::string method;
         std::string url;
         std::string path;
+        // Declared before `body`: a lazy jsonBody points into it, and the
+        // implicit copy/move must parse it before `body` is moved away
+        LazyJson jsonBody;      // on-demand when parsed lazily (see parseBody)
         std::string body;
-        std::string protocol;        // HTTP/1.1, HTTP/2
+        std::string protocol;        // http / https (X-Forwarded-Proto)
+        std::string httpVersion;     // HTTP/1.1, HTTP/2
         std::string hostname;        // من Host header
         std::string originalUrl;     // الـ URL الأصلي قبل أي تعديل
 
@@ -30,10 +41,19 @@ namespace xpresspp
 
         std::string ip;
         std::vector<std::string> ips;  // X-Forwarded-For chain
+
+        // 🔥 Client process on a Unix socket (config.peerCredentials)
+        struct PeerCredentials
+        {
+            long pid;
+            long uid;
+            long gid;
+        };
+        std::optional<PeerCredentials> peer;
         std::string userAgent;
         std::string referer;
 
-        json jsonBody;
+        MultipartForm form;     // multipart/form-data: text fields + uploaded files
 
         // 🔥 Request metadata
         std::chrono::system_clock::time_point startTime;
@@ -44,6 +64,23 @@ namespace xpresspp
         bool secure = false;    // HTTPS?
         std::string subdomains; // subdomain parsing
 
+        // 🔥 Body bytes wherever they are: `body`, or for a body over
+        // config.bodySpillThreshold the read-only mapping of the temp file
+        // it was streamed to (`body` is then empty)
+        std::string_view bodyView() const
+        {
+            return spilled_.data() ? spilled_ : std::string_view(body);
+        }
+
+        bool bodySpilled() const { return spilledOwner_ != nullptr; }
+
+        // `owner` keeps `bytes` mapped; released with the request
+        void spillBody(std::shared_ptr<const void> owner, std::string_view bytes)
+        {
+            spilledOwner_ = std::move(owner);
+            spilled_ = bytes.data() ? bytes : std::string_view("", 0);
+        }
+
         // Constructor
         Request() : startTime(std::chrono::system_clock::now()) {}
 
@@ -80,23 +117,32 @@ namespace xpresspp
         }
 
         // ----------------------------------------------
-        // 🔥 Automatic body parsing (JSON / x-www-form)
+        // 🔥 Automatic body parsing (JSON / MessagePack / CBOR / x-www-form)
+        // lazy: JSON is only indexed here; getJSON/validateJSON parse single
+        // members and the full DOM is built on first direct jsonBody access
         // ----------------------------------------------
-        void parseBody()
+        void parseBody(bool lazy = false)
         {
             jsonBody = json::object();
             auto ctype = getHeader("Content-Type");
+            auto bytes = bodyView();
 
             // ---------------------------
             // JSON
             // ---------------------------
             if (ctype.find("application/json") != std::string::npos)
             {
-                if (!body.empty() && (body[0] == '{' || body[0] == '['))
+                if (!bytes.empty() && (bytes[0] == '{' || bytes[0] == '['))
                 {
+                    if (lazy)
+                    {
+                        jsonBody.defer(bytes);
+                        return;
+                    }
+
                     try
                     {
-                        jsonBody = json::parse(body);
+                        jsonBody = json::parse(bytes);
                     }
                     catch (...)
                     {
@@ -106,12 +152,42 @@ namespace xpresspp
                 return;
             }
 
+            // ---------------------------
+            // MessagePack / CBOR (same DOM as JSON)
+            // ---------------------------
+            auto format = bodyFormat();
+            if (format != nlohmann::json::input_format_t::json)
+            {
+                if (!bytes.empty())
+                {
+                    json parsed = format == nlohmann::json::input_format_t::msgpack
+                                      ? json::from_msgpack(bytes, true, false)
+                                      : json::from_cbor(bytes, true, false);
+                    if (!parsed.is_discarded())
+                        jsonBody = std::move(parsed);
+                }
+                return;
+            }
+
+            // ---------------------------
+            // multipart/form-data (parsed as it streamed in): text
+            // fields; files stay in `form`
+            // ---------------------------
+            if (ctype.find("multipart/form-data") != std::string::npos)
+            {
+                for (auto &[k, v] : form.fields)
+                {
+                    jsonBody[k] = v;
+                }
+                return;
+            }
+
             // ---------------------------
             // URL-encoded (a=1&b=2)
             // ---------------------------
             if (ctype.find("application/x-www-form-urlencoded") != std::string::npos)
             {
-                parseQuery(body);
+                parseQuery(std::string(bytes));
                 for (auto &[k, v] : query)
                 {
                     jsonBody[k] = v;
@@ -339,7 +415,7 @@ namespace xpresspp
         // 🔥 Check if request has body
         bool hasBody() const
         {
-            return !body.empty() || contentLength > 0;
+            return !bodyView().empty() || contentLength > 0;
         }
 
         // 🔥 Validate JSON body against expected fields
@@ -347,6 +423,7 @@ namespace xpresspp
         {
             if (!jsonBody.is_object()) return false;
 
+            // On-demand bodies answer this from the member table (no DOM)
             for (auto &field : requiredFields)
             {
                 if (!jsonBody.contains(field))
@@ -359,13 +436,44 @@ namespace xpresspp
         template<typename T>
         T getJSON(const std::string &key, const T &defaultValue = T()) const
         {
-            try
-            {
-                if (jsonBody.contains(key))
-                    return jsonBody[key].get<T>();
-            }
-            catch (...) {}
-            return defaultValue;
+            T value;
+            return jsonBody.tryGet(key, value) ? value : defaultValue;
+        }
+
+        // 🔥 Wire format of the body, from Content-Type
+        nlohmann::json::input_format_t bodyFormat() const
+        {
+            std::string ct = contentType();
+            if (ct.find("msgpack") != std::string::npos)
+                return nlohmann::json::input_format_t::msgpack;
+            if (ct.find("application/cbor") != std::string::npos)
+                return nlohmann::json::input_format_t::cbor;
+            return nlohmann::json::input_format_t::json;
+        }
+
+        // 🔥 Bind JSON body straight into a struct (SAX, no DOM)
+        // Works with XPRESSPP_JSON types, containers, optionals and scalars;
+        // unknown keys are skipped. Throws BindError with a JSON pointer.
+        // MessagePack and CBOR bodies go through the same SAX path.
+        template<typename T>
+        T bind() const
+        {
+            T out{};
+            JsonBinder binder;
+            if (!binder.bind(bodyView(), out, bodyFormat()))
+                throw BindError(binder.errorPointer(), binder.errorMessage());
+            return out;
+        }
+
+        template<typename T>
+        bool tryBind(T &out, std::string *error = nullptr) const
+        {
+            JsonBinder binder;
+            if (binder.bind(bodyView(), out, bodyFormat()))
+                return true;
+            if (error)
+                *error = BindError(binder.errorPointer(), binder.errorMessage()).what();
+            return false;
         }
 
         // 🔥 Check if route matches pattern
@@ -426,17 +534,19 @@ namespace xpresspp
         }
 
         // 🔥 Check if request is fresh (for caching)
+        // If-None-Match: weak comparison over the list ("*" included);
+        // If-Modified-Since (dates parsed) only when If-None-Match is absent
         bool isFresh(const std::string &etag, const std::string &lastModified = "") const
         {
             std::string ifNoneMatch = getHeader("If-None-Match");
-            if (!ifNoneMatch.empty() && ifNoneMatch == etag)
-                return true;
+            if (!ifNoneMatch.empty())
+                return etag::noneMatch(ifNoneMatch, etag);
 
             if (!lastModified.empty())
             {
                 std::string ifModifiedSince = getHeader("If-Modified-Since");
-                if (!ifModifiedSince.empty() && ifModifiedSince == lastModified)
-                    return true;
+                if (!ifModifiedSince.empty())
+                    return etag::notModifiedSince(lastModified, ifModifiedSince);
             }
 
             return false;
@@ -454,7 +564,7 @@ namespace xpresspp
         // 🔥 Get all data as JSON (params + query + body)
         json getAllData() const
         {
-            json result = jsonBody.is_object() ? jsonBody : json::object();
+            json result = jsonBody.is_object() ? *jsonBody : json::object();
             
             for (auto &[k, v] : params)
                 result[k] = v;
@@ -480,5 +590,9 @@ namespace xpresspp
             oss << "===================\n";
             return oss.str();
         }
+
+    private:
+        std::shared_ptr<const void> spilledOwner_;
+        std::string_view spilled_;
     };
 }
\ No newline at end of file
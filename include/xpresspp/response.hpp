@@ -8,11 +8,98 @@
 #include <iomanip>
 #include <ctime>
 #include <filesystem>
+#include <algorithm>
+#include <cstdlib>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <type_traits>
+#include <vector>
+#include "json_reflect.hpp"
+#include "etag.hpp"
 
 namespace xpresspp
 {
     using json = nlohmann::json;
 
+    // 🔥 JSON streaming output format
+    enum class JsonStreamMode
+    {
+        Array, // [a,b,c]
+        NDJSON // a\nb\nc\n
+    };
+
+    // 🔥 Negotiated body encoding (see Response::encode)
+    enum class BodyEncoding
+    {
+        Json,    // application/json
+        MsgPack, // application/msgpack
+        Cbor     // application/cbor
+    };
+
+    // 🔥 Incremental JSON encoder (used by Response::jsonStream)
+    // Elements are written with JsonWriter into a local buffer that is
+    // flushed to the writer every `flushThreshold` bytes.
+    class JsonStreamEncoder
+    {
+    public:
+        using Writer = std::function<bool(const char *data, size_t length)>;
+
+        JsonStreamEncoder(const Writer &write, JsonStreamMode mode, size_t flushThreshold = 16 * 1024)
+            : write_(write), mode_(mode), flushThreshold_(flushThreshold)
+        {
+            buffer_.reserve(flushThreshold_ + 1024);
+        }
+
+        JsonStreamEncoder(const JsonStreamEncoder &) = delete;
+        JsonStreamEncoder &operator=(const JsonStreamEncoder &) = delete;
+
+        template <typename T>
+        bool element(const T &value)
+        {
+            if (mode_ == JsonStreamMode::Array)
+                buffer_.push_back(count_ == 0 ? '[' : ',');
+
+            JsonWriter(buffer_).value(value);
+
+            if (mode_ == JsonStreamMode::NDJSON)
+                buffer_.push_back('\n');
+
+            count_++;
+            return buffer_.size() >= flushThreshold_ ? flush() : true;
+        }
+
+        bool finish()
+        {
+            if (mode_ == JsonStreamMode::Array)
+            {
+                if (count_ == 0)
+                    buffer_.push_back('[');
+                buffer_.push_back(']');
+            }
+            return flush();
+        }
+
+        bool flush()
+        {
+            if (buffer_.empty())
+                return true;
+
+            bool ok = write_(buffer_.data(), buffer_.size());
+            buffer_.clear();
+            return ok;
+        }
+
+        size_t count() const { return count_; }
+
+    private:
+        const Writer &write_;
+        JsonStreamMode mode_;
+        size_t flushThreshold_;
+        size_t count_ = 0;
+        std::string buffer_;
+    };
+
     class Response
     {
     public:
@@ -40,16 +127,160 @@ namespace xpresspp
         // ------------------------------
         void json(const nlohmann::json &data)
         {
-            type("application/json; charset=utf-8");
-            body = data.dump();
+            writeJsonBody([&](JsonWriter &writer)
+                          { writer.value(data); });
         }
 
+        // Written straight from the pairs (no intermediate object); keys are
+        // emitted sorted with last-one-wins, same as dump() of the object.
         void json(const std::initializer_list<std::pair<std::string, nlohmann::json>> &list)
         {
-            nlohmann::json j = nlohmann::json::object();
+            using Pair = std::pair<std::string, nlohmann::json>;
+            std::vector<const Pair *> sorted;
+            sorted.reserve(list.size());
             for (auto &p : list)
-                j[p.first] = p.second;
-            json(j);
+                sorted.push_back(&p);
+            std::stable_sort(sorted.begin(), sorted.end(), [](const Pair *a, const Pair *b)
+                             { return a->first < b->first; });
+
+            writeJsonBody([&](JsonWriter &writer)
+                          {
+                writer.beginObject();
+                for (size_t i = 0; i < sorted.size(); i++)
+                {
+                    if (i + 1 < sorted.size() && sorted[i + 1]->first == sorted[i]->first)
+                        continue;
+                    writer.field(sorted[i]->first, sorted[i]->second);
+                }
+                writer.endObject(); });
+        }
+
+        // 🔥 Direct JSON: serialize a value (XPRESSPP_JSON types, containers,
+        // scalars) straight into the body without building a DOM
+        template <typename T>
+        void jsonDirect(const T &value)
+        {
+            writeJsonBody([&](JsonWriter &writer)
+                          { writer.value(value); });
+        }
+
+        template <typename T>
+        void jsonDirect(int code, const T &value)
+        {
+            status(code);
+            jsonDirect(value);
+        }
+
+        // ------------------------------
+        // 🔥 CONTENT NEGOTIATION (JSON / MessagePack / CBOR)
+        // ------------------------------
+        // The server hands over the request's Accept header; encode() picks
+        // the best format and writes the binary ones through nlohmann's
+        // binary_writer straight into the body. JSON keeps the jsonDirect path.
+        void setAccept(const std::string &accept) { acceptHeader = accept; }
+        void setIfNoneMatch(const std::string &tags) { ifNoneMatchHeader = tags; }
+        const std::string &getAccept() const { return acceptHeader; }
+
+        BodyEncoding negotiatedEncoding() const { return negotiateEncoding(acceptHeader); }
+
+        template <typename T>
+        void encode(const T &data)
+        {
+            if (!hasHeader("Vary"))
+                setHeader("Vary", "Accept");
+            else if (getHeader("Vary").find("Accept") == std::string::npos)
+                append("Vary", "Accept");
+
+            BodyEncoding encoding = negotiatedEncoding();
+            if (encoding == BodyEncoding::Json)
+            {
+                jsonDirect(data);
+                return;
+            }
+
+            body.clear();
+            if constexpr (std::is_same_v<T, nlohmann::json>)
+                writeBinary(encoding, data);
+            else
+                writeBinary(encoding, nlohmann::json(data));
+        }
+
+        template <typename T>
+        void encode(int code, const T &data)
+        {
+            status(code);
+            encode(data);
+        }
+
+        // Picks by q-value; ties prefer JSON, then MessagePack, then CBOR.
+        // Wildcards and unacceptable lists fall back to JSON.
+        static BodyEncoding negotiateEncoding(const std::string &accept)
+        {
+            // Per format: the q-value of the most specific range that names
+            // it (exact > application/* > */*), whatever the wildcard's q
+            double q[3] = {0, 0, 0};
+            int specificity[3] = {-1, -1, -1};
+            bool any = false;
+            auto apply = [&](BodyEncoding encoding, int level, double weight)
+            {
+                int slot = static_cast<int>(encoding);
+                if (level > specificity[slot])
+                {
+                    specificity[slot] = level;
+                    q[slot] = weight;
+                }
+                else if (level == specificity[slot])
+                    q[slot] = std::max(q[slot], weight);
+                any = true;
+            };
+            size_t pos = 0;
+
+            while (pos < accept.size())
+            {
+                size_t comma = accept.find(',', pos);
+                if (comma == std::string::npos)
+                    comma = accept.size();
+                std::string range = accept.substr(pos, comma - pos);
+                pos = comma + 1;
+
+                double weight = 1.0;
+                auto semi = range.find(';');
+                if (semi != std::string::npos)
+                {
+                    auto qpos = range.find("q=", semi);
+                    if (qpos != std::string::npos)
+                        weight = std::strtod(range.c_str() + qpos + 2, nullptr);
+                    range.erase(semi);
+                }
+                range.erase(0, range.find_first_not_of(" \t"));
+                range.erase(range.find_last_not_of(" \t") + 1);
+                std::transform(range.begin(), range.end(), range.begin(), ::tolower);
+
+                if (range == "application/json")
+                    apply(BodyEncoding::Json, 2, weight);
+                else if (range == "application/msgpack" || range == "application/x-msgpack" ||
+                         range == "application/vnd.msgpack")
+                    apply(BodyEncoding::MsgPack, 2, weight);
+                else if (range == "application/cbor")
+                    apply(BodyEncoding::Cbor, 2, weight);
+                else if (range == "application/*" || range == "*/*")
+                {
+                    int level = range == "*/*" ? 0 : 1;
+                    apply(BodyEncoding::Json, level, weight);
+                    apply(BodyEncoding::MsgPack, level, weight);
+                    apply(BodyEncoding::Cbor, level, weight);
+                }
+            }
+
+            if (!any)
+                return BodyEncoding::Json;
+
+            // Ties go to JSON
+            int best = 0;
+            for (int i = 1; i < 3; i++)
+                if (q[i] > q[best])
+                    best = i;
+            return static_cast<BodyEncoding>(best);
         }
 
         // ------------------------------
@@ -371,6 +602,39 @@ namespace xpresspp
             setHeader("Last-Modified", oss.str());
         }
 
+        // 🔥 Server-side response cache (ServerConfig::responseCache)
+        // Marks a GET response for replay for `seconds`; surrogate keys let
+        // handlers purge it later (cache->purge("users")). Requests with
+        // Authorization or Cookie are neither stored nor served from the
+        // cache unless `sharedAcrossUsers` says the response is the same
+        // for every user.
+        void serverCache(int seconds, const std::vector<std::string> &keys = {},
+                         bool sharedAcrossUsers = false)
+        {
+            serverCacheTtl = seconds;
+            surrogateKeys = keys;
+            serverCacheShared = sharedAcrossUsers;
+        }
+
+        int getServerCacheTtl() const { return serverCacheTtl; }
+        const std::vector<std::string> &getSurrogateKeys() const { return surrogateKeys; }
+        bool isServerCacheShared() const { return serverCacheShared; }
+
+        // 🔥 Version-keyed ETag: declare a cheap key (row version, revision,
+        // updatedAt...) before building the body. Returns true after turning
+        // the response into a 304 when the client already has that version.
+        bool version(const std::string &key)
+        {
+            std::string tag = "\"v-" + fastHash128(key).hex() + "\"";
+            setHeader("ETag", tag);
+
+            if (ifNoneMatchHeader.empty() || !etag::noneMatch(ifNoneMatchHeader, tag))
+                return false;
+
+            notModified();
+            return true;
+        }
+
         // 🔥 ETag support
         void etag(const std::string &tag, bool weak = false)
         {
@@ -392,10 +656,12 @@ namespace xpresspp
             setHeader("X-RateLimit-Reset", std::to_string(reset));
         }
 
-        // 🔥 Compression hint
+        // 🔥 Compression hint (overrides the server's compression policy;
+        // already-compressed types are still never recompressed)
         void enableCompression(bool enable = true)
         {
             compressionEnabled = enable;
+            compressionOverride = true;
         }
 
         // 🔥 Streaming response
@@ -406,6 +672,77 @@ namespace xpresspp
                 setHeader("Transfer-Encoding", "chunked");
         }
 
+        // 🔥 Chunked body producer
+        // The provider runs after the handler returns and pushes bytes through
+        // `write`, which returns false once the client has gone away.
+        using StreamWriter = std::function<bool(const char *data, size_t length)>;
+        using StreamProvider = std::function<bool(const StreamWriter &write)>;
+
+        void streamBody(StreamProvider provider, const std::string &mime = "application/octet-stream")
+        {
+            type(mime);
+            body.clear();
+            streamingMode = true;
+            streamProvider = std::move(provider);
+        }
+
+        bool hasStreamProvider() const { return static_cast<bool>(streamProvider); }
+        const StreamProvider &getStreamProvider() const { return streamProvider; }
+
+        // 🔥 Protocol switch (101 Switching Protocols)
+        // Once the response head is written, the handler owns the socket,
+        // along with any bytes the client sent after the request head.
+        using UpgradeHandler = std::function<void(std::intptr_t socket, std::string buffered)>;
+
+        void upgrade(UpgradeHandler handler)
+        {
+            statusCode = 101;
+            body.clear();
+            upgradeHandler = std::move(handler);
+        }
+
+        bool hasUpgrade() const { return static_cast<bool>(upgradeHandler); }
+        const UpgradeHandler &getUpgrade() const { return upgradeHandler; }
+
+        // 🔥 Streaming JSON (array or NDJSON) without building the whole DOM
+        // Generator fills `next` and returns false when exhausted.
+        using JsonGenerator = std::function<bool(nlohmann::json &next)>;
+
+        void jsonStream(JsonGenerator generator, JsonStreamMode mode = JsonStreamMode::Array)
+        {
+            streamBody([generator = std::move(generator), mode](const StreamWriter &write) mutable
+                       {
+                JsonStreamEncoder encoder(write, mode);
+                nlohmann::json next;
+                while (generator(next))
+                {
+                    if (!encoder.element(next))
+                        return false;
+                    next = nullptr;
+                }
+                return encoder.finish(); },
+                       jsonStreamMime(mode));
+        }
+
+        // Iterator range: the underlying container must outlive the response
+        template <typename Iterator>
+        void jsonStream(Iterator first, Iterator last, JsonStreamMode mode = JsonStreamMode::Array)
+        {
+            streamBody([first, last, mode](const StreamWriter &write)
+                       { return writeJsonRange(write, mode, first, last); },
+                       jsonStreamMime(mode));
+        }
+
+        // Container: ownership moves into the stream
+        template <typename Container, typename = decltype(std::declval<const Container &>().begin())>
+        void jsonStream(Container items, JsonStreamMode mode = JsonStreamMode::Array)
+        {
+            auto owned = std::make_shared<const Container>(std::move(items));
+            streamBody([owned, mode](const StreamWriter &write)
+                       { return writeJsonRange(write, mode, owned->begin(), owned->end()); },
+                       jsonStreamMime(mode));
+        }
+
         // 🔥 Server timing API
         void addTiming(const std::string &name, double duration, const std::string &description = "")
         {
@@ -513,6 +850,11 @@ namespace xpresspp
             headers.clear();
             contentType = "text/plain; charset=utf-8";
             ended = false;
+            streamingMode = false;
+            streamProvider = nullptr;
+            serverCacheTtl = 0;
+            surrogateKeys.clear();
+            serverCacheShared = false;
         }
 
         // 🔥 Render template (placeholder for template engine integration)
@@ -562,6 +904,7 @@ namespace xpresspp
 
         // 🔥 Get compression status
         bool isCompressionEnabled() const { return compressionEnabled; }
+        bool hasCompressionOverride() const { return compressionOverride; }
         bool isStreaming() const { return streamingMode; }
 
     private:
@@ -571,7 +914,66 @@ namespace xpresspp
         std::string contentType;
         bool ended;
         bool compressionEnabled;
+        bool compressionOverride = false;
         bool streamingMode;
+        StreamProvider streamProvider;
+        UpgradeHandler upgradeHandler;
+        std::string acceptHeader;
+        std::string ifNoneMatchHeader;
+        int serverCacheTtl = 0;
+        std::vector<std::string> surrogateKeys;
+        bool serverCacheShared = false;
+
+        void writeBinary(BodyEncoding encoding, const nlohmann::json &data)
+        {
+            nlohmann::detail::output_adapter<char, std::string> out(body);
+            if (encoding == BodyEncoding::MsgPack)
+            {
+                type("application/msgpack");
+                nlohmann::json::to_msgpack(data, out);
+            }
+            else
+            {
+                type("application/cbor");
+                nlohmann::json::to_cbor(data, out);
+            }
+        }
+
+        // 🔥 JSON bodies are built in a per-thread scratch buffer whose
+        // capacity survives across requests, then copied out in one allocation
+        template <typename Fill>
+        void writeJsonBody(Fill &&fill)
+        {
+            static constexpr size_t maxRetainedScratch = 1024 * 1024;
+            thread_local std::string scratch;
+
+            type("application/json; charset=utf-8");
+            scratch.clear();
+            JsonWriter writer(scratch);
+            fill(writer);
+            body.assign(scratch);
+
+            if (scratch.capacity() > maxRetainedScratch)
+                std::string().swap(scratch);
+        }
+
+        static std::string jsonStreamMime(JsonStreamMode mode)
+        {
+            return mode == JsonStreamMode::NDJSON ? "application/x-ndjson"
+                                                  : "application/json; charset=utf-8";
+        }
+
+        template <typename Iterator>
+        static bool writeJsonRange(const StreamWriter &write, JsonStreamMode mode, Iterator first, Iterator last)
+        {
+            JsonStreamEncoder encoder(write, mode);
+            for (; first != last; ++first)
+            {
+                if (!encoder.element(*first))
+                    return false;
+            }
+            return encoder.finish();
+        }
 
         // 🔥 MIME type detection
         std::string getMimeType(const std::string &path)
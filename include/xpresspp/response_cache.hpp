@@ -0,0 +1,404 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+#include <algorithm>
+#include <nlohmann/json.hpp>
+#include "compression.hpp"
+#include "etag.hpp"
+#include "httplib.h"
+
+namespace xpresspp
+{
+    // 🔥 Server-side response cache options
+    struct ResponseCacheOptions
+    {
+        size_t maxBytes = 64 * 1024 * 1024; // total budget, split across shards
+        size_t shards = 16;                 // independent locks / LRU lists
+        int maxTtl = 3600;                  // seconds; caps res.serverCache()
+    };
+
+    // 🔥 In-memory cache of finished GET responses
+    // Entries hold the final status, headers and (already compressed) body,
+    // one entry per Content-Encoding variant. A hit is replayed straight
+    // into httplib without building a Request or running the handler.
+    // Handlers opt in with res.serverCache(ttl, {surrogate keys}); the keys
+    // let mutations purge every response that depends on them. Entries are
+    // keyed by Host and target; responses to requests carrying credentials
+    // (Authorization, Cookie) are only shared when the handler says so.
+    class ResponseCache
+    {
+    public:
+        struct Stats
+        {
+            uint64_t hits = 0;
+            uint64_t misses = 0;
+            uint64_t stores = 0;
+            uint64_t evictions = 0;
+            uint64_t expirations = 0;
+            uint64_t purges = 0;
+            size_t entries = 0;
+            size_t bytes = 0;
+        };
+
+        explicit ResponseCache(const ResponseCacheOptions &options = {})
+            : options_(options), shards_(std::max<size_t>(options.shards, 1))
+        {
+            shardBudget_ = options_.maxBytes / shards_.size();
+        }
+
+        // Replays a fresh entry for this request; false = miss
+        bool serve(const httplib::Request &req, httplib::Response &res)
+        {
+            std::string encoding = compression::token(compression::negotiate(req.get_header_value("Accept-Encoding")));
+            if (encoding == "identity")
+                encoding.clear();
+
+            const std::string &host = req.get_header_value("Host");
+            auto entry = find(variantKey(host, req.target, encoding));
+            if (!entry && !encoding.empty())
+            {
+                // Bodies no client gets compressed are stored once, as identity
+                auto identity = find(variantKey(host, req.target, ""));
+                if (identity && !identity->varyEncoding)
+                    entry = std::move(identity);
+            }
+
+            // A user's request may get a per-user response from the handler
+            if (entry && !entry->shared && hasCredentials(req))
+                entry = nullptr;
+
+            if (!entry)
+            {
+                misses_++;
+                return false;
+            }
+
+            hits_++;
+            res.status = entry->status;
+            for (auto &h : entry->headers)
+                res.set_header(h.first, h.second);
+
+            auto age = std::chrono::duration_cast<std::chrono::seconds>(Clock::now() - entry->storedAt).count();
+            res.set_header("Age", std::to_string(age));
+            res.set_header("X-Cache", "HIT");
+
+            // Revalidation against the cached validator: 304, no body
+            std::string ifNoneMatch = req.get_header_value("If-None-Match");
+            if (!ifNoneMatch.empty() && entry->status == 200 && etag::noneMatch(ifNoneMatch, entry->etag))
+            {
+                res.status = 304;
+                return true;
+            }
+
+            // Shared with the cache: no body copy, and eviction mid-write is safe
+            if (entry->body.empty())
+                res.set_content("", entry->contentType);
+            else
+                res.set_content_provider(
+                    entry->body.size(), entry->contentType,
+                    [entry](size_t offset, size_t length, httplib::DataSink &sink)
+                    { return sink.write(entry->body.data() + offset, length); });
+            return true;
+        }
+
+        // varyEncoding: other Content-Encoding variants of this URL may exist;
+        // shared: the response is the same for every user (res.serverCache)
+        void store(const httplib::Request &req, const httplib::Response &res, int ttl,
+                   const std::vector<std::string> &surrogateKeys, bool varyEncoding,
+                   bool shared = false)
+        {
+            ttl = std::min(ttl, options_.maxTtl);
+            if (ttl <= 0 || res.has_header("Set-Cookie") || (!shared && hasCredentials(req)))
+                return;
+
+            std::string encoding = res.get_header_value("Content-Encoding");
+            if (!encoding.empty() && encoding != "gzip" && encoding != "deflate" && encoding != "zstd")
+                return; // zdict variants depend on the client's dictionaries
+            if (!variesOnlyOnEncoding(res.get_header_value("Vary")))
+                return; // the key does not cover Accept, Cookie, ...
+
+            auto entry = std::make_shared<Entry>();
+            entry->key = variantKey(req.get_header_value("Host"), req.target, encoding);
+            entry->status = res.status;
+            entry->contentType = res.get_header_value("Content-Type");
+            entry->etag = res.get_header_value("ETag");
+            entry->body = res.body;
+            entry->surrogateKeys = surrogateKeys;
+            entry->surrogateKeys.push_back(pathTag(req.target)); // for purgePath
+            entry->varyEncoding = varyEncoding;
+            entry->shared = shared;
+            entry->storedAt = Clock::now();
+            entry->expires = entry->storedAt + std::chrono::seconds(ttl);
+
+            for (auto &h : res.headers)
+            {
+                if (h.first == "Content-Type" || h.first == "Content-Length" || h.first == "X-Request-ID" ||
+                    h.first == "X-Response-Time" || h.first == "X-Cache" ||
+                    h.first.compare(0, 12, "X-RateLimit-") == 0)
+                    continue;
+                entry->headers.emplace_back(h.first, h.second);
+            }
+
+            entry->size = entry->key.size() + entry->body.size() + entry->contentType.size() + sizeof(Entry);
+            for (auto &h : entry->headers)
+                entry->size += h.first.size() + h.second.size();
+            if (entry->size > shardBudget_)
+                return;
+
+            auto &shard = shardFor(entry->key);
+            std::lock_guard<std::mutex> lock(shard.mutex);
+
+            auto it = shard.index.find(entry->key);
+            if (it != shard.index.end())
+                unlink(shard, it->second);
+
+            shard.lru.push_front(entry);
+            shard.index[entry->key] = shard.lru.begin();
+            shard.bytes += entry->size;
+            for (auto &tag : entry->surrogateKeys)
+                shard.tags[tag].insert(entry->key);
+            stores_++;
+
+            while (shard.bytes > shardBudget_ && !shard.lru.empty())
+            {
+                unlink(shard, std::prev(shard.lru.end()));
+                evictions_++;
+            }
+        }
+
+        // 🔥 Purge every entry tagged with a surrogate key
+        size_t purge(const std::string &surrogateKey)
+        {
+            return purgeTag(surrogateKey);
+        }
+
+        // 🔥 Purge every variant (hosts, encodings) of one URL (path + query, as requested)
+        size_t purgePath(const std::string &target)
+        {
+            return purgeTag(pathTag(target));
+        }
+
+        void clear()
+        {
+            for (auto &shard : shards_)
+            {
+                std::lock_guard<std::mutex> lock(shard.mutex);
+                purges_ += shard.lru.size();
+                shard.lru.clear();
+                shard.index.clear();
+                shard.tags.clear();
+                shard.bytes = 0;
+            }
+        }
+
+        Stats stats() const
+        {
+            Stats s;
+            s.hits = hits_.load();
+            s.misses = misses_.load();
+            s.stores = stores_.load();
+            s.evictions = evictions_.load();
+            s.expirations = expirations_.load();
+            s.purges = purges_.load();
+            for (auto &shard : shards_)
+            {
+                std::lock_guard<std::mutex> lock(shard.mutex);
+                s.entries += shard.lru.size();
+                s.bytes += shard.bytes;
+            }
+            return s;
+        }
+
+        nlohmann::json statsJSON() const
+        {
+            auto s = stats();
+            uint64_t lookups = s.hits + s.misses;
+            return {
+                {"hits", s.hits},
+                {"misses", s.misses},
+                {"hitRatio", lookups ? static_cast<double>(s.hits) / lookups : 0.0},
+                {"stores", s.stores},
+                {"evictions", s.evictions},
+                {"expirations", s.expirations},
+                {"purges", s.purges},
+                {"entries", s.entries},
+                {"bytes", s.bytes},
+                {"maxBytes", options_.maxBytes}};
+        }
+
+        // The request may get bytes meant for one user only
+        static bool hasCredentials(const httplib::Request &req)
+        {
+            return req.has_header("Authorization") || req.has_header("Cookie");
+        }
+
+        // The response is meant for one user only
+        static bool isPrivate(const httplib::Response &res)
+        {
+            if (res.has_header("Set-Cookie"))
+                return true;
+            auto control = res.get_header_value("Cache-Control");
+            return control.find("private") != std::string::npos || control.find("no-store") != std::string::npos;
+        }
+
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        struct Entry
+        {
+            std::string key;
+            int status = 200;
+            std::string contentType;
+            std::string etag;
+            std::vector<std::pair<std::string, std::string>> headers;
+            std::string body;
+            std::vector<std::string> surrogateKeys;
+            bool varyEncoding = false;
+            bool shared = false;
+            size_t size = 0;
+            Clock::time_point storedAt;
+            Clock::time_point expires;
+        };
+
+        using EntryList = std::list<std::shared_ptr<const Entry>>;
+
+        struct Shard
+        {
+            mutable std::mutex mutex;
+            EntryList lru; // front = most recently used
+            std::unordered_map<std::string, EntryList::iterator> index;
+            std::unordered_map<std::string, std::unordered_set<std::string>> tags;
+            size_t bytes = 0;
+        };
+
+        ResponseCacheOptions options_;
+        std::vector<Shard> shards_;
+        size_t shardBudget_ = 0;
+
+        std::atomic<uint64_t> hits_{0};
+        std::atomic<uint64_t> misses_{0};
+        std::atomic<uint64_t> stores_{0};
+        std::atomic<uint64_t> evictions_{0};
+        std::atomic<uint64_t> expirations_{0};
+        std::atomic<uint64_t> purges_{0};
+
+        static std::string variantKey(const std::string &host, const std::string &target,
+                                      const std::string &encoding)
+        {
+            std::string key;
+            key.reserve(host.size() + target.size() + encoding.size() + 2);
+            key += host;
+            key += '\n';
+            key += target;
+            key += '\n';
+            key += encoding;
+            return key;
+        }
+
+        // Internal surrogate key grouping every host/encoding variant of a URL;
+        // the leading newline keeps it apart from handler-chosen keys
+        static std::string pathTag(const std::string &target)
+        {
+            return "\npath\n" + target;
+        }
+
+        size_t purgeTag(const std::string &surrogateKey)
+        {
+
+            size_t removed = 0;
+            for (auto &shard : shards_)
+            {
+                std::lock_guard<std::mutex> lock(shard.mutex);
+                auto tag = shard.tags.find(surrogateKey);
+                if (tag == shard.tags.end())
+                    continue;
+
+                auto keys = std::move(tag->second);
+                shard.tags.erase(tag);
+                for (auto &key : keys)
+                {
+                    auto it = shard.index.find(key);
+                    if (it == shard.index.end())
+                        continue;
+                    unlink(shard, it->second);
+                    removed++;
+                }
+            }
+            purges_ += removed;
+            return removed;
+        }
+
+
+        static bool variesOnlyOnEncoding(const std::string &vary)
+        {
+            size_t pos = 0;
+            while (pos < vary.size())
+            {
+                size_t comma = vary.find(',', pos);
+                if (comma == std::string::npos)
+                    comma = vary.size();
+                std::string name = vary.substr(pos, comma - pos);
+                pos = comma + 1;
+
+                name.erase(0, name.find_first_not_of(" \t"));
+                name.erase(name.find_last_not_of(" \t") + 1);
+                std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+                if (!name.empty() && name != "accept-encoding")
+                    return false;
+            }
+            return true;
+        }
+
+        Shard &shardFor(const std::string &key)
+        {
+            return shards_[std::hash<std::string>{}(key) % shards_.size()];
+        }
+
+        std::shared_ptr<const Entry> find(const std::string &key)
+        {
+            auto &shard = shardFor(key);
+            std::lock_guard<std::mutex> lock(shard.mutex);
+
+            auto it = shard.index.find(key);
+            if (it == shard.index.end())
+                return nullptr;
+
+            auto entry = *it->second;
+            if (Clock::now() >= entry->expires)
+            {
+                unlink(shard, it->second);
+                expirations_++;
+                return nullptr;
+            }
+
+            shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+            return entry;
+        }
+
+        // Caller holds the shard lock
+        static void unlink(Shard &shard, EntryList::iterator pos)
+        {
+            const auto &entry = **pos;
+            for (auto &tag : entry.surrogateKeys)
+            {
+                auto t = shard.tags.find(tag);
+                if (t == shard.tags.end())
+                    continue;
+                t->second.erase(entry.key);
+                if (t->second.empty())
+                    shard.tags.erase(t);
+            }
+            shard.bytes -= entry.size;
+            shard.index.erase(entry.key);
+            shard.lru.erase(pos);
+        }
+    };
+}
@@ -1,11 +1,21 @@
 #pragma once
 #include "app.hpp"
+#include "compression.hpp"
+#include "zstd_dictionary.hpp"
+#include "response_cache.hpp"
+#include "single_flight.hpp"
+#include "rate_limiter.hpp"
+#include "worker_pool.hpp"
+#include "http2.hpp"
+#include "lifecycle.hpp"
+#include "prefork.hpp"
 #include "httplib.h"
 #include <string>
 #include <iostream>
 #include <unordered_map>
 #include <sstream>
 #include <algorithm>
+#include <charconv>
 #include <chrono>
 #include <thread>
 #include <atomic>
@@ -13,6 +23,12 @@
 #include <iomanip>
 #include <ctime>
 #include <random>
+#include <unordered_set>
+#include <vector>
+#ifndef _WIN32
+#include <sys/stat.h>
+#include <sys/un.h>
+#endif
 
 inline std::unordered_map<std::string, std::string> parse_cookies(const std::string &cookieHeader)
 {
@@ -59,13 +75,60 @@ inline std::unordered_map<std::string, std::string> extract_params(
 
 namespace xpresspp
 {
+    // 🔥 One socket to accept on (ServerConfig::listeners)
+    struct Listener
+    {
+        std::string host = "0.0.0.0"; // TCP: IPv4 / IPv6 address or hostname
+        int port = 3000;
+        bool ipv6Only = false; // IPv6: no v4-mapped clients (so 0.0.0.0 can bind the same port)
+        std::string path;      // Unix socket: a file path, or "@name" for the abstract namespace (Linux)
+        int mode = 0660;       // permissions of a path socket
+
+        static Listener tcp(const std::string &host, int port, bool ipv6Only = false)
+        {
+            Listener listener;
+            listener.host = host;
+            listener.port = port;
+            listener.ipv6Only = ipv6Only;
+            return listener;
+        }
+
+        static Listener unixSocket(const std::string &path, int mode = 0660)
+        {
+            Listener listener;
+            listener.path = path;
+            listener.mode = mode;
+            return listener;
+        }
+
+        bool isUnix() const { return !path.empty(); }
+        bool isAbstract() const { return isUnix() && path[0] == '@'; }
+
+        // For logs: "http://[::1]:3000", "unix:/run/app.sock"
+        std::string url(bool ssl = false) const
+        {
+            if (isUnix())
+                return "unix:" + path;
+            auto address = host.find(':') != std::string::npos ? "[" + host + "]" : host;
+            return (ssl ? "https://" : "http://") + address + ":" + std::to_string(port);
+        }
+    };
+
     // 🔥 Server Configuration
     struct ServerConfig
     {
         // Basic
         std::string host = "0.0.0.0";
         int port = 3000;
+        // Several sockets (TCP v4 / v6, Unix) served by the same routes,
+        // workers and metrics; empty = host:port
+        std::vector<Listener> listeners;
+        bool peerCredentials = false; // Unix sockets: req.peer from SO_PEERCRED
         int threadPoolSize = 8;
+        // Async handlers on HTTP/1.x release their worker while they wait; on
+        // HTTP/2 streams and HTTPS each waiting request holds a thread until
+        // done(), so this also caps those
+        int maxThreads = 256; // threadPoolSize + replacements for workers parked on async handlers
 
         // Timeouts
         int readTimeout = 30; // seconds
@@ -76,13 +139,32 @@ namespace xpresspp
         size_t maxRequestSize = 10 * 1024 * 1024; // 10MB
         size_t maxHeaderSize = 8 * 1024;          // 8KB
         int maxConnections = 1000;
+        // Bodies above this go to an unlinked temp file in bodySpillDir,
+        // mapped read-only (req.bodyView()); 0 = always in memory
+        size_t bodySpillThreshold = 0;
+        std::string bodySpillDir = "/tmp";
+        // multipart/form-data: per-part limits, upload dir / sink (req.form)
+        MultipartOptions multipart;
 
         // Features
         bool enableLogging = true;
         bool enableMetrics = true;
         bool enableCORS = false;
         bool enableCompression = true;
+        CompressionPolicy compression; // types, min size, levels, per-route overrides
         bool trustProxy = false;
+        bool lazyJsonBody = true; // index JSON bodies, parse members on demand
+        bool autoETag = false;    // strong ETag from the body hash + automatic 304s
+
+        // Server-side response cache; null = off. Share the instance with
+        // handlers that need to purge (cache->purge("users")).
+        std::shared_ptr<ResponseCache> responseCache;
+
+        // Routes whose identical concurrent GETs share one handler run
+        CoalescingConfig coalescing;
+
+        // Per-client request budget (IP, bearer token or custom key)
+        RateLimitConfig rateLimit;
 
         // SSL/TLS
         bool enableSSL = false;
@@ -93,15 +175,41 @@ namespace xpresspp
         bool reuseAddress = true;
         bool reusePort = false;
         bool tcpNoDelay = true;
+        int processes = 1; // > 1: prefork workers under a supervising master (Linux); 0 = one per core
+        bool enableHTTP2 = false; // h2c: prior knowledge and Upgrade: h2c (not over SSL)
+        int webSocketThreads = 1; // event loops for upgraded WebSocket connections
+
+        // Lifecycle
+        bool handleSignals = false; // SIGTERM / SIGINT: graceful stop, SIGHUP: hot restart
+        int drainTimeout = 30;      // seconds in-flight requests get after a stop
+        bool hotRestart = false;    // SIGHUP hands the listening socket to a fresh start of the binary
+        int restartTimeout = 30;   // seconds the new process gets to start serving
     };
 
     // 🔥 Request Statistics
+    // (the deprecated alias below would otherwise warn in every file that
+    // includes this one, from the implicit constructor)
+#if defined(_MSC_VER)
+#pragma warning(push)
+#pragma warning(disable : 4996)
+#elif defined(__GNUC__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wdeprecated-declarations"
+#endif
     struct RequestStats
     {
         std::atomic<uint64_t> totalRequests{0};
         std::atomic<uint64_t> successRequests{0};
         std::atomic<uint64_t> errorRequests{0};
-        std::atomic<uint64_t> activeConnections{0};
+        std::atomic<uint64_t> activeRequests{0}; // route handlers running (connections: Server::activeConnections)
+
+        // The old name of activeRequests; it never counted connections
+        [[deprecated("use activeRequests (open connections: Server::activeConnections())")]]
+        std::atomic<uint64_t> &activeConnections = activeRequests;
+
+        // Prefork: every worker also adds to the instance-wide block
+        SharedMetrics *shared = nullptr;
+        int slot = -1;
 
         std::unordered_map<int, uint64_t> statusCodes;
         std::unordered_map<std::string, uint64_t> methodCounts;
@@ -110,6 +218,25 @@ namespace xpresspp
         double avgResponseTime = 0.0;
         std::mutex statsMutex;
 
+        // Counts a request from the route handler's start to its end
+        // (a suspended async request counts until its response is written)
+        struct ActiveRequest
+        {
+            RequestStats &stats;
+            explicit ActiveRequest(RequestStats &s) : stats(s)
+            {
+                stats.activeRequests++;
+                if (stats.shared)
+                    stats.shared->active++;
+            }
+            ~ActiveRequest()
+            {
+                stats.activeRequests--;
+                if (stats.shared)
+                    stats.shared->active--;
+            }
+        };
+
         void recordRequest(const std::string &method, const std::string &path,
                            int status, double duration)
         {
@@ -128,8 +255,24 @@ namespace xpresspp
 
             // Update average response time (simple moving average)
             avgResponseTime = (avgResponseTime * (totalRequests - 1) + duration) / totalRequests;
+
+            if (shared)
+                shared->record(slot, method, status, duration);
+        }
+
+        // A failure with no response recorded
+        void recordError()
+        {
+            errorRequests++;
+            if (shared)
+                shared->error++;
         }
     };
+#if defined(_MSC_VER)
+#pragma warning(pop)
+#elif defined(__GNUC__)
+#pragma GCC diagnostic pop
+#endif
 
     class Server
     {
@@ -169,6 +312,11 @@ namespace xpresspp
         // 🔥 Enhanced run with features
         void run()
         {
+#ifdef XPRESSPP_PREFORK
+            if (workerSlot_ < 0 && processes() > 1)
+                return runPrefork();
+#endif
+
             httplib::Server svr;
 
             // ========================================
@@ -179,16 +327,61 @@ namespace xpresspp
             svr.set_read_timeout(config_.readTimeout, 0);
             svr.set_write_timeout(config_.writeTimeout, 0);
             svr.set_keep_alive_timeout(config_.keepAliveTimeout);
+            svr.set_tcp_nodelay(config_.tcpNoDelay); // HTTP/2 frames of different streams go out as separate writes
+            svr.set_peer_credentials(config_.peerCredentials);
+            applySocketOptions(svr); // the SSL listen binds here
 
             // Limits
             svr.set_payload_max_length(config_.maxRequestSize);
+            svr.set_header_max_length(config_.maxHeaderSize); // request line + headers; 431 beyond
+            svr.set_body_spill_threshold(config_.bodySpillThreshold, config_.bodySpillDir);
 
             // Thread pool
             svr.new_task_queue = [this]
             {
-                return new httplib::ThreadPool(config_.threadPoolSize);
+                pool_ = new WorkerPool(config_.threadPoolSize, config_.maxThreads);
+                return pool_;
             };
 
+            // HTTP/2: each stream of a connection runs as its own pool task
+            if (config_.enableHTTP2)
+            {
+                svr.set_h2c_handler([this](httplib::Stream &conn, const httplib::Request &req,
+                                           const std::function<bool(httplib::Stream &)> &dispatch)
+                                    {
+                    if (!http2::isPriorKnowledge(req) && !http2::isUpgrade(req))
+                        return false;
+
+                    http2::Options options;
+                    options.maxHeaderListSize = config_.maxHeaderSize;
+                    options.idleTimeoutSec = config_.keepAliveTimeout;
+                    options.readTimeoutSec = config_.readTimeout;
+                    options.writeTimeoutSec = config_.writeTimeout;
+                    http2::ServerConnection connection(conn, dispatch, [this](std::function<void()> task)
+                                                       { return pool_ && pool_->enqueue(std::move(task)); },
+                                                       options);
+
+                    // Drained with the server: GOAWAY, then closed once idle
+                    {
+                        std::lock_guard<std::mutex> lock(h2Mutex_);
+                        h2Connections_.insert(&connection);
+                    }
+                    if (phase_ == Phase::Draining)
+                        connection.drain();
+
+                    // This worker only reads frames now: the pool may replace it
+                    auto parker = async_detail::currentParker();
+                    if (parker)
+                        parker->park();
+                    connection.run(req);
+                    if (parker)
+                        parker->unpark();
+
+                    std::lock_guard<std::mutex> lock(h2Mutex_);
+                    h2Connections_.erase(&connection);
+                    return true; });
+            }
+
             // ========================================
             // 🔥 Global Middleware (Logger, CORS, etc.)
             // ========================================
@@ -203,8 +396,6 @@ namespace xpresspp
             // Pre-routing middleware (CORS, etc.)
             svr.set_pre_routing_handler([this](const httplib::Request &req, httplib::Response &res)
                                         {
-                stats_.activeConnections++;
-                
                 // CORS
                 if (config_.enableCORS)
                 {
@@ -222,16 +413,16 @@ namespace xpresspp
                 
                 return httplib::Server::HandlerResponse::Unhandled; });
 
-            // Post-routing handler (cleanup)
-            svr.set_post_routing_handler([this](const httplib::Request &, httplib::Response &)
-                                         { stats_.activeConnections--; });
-
             // ========================================
             // 🔥 Error Handlers
             // ========================================
 
             svr.set_error_handler([](const httplib::Request &, httplib::Response &res)
                                   {
+                // Keep bodies produced by handlers (res.error, bind errors...)
+                if (!res.body.empty())
+                    return;
+
                 nlohmann::json error = {
                     {"error", true},
                     {"status", res.status},
@@ -268,163 +459,127 @@ namespace xpresspp
                 res.status = 500;
                 res.set_content(errorJson.dump(), "application/json"); });
 
+            if (config_.rateLimit.enabled)
+            {
+                const auto &limits = config_.rateLimit;
+                rateLimiter_ = std::make_unique<RateLimiter>(limits);
+                if (limits.burst == 0 && rateLimiter_->burst() < limits.limit)
+                    std::cerr << "⚠️  rateLimit: burst capped at " << rateLimiter_->burst()
+                              << " (set rateLimit.burst to silence this)\n";
+                if (rateLimiter_->enforcedLimit() < limits.limit * 0.98)
+                    std::cerr << "⚠️  rateLimit: burst " << rateLimiter_->burst() << " leaves "
+                              << static_cast<long long>(rateLimiter_->enforcedLimit()) << " of " << limits.limit
+                              << " requests per window enforceable; lower rateLimit.burst\n";
+            }
+
+            // ========================================
+            // 🔥 zstd dictionaries (trained per route, served by ID)
+            // ========================================
+
+#ifdef XPRESSPP_ZSTD_SUPPORT
+            if (config_.compression.dictionary.enabled)
+            {
+                dictionaries_ = std::make_unique<ZstdDictionaryStore>(config_.compression.dictionary);
+                for (auto &route : app_.getRoutes())
+                    dictionaries_->addRoute(route.path);
+
+                svr.Get(std::string(ZstdDictionaryStore::path) + "(\\d+)",
+                        [this](const httplib::Request &req, httplib::Response &res)
+                        {
+                            // An ID that does not fit in 32 bits names no dictionary
+                            const auto &digits = req.matches[1];
+                            uint32_t id = 0;
+                            auto parsed = std::from_chars(&*digits.first, &*digits.first + digits.length(), id);
+                            auto dictionary = parsed.ec == std::errc() ? dictionaries_->byId(id) : nullptr;
+                            if (!dictionary)
+                            {
+                                res.status = 404;
+                                return;
+                            }
+                            res.set_header("Cache-Control", "public, max-age=31536000, immutable");
+                            res.set_content(dictionary->bytes, "application/octet-stream");
+                        });
+            }
+#endif
+
             // ========================================
             // 🔥 Register Routes
             // ========================================
 
+            app_.compile(); // per-route middleware chains
+            app_.webSockets().setThreads(config_.webSocketThreads);
+
             for (auto &route : app_.getRoutes())
             {
-                auto handler = [&, route](const httplib::Request &req, httplib::Response &res)
+                // The route table is fixed from here on: capture a pointer, not a copy
+                const Route *routeEntry = &route;
+                auto handler = [&, routeEntry](const httplib::Request &req, httplib::Response &res,
+                                               const httplib::ContentReader *reader)
                 {
+                    const Route &route = *routeEntry;
                     auto startTime = std::chrono::high_resolution_clock::now();
+                    RequestStats::ActiveRequest active(stats_);
 
-                    try
+                    // Rate limit first: cache hits and coalesced replays count
+                    // too, and a rejected request's body is never read
+                    if (rateLimiter_ && rateLimiter_->appliesTo(route.path))
                     {
-                        Request xreq;
-
-                        // ========================================
-                        // 🔥 Build Request Object
-                        // ========================================
-
-                        // Basic info
-                        xreq.method = req.method;
-                        xreq.url = req.path;
-                        xreq.path = req.path;
-                        xreq.originalUrl = req.path;
-                        xreq.protocol = req.has_header("X-Forwarded-Proto")
-                                            ? req.get_header_value("X-Forwarded-Proto")
-                                            : "http";
-
-                        // Generate unique request ID
-                        xreq.requestId = generateRequestId();
-                        xreq.startTime = std::chrono::system_clock::now();
-
-                        // Query string
-                        if (!req.params.empty())
+                        uint64_t key = rateLimiter_->keyHash(req, config_.trustProxy);
+                        if (key != 0)
                         {
-                            std::ostringstream qs;
-                            bool first = true;
-                            for (const auto &p : req.params)
+                            auto decision = rateLimiter_->check(key);
+                            RateLimiter::apply(decision, res);
+                            if (!decision.allowed)
                             {
-                                if (!first)
-                                    qs << '&';
-                                first = false;
-                                qs << p.first << '=' << p.second;
+                                // Its bytes are still on the connection: close it
+                                if (reader)
+                                {
+                                    auto &headers = const_cast<httplib::Request &>(req).headers;
+                                    headers.erase("Connection");
+                                    headers.emplace("Connection", "close");
+                                }
+                                recordReplay(req, res, startTime);
+                                return;
                             }
-                            xreq.parseQuery(qs.str());
-                        }
-
-                        // Body
-                        xreq.body = req.body;
-                        xreq.contentLength = req.body.size();
-
-                        // Route params
-                        xreq.params = extract_params(route.path, req.path);
-
-                        // Cookies
-                        auto ck = req.headers.find("Cookie");
-                        if (ck != req.headers.end())
-                        {
-                            xreq.cookies = parse_cookies(ck->second);
                         }
+                    }
 
-                        // Headers
-                        for (auto &h : req.headers)
-                            xreq.headers[h.first] = h.second;
-
-                        // Extract common headers
-                        xreq.userAgent = req.get_header_value("User-Agent");
-                        xreq.referer = req.get_header_value("Referer");
-                        xreq.hostname = req.get_header_value("Host");
+                    // Then the body, as on routes without a reader
+                    MultipartForm form;
+                    if (reader && !readBody(req, res, *reader, form))
+                    {
+                        recordReplay(req, res, startTime);
+                        return;
+                    }
 
-                        // IP handling (with proxy support)
-                        if (config_.trustProxy)
-                        {
-                            xreq.ip = req.get_header_value("X-Forwarded-For");
-                            if (xreq.ip.empty())
-                                xreq.ip = req.get_header_value("X-Real-IP");
-                            if (xreq.ip.empty())
-                                xreq.ip = req.remote_addr;
+                    // Cached and coalesced responses skip Request building and
+                    // the handler; routes with middleware replay inside the chain
+                    SingleFlight::Leader leader;
+                    if (route.chain.empty() && replay(route, req, res, leader))
+                    {
+                        recordReplay(req, res, startTime);
+                        return;
+                    }
 
-                            xreq.parseForwardedIPs();
-                        }
-                        else
+                    try
+                    {
+                        // Async routes may finish after this call returns:
+                        // their request lives on the heap (see serveAsync)
+                        if (route.async && req.suspendable)
                         {
-                            xreq.ip = req.remote_addr;
+                            serveAsync(route, req, res, form, leader, startTime);
+                            return;
                         }
 
-                        // HTTPS detection
-                        xreq.secure = (xreq.protocol == "https") ||
-                                      req.get_header_value("X-Forwarded-Ssl") == "on";
-
-                        // Parse body
-                        xreq.parseBody();
-
-                        // Parse cookies
-                        xreq.parseCookies();
-
-                        // ========================================
-                        // 🔥 Create Response Object
-                        // ========================================
-
+                        Request xreq;
                         Response xres;
-                        xres.requestId(xreq.requestId);
-
-                        // Add server header
-                        xres.setHeader("X-Powered-By", "Xpress++");
-
-                        // Security headers (if enabled globally)
-                        if (config_.enableCORS)
-                            xres.cors();
-
-                        // ========================================
-                        // 🔥 Execute Handler
-                        // ========================================
-
-                        route.handler(xreq, xres);
-
-                        // ========================================
-                        // 🔥 Build HTTP Response
-                        // ========================================
-
-                        res.status = xres.getStatus();
-
-                        for (auto &h : xres.getHeaders())
-                            res.set_header(h.first.c_str(), h.second.c_str());
-
-                        res.set_content(xres.getBody(), xres.getContentType().c_str());
-
-                        // ========================================
-                        // 🔥 Record Metrics
-                        // ========================================
-
-                        if (config_.enableMetrics)
-                        {
-                            auto endTime = std::chrono::high_resolution_clock::now();
-                            auto duration = std::chrono::duration<double, std::milli>(endTime - startTime).count();
-
-                            stats_.recordRequest(req.method, req.path, res.status, duration);
-
-                            // Add timing header
-                            res.set_header("X-Response-Time", std::to_string(duration) + "ms");
-                        }
+                        buildExchange(route, req, form, xreq, xres);
+                        if (execute(route, req, res, xreq, xres, leader, startTime))
+                            respond(route, req, res, xreq, xres, leader, startTime);
                     }
-                    catch (const std::exception &e)
+                    catch (const std::exception &)
                     {
-                        std::cerr << "[Server Error] " << req.method << " " << req.path
-                                  << " - " << e.what() << std::endl;
-
-                        nlohmann::json errorJson = {
-                            {"error", true},
-                            {"status", 500},
-                            {"message", "Internal Server Error"},
-                            {"details", e.what()}};
-
-                        res.status = 500;
-                        res.set_content(errorJson.dump(), "application/json");
-
-                        if (config_.enableMetrics)
-                            stats_.errorRequests++;
+                        respondError(req, res);
                     }
                 };
 
@@ -432,27 +587,27 @@ namespace xpresspp
                 // 🔥 Register Route by Method
                 // ========================================
 
-                if (route.method == "GET")
-                    svr.Get(route.path.c_str(), handler);
-                else if (route.method == "POST")
-                    svr.Post(route.path.c_str(), handler);
-                else if (route.method == "PUT")
-                    svr.Put(route.path.c_str(), handler);
-                else if (route.method == "PATCH")
-                    svr.Patch(route.path.c_str(), handler);
-                else if (route.method == "DELETE")
-                    svr.Delete(route.path.c_str(), handler);
-                else if (route.method == "OPTIONS")
-                    svr.Options(route.path.c_str(), handler);
-                else if (route.method == "ALL")
-                {
-                    svr.Get(route.path.c_str(), handler);
-                    svr.Post(route.path.c_str(), handler);
-                    svr.Put(route.path.c_str(), handler);
-                    svr.Patch(route.path.c_str(), handler);
-                    svr.Delete(route.path.c_str(), handler);
-                    svr.Options(route.path.c_str(), handler);
-                }
+                // Methods with a body go in httplib's content-reader lists:
+                // their handler runs before the body is read
+                auto plain = [handler](const httplib::Request &req, httplib::Response &res)
+                { handler(req, res, nullptr); };
+                auto reading = [handler](const httplib::Request &req, httplib::Response &res,
+                                         const httplib::ContentReader &reader)
+                { handler(req, res, &reader); };
+
+                bool all = route.method == "ALL";
+                if (all || route.method == "GET")
+                    svr.Get(route.path.c_str(), plain);
+                if (all || route.method == "POST")
+                    svr.Post(route.path.c_str(), reading);
+                if (all || route.method == "PUT")
+                    svr.Put(route.path.c_str(), reading);
+                if (all || route.method == "PATCH")
+                    svr.Patch(route.path.c_str(), reading);
+                if (all || route.method == "DELETE")
+                    svr.Delete(route.path.c_str(), reading);
+                if (all || route.method == "OPTIONS")
+                    svr.Options(route.path.c_str(), plain);
             }
 
             // ========================================
@@ -468,7 +623,8 @@ namespace xpresspp
                     {"status", "healthy"},
                     {"uptime", uptime},
                     {"timestamp", getCurrentTimestamp()},
-                    {"activeConnections", stats_.activeConnections.load()}
+                    {"activeConnections", activeConnections()},
+                    {"activeRequests", stats_.activeRequests.load()}
                 };
                 
                 res.set_content(health.dump(), "application/json"); });
@@ -486,7 +642,8 @@ namespace xpresspp
             // 🔥 Start Server
             // ========================================
 
-            printStartupBanner();
+            if (workerSlot_ < 0)
+                printStartupBanner();
 
             if (config_.enableSSL && !config_.sslCertPath.empty())
             {
@@ -501,7 +658,7 @@ namespace xpresspp
             }
             else
             {
-                svr.listen(config_.host.c_str(), config_.port);
+                serve(svr);
             }
         }
 
@@ -509,24 +666,57 @@ namespace xpresspp
         // 🔥 Graceful Shutdown
         // ========================================
 
+        // Stops accepting, lets in-flight requests finish (config.drainTimeout),
+        // then closes what is left; run() returns once every worker is done.
+        // Callable from any thread; SIGTERM / SIGINT do the same.
         void shutdown()
         {
-            std::cout << "\n🛑 Shutting down server gracefully...\n";
+            if (workerSlot_ >= 0)
+                return drain(false); // the master reports for the instance
 
-            // Wait for active connections to complete
-            int maxWait = 10; // seconds
-            int waited = 0;
+            std::cout << "\n🛑 Shutting down server gracefully...\n";
+            drain(false);
+            printShutdownStats();
+            std::cout << "✅ Server stopped\n";
+        }
 
-            while (stats_.activeConnections > 0 && waited < maxWait)
+        // 🔥 Hot restart (SIGHUP): start the binary again on the same
+        // listening socket, then drain. Keeps serving if the new process
+        // does not come up within config.restartTimeout.
+        bool restart()
+        {
+#ifdef XPRESSPP_LIFECYCLE_SIGNALS
+            auto http = http_.load();
+            Phase serving = Phase::Serving;
+            if (!http || !phase_.compare_exchange_strong(serving, Phase::Restarting))
+                return false;
+
+            std::cout << "\n🔁 Hot restart: starting a new process...\n";
+            auto successor = lifecycle::spawnSuccessor(listeners_, config_.restartTimeout);
+            if (!successor.ready)
             {
-                std::cout << "⏳ Waiting for " << stats_.activeConnections
-                          << " active connections...\n";
-                std::this_thread::sleep_for(std::chrono::seconds(1));
-                waited++;
+                std::cerr << "⚠️  Hot restart failed (" << successor.error << "), still serving\n";
+                phase_ = Phase::Serving;
+                return false;
             }
+            handedOff_ = true;
 
+            std::cout << "🔁 Pid " << successor.pid << " is serving; draining this one\n";
+            drain(true);
             printShutdownStats();
-            std::cout << "✅ Server stopped\n";
+            std::cout << "✅ Handed over to pid " << successor.pid << "\n";
+            return true;
+#else
+            return false;
+#endif
+        }
+
+        // Connections being served (WebSockets live on their loops and
+        // count in webSockets().connections())
+        size_t activeConnections() const
+        {
+            auto http = http_.load();
+            return http ? http->connection_count() : 0;
         }
 
     private:
@@ -534,11 +724,995 @@ namespace xpresspp
         ServerConfig config_;
         RequestStats stats_;
         std::chrono::system_clock::time_point startTime_;
+        SingleFlight coalescer_;
+        std::unique_ptr<RateLimiter> rateLimiter_;
+        WorkerPool *pool_ = nullptr; // owned by httplib::Server
+
+        // Lifecycle: the listening server while run() is in listen
+        enum class Phase
+        {
+            Serving,
+            Restarting,
+            Draining
+        };
+        std::atomic<httplib::Server *> http_{nullptr};
+        std::atomic<Phase> phase_{Phase::Serving};
+        std::atomic<bool> forceStop_{false};
+        std::mutex drainMutex_;
+        std::thread lifecycleThread_; // a signal's drain or restart
+        std::mutex h2Mutex_;
+        std::unordered_set<http2::ServerConnection *> h2Connections_;
+
+        // Prefork worker: its slot and the sockets the master bound (none:
+        // binds its own with SO_REUSEPORT)
+        int workerSlot_ = -1;
+        std::vector<int> inheritedListeners_;
+        std::vector<int> listeners_;         // this process's, in config order
+        std::atomic<bool> handedOff_{false}; // a successor serves our sockets now
+#ifdef XPRESSPP_ZSTD_SUPPORT
+        std::unique_ptr<ZstdDictionaryStore> dictionaries_;
+#endif
+
+        // ========================================
+        // 🔥 Listen + Lifecycle
+        // ========================================
+
+        int processes() const
+        {
+            return config_.processes > 0 ? config_.processes
+                                         : static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+        }
+
+        // SO_REUSEADDR / SO_REUSEPORT as configured (httplib would always
+        // set SO_REUSEPORT, letting a second instance share the port)
+        void applySocketOptions(httplib::Server &svr)
+        {
+            svr.set_socket_options([this](socket_t sock)
+                                   {
+                if (config_.reuseAddress)
+                    httplib::detail::set_socket_opt(sock, SOL_SOCKET, SO_REUSEADDR, 1);
+#ifdef SO_REUSEPORT
+                if (config_.reusePort)
+                    httplib::detail::set_socket_opt(sock, SOL_SOCKET, SO_REUSEPORT, 1);
+#endif
+            });
+        }
+
+        std::vector<Listener> configuredListeners() const
+        {
+            if (!config_.listeners.empty())
+                return config_.listeners;
+            return {Listener::tcp(config_.host, config_.port)};
+        }
+
+        bool hasUnixListener() const
+        {
+            return std::any_of(config_.listeners.begin(), config_.listeners.end(),
+                               [](const Listener &l)
+                               { return l.isUnix(); });
+        }
+
+#ifndef _WIN32
+        // A socket file nobody accepts on any more (left by a crash) is
+        // removed; a live one belongs to another instance
+        static bool removeStaleSocket(const std::string &path)
+        {
+            struct stat st;
+            if (lstat(path.c_str(), &st) != 0)
+                return true;
+            if (!S_ISSOCK(st.st_mode) || path.size() >= sizeof(sockaddr_un::sun_path))
+                return false;
+
+            sockaddr_un addr{};
+            addr.sun_family = AF_UNIX;
+            std::copy(path.begin(), path.end(), addr.sun_path);
+            int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            bool live = probe >= 0 && connect(probe, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) == 0;
+            if (probe >= 0)
+                close(probe);
+            return !live && unlink(path.c_str()) == 0;
+        }
+#endif
+
+        // A bound, listening socket, or INVALID_SOCKET (reported)
+        socket_t bindListener(const Listener &listener)
+        {
+            httplib::Server binder; // only binds: the socket outlives it
+            applySocketOptions(binder);
+            binder.set_tcp_nodelay(config_.tcpNoDelay); // accepted sockets inherit it
+
+            bool bound = false;
+            if (listener.isUnix())
+            {
+#ifndef _WIN32
+                if (!listener.isAbstract() && !removeStaleSocket(listener.path))
+                {
+                    std::cerr << "❌ " << listener.path << " is in use or not a socket\n";
+                    return INVALID_SOCKET;
+                }
+                binder.set_address_family(AF_UNIX);
+                bound = binder.bind_to_port(listener.path, 1); // the port is unused
+                if (bound && !listener.isAbstract())
+                    chmod(listener.path.c_str(), static_cast<mode_t>(listener.mode));
+#endif
+            }
+            else
+            {
+                binder.set_ipv6_v6only(listener.ipv6Only);
+                bound = binder.bind_to_port(listener.host, listener.port);
+            }
+
+            if (!bound)
+            {
+                std::cerr << "❌ Cannot listen on " << listener.url() << "\n";
+                return INVALID_SOCKET;
+            }
+            return binder.listening_socket();
+        }
+
+        // This process's sockets in config order: the handed-over ones
+        // first (a successor's config may add listeners), the rest bound
+        // here. Empty when one cannot be bound.
+        std::vector<int> openListeners(const std::vector<int> &inherited)
+        {
+            auto configured = configuredListeners();
+            std::vector<int> sockets;
+            for (size_t i = 0; i < inherited.size(); i++)
+            {
+                if (i < configured.size())
+                    sockets.push_back(inherited[i]);
+                else
+                    httplib::detail::close_socket(inherited[i]); // no longer configured
+            }
+            for (size_t i = sockets.size(); i < configured.size(); i++)
+            {
+                auto sock = bindListener(configured[i]);
+                if (sock == INVALID_SOCKET)
+                {
+                    for (auto open : sockets)
+                        httplib::detail::close_socket(open);
+                    return {};
+                }
+                sockets.push_back(static_cast<int>(sock));
+            }
+            return sockets;
+        }
+
+        // Socket files go with the instance: not after a hot restart (the
+        // successor serves them) and not when a prefork worker exits
+        void removeSocketFiles()
+        {
+#ifndef _WIN32
+            if (handedOff_ || workerSlot_ >= 0)
+                return;
+            for (auto &listener : config_.listeners)
+                if (listener.isUnix() && !listener.isAbstract())
+                    unlink(listener.path.c_str());
+#endif
+        }
+
+        // Binds (or takes over a predecessor's sockets on hot restart) and
+        // accepts on every listener until stopped
+        bool serve(httplib::Server &svr)
+        {
+#ifdef XPRESSPP_LIFECYCLE_SIGNALS
+            lifecycle::Inheritance inherited;
+            if (sharesListener())
+            {
+                // Prefork siblings accept on the same sockets: stop_accepting()
+                // cannot wake a blocked accept(), and a sibling may take a
+                // connection we polled
+                svr.set_idle_interval(0, 100000);
+            }
+
+            auto listeners = openListeners(!inheritedListeners_.empty() ? inheritedListeners_ : inherited.listeners());
+            if (listeners.empty())
+                return false;
+            if (!inherited.listeners().empty())
+                std::cout << "🔁 Took over " << inherited.listeners().size()
+                          << " listening socket(s) from pid " << getppid() << "\n";
+#else
+            auto listeners = openListeners({});
+            if (listeners.empty())
+                return false;
+#endif
+            // Several sockets share one poll, which must not block in accept()
+            if (sharesListener() || listeners.size() > 1)
+                for (auto sock : listeners)
+                    httplib::detail::set_nonblocking(sock, true);
+            for (size_t i = 1; i < listeners.size(); i++)
+                svr.add_listening_socket(listeners[i]);
+
+            listeners_ = listeners;
+            http_ = &svr;
+#ifdef XPRESSPP_LIFECYCLE_SIGNALS
+            std::unique_ptr<lifecycle::SignalWatcher> signals;
+            if (config_.handleSignals)
+                signals = std::make_unique<lifecycle::SignalWatcher>([this](int signo)
+                                                                     { onSignal(signo); });
+            inherited.ready();
+
+            bool ok = svr.listen_on(listeners[0]);
+
+            signals.reset();
+            if (lifecycleThread_.joinable())
+                lifecycleThread_.join(); // the drain that stopped us
+#else
+            bool ok = svr.listen_on(listeners[0]);
+#endif
+            std::lock_guard<std::mutex> lock(drainMutex_);
+            http_ = nullptr;
+            removeSocketFiles();
+            return ok;
+        }
+
+        // Prefork workers accept alongside their siblings. A hot restart
+        // successor only shares the sockets once this process is stopping,
+        // and wakeAcceptLoop() covers that: no polling until then.
+        bool sharesListener() const
+        {
+            return !inheritedListeners_.empty();
+        }
+
+#ifdef XPRESSPP_LIFECYCLE_SIGNALS
+        // A blocking accept() does not notice stop_accepting(): connect to
+        // our own listeners until this accept loop wakes up and exits. The
+        // successor may take some of these connections; they carry no
+        // request and are closed at once.
+        void wakeAcceptLoop(httplib::Server &http, const std::vector<sockaddr_storage> &addresses,
+                            const std::vector<socklen_t> &sizes)
+        {
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+            while (http.is_running() && std::chrono::steady_clock::now() < deadline)
+            {
+                for (size_t i = 0; i < addresses.size(); i++)
+                {
+                    int sock = socket(addresses[i].ss_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+                    if (sock < 0)
+                        continue;
+                    connect(sock, reinterpret_cast<const sockaddr *>(&addresses[i]), sizes[i]);
+                    close(sock);
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+        }
+
+#ifdef XPRESSPP_PREFORK
+        // 🔥 Prefork: this process only supervises; each worker is a fork
+        // running the normal server on the socket bound here (or on its own
+        // SO_REUSEPORT socket with config.reusePort). Metrics go to a shared
+        // block, so any worker's /metrics covers the instance.
+        void runPrefork()
+        {
+            auto *shared = SharedMetrics::create();
+            if (!shared)
+            {
+                std::cerr << "⚠️  No shared memory for metrics; serving in one process\n";
+                config_.processes = 1;
+                return run();
+            }
+            stats_.shared = shared;
+
+            // With reusePort each worker binds its own TCP sockets; a Unix
+            // path can only be bound once, so then the master binds them all
+            lifecycle::Inheritance inherited;
+            std::vector<int> listeners = inherited.listeners();
+            if (!config_.reusePort || hasUnixListener() || !listeners.empty())
+            {
+                listeners = openListeners(listeners);
+                if (listeners.empty())
+                    return;
+                for (auto sock : listeners)
+                    httplib::detail::set_nonblocking(sock, true);
+            }
+
+            printStartupBanner();
+
+            Supervisor::Options options;
+            options.workers = static_cast<size_t>(processes());
+            Supervisor supervisor(options, *shared, [this, &listeners](size_t slot)
+                                  {
+                workerSlot_ = static_cast<int>(slot);
+                stats_.slot = workerSlot_;
+                inheritedListeners_ = listeners;
+                std::cout << "👷 Worker " << slot << " (pid " << getpid() << ") serving\n";
+                run();
+                std::exit(0); });
+
+            inherited.ready();
+            supervisor.run([this, &listeners]
+                           {
+                if (!config_.hotRestart)
+                    return false;
+                if (listeners.empty())
+                {
+                    std::cerr << "⚠️  Hot restart needs the shared listening sockets (reusePort is on)\n";
+                    return false;
+                }
+                std::cout << "\n🔁 Hot restart: starting a new instance...\n";
+                auto successor = lifecycle::spawnSuccessor(listeners, config_.restartTimeout);
+                if (!successor.ready)
+                {
+                    std::cerr << "⚠️  Hot restart failed (" << successor.error << "), still serving\n";
+                    return false;
+                }
+                handedOff_ = true;
+                std::cout << "🔁 Pid " << successor.pid << " took over; draining the workers\n";
+                return true; },
+                           [&listeners]
+                           {
+                // Workers close theirs as they drain: new connections are refused
+                for (auto sock : listeners)
+                    close(sock);
+                listeners.clear();
+            });
+
+            removeSocketFiles();
+            printShutdownStats();
+            std::cout << "✅ Server stopped\n";
+        }
+#endif
+
+        // On the signal watcher thread: the work runs on lifecycleThread_,
+        // so a second SIGTERM / SIGINT can cut a drain short
+        void onSignal(int signo)
+        {
+            if (signo != SIGHUP && phase_ == Phase::Draining)
+            {
+                std::cout << "⚡ Forced stop: closing remaining connections\n";
+                forceStop_ = true;
+                return;
+            }
+            if (phase_ != Phase::Serving)
+                return;
+            if (signo == SIGHUP && (!config_.hotRestart || workerSlot_ >= 0))
+                return; // prefork: the master restarts the instance
+
+            if (lifecycleThread_.joinable())
+                lifecycleThread_.join(); // a failed restart attempt
+            lifecycleThread_ = std::thread([this, signo]
+                                           { signo == SIGHUP ? (void)restart() : shutdown(); });
+        }
+#endif
+
+        // 🔥 Stop accepting, let in-flight requests finish, then close the
+        // rest. A handed-over socket stays open for the successor.
+        void drain(bool handoff)
+        {
+            std::lock_guard<std::mutex> lock(drainMutex_);
+            auto http = http_.load();
+            if (!http || phase_.exchange(Phase::Draining) == Phase::Draining)
+                return;
+
+            if (handoff && !sharesListener())
+            {
+#ifdef XPRESSPP_LIFECYCLE_SIGNALS
+                // Addresses first: stop_accepting() closes the main socket
+                std::vector<sockaddr_storage> addresses(listeners_.size());
+                std::vector<socklen_t> sizes(listeners_.size(), sizeof(sockaddr_storage));
+                for (size_t i = 0; i < listeners_.size(); i++)
+                    getsockname(listeners_[i], reinterpret_cast<sockaddr *>(&addresses[i]), &sizes[i]);
+                http->stop_accepting();
+                wakeAcceptLoop(*http, addresses, sizes);
+#endif
+            }
+            else if (handoff || sharesListener())
+                http->stop_accepting();
+            else
+                http->stop();
+
+            {
+                std::lock_guard<std::mutex> h2Lock(h2Mutex_);
+                for (auto *connection : h2Connections_)
+                    connection->drain();
+            }
+            app_.webSockets().stop(); // 1001 Going Away: clients reconnect
+
+            using Clock = std::chrono::steady_clock;
+            auto deadline = Clock::now() + std::chrono::seconds(config_.drainTimeout);
+            auto report = Clock::now() + std::chrono::seconds(1);
+            size_t left;
+            while ((left = http->connection_count()) > 0 && !forceStop_ && Clock::now() < deadline)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(20));
+                if (Clock::now() >= report)
+                {
+                    std::cout << "⏳ Waiting for " << left << " active connections...\n";
+                    report += std::chrono::seconds(1);
+                }
+            }
+            if (left > 0)
+            {
+                std::cout << "✂️  Closing " << left << " connections still open\n";
+                http->close_connections();
+            }
+        }
 
         // ========================================
         // 🔥 Helper Methods
         // ========================================
 
+        // A route's body, before its handler: multipart/form-data streams
+        // through MultipartParser (fields to memory, files to disk or
+        // config.multipart.sink), anything else is read by httplib into
+        // req.body. false = the response is an error (status set).
+        bool readBody(const httplib::Request &req, httplib::Response &res,
+                      const httplib::ContentReader &reader, MultipartForm &form)
+        {
+            auto boundary = MultipartParser::boundaryOf(req.get_header_value("Content-Type"));
+            if (boundary.empty())
+                return reader.read_body();
+
+            MultipartParser parser(boundary, config_.multipart, req.path, form);
+            bool ok = reader([&](const char *data, size_t size)
+                             { return parser.feed(data, size); }) &&
+                      parser.finish();
+            if (!ok && parser.status())
+            {
+                res.status = parser.status();
+                res.set_content(nlohmann::json{{"error", true},
+                                               {"status", parser.status()},
+                                               {"message", parser.error()}}
+                                    .dump(),
+                                "application/json");
+            }
+            return ok;
+        }
+
+        // 🔥 Fills res from the response cache or a coalesced flight; on a
+        // miss of a coalesced route, leader is set for this request to complete
+        bool replay(const Route &route, const httplib::Request &req, httplib::Response &res,
+                    SingleFlight::Leader &leader)
+        {
+            auto &cache = config_.responseCache;
+            if (cache && req.method == "GET" && cache->serve(req, res))
+                return true;
+
+            // Identical concurrent GETs on coalesced routes wait for the
+            // first one; a timeout or unshareable result runs them anyway.
+            // Credentialed requests may get per-user bytes: never shared.
+            if (req.method == "GET" && config_.coalescing.routes.count(route.path) &&
+                !ResponseCache::hasCredentials(req))
+            {
+                std::shared_ptr<SingleFlight::Flight> flight;
+                leader = coalescer_.join(coalescingKey(req), flight);
+
+                SingleFlight::Result shared;
+                if (!leader &&
+                    flight->wait(std::chrono::milliseconds(config_.coalescing.timeoutMs), shared) &&
+                    shared)
+                {
+                    SharedResponse::apply(shared, res);
+                    res.set_header("X-Coalesced", "true");
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // ========================================
+        // 🔥 Route Pipeline
+        // ========================================
+
+        using StartTime = std::chrono::high_resolution_clock::time_point;
+
+        // 🔥 Request and Response objects for a route handler
+        void buildExchange(const Route &route, const httplib::Request &req, MultipartForm &form,
+                           Request &xreq, Response &xres)
+        {
+            // ========================================
+            // 🔥 Build Request Object
+            // ========================================
+
+            // Basic info
+            xreq.method = req.method;
+            xreq.url = req.path;
+            xreq.path = req.path;
+            xreq.originalUrl = req.path;
+            xreq.httpVersion = req.version;
+            xreq.protocol = req.has_header("X-Forwarded-Proto")
+                                ? req.get_header_value("X-Forwarded-Proto")
+                                : "http";
+
+            // Generate unique request ID
+            xreq.requestId = generateRequestId();
+            xreq.startTime = std::chrono::system_clock::now();
+
+            // Query string
+            if (!req.params.empty())
+            {
+                std::ostringstream qs;
+                bool first = true;
+                for (const auto &p : req.params)
+                {
+                    if (!first)
+                        qs << '&';
+                    first = false;
+                    qs << p.first << '=' << p.second;
+                }
+                xreq.parseQuery(qs.str());
+            }
+
+            // Body: moved, httplib's request is not read after the
+            // route handler; a spilled one is shared, not copied
+            if (req.spilled_body)
+                xreq.spillBody(req.spilled_body, {req.spilled_body->data(), req.spilled_body->size()});
+            else
+                xreq.body = std::move(const_cast<httplib::Request &>(req).body);
+            xreq.contentLength = xreq.bodyView().size();
+            xreq.form = std::move(form);
+
+            // Route params
+            xreq.params = extract_params(route.path, req.path);
+
+            // Cookies
+            auto ck = req.headers.find("Cookie");
+            if (ck != req.headers.end())
+            {
+                xreq.cookies = parse_cookies(ck->second);
+            }
+
+            // Headers
+            for (auto &h : req.headers)
+                xreq.headers[h.first] = h.second;
+
+            // Extract common headers
+            xreq.userAgent = req.get_header_value("User-Agent");
+            xreq.referer = req.get_header_value("Referer");
+            xreq.hostname = req.get_header_value("Host");
+
+            // IP handling (with proxy support)
+            if (config_.trustProxy)
+            {
+                xreq.ip = req.get_header_value("X-Forwarded-For");
+                if (xreq.ip.empty())
+                    xreq.ip = req.get_header_value("X-Real-IP");
+                if (xreq.ip.empty())
+                    xreq.ip = req.remote_addr;
+
+                xreq.parseForwardedIPs();
+            }
+            else
+            {
+                xreq.ip = req.remote_addr;
+            }
+            if (req.has_peer_credentials)
+                xreq.peer = Request::PeerCredentials{req.peer_pid, req.peer_uid, req.peer_gid};
+
+            // HTTPS detection
+            xreq.secure = (xreq.protocol == "https") ||
+                          req.get_header_value("X-Forwarded-Ssl") == "on";
+
+            // Parse body
+            xreq.parseBody(config_.lazyJsonBody);
+
+            // Parse cookies
+            xreq.parseCookies();
+
+            // ========================================
+            // 🔥 Create Response Object
+            // ========================================
+
+            xres.requestId(xreq.requestId);
+            xres.setAccept(xreq.getHeader("Accept"));
+            xres.setIfNoneMatch(xreq.getHeader("If-None-Match"));
+
+            // Add server header
+            xres.setHeader("X-Powered-By", "Xpress++");
+
+            // Security headers (if enabled globally)
+            if (config_.enableCORS)
+                xres.cors();
+        }
+
+        // 🔥 Runs the middleware chain and the handler. false = the response
+        // is already complete (replayed or switching protocols)
+        bool execute(const Route &route, const httplib::Request &req, httplib::Response &res,
+                     Request &xreq, Response &xres, SingleFlight::Leader &leader, StartTime startTime)
+        {
+            // ========================================
+            // 🔥 Execute Handler
+            // ========================================
+
+            // Middleware chain, then the handler (or a replay of
+            // a cached or coalesced response in its place)
+            if (!route.chain.empty())
+            {
+                bool replayed = false;
+                Handler terminal = [&](Request &rq, Response &rs)
+                {
+                    if (replay(route, req, res, leader))
+                        replayed = true;
+                    else
+                        route.handler(rq, rs);
+                };
+                Next next(route, terminal, xreq, xres);
+                next();
+
+                if (replayed)
+                {
+                    // Headers set by the middleware win over the stored ones
+                    for (auto &h : xres.getHeaders())
+                    {
+                        auto rng = res.headers.equal_range(h.first);
+                        res.headers.erase(rng.first, rng.second);
+                        res.set_header(h.first.c_str(), h.second.c_str());
+                    }
+                    recordReplay(req, res, startTime);
+                    return false;
+                }
+            }
+            else
+            {
+                Next next(route, xreq, xres);
+                next();
+            }
+
+            // ========================================
+            // 🔥 Protocol switch (WebSocket)
+            // ========================================
+
+            // httplib writes the 101 head, then hands the socket
+            // and any bytes read past the request to the handler
+            if (xres.getStatus() == 101 && xres.hasUpgrade())
+            {
+                res.status = 101;
+                for (auto &h : xres.getHeaders())
+                    res.set_header(h.first.c_str(), h.second.c_str());
+
+                res.upgrade_handler = [upgrade = xres.getUpgrade()](httplib::Stream &strm)
+                {
+                    upgrade(static_cast<std::intptr_t>(strm.socket()),
+                            std::string(strm.read_buffer_data(), strm.read_buffer_size()));
+                };
+
+                if (config_.enableMetrics)
+                    stats_.recordRequest(req.method, req.path, 101,
+                                         std::chrono::duration<double, std::milli>(
+                                             std::chrono::high_resolution_clock::now() - startTime)
+                                             .count());
+                return false;
+            }
+
+            return true;
+        }
+
+        // 🔥 httplib's response from the handler's: conditional GET, headers,
+        // compression, response cache and metrics
+        void respond(const Route &route, const httplib::Request &req, httplib::Response &res,
+                     Request &xreq, Response &xres, SingleFlight::Leader &leader, StartTime startTime)
+        {
+            // ========================================
+            // 🔥 Conditional GET (before any body bytes go out)
+            // ========================================
+
+            if ((req.method == "GET" || req.method == "HEAD") && xres.getStatus() == 200 &&
+                !xres.hasStreamProvider())
+            {
+                if (config_.autoETag && !xres.hasHeader("ETag"))
+                    xres.setHeader("ETag", etag::strong(xres.getBody()));
+
+                if (xreq.isFresh(xres.getHeader("ETag"), xres.getHeader("Last-Modified")))
+                    xres.notModified();
+            }
+
+            // ========================================
+            // 🔥 Build HTTP Response
+            // ========================================
+
+            res.status = xres.getStatus();
+
+            for (auto &h : xres.getHeaders())
+                res.set_header(h.first.c_str(), h.second.c_str());
+
+            bool streaming = xres.hasStreamProvider();
+            bool compressible = isCompressible(route, req, xres);
+            ContentEncoding encoding = ContentEncoding::Identity;
+            if (compressible && (streaming || xres.getBody().size() >= config_.compression.minSize))
+                encoding = compression::negotiate(req.get_header_value("Accept-Encoding"));
+
+            if (compressible)
+            {
+                auto vary = res.headers.find("Vary");
+                if (vary == res.headers.end())
+                    res.set_header("Vary", "Accept-Encoding");
+                else
+                    vary->second += ", Accept-Encoding";
+            }
+
+            if (encoding != ContentEncoding::Identity)
+            {
+                // Lengths set by the handler (sendFile...) describe the raw body
+                auto rng = res.headers.equal_range("Content-Length");
+                res.headers.erase(rng.first, rng.second);
+            }
+
+            if (streaming)
+            {
+                // Chunked output: the provider runs once httplib starts writing
+                for (auto *name : {"Content-Type", "Content-Length", "Transfer-Encoding"})
+                {
+                    auto rng = res.headers.equal_range(name);
+                    res.headers.erase(rng.first, rng.second);
+                }
+
+                if (encoding != ContentEncoding::Identity)
+                {
+                    res.set_header("Content-Encoding", compression::token(encoding));
+                    tagEncoding(res);
+                }
+
+                auto provider = xres.getStreamProvider();
+                res.set_chunked_content_provider(
+                    xres.getContentType(),
+                    [this, provider, encoding](size_t, httplib::DataSink &sink)
+                    {
+                        Response::StreamWriter write = [&sink](const char *data, size_t length)
+                        { return sink.write(data, length); };
+
+                        if (encoding == ContentEncoding::Identity)
+                        {
+                            if (!provider(write))
+                                return false;
+                        }
+                        else
+                        {
+                            // Each provider write is compressed and flushed as it arrives
+                            StreamCompressor compressor(encoding, config_.compression);
+                            Response::StreamWriter compressed = [&](const char *data, size_t length)
+                            { return compressor.write(data, length, write); };
+
+                            if (!compressor.valid() || !provider(compressed) || !compressor.finish(write))
+                                return false;
+                        }
+
+                        sink.done();
+                        return true;
+                    });
+            }
+            else
+            {
+                res.set_content(xres.getBody(), xres.getContentType().c_str());
+
+                bool encoded = compressible && compressWithDictionary(route, req, res);
+                if (!encoded && encoding != ContentEncoding::Identity &&
+                    compression::compressBody(encoding, config_.compression, res.body))
+                    res.set_header("Content-Encoding", compression::token(encoding));
+
+                if (res.has_header("Content-Encoding"))
+                    tagEncoding(res);
+            }
+
+            auto &cache = config_.responseCache;
+            if (cache && req.method == "GET" && !streaming && xres.getServerCacheTtl() > 0 && res.status == 200)
+            {
+                bool varyEncoding = compressible && xres.getBody().size() >= config_.compression.minSize;
+                cache->store(req, res, xres.getServerCacheTtl(), xres.getSurrogateKeys(), varyEncoding,
+                             xres.isServerCacheShared());
+                res.set_header("X-Cache", "MISS");
+            }
+
+            if (leader)
+                leader.complete(streaming || res.status >= 500 ? nullptr : SharedResponse::capture(res));
+
+            // ========================================
+            // 🔥 Record Metrics
+            // ========================================
+
+            if (config_.enableMetrics)
+            {
+                auto endTime = std::chrono::high_resolution_clock::now();
+                auto duration = std::chrono::duration<double, std::milli>(endTime - startTime).count();
+
+                stats_.recordRequest(req.method, req.path, res.status, duration);
+
+                // Add timing header
+                res.set_header("X-Response-Time", std::to_string(duration) + "ms");
+            }
+        }
+
+        // 🔥 The error response for the exception being handled
+        void respondError(const httplib::Request &req, httplib::Response &res)
+        {
+            try
+            {
+                throw;
+            }
+            catch (const BindError &e)
+            {
+                nlohmann::json errorJson = {
+                    {"error", true},
+                    {"status", 400},
+                    {"message", "Invalid request body"},
+                    {"pointer", e.pointer()},
+                    {"details", e.message()}};
+
+                res.status = 400;
+                res.set_content(errorJson.dump(), "application/json");
+            }
+            catch (const std::exception &e)
+            {
+                std::cerr << "[Server Error] " << req.method << " " << req.path
+                          << " - " << e.what() << std::endl;
+
+                nlohmann::json errorJson = {
+                    {"error", true},
+                    {"status", 500},
+                    {"message", "Internal Server Error"},
+                    {"details", e.what()}};
+
+                res.status = 500;
+                res.set_content(errorJson.dump(), "application/json");
+
+                if (config_.enableMetrics)
+                    stats_.recordError();
+            }
+        }
+
+        // An async route's request, kept while its response is suspended
+        struct Exchange
+        {
+            Request xreq;
+            Response xres;
+            SingleFlight::Leader leader;
+            StartTime startTime;
+            async_detail::Suspension suspension;
+            std::unique_ptr<RequestStats::ActiveRequest> active; // while suspended
+        };
+
+        // 🔥 An async route on a connection httplib can suspend
+        // fromAsync leaves its completion in the exchange instead of
+        // blocking. If the handler returns before done(), the worker goes
+        // back to the pool and the connection waits on no thread; the
+        // worker that resumes it once done() is called finishes the response.
+        void serveAsync(const Route &route, const httplib::Request &req, httplib::Response &res,
+                        MultipartForm &form, SingleFlight::Leader &leader, StartTime startTime)
+        {
+            auto exchange = std::make_shared<Exchange>();
+            exchange->leader = std::move(leader);
+            exchange->startTime = startTime;
+            buildExchange(route, req, form, exchange->xreq, exchange->xres);
+
+            bool complete;
+            try
+            {
+                async_detail::SuspensionScope scope(&exchange->suspension);
+                complete = execute(route, req, res, exchange->xreq, exchange->xres, exchange->leader, startTime);
+            }
+            catch (...)
+            {
+                // A timer or thread may still hold done and write to xres
+                if (auto &completion = exchange->suspension.completion)
+                    completion->then([exchange] {});
+                throw;
+            }
+
+            auto &completion = exchange->suspension.completion;
+            if (complete && completion && !completion->isDone())
+            {
+                exchange->active = std::make_unique<RequestStats::ActiveRequest>(stats_);
+                res.suspend_handler = [exchange](std::function<void()> resume)
+                { exchange->suspension.completion->then(std::move(resume)); };
+                res.resume_handler = [this, &route, exchange](const httplib::Request &req, httplib::Response &res)
+                {
+                    try
+                    {
+                        if (auto error = exchange->suspension.completion->error)
+                            std::rethrow_exception(error);
+                        respond(route, req, res, exchange->xreq, exchange->xres, exchange->leader,
+                                exchange->startTime);
+                    }
+                    catch (const std::exception &)
+                    {
+                        respondError(req, res);
+                    }
+                    exchange->active.reset();
+                };
+                return;
+            }
+
+            if (completion && completion->error)
+                std::rethrow_exception(completion->error);
+            if (complete)
+                respond(route, req, res, exchange->xreq, exchange->xres, exchange->leader, startTime);
+        }
+
+        // 🔥 Metrics for responses replayed without running the handler
+        template <typename TimePoint>
+        void recordReplay(const httplib::Request &req, httplib::Response &res, TimePoint startTime)
+        {
+            if (!config_.enableMetrics)
+                return;
+
+            auto duration = std::chrono::duration<double, std::milli>(
+                                std::chrono::high_resolution_clock::now() - startTime)
+                                .count();
+            stats_.recordRequest(req.method, req.path, res.status, duration);
+            res.set_header("X-Response-Time", std::to_string(duration) + "ms");
+        }
+
+        // Requests only share a response when they would get the same bytes
+        static std::string coalescingKey(const httplib::Request &req)
+        {
+            return req.get_header_value("Host") + '\n' + req.target + '\n' +
+                   req.get_header_value("Accept-Encoding") + '\n' +
+                   req.get_header_value("Accept") + '\n' + req.get_header_value("If-None-Match") + '\n' +
+                   req.get_header_value("If-Modified-Since");
+        }
+
+        // A strong ETag names one representation: compressed variants get
+        // "-gzip" etc. (etag::noneMatch ignores the suffix when validating)
+        static void tagEncoding(httplib::Response &res)
+        {
+            auto it = res.headers.find("ETag");
+            if (it == res.headers.end())
+                return;
+
+            auto &tag = it->second;
+            if (tag.size() < 2 || tag[0] == 'W' || tag.back() != '"')
+                return;
+            tag.insert(tag.size() - 1, "-" + res.get_header_value("Content-Encoding"));
+        }
+
+        // 🔥 Compression eligibility: response override > route policy >
+        // global flag, then status and content type. Size and the client's
+        // Accept-Encoding are applied by the caller.
+        bool isCompressible(const Route &route, const httplib::Request &req, const Response &xres)
+        {
+            const auto &policy = config_.compression;
+
+            bool enabled = config_.enableCompression;
+            auto routeRule = policy.routes.find(route.path);
+            if (routeRule != policy.routes.end())
+                enabled = routeRule->second;
+            if (xres.hasCompressionOverride())
+                enabled = xres.isCompressionEnabled();
+            if (!enabled)
+                return false;
+
+            int status = xres.getStatus();
+            if (status == 204 || status == 304 || req.method == "HEAD" || xres.hasHeader("Content-Encoding"))
+                return false;
+
+            const auto &ctype = xres.getContentType();
+            if (policy.isCompressedType(ctype))
+                return false;
+            return xres.hasCompressionOverride() || policy.isCompressibleType(ctype);
+        }
+
+        // 🔥 Small bodies: feed the route's dictionary trainer and, for
+        // clients that opted in with "zdict", compress with the dictionary.
+        // Dictionaries are public (/_xpresspp/dict/<id>), so per-user
+        // responses are never sampled: the same gate as the response cache.
+        bool compressWithDictionary(const Route &route, const httplib::Request &req, httplib::Response &res)
+        {
+#ifdef XPRESSPP_ZSTD_SUPPORT
+            if (!dictionaries_ || res.body.size() > config_.compression.dictionary.maxBodySize)
+                return false;
+
+            if (!ResponseCache::hasCredentials(req) && !ResponseCache::isPrivate(res))
+                dictionaries_->sample(route.path, res.body);
+
+            if (compression::qValue(req.get_header_value("Accept-Encoding"), ZstdDictionaryStore::token) <= 0)
+                return false;
+
+            auto dictionary = dictionaries_->forRoute(route.path);
+            if (!dictionary || !ZstdDictionaryStore::compress(*dictionary, res.body))
+                return false;
+
+            auto rng = res.headers.equal_range("Content-Length");
+            res.headers.erase(rng.first, rng.second);
+            res.set_header("Content-Encoding", ZstdDictionaryStore::token);
+            res.set_header("X-Zstd-Dictionary", std::to_string(dictionary->id));
+            return true;
+#else
+            (void)route;
+            (void)req;
+            (void)res;
+            return false;
+#endif
+        }
+
         void printStartupBanner()
         {
             std::cout << "\n";
@@ -547,17 +1721,21 @@ namespace xpresspp
             std::cout << "╚════════════════════════════════════════╝\n";
             std::cout << "\n";
             std::cout << "📡 Protocol:  " << (config_.enableSSL ? "HTTPS" : "HTTP") << "\n";
-            std::cout << "🌐 Host:      " << config_.host << "\n";
-            std::cout << "🔌 Port:      " << config_.port << "\n";
-            std::cout << "👥 Threads:   " << config_.threadPoolSize << "\n";
+            if (config_.listeners.empty())
+            {
+                std::cout << "🌐 Host:      " << config_.host << "\n";
+                std::cout << "🔌 Port:      " << config_.port << "\n";
+            }
+            std::cout << "👥 Threads:   " << config_.threadPoolSize
+                      << (processes() > 1 ? " × " + std::to_string(processes()) + " processes" : "") << "\n";
             std::cout << "📊 Logging:   " << (config_.enableLogging ? "✓" : "✗") << "\n";
             std::cout << "📈 Metrics:   " << (config_.enableMetrics ? "✓" : "✗") << "\n";
             std::cout << "🔐 CORS:      " << (config_.enableCORS ? "✓" : "✗") << "\n";
             std::cout << "\n";
 
             std::cout << "📍 Endpoints:\n";
-            std::cout << "   • " << (config_.enableSSL ? "https://" : "http://")
-                      << config_.host << ":" << config_.port << "\n";
+            for (auto &listener : configuredListeners())
+                std::cout << "   • " << listener.url(config_.enableSSL) << "\n";
             std::cout << "   • Health: /health\n";
             if (config_.enableMetrics)
                 std::cout << "   • Metrics: /metrics\n";
@@ -577,12 +1755,22 @@ namespace xpresspp
 
         void printShutdownStats()
         {
+            uint64_t total = stats_.totalRequests, success = stats_.successRequests, errors = stats_.errorRequests;
+            double avg = stats_.avgResponseTime;
+            if (stats_.shared) // prefork master: the whole instance
+            {
+                total = stats_.shared->total;
+                success = stats_.shared->success;
+                errors = stats_.shared->error;
+                avg = total ? stats_.shared->durationMicros / 1000.0 / total : 0.0;
+            }
+
             std::cout << "\n📊 Final Statistics:\n";
-            std::cout << "   Total Requests:   " << stats_.totalRequests << "\n";
-            std::cout << "   Success:          " << stats_.successRequests << "\n";
-            std::cout << "   Errors:           " << stats_.errorRequests << "\n";
+            std::cout << "   Total Requests:   " << total << "\n";
+            std::cout << "   Success:          " << success << "\n";
+            std::cout << "   Errors:           " << errors << "\n";
             std::cout << "   Avg Response:     " << std::fixed << std::setprecision(2)
-                      << stats_.avgResponseTime << "ms\n";
+                      << avg << "ms\n";
             std::cout << "   Uptime:           " << getUptime() << "\n\n";
         }
 
@@ -695,12 +1883,47 @@ namespace xpresspp
             nlohmann::json metrics = {
                 {"uptime", getUptime()},
                 {"timestamp", getCurrentTimestamp()},
-                {"requests", {{"total", stats_.totalRequests.load()}, {"success", stats_.successRequests.load()}, {"error", stats_.errorRequests.load()}, {"active", stats_.activeConnections.load()}}},
+                {"requests", {{"total", stats_.totalRequests.load()}, {"success", stats_.successRequests.load()}, {"error", stats_.errorRequests.load()}, {"active", stats_.activeRequests.load()}}},
+                {"connections", activeConnections()},
                 {"performance", {{"avgResponseTime", stats_.avgResponseTime}}},
                 {"statusCodes", stats_.statusCodes},
                 {"methods", stats_.methodCounts},
                 {"topPaths", stats_.pathCounts}};
 
+            if (config_.responseCache)
+                metrics["cache"] = config_.responseCache->statsJSON();
+
+            if (!config_.coalescing.routes.empty())
+                metrics["coalescing"] = {
+                    {"executions", coalescer_.executions()},
+                    {"coalesced", coalescer_.coalesced()}};
+
+            if (rateLimiter_)
+                metrics["rateLimit"] = rateLimiter_->statsJSON();
+
+            // Receive / send buffers, pooled across connections: an idle
+            // keep-alive connection holds none
+            auto buffers = httplib::detail::BufferPool::instance().stats();
+            auto connections = activeConnections();
+            metrics["buffers"] = {
+                {"inUse", buffers.in_use},
+                {"inUseBytes", buffers.in_use_bytes},
+                {"perConnectionBytes", connections ? buffers.in_use_bytes / connections : 0},
+                {"freeBytes", buffers.free_bytes},
+                {"slabBytes", buffers.slab_bytes},
+                {"allocations", buffers.allocations},
+                {"reuses", buffers.reuses}};
+
+            // Prefork: instance-wide totals; topPaths, cache and the rest
+            // stay this worker's
+#ifdef XPRESSPP_PREFORK
+            if (stats_.shared)
+            {
+                metrics.update(stats_.shared->toJSON());
+                metrics["worker"] = {{"slot", stats_.slot}, {"pid", static_cast<int64_t>(getpid())}};
+            }
+#endif
+
             return metrics;
         }
     };
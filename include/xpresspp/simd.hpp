@@ -0,0 +1,53 @@
+#pragma once
+#include <cstdint>
+
+// SIMD used by the byte scanners (JSON, request heads, multipart, WebSocket
+// masks, ETag hashing, rate limiter buckets). XPRESSPP_AVX2 marks 32-byte
+// paths; XPRESSPP_SSE2 is set whenever 16-byte SSE2 is available, AVX2
+// builds included, so `#if AVX2 ... #elif SSE2` and a 16-byte tail under
+// `#ifdef XPRESSPP_SSE2` both work.
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define XPRESSPP_AVX2 1
+#endif
+
+#if defined(__SSE2__) || defined(__AVX2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define XPRESSPP_SSE2 1
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace xpresspp
+{
+    namespace simd
+    {
+        // Index of the lowest set bit; mask must not be 0
+        inline unsigned lowestBit(uint32_t mask)
+        {
+#if defined(_MSC_VER) && !defined(__clang__)
+            unsigned long index;
+            _BitScanForward(&index, mask);
+            return static_cast<unsigned>(index);
+#else
+            return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+        }
+
+        inline unsigned lowestBit(uint64_t mask)
+        {
+#if defined(_MSC_VER) && !defined(__clang__) && (defined(_M_X64) || defined(_M_ARM64))
+            unsigned long index;
+            _BitScanForward64(&index, mask);
+            return static_cast<unsigned>(index);
+#elif defined(_MSC_VER) && !defined(__clang__)
+            auto low = static_cast<uint32_t>(mask);
+            return low ? lowestBit(low) : 32 + lowestBit(static_cast<uint32_t>(mask >> 32));
+#else
+            return static_cast<unsigned>(__builtin_ctzll(mask));
+#endif
+        }
+    }
+}
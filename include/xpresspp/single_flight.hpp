@@ -0,0 +1,214 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <chrono>
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+#include "httplib.h"
+
+namespace xpresspp
+{
+    // 🔥 Per-route request coalescing (ServerConfig::coalescing)
+    struct CoalescingConfig
+    {
+        std::unordered_set<std::string> routes; // route templates ("/api/report"); requests with
+                                                // Authorization or Cookie always run alone
+        int timeoutMs = 5000;                   // followers then run the handler themselves
+    };
+
+    // 🔥 A finished response that can be replayed to other requests
+    struct SharedResponse
+    {
+        int status = 200;
+        std::string contentType;
+        std::vector<std::pair<std::string, std::string>> headers;
+        std::string body;
+
+        // Per-request and framing headers are left to each replay
+        static std::shared_ptr<const SharedResponse> capture(const httplib::Response &res)
+        {
+            if (res.has_header("Set-Cookie"))
+                return nullptr; // never fan one client's session out to others
+
+            auto shared = std::make_shared<SharedResponse>();
+            shared->status = res.status;
+            shared->contentType = res.get_header_value("Content-Type");
+            shared->body = res.body;
+            for (auto &h : res.headers)
+            {
+                if (h.first == "Content-Type" || h.first == "Content-Length" || h.first == "X-Request-ID" ||
+                    h.first == "X-Response-Time" ||
+                    h.first.compare(0, 12, "X-RateLimit-") == 0)
+                    continue;
+                shared->headers.emplace_back(h.first, h.second);
+            }
+            return shared;
+        }
+
+        static void apply(const std::shared_ptr<const SharedResponse> &shared, httplib::Response &res)
+        {
+            res.status = shared->status;
+            for (auto &h : shared->headers)
+                res.set_header(h.first, h.second);
+
+            if (shared->body.empty())
+                res.set_content("", shared->contentType);
+            else
+                res.set_content_provider(
+                    shared->body.size(), shared->contentType,
+                    [shared](size_t offset, size_t length, httplib::DataSink &sink)
+                    { return sink.write(shared->body.data() + offset, length); });
+        }
+    };
+
+    // 🔥 Single-flight: one execution per key, everyone else shares it
+    // The first request for a key becomes the leader and runs the handler;
+    // concurrent requests for the same key either block on wait() (worker
+    // threads) or register onComplete() (async handlers). A null result —
+    // error, streamed or cookie-carrying response, leader gone — tells
+    // followers to run the handler independently.
+    class SingleFlight
+    {
+    public:
+        using Result = std::shared_ptr<const SharedResponse>;
+        using Callback = std::function<void(const Result &)>;
+
+        class Flight
+        {
+        public:
+            bool wait(std::chrono::milliseconds timeout, Result &out)
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                if (!cv_.wait_for(lock, timeout, [this]
+                                  { return done_; }))
+                    return false;
+                out = result_;
+                return true;
+            }
+
+            void onComplete(Callback callback)
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                if (!done_)
+                {
+                    callbacks_.push_back(std::move(callback));
+                    return;
+                }
+                lock.unlock();
+                callback(result_);
+            }
+
+        private:
+            friend class SingleFlight;
+
+            std::mutex mutex_;
+            std::condition_variable cv_;
+            bool done_ = false;
+            Result result_;
+            std::vector<Callback> callbacks_;
+
+            void finish(Result result)
+            {
+                std::vector<Callback> callbacks;
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    if (done_)
+                        return;
+                    done_ = true;
+                    result_ = std::move(result);
+                    callbacks.swap(callbacks_);
+                }
+                cv_.notify_all();
+                for (auto &callback : callbacks)
+                    callback(result_);
+            }
+        };
+
+        // Held by the leader; completes with null if it never calls complete()
+        class Leader
+        {
+        public:
+            Leader() = default;
+            Leader(SingleFlight *group, std::string key, std::shared_ptr<Flight> flight)
+                : group_(group), key_(std::move(key)), flight_(std::move(flight)) {}
+
+            Leader(const Leader &) = delete;
+            Leader &operator=(const Leader &) = delete;
+
+            Leader(Leader &&other) noexcept { *this = std::move(other); }
+            Leader &operator=(Leader &&other) noexcept
+            {
+                if (this != &other)
+                {
+                    complete(nullptr);
+                    group_ = other.group_;
+                    key_ = std::move(other.key_);
+                    flight_ = std::move(other.flight_);
+                    other.group_ = nullptr;
+                }
+                return *this;
+            }
+
+            ~Leader() { complete(nullptr); }
+
+            explicit operator bool() const { return group_ != nullptr; }
+
+            void complete(Result result)
+            {
+                if (!group_)
+                    return;
+                group_->finish(key_, flight_, std::move(result));
+                group_ = nullptr;
+            }
+
+        private:
+            SingleFlight *group_ = nullptr;
+            std::string key_;
+            std::shared_ptr<Flight> flight_;
+        };
+
+        // Returns a Leader when this caller must execute; otherwise `flight`
+        // is the in-flight execution to wait on
+        Leader join(const std::string &key, std::shared_ptr<Flight> &flight)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = inFlight_.find(key);
+            if (it != inFlight_.end())
+            {
+                flight = it->second;
+                coalesced_++;
+                return {};
+            }
+
+            flight = std::make_shared<Flight>();
+            inFlight_.emplace(key, flight);
+            executions_++;
+            return Leader(this, key, flight);
+        }
+
+        uint64_t executions() const { return executions_.load(); }
+        uint64_t coalesced() const { return coalesced_.load(); }
+
+    private:
+        std::mutex mutex_;
+        std::unordered_map<std::string, std::shared_ptr<Flight>> inFlight_;
+        std::atomic<uint64_t> executions_{0};
+        std::atomic<uint64_t> coalesced_{0};
+
+        void finish(const std::string &key, const std::shared_ptr<Flight> &flight, Result result)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                auto it = inFlight_.find(key);
+                if (it != inFlight_.end() && it->second == flight)
+                    inFlight_.erase(it);
+            }
+            flight->finish(std::move(result));
+        }
+    };
+}
@@ -0,0 +1,1945 @@
+#pragma once
+#include <algorithm>
+#include <any>
+#include <array>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "compression.hpp" // XPRESSPP_ZLIB_SUPPORT, <zlib.h>
+#include "request.hpp"
+#include "response.hpp"
+
+#if !defined(_WIN32)
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#define XPRESSPP_WEBSOCKET_LOOP 1
+#if defined(__linux__)
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#define XPRESSPP_WEBSOCKET_EPOLL 1
+#endif
+#endif
+
+#include "simd.hpp"
+
+namespace xpresspp
+{
+    namespace websocket
+    {
+        // Frame opcodes (RFC 6455 5.2)
+        namespace opcode
+        {
+            constexpr uint8_t Continuation = 0x0;
+            constexpr uint8_t Text = 0x1;
+            constexpr uint8_t Binary = 0x2;
+            constexpr uint8_t Close = 0x8;
+            constexpr uint8_t Ping = 0x9;
+            constexpr uint8_t Pong = 0xa;
+        }
+
+        // Close status codes (RFC 6455 7.4.1)
+        namespace closeCode
+        {
+            constexpr int Normal = 1000;
+            constexpr int GoingAway = 1001;
+            constexpr int ProtocolError = 1002;
+            constexpr int UnsupportedData = 1003;
+            constexpr int NoStatus = 1005; // reported only: the close frame had no code
+            constexpr int Abnormal = 1006; // reported only: no close frame at all
+            constexpr int InvalidPayload = 1007;
+            constexpr int PolicyViolation = 1008;
+            constexpr int MessageTooBig = 1009;
+            constexpr int InternalError = 1011;
+        }
+
+        // 🔥 Per-route connection limits and compression
+        struct Options
+        {
+            size_t maxMessageSize = 16 * 1024 * 1024;  // after inflating; 1009 beyond
+            int idleTimeout = 120;                     // seconds: ping after half, drop after all; 0 = off
+            size_t maxBackpressure = 16 * 1024 * 1024; // queued outbound bytes; sends beyond are dropped
+            bool compression = true;                   // permessage-deflate when offered (zlib builds)
+            int compressionLevel = 6;
+            int compressionWindowBits = 13; // server_max_window_bits: deflate state ~2^(bits+3) bytes
+            size_t compressMinSize = 64;    // smaller messages go out uncompressed
+        };
+
+        class WebSocket;
+
+        // 🔥 A WebSocket route: callbacks plus options
+        // open runs on the HTTP worker that accepted the handshake, before
+        // the connection moves to its event loop (the upgrade Request is only
+        // available there); message and close run on that loop, never
+        // concurrently for one connection. Callbacks must not block: a
+        // loop serves thousands of connections.
+        struct Behavior
+        {
+            std::function<void(WebSocket &ws, Request &req)> open;
+            std::function<void(WebSocket &ws, std::string_view message, bool binary)> message;
+            std::function<void(WebSocket &ws, int code, std::string_view reason)> close;
+            std::vector<std::string> protocols; // Sec-WebSocket-Protocol values, in preference order
+            Options options;
+        };
+
+        namespace ws_detail
+        {
+            // XORs data with the 4-byte masking key, 32/16/8 bytes at a time
+            // (AVX2/SSE2/scalar). Every step is a multiple of 4, so the key
+            // stays aligned with the payload offset.
+            inline void applyMask(char *data, size_t length, const uint8_t key[4])
+            {
+                uint32_t key32;
+                std::memcpy(&key32, key, 4);
+                size_t i = 0;
+#if defined(XPRESSPP_AVX2)
+                const __m256i mask256 = _mm256_set1_epi32(static_cast<int>(key32));
+                for (; i + 32 <= length; i += 32)
+                {
+                    auto *p = reinterpret_cast<__m256i *>(data + i);
+                    _mm256_storeu_si256(p, _mm256_xor_si256(_mm256_loadu_si256(p), mask256));
+                }
+#endif
+#if defined(XPRESSPP_SSE2)
+                const __m128i mask128 = _mm_set1_epi32(static_cast<int>(key32));
+                for (; i + 16 <= length; i += 16)
+                {
+                    auto *p = reinterpret_cast<__m128i *>(data + i);
+                    _mm_storeu_si128(p, _mm_xor_si128(_mm_loadu_si128(p), mask128));
+                }
+#endif
+                const uint64_t key64 = (static_cast<uint64_t>(key32) << 32) | key32;
+                for (; i + 8 <= length; i += 8)
+                {
+                    uint64_t word;
+                    std::memcpy(&word, data + i, 8);
+                    word ^= key64;
+                    std::memcpy(data + i, &word, 8);
+                }
+                for (; i < length; i++)
+                    data[i] = static_cast<char>(data[i] ^ key[i & 3]);
+            }
+
+            inline std::array<uint8_t, 20> sha1(std::string_view input)
+            {
+                uint32_t h[5] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0};
+                auto rotl = [](uint32_t x, int n)
+                { return (x << n) | (x >> (32 - n)); };
+
+                std::string data(input);
+                data += static_cast<char>(0x80);
+                while (data.size() % 64 != 56)
+                    data += '\0';
+                uint64_t bits = static_cast<uint64_t>(input.size()) * 8;
+                for (int i = 7; i >= 0; i--)
+                    data += static_cast<char>((bits >> (i * 8)) & 0xff);
+
+                for (size_t chunk = 0; chunk < data.size(); chunk += 64)
+                {
+                    uint32_t w[80];
+                    for (int i = 0; i < 16; i++)
+                    {
+                        auto *p = reinterpret_cast<const unsigned char *>(data.data() + chunk + i * 4);
+                        w[i] = (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | p[3];
+                    }
+                    for (int i = 16; i < 80; i++)
+                        w[i] = rotl(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+
+                    uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+                    for (int i = 0; i < 80; i++)
+                    {
+                        uint32_t f, k;
+                        if (i < 20)
+                            f = (b & c) | (~b & d), k = 0x5a827999;
+                        else if (i < 40)
+                            f = b ^ c ^ d, k = 0x6ed9eba1;
+                        else if (i < 60)
+                            f = (b & c) | (b & d) | (c & d), k = 0x8f1bbcdc;
+                        else
+                            f = b ^ c ^ d, k = 0xca62c1d6;
+                        uint32_t t = rotl(a, 5) + f + e + k + w[i];
+                        e = d, d = c, c = rotl(b, 30), b = a, a = t;
+                    }
+                    h[0] += a, h[1] += b, h[2] += c, h[3] += d, h[4] += e;
+                }
+
+                std::array<uint8_t, 20> digest;
+                for (int i = 0; i < 20; i++)
+                    digest[i] = static_cast<uint8_t>(h[i / 4] >> (24 - (i % 4) * 8));
+                return digest;
+            }
+
+            inline std::string base64Encode(const uint8_t *data, size_t length)
+            {
+                static const char table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+                std::string out;
+                out.reserve((length + 2) / 3 * 4);
+                for (size_t i = 0; i < length; i += 3)
+                {
+                    uint32_t n = uint32_t(data[i]) << 16;
+                    if (i + 1 < length)
+                        n |= uint32_t(data[i + 1]) << 8;
+                    if (i + 2 < length)
+                        n |= data[i + 2];
+                    out += table[(n >> 18) & 63];
+                    out += table[(n >> 12) & 63];
+                    out += i + 1 < length ? table[(n >> 6) & 63] : '=';
+                    out += i + 2 < length ? table[n & 63] : '=';
+                }
+                return out;
+            }
+
+            // Sec-WebSocket-Key: base64 of 16 bytes
+            inline bool isValidKey(std::string_view key)
+            {
+                if (key.size() != 24 || key[22] != '=' || key[23] != '=')
+                    return false;
+                return std::all_of(key.begin(), key.begin() + 22, [](char c)
+                                   { return std::isalnum(static_cast<unsigned char>(c)) || c == '+' || c == '/'; });
+            }
+
+            // UTF-8 as RFC 3629 defines it: no overlongs, surrogates or
+            // code points above U+10FFFF. ASCII runs go 8 bytes at a time.
+            inline bool isValidUtf8(const char *text, size_t length)
+            {
+                auto *p = reinterpret_cast<const unsigned char *>(text);
+                auto *end = p + length;
+                while (p < end)
+                {
+                    while (end - p >= 8)
+                    {
+                        uint64_t word;
+                        std::memcpy(&word, p, 8);
+                        if (word & 0x8080808080808080ull)
+                            break;
+                        p += 8;
+                    }
+                    if (p == end)
+                        break;
+                    if (*p < 0x80)
+                    {
+                        p++;
+                        continue;
+                    }
+
+                    size_t extra;
+                    uint32_t cp, min;
+                    if ((*p & 0xe0) == 0xc0)
+                        extra = 1, cp = *p & 0x1f, min = 0x80;
+                    else if ((*p & 0xf0) == 0xe0)
+                        extra = 2, cp = *p & 0x0f, min = 0x800;
+                    else if ((*p & 0xf8) == 0xf0)
+                        extra = 3, cp = *p & 0x07, min = 0x10000;
+                    else
+                        return false;
+                    if (static_cast<size_t>(end - p) <= extra)
+                        return false;
+                    for (size_t i = 1; i <= extra; i++)
+                    {
+                        if ((p[i] & 0xc0) != 0x80)
+                            return false;
+                        cp = (cp << 6) | (p[i] & 0x3f);
+                    }
+                    if (cp < min || cp > 0x10ffff || (cp >= 0xd800 && cp <= 0xdfff))
+                        return false;
+                    p += extra + 1;
+                }
+                return true;
+            }
+
+            struct FrameHeader
+            {
+                bool fin = false;
+                bool rsv1 = false;     // permessage-deflate: compressed message
+                bool reserved = false; // RSV2 / RSV3
+                bool masked = false;
+                uint8_t opcode = 0;
+                uint8_t key[4] = {};
+                uint64_t length = 0;
+            };
+
+            // Header length, or 0 while the header is incomplete
+            inline size_t parseFrameHeader(const char *data, size_t size, FrameHeader &header)
+            {
+                if (size < 2)
+                    return 0;
+                auto *p = reinterpret_cast<const unsigned char *>(data);
+                header.fin = p[0] & 0x80;
+                header.rsv1 = p[0] & 0x40;
+                header.reserved = p[0] & 0x30;
+                header.opcode = p[0] & 0x0f;
+                header.masked = p[1] & 0x80;
+
+                uint8_t length7 = p[1] & 0x7f;
+                size_t need = 2 + (length7 == 126 ? 2 : length7 == 127 ? 8 : 0) + (header.masked ? 4 : 0);
+                if (size < need)
+                    return 0;
+
+                size_t at = 2;
+                header.length = length7;
+                if (length7 >= 126)
+                {
+                    size_t bytes = length7 == 126 ? 2 : 8;
+                    header.length = 0;
+                    for (size_t i = 0; i < bytes; i++)
+                        header.length = (header.length << 8) | p[at++];
+                }
+                if (header.masked)
+                    std::memcpy(header.key, p + at, 4);
+                return need;
+            }
+
+            inline void appendFrameHeader(std::string &out, uint8_t op, size_t length, bool rsv1 = false,
+                                          const uint8_t *key = nullptr, bool fin = true)
+            {
+                out += static_cast<char>((fin ? 0x80 : 0) | (rsv1 ? 0x40 : 0) | op);
+                uint8_t maskBit = key ? 0x80 : 0;
+                if (length < 126)
+                    out += static_cast<char>(maskBit | length);
+                else if (length <= 0xffff)
+                {
+                    out += static_cast<char>(maskBit | 126);
+                    out += static_cast<char>(length >> 8);
+                    out += static_cast<char>(length & 0xff);
+                }
+                else
+                {
+                    out += static_cast<char>(maskBit | 127);
+                    for (int i = 7; i >= 0; i--)
+                        out += static_cast<char>((static_cast<uint64_t>(length) >> (i * 8)) & 0xff);
+                }
+                if (key)
+                    out.append(reinterpret_cast<const char *>(key), 4);
+            }
+
+            constexpr size_t maxFrameHeader = 14;
+
+            inline bool isValidCloseCode(int code)
+            {
+                if (code >= 3000 && code <= 4999)
+                    return true;
+                return code >= 1000 && code <= 1014 && code != 1004 && code != 1005 && code != 1006;
+            }
+
+            inline std::string_view trim(std::string_view s)
+            {
+                while (!s.empty() && (s.front() == ' ' || s.front() == '\t'))
+                    s.remove_prefix(1);
+                while (!s.empty() && (s.back() == ' ' || s.back() == '\t'))
+                    s.remove_suffix(1);
+                return s;
+            }
+
+            inline bool equalsIgnoreCase(std::string_view a, std::string_view b)
+            {
+                return a.size() == b.size() &&
+                       std::equal(a.begin(), a.end(), b.begin(), [](char x, char y)
+                                  { return std::tolower(static_cast<unsigned char>(x)) ==
+                                           std::tolower(static_cast<unsigned char>(y)); });
+            }
+
+            // Splits a comma-separated header value, skipping empty elements
+            template <typename F>
+            inline void forEachElement(std::string_view value, F &&f)
+            {
+                while (!value.empty())
+                {
+                    auto comma = value.find(',');
+                    auto element = trim(value.substr(0, comma));
+                    if (!element.empty() && !f(element))
+                        return;
+                    if (comma == std::string_view::npos)
+                        break;
+                    value.remove_prefix(comma + 1);
+                }
+            }
+
+            // "Connection: keep-alive, Upgrade" contains the token "upgrade"
+            inline bool hasToken(std::string_view value, std::string_view token)
+            {
+                bool found = false;
+                forEachElement(value, [&](std::string_view element)
+                               { found = equalsIgnoreCase(element, token);
+                                 return !found; });
+                return found;
+            }
+
+            inline int64_t nowMs()
+            {
+                return std::chrono::duration_cast<std::chrono::milliseconds>(
+                           std::chrono::steady_clock::now().time_since_epoch())
+                    .count();
+            }
+        }
+
+        // 🔥 Sec-WebSocket-Accept for a client's Sec-WebSocket-Key
+        inline std::string acceptKey(std::string_view key)
+        {
+            auto digest = ws_detail::sha1(std::string(key) + "258EAFA5-E914-47DA-95CA-C5AB0DC85B11");
+            return ws_detail::base64Encode(digest.data(), digest.size());
+        }
+
+        // 🔥 permessage-deflate parameters agreed for one connection (RFC 7692)
+        struct DeflateSettings
+        {
+            bool enabled = false;
+            bool serverNoContextTakeover = false;
+            bool clientNoContextTakeover = false;
+            int serverWindowBits = 15;
+            int clientWindowBits = 15;
+        };
+
+        // 🔥 Picks the first permessage-deflate offer in Sec-WebSocket-Extensions
+        // that can be honoured, capping our window at maxWindowBits. Fills the
+        // response header value; false = no compression.
+        inline bool negotiateDeflate(std::string_view offers, int maxWindowBits,
+                                     DeflateSettings &settings, std::string &response)
+        {
+            maxWindowBits = std::max(9, std::min(15, maxWindowBits));
+            bool accepted = false;
+
+            ws_detail::forEachElement(offers, [&](std::string_view offer)
+                                      {
+                auto semicolon = offer.find(';');
+                if (!ws_detail::equalsIgnoreCase(ws_detail::trim(offer.substr(0, semicolon)), "permessage-deflate"))
+                    return true;
+
+                DeflateSettings candidate;
+                candidate.enabled = true;
+                bool serverBitsOffered = false;
+                int clientBits = 0; // 0 = not offered, -1 = offered without a value
+                unsigned seen = 0;
+
+                auto parseBits = [](std::string_view value)
+                {
+                    if (value.size() >= 2 && value.front() == '"' && value.back() == '"')
+                        value = value.substr(1, value.size() - 2);
+                    if (value.empty() || value.size() > 2 ||
+                        !std::all_of(value.begin(), value.end(), [](char c)
+                                     { return c >= '0' && c <= '9'; }))
+                        return 0;
+                    int bits = std::stoi(std::string(value));
+                    return bits >= 8 && bits <= 15 ? bits : 0;
+                };
+
+                while (semicolon != std::string_view::npos)
+                {
+                    offer.remove_prefix(semicolon + 1);
+                    semicolon = offer.find(';');
+                    auto param = ws_detail::trim(offer.substr(0, semicolon));
+                    auto eq = param.find('=');
+                    auto name = ws_detail::trim(param.substr(0, eq));
+                    auto value = eq == std::string_view::npos ? std::string_view() : ws_detail::trim(param.substr(eq + 1));
+
+                    unsigned bit;
+                    if (name == "server_no_context_takeover" && eq == std::string_view::npos)
+                        bit = 1, candidate.serverNoContextTakeover = true;
+                    else if (name == "client_no_context_takeover" && eq == std::string_view::npos)
+                        bit = 2, candidate.clientNoContextTakeover = true;
+                    else if (name == "server_max_window_bits" && (candidate.serverWindowBits = parseBits(value)))
+                        bit = 4, serverBitsOffered = true;
+                    else if (name == "client_max_window_bits" && (eq == std::string_view::npos || parseBits(value)))
+                        bit = 8, clientBits = eq == std::string_view::npos ? -1 : parseBits(value);
+                    else
+                        return true; // unknown or malformed parameter: decline this offer
+
+                    if (seen & bit)
+                        return true; // duplicate parameter
+                    seen |= bit;
+                }
+
+                // zlib cannot deflate with a 256-byte window
+                candidate.serverWindowBits = std::min(candidate.serverWindowBits, maxWindowBits);
+                if (candidate.serverWindowBits < 9)
+                    return true;
+                if (clientBits > 0)
+                    candidate.clientWindowBits = clientBits;
+
+                response = "permessage-deflate";
+                if (candidate.serverNoContextTakeover)
+                    response += "; server_no_context_takeover";
+                if (candidate.clientNoContextTakeover)
+                    response += "; client_no_context_takeover";
+                if (serverBitsOffered || candidate.serverWindowBits < 15)
+                    response += "; server_max_window_bits=" + std::to_string(candidate.serverWindowBits);
+                if (clientBits > 0)
+                    response += "; client_max_window_bits=" + std::to_string(clientBits);
+
+                settings = candidate;
+                accepted = true;
+                return false; });
+
+            return accepted;
+        }
+
+#ifdef XPRESSPP_ZLIB_SUPPORT
+        // 🔥 Raw deflate for one direction of permessage-deflate
+        // Each message is flushed with Z_SYNC_FLUSH and loses its trailing
+        // 00 00 ff ff; the window carries over unless reset() is called
+        // (no context takeover). memLevel follows the window size, so a
+        // 2^13 window costs ~64 KB instead of zlib's default ~256 KB.
+        class Deflater
+        {
+        public:
+            Deflater() = default;
+            Deflater(const Deflater &) = delete;
+            Deflater &operator=(const Deflater &) = delete;
+
+            ~Deflater()
+            {
+                if (ready_)
+                    deflateEnd(&strm_);
+            }
+
+            bool init(int level, int windowBits)
+            {
+                int memLevel = std::max(1, std::min(8, windowBits - 7));
+                ready_ = deflateInit2(&strm_, level, Z_DEFLATED, -windowBits, memLevel, Z_DEFAULT_STRATEGY) == Z_OK;
+                return ready_;
+            }
+
+            void reset() { deflateReset(&strm_); }
+
+            // Appends the compressed message to out
+            bool compress(const char *data, size_t size, std::string &out)
+            {
+                size_t start = out.size();
+                size_t used = start;
+                size_t chunk = deflateBound(&strm_, static_cast<uLong>(size)) + 16;
+
+                strm_.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+                strm_.avail_in = static_cast<uInt>(size);
+                for (;;)
+                {
+                    out.resize(used + chunk);
+                    strm_.next_out = reinterpret_cast<Bytef *>(&out[used]);
+                    strm_.avail_out = static_cast<uInt>(chunk);
+                    int rc = deflate(&strm_, Z_SYNC_FLUSH);
+                    used += chunk - strm_.avail_out;
+                    if (rc != Z_OK && rc != Z_BUF_ERROR)
+                    {
+                        out.resize(start);
+                        return false;
+                    }
+                    if (strm_.avail_out != 0)
+                        break;
+                }
+
+                if (used - start >= 4 && std::memcmp(&out[used - 4], "\x00\x00\xff\xff", 4) == 0)
+                    used -= 4;
+                out.resize(used);
+                return true;
+            }
+
+        private:
+            z_stream strm_{};
+            bool ready_ = false;
+        };
+
+        class Inflater
+        {
+        public:
+            enum Result
+            {
+                Ok,
+                TooBig,
+                Corrupt
+            };
+
+            Inflater() = default;
+            Inflater(const Inflater &) = delete;
+            Inflater &operator=(const Inflater &) = delete;
+
+            ~Inflater()
+            {
+                if (ready_)
+                    inflateEnd(&strm_);
+            }
+
+            bool init(int windowBits)
+            {
+                ready_ = inflateInit2(&strm_, -windowBits) == Z_OK;
+                return ready_;
+            }
+
+            void reset() { inflateReset(&strm_); }
+
+            // Replaces out with the inflated message; stops past limit bytes
+            Result decompress(const char *data, size_t size, std::string &out, size_t limit)
+            {
+                static const unsigned char tail[4] = {0x00, 0x00, 0xff, 0xff};
+                const unsigned char *inputs[2] = {reinterpret_cast<const unsigned char *>(data), tail};
+                size_t sizes[2] = {size, sizeof(tail)};
+
+                size_t used = 0;
+                out.clear();
+                for (int i = 0; i < 2; i++)
+                {
+                    strm_.next_in = const_cast<Bytef *>(inputs[i]);
+                    strm_.avail_in = static_cast<uInt>(sizes[i]);
+                    for (;;)
+                    {
+                        if (out.size() - used < 1024)
+                            out.resize(std::max(out.size() * 2, used + 16 * 1024));
+                        strm_.next_out = reinterpret_cast<Bytef *>(&out[used]);
+                        strm_.avail_out = static_cast<uInt>(out.size() - used);
+                        int rc = inflate(&strm_, Z_SYNC_FLUSH);
+                        used = out.size() - strm_.avail_out;
+                        if (used > limit)
+                            return TooBig;
+                        if (rc == Z_STREAM_END)
+                        {
+                            // A final block (BFINAL) ends the stream: the next message starts fresh
+                            inflateReset(&strm_);
+                            out.resize(used);
+                            return Ok;
+                        }
+                        if (rc == Z_BUF_ERROR || (rc == Z_OK && strm_.avail_in == 0 && strm_.avail_out != 0))
+                            break;
+                        if (rc != Z_OK)
+                            return Corrupt;
+                    }
+                }
+                out.resize(used);
+                return Ok;
+            }
+
+        private:
+            z_stream strm_{};
+            bool ready_ = false;
+        };
+#endif
+
+#ifdef XPRESSPP_WEBSOCKET_LOOP
+        class Hub;
+        class Loop;
+
+        // 🔥 One WebSocket connection
+        // send/close/subscribe/publish may be called from any thread: frames
+        // are queued under the connection's lock and written by its loop.
+        // Keep a std::shared_ptr (shared_from_this()) to send after the
+        // callback returns; sends fail once the connection has closed.
+        class WebSocket : public std::enable_shared_from_this<WebSocket>
+        {
+        public:
+            WebSocket(Hub &hub, Loop &loop, std::shared_ptr<const Behavior> behavior,
+                      const DeflateSettings &deflate, std::string remoteAddress, std::string protocol)
+                : hub_(hub), loop_(loop), behavior_(std::move(behavior)), deflate_(deflate),
+                  remoteAddress_(std::move(remoteAddress)), protocol_(std::move(protocol)) {}
+
+            WebSocket(const WebSocket &) = delete;
+            WebSocket &operator=(const WebSocket &) = delete;
+
+            ~WebSocket()
+            {
+                if (fd_ >= 0)
+                    ::close(fd_);
+            }
+
+            // Text by default; false = closed, or dropped over maxBackpressure
+            bool send(std::string_view message, bool binary = false)
+            {
+                return sendFrame(binary ? opcode::Binary : opcode::Text, message, true);
+            }
+
+            bool ping(std::string_view payload = {})
+            {
+                return sendFrame(opcode::Ping, payload.substr(0, 125), false);
+            }
+
+            // Starts the closing handshake; the close callback follows once the
+            // client answers (or after 5 s)
+            void close(int code = closeCode::Normal, std::string_view reason = {});
+
+            // Drops the connection without a closing handshake (close code 1006)
+            void terminate();
+
+            // Topics for Hub::publish (App::publish)
+            bool subscribe(const std::string &topic);
+            bool unsubscribe(const std::string &topic);
+
+            // To every other subscriber of topic; returns how many it reached
+            size_t publish(const std::string &topic, std::string_view message, bool binary = false);
+
+            size_t bufferedAmount() const
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                return outBytes_;
+            }
+
+            bool isOpen() const
+            {
+                auto state = state_.load();
+                return state == State::Connecting || state == State::Open;
+            }
+
+            bool compressed() const { return deflate_.enabled; } // permessage-deflate negotiated
+            const std::string &protocol() const { return protocol_; }
+            const std::string &remoteAddress() const { return remoteAddress_; }
+
+            // Per-connection user data, typically set in open
+            std::any data;
+
+        private:
+            friend class Hub;
+            friend class Loop;
+            friend struct Handoff;
+
+            enum class State
+            {
+                Connecting, // open callback running, socket not on the loop yet
+                Open,
+                Closing, // close frame queued, waiting for the client's
+                Closed
+            };
+
+            // Queued frame bytes: owned small frames share a segment; a
+            // broadcast frame is shared by every subscriber it is queued on
+            struct Segment
+            {
+                std::shared_ptr<const std::string> shared;
+                std::string own;
+
+                const char *data() const { return shared ? shared->data() : own.data(); }
+                size_t size() const { return shared ? shared->size() : own.size(); }
+            };
+
+            static constexpr size_t segmentSize = 16 * 1024;
+            static constexpr int64_t closeTimeoutMs = 5000;
+
+            Hub &hub_;
+            Loop &loop_;
+            std::shared_ptr<const Behavior> behavior_;
+            const DeflateSettings deflate_;
+            const std::string remoteAddress_;
+            const std::string protocol_;
+
+            std::atomic<State> state_{State::Connecting};
+            std::atomic<int64_t> closeSentAt_{0};
+
+            // Outbound, guarded by mutex_
+            mutable std::mutex mutex_;
+            std::deque<Segment> out_;
+            size_t outBytes_ = 0;
+            size_t headWritten_ = 0; // bytes of out_.front() already sent
+            bool dirty_ = false;     // on the loop's flush list
+            std::vector<std::string> topics_;
+#ifdef XPRESSPP_ZLIB_SUPPORT
+            std::unique_ptr<Deflater> deflater_; // created by the first compressed send
+            bool resetDeflater_ = false;         // a shared compressed frame went out in between
+            std::string compressed_;
+#endif
+
+            // Loop thread only
+            int fd_ = -1;
+            bool adopted_ = false;
+            bool wantWrite_ = false;
+            bool readClosed_ = false;
+            bool closeAfterFlush_ = false;
+            bool pingOutstanding_ = false;
+            int64_t lastActivity_ = 0;
+            int closeCode_ = closeCode::Abnormal;
+            std::string closeReason_;
+            std::string in_;      // partial frame carried over between reads
+            std::string message_; // fragments of the message being received
+            uint8_t messageOpcode_ = 0;
+            bool messageCompressed_ = false;
+#ifdef XPRESSPP_ZLIB_SUPPORT
+            std::unique_ptr<Inflater> inflater_;
+            std::string inflated_;
+#endif
+
+            const Options &options() const { return behavior_->options; }
+
+            bool markDirtyLocked()
+            {
+                if (dirty_)
+                    return false;
+                dirty_ = true;
+                return true;
+            }
+
+            void appendFrameLocked(uint8_t op, const char *payload, size_t length, bool rsv1)
+            {
+                size_t frameSize = ws_detail::maxFrameHeader + length;
+                if (out_.empty() || out_.back().shared || out_.back().own.size() + frameSize > segmentSize)
+                    out_.emplace_back();
+                auto &tail = out_.back().own;
+                size_t before = tail.size();
+                ws_detail::appendFrameHeader(tail, op, length, rsv1);
+                tail.append(payload, length);
+                outBytes_ += tail.size() - before;
+            }
+
+            bool sendFrame(uint8_t op, std::string_view payload, bool dataFrame);
+            bool enqueueShared(const std::shared_ptr<const std::string> &frame, bool compressed, bool &schedule);
+
+            void adopt(int fd, std::string buffered);
+            void onReadable();
+            void consume(char *data, size_t length);
+            size_t parse(char *data, size_t length);
+            void onFrame(const ws_detail::FrameHeader &header, char *payload, size_t length);
+            void deliver(uint8_t op, bool compressed, char *data, size_t length);
+            void onCloseFrame(const char *payload, size_t length);
+            void fail(int code, std::string_view reason);
+            void flush();
+            void sweep(int64_t now);
+            void finish(int code, std::string_view reason);
+        };
+
+        // 🔥 Event loop for upgraded connections
+        // One thread multiplexes every socket assigned to it (epoll on Linux,
+        // poll elsewhere), so idle and slow connections cost no worker. Other
+        // threads reach it through post() and the flush list, woken by an
+        // eventfd (a pipe elsewhere). Keepalive runs from a 1 s sweep.
+        class Loop
+        {
+        public:
+            Loop()
+            {
+#ifdef XPRESSPP_WEBSOCKET_EPOLL
+                poller_ = epoll_create1(EPOLL_CLOEXEC);
+                wakeRead_ = wakeWrite_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+                epoll_event ev{};
+                ev.events = EPOLLIN;
+                ev.data.fd = wakeRead_;
+                epoll_ctl(poller_, EPOLL_CTL_ADD, wakeRead_, &ev);
+#else
+                int fds[2] = {-1, -1};
+                if (pipe(fds) == 0)
+                {
+                    for (int fd : fds)
+                    {
+                        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+                        fcntl(fd, F_SETFD, FD_CLOEXEC);
+                    }
+                }
+                wakeRead_ = fds[0];
+                wakeWrite_ = fds[1];
+#endif
+                scratch_.resize(64 * 1024);
+                thread_ = std::thread([this]
+                                      { run(); });
+            }
+
+            Loop(const Loop &) = delete;
+            Loop &operator=(const Loop &) = delete;
+
+            ~Loop()
+            {
+                stopping_ = true;
+                wake();
+                if (thread_.joinable())
+                    thread_.join();
+#ifdef XPRESSPP_WEBSOCKET_EPOLL
+                ::close(poller_);
+                ::close(wakeRead_);
+#else
+                ::close(wakeRead_);
+                ::close(wakeWrite_);
+#endif
+            }
+
+            void post(std::function<void()> task)
+            {
+                bool wakeUp;
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    tasks_.push_back(std::move(task));
+                    wakeUp = needsWakeLocked();
+                }
+                if (wakeUp)
+                    wake();
+            }
+
+            // Queues connections with new frames for a flush
+            void schedule(std::shared_ptr<WebSocket> ws)
+            {
+                bool wakeUp;
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    dirty_.push_back(std::move(ws));
+                    wakeUp = needsWakeLocked();
+                }
+                if (wakeUp)
+                    wake();
+            }
+
+            void schedule(std::vector<std::shared_ptr<WebSocket>> &batch)
+            {
+                bool wakeUp;
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    if (dirty_.empty())
+                        dirty_.swap(batch);
+                    else
+                        dirty_.insert(dirty_.end(), batch.begin(), batch.end());
+                    wakeUp = needsWakeLocked();
+                }
+                batch.clear();
+                if (wakeUp)
+                    wake();
+            }
+
+            bool inLoopThread() const { return std::this_thread::get_id() == thread_.get_id(); }
+
+        private:
+            friend class WebSocket;
+
+            struct Event
+            {
+                int fd;
+                bool readable;
+                bool writable;
+            };
+
+            int poller_ = -1;
+            int wakeRead_ = -1;
+            int wakeWrite_ = -1;
+            std::thread thread_;
+            std::atomic<bool> stopping_{false};
+
+            std::mutex mutex_;
+            std::vector<std::function<void()>> tasks_;
+            std::vector<std::shared_ptr<WebSocket>> dirty_;
+            bool wakePending_ = false;
+
+            // Loop thread only
+            std::unordered_map<int, std::shared_ptr<WebSocket>> sockets_;
+            std::vector<char> scratch_; // shared receive buffer
+            int64_t lastSweep_ = 0;
+
+            bool needsWakeLocked()
+            {
+                if (wakePending_ || inLoopThread())
+                    return false;
+                wakePending_ = true;
+                return true;
+            }
+
+            void wake()
+            {
+                uint64_t one = 1;
+                ssize_t n = ::write(wakeWrite_, &one, sizeof(one));
+                (void)n;
+            }
+
+            void attach(const std::shared_ptr<WebSocket> &ws)
+            {
+                sockets_[ws->fd_] = ws;
+#ifdef XPRESSPP_WEBSOCKET_EPOLL
+                epoll_event ev{};
+                ev.events = EPOLLIN;
+                ev.data.fd = ws->fd_;
+                epoll_ctl(poller_, EPOLL_CTL_ADD, ws->fd_, &ev);
+#endif
+            }
+
+            void watch(int fd, bool writable)
+            {
+#ifdef XPRESSPP_WEBSOCKET_EPOLL
+                epoll_event ev{};
+                ev.events = EPOLLIN | (writable ? static_cast<uint32_t>(EPOLLOUT) : 0u);
+                ev.data.fd = fd;
+                epoll_ctl(poller_, EPOLL_CTL_MOD, fd, &ev);
+#else
+                (void)fd;
+                (void)writable; // poll() reads wantWrite_ every round
+#endif
+            }
+
+            void detach(int fd)
+            {
+#ifdef XPRESSPP_WEBSOCKET_EPOLL
+                epoll_ctl(poller_, EPOLL_CTL_DEL, fd, nullptr);
+#endif
+                sockets_.erase(fd);
+            }
+
+            void wait(int timeoutMs, std::vector<Event> &events)
+            {
+                events.clear();
+#ifdef XPRESSPP_WEBSOCKET_EPOLL
+                epoll_event ready[256];
+                int n = epoll_wait(poller_, ready, 256, timeoutMs);
+                for (int i = 0; i < n; i++)
+                {
+                    if (ready[i].data.fd == wakeRead_)
+                    {
+                        uint64_t count;
+                        ssize_t r = ::read(wakeRead_, &count, sizeof(count));
+                        (void)r;
+                        continue;
+                    }
+                    events.push_back({ready[i].data.fd, (ready[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP)) != 0,
+                                      (ready[i].events & EPOLLOUT) != 0});
+                }
+#else
+                std::vector<pollfd> fds;
+                fds.reserve(sockets_.size() + 1);
+                fds.push_back({wakeRead_, POLLIN, 0});
+                for (auto &entry : sockets_)
+                    fds.push_back({entry.first, static_cast<short>(POLLIN | (entry.second->wantWrite_ ? POLLOUT : 0)), 0});
+                int n = ::poll(fds.data(), static_cast<nfds_t>(fds.size()), timeoutMs);
+                if (n <= 0)
+                    return;
+                if (fds[0].revents)
+                {
+                    char drain[64];
+                    while (::read(wakeRead_, drain, sizeof(drain)) > 0)
+                    {
+                    }
+                }
+                for (size_t i = 1; i < fds.size(); i++)
+                {
+                    if (fds[i].revents)
+                        events.push_back({fds[i].fd, (fds[i].revents & (POLLIN | POLLERR | POLLHUP)) != 0,
+                                          (fds[i].revents & POLLOUT) != 0});
+                }
+#endif
+            }
+
+            void run()
+            {
+                std::vector<Event> events;
+                std::vector<std::function<void()>> tasks;
+                std::vector<std::shared_ptr<WebSocket>> dirty;
+                lastSweep_ = ws_detail::nowMs();
+
+                while (!stopping_)
+                {
+                    bool pending;
+                    {
+                        std::lock_guard<std::mutex> lock(mutex_);
+                        pending = !tasks_.empty() || !dirty_.empty();
+                    }
+                    int64_t untilSweep = lastSweep_ + 1000 - ws_detail::nowMs();
+                    wait(pending ? 0 : static_cast<int>(std::max<int64_t>(0, untilSweep)), events);
+
+                    for (auto &event : events)
+                    {
+                        auto it = sockets_.find(event.fd);
+                        if (it == sockets_.end())
+                            continue; // closed by an earlier event of this round
+                        auto ws = it->second;
+                        if (event.writable)
+                            ws->flush();
+                        if (event.readable)
+                            ws->onReadable();
+                    }
+
+                    {
+                        std::lock_guard<std::mutex> lock(mutex_);
+                        tasks.swap(tasks_);
+                        dirty.swap(dirty_);
+                        wakePending_ = false;
+                    }
+                    for (auto &task : tasks)
+                        task();
+                    tasks.clear();
+                    for (auto &ws : dirty)
+                        ws->flush();
+                    dirty.clear();
+
+                    int64_t now = ws_detail::nowMs();
+                    if (now - lastSweep_ >= 1000)
+                    {
+                        lastSweep_ = now;
+                        sweep(now);
+                    }
+                }
+
+                // Shutdown: adopt what is still queued, then say goodbye
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    tasks.swap(tasks_);
+                    dirty_.clear();
+                }
+                for (auto &task : tasks)
+                    task();
+
+                std::vector<std::shared_ptr<WebSocket>> all;
+                for (auto &entry : sockets_)
+                    all.push_back(entry.second);
+                for (auto &ws : all)
+                {
+                    ws->close(closeCode::GoingAway, "server shutting down");
+                    ws->flush();
+                    ws->finish(closeCode::GoingAway, "server shutting down");
+                }
+            }
+
+            void sweep(int64_t now)
+            {
+                std::vector<std::shared_ptr<WebSocket>> due;
+                for (auto &entry : sockets_)
+                {
+                    auto &ws = entry.second;
+                    int idleTimeout = ws->options().idleTimeout;
+                    bool closing = ws->state_ == WebSocket::State::Closing;
+                    if ((closing && now - ws->closeSentAt_ >= WebSocket::closeTimeoutMs) ||
+                        (idleTimeout > 0 && !closing && now - ws->lastActivity_ >= idleTimeout * 1000 / 2))
+                        due.push_back(ws);
+                }
+                for (auto &ws : due)
+                    ws->sweep(now);
+            }
+        };
+
+        // 🔥 Connections and topics
+        // Loops start with the first connection (setThreads() before that).
+        // publish() builds the frame once — and compresses it once per
+        // negotiated window size — then queues that same buffer on every
+        // subscriber and wakes each loop once.
+        class Hub
+        {
+        public:
+            Hub() = default;
+            Hub(const Hub &) = delete;
+            Hub &operator=(const Hub &) = delete;
+
+            ~Hub() { stop(); }
+
+            void setThreads(size_t threads) { threads_ = std::max<size_t>(threads, 1); }
+
+            size_t publish(const std::string &topic, std::string_view message, bool binary = false)
+            {
+                return publish(topic, message, binary, nullptr);
+            }
+
+            size_t connections() const { return connections_; }
+
+            size_t subscribers(const std::string &topic) const
+            {
+                std::shared_lock<std::shared_mutex> lock(topicsMutex_);
+                auto it = topics_.find(topic);
+                return it == topics_.end() ? 0 : it->second.size();
+            }
+
+            // Closes every connection with 1001 and joins the loops
+            void stop()
+            {
+                std::vector<std::unique_ptr<Loop>> loops;
+                {
+                    std::lock_guard<std::mutex> lock(loopsMutex_);
+                    loops.swap(loops_);
+                }
+                loops.clear();
+            }
+
+        private:
+            friend class WebSocket;
+            friend void upgrade(Hub &hub, const std::shared_ptr<const Behavior> &behavior, Request &req, Response &res);
+
+            size_t threads_ = 1;
+            std::mutex loopsMutex_;
+            std::vector<std::unique_ptr<Loop>> loops_;
+            std::atomic<size_t> next_{0};
+            std::atomic<size_t> connections_{0};
+
+            mutable std::shared_mutex topicsMutex_;
+            std::unordered_map<std::string, std::unordered_set<std::shared_ptr<WebSocket>>> topics_;
+
+            Loop &assign()
+            {
+                std::lock_guard<std::mutex> lock(loopsMutex_);
+                if (loops_.empty())
+                {
+                    for (size_t i = 0; i < threads_; i++)
+                        loops_.push_back(std::make_unique<Loop>());
+                }
+                return *loops_[next_++ % loops_.size()];
+            }
+
+            size_t publish(const std::string &topic, std::string_view message, bool binary, const WebSocket *skip)
+            {
+                auto op = binary ? opcode::Binary : opcode::Text;
+                auto frame = std::make_shared<std::string>();
+                frame->reserve(ws_detail::maxFrameHeader + message.size());
+                ws_detail::appendFrameHeader(*frame, op, message.size());
+                frame->append(message.data(), message.size());
+                std::shared_ptr<const std::string> plain = std::move(frame);
+
+#ifdef XPRESSPP_ZLIB_SUPPORT
+                std::shared_ptr<const std::string> compressed[16]; // by window bits
+#endif
+                std::unordered_map<Loop *, std::vector<std::shared_ptr<WebSocket>>> wake;
+                size_t reached = 0;
+
+                {
+                    std::shared_lock<std::shared_mutex> lock(topicsMutex_);
+                    auto it = topics_.find(topic);
+                    if (it == topics_.end())
+                        return 0;
+
+                    for (auto &ws : it->second)
+                    {
+                        if (ws.get() == skip)
+                            continue;
+
+                        const std::shared_ptr<const std::string> *variant = &plain;
+                        bool isCompressed = false;
+#ifdef XPRESSPP_ZLIB_SUPPORT
+                        if (ws->deflate_.enabled && message.size() >= ws->options().compressMinSize)
+                        {
+                            auto &slot = compressed[ws->deflate_.serverWindowBits];
+                            if (!slot)
+                                slot = compressShared(op, message, ws->options().compressionLevel,
+                                                      ws->deflate_.serverWindowBits);
+                            if (slot)
+                                variant = &slot, isCompressed = true;
+                        }
+#endif
+                        bool schedule = false;
+                        if (ws->enqueueShared(*variant, isCompressed, schedule))
+                            reached++;
+                        if (schedule)
+                            wake[&ws->loop_].push_back(ws);
+                    }
+                }
+
+                for (auto &entry : wake)
+                    entry.first->schedule(entry.second);
+                return reached;
+            }
+
+#ifdef XPRESSPP_ZLIB_SUPPORT
+            // Without context takeover, so any subscriber's inflater can read it
+            static std::shared_ptr<const std::string> compressShared(uint8_t op, std::string_view message,
+                                                                     int level, int windowBits)
+            {
+                thread_local std::unique_ptr<Deflater> deflaters[16];
+                thread_local int levels[16] = {};
+                auto &deflater = deflaters[windowBits];
+                if (!deflater || levels[windowBits] != level)
+                {
+                    deflater = std::make_unique<Deflater>();
+                    if (!deflater->init(level, windowBits))
+                    {
+                        deflater.reset();
+                        return nullptr;
+                    }
+                    levels[windowBits] = level;
+                }
+                else
+                    deflater->reset();
+
+                std::string payload;
+                if (!deflater->compress(message.data(), message.size(), payload))
+                    return nullptr;
+                auto frame = std::make_shared<std::string>();
+                frame->reserve(ws_detail::maxFrameHeader + payload.size());
+                ws_detail::appendFrameHeader(*frame, op, payload.size(), true);
+                frame->append(payload);
+                return frame;
+            }
+#endif
+
+            void subscribe(const std::string &topic, const std::shared_ptr<WebSocket> &ws)
+            {
+                std::unique_lock<std::shared_mutex> lock(topicsMutex_);
+                topics_[topic].insert(ws);
+            }
+
+            void unsubscribe(const std::string &topic, const std::shared_ptr<WebSocket> &ws)
+            {
+                std::unique_lock<std::shared_mutex> lock(topicsMutex_);
+                auto it = topics_.find(topic);
+                if (it == topics_.end())
+                    return;
+                it->second.erase(ws);
+                if (it->second.empty())
+                    topics_.erase(it);
+            }
+        };
+
+        // ========================================
+        // 🔥 WebSocket (needs Loop and Hub)
+        // ========================================
+
+        inline bool WebSocket::sendFrame(uint8_t op, std::string_view payload, bool dataFrame)
+        {
+            bool schedule;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                auto state = state_.load();
+                if (state != State::Connecting && state != State::Open)
+                    return false;
+                if (dataFrame && outBytes_ + payload.size() > options().maxBackpressure)
+                    return false;
+
+                bool queued = false;
+#ifdef XPRESSPP_ZLIB_SUPPORT
+                if (dataFrame && deflate_.enabled && payload.size() >= options().compressMinSize)
+                {
+                    if (!deflater_)
+                    {
+                        deflater_ = std::make_unique<Deflater>();
+                        if (!deflater_->init(options().compressionLevel, deflate_.serverWindowBits))
+                            deflater_.reset();
+                    }
+                    else if (resetDeflater_ || deflate_.serverNoContextTakeover)
+                        deflater_->reset();
+                    resetDeflater_ = false;
+
+                    compressed_.clear();
+                    if (deflater_ && deflater_->compress(payload.data(), payload.size(), compressed_))
+                    {
+                        appendFrameLocked(op, compressed_.data(), compressed_.size(), true);
+                        queued = true;
+                    }
+                    if (compressed_.capacity() > segmentSize * 4)
+                        std::string().swap(compressed_);
+                }
+#endif
+                if (!queued)
+                    appendFrameLocked(op, payload.data(), payload.size(), false);
+                schedule = markDirtyLocked();
+            }
+            if (schedule)
+                loop_.schedule(shared_from_this());
+            return true;
+        }
+
+        // Broadcast path: the caller (Hub::publish) schedules the flush
+        inline bool WebSocket::enqueueShared(const std::shared_ptr<const std::string> &frame, bool compressed,
+                                             bool &schedule)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto state = state_.load();
+            if (state != State::Connecting && state != State::Open)
+                return false;
+            if (outBytes_ + frame->size() > options().maxBackpressure)
+                return false;
+
+            Segment segment;
+            segment.shared = frame;
+            out_.push_back(std::move(segment));
+            outBytes_ += frame->size();
+#ifdef XPRESSPP_ZLIB_SUPPORT
+            // The client's inflater window now holds this message, which our
+            // deflater never saw: its next back-reference could point into it
+            if (compressed)
+                resetDeflater_ = true;
+#else
+            (void)compressed;
+#endif
+            schedule = markDirtyLocked();
+            return true;
+        }
+
+        inline void WebSocket::close(int code, std::string_view reason)
+        {
+            bool schedule;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                auto state = state_.load();
+                if (state != State::Connecting && state != State::Open)
+                    return;
+
+                std::string payload;
+                payload += static_cast<char>((code >> 8) & 0xff);
+                payload += static_cast<char>(code & 0xff);
+                payload.append(reason.substr(0, 123));
+                appendFrameLocked(opcode::Close, payload.data(), payload.size(), false);
+                closeSentAt_ = ws_detail::nowMs();
+                state_ = State::Closing;
+                schedule = markDirtyLocked();
+            }
+            if (schedule)
+                loop_.schedule(shared_from_this());
+        }
+
+        inline void WebSocket::terminate()
+        {
+            auto self = shared_from_this();
+            loop_.post([self]
+                       { self->finish(closeCode::Abnormal, ""); });
+        }
+
+        inline bool WebSocket::subscribe(const std::string &topic)
+        {
+            if (!isOpen())
+                return false;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (std::find(topics_.begin(), topics_.end(), topic) != topics_.end())
+                    return true;
+                topics_.push_back(topic);
+            }
+            hub_.subscribe(topic, shared_from_this());
+
+            // Lost a race with finish(), which only unsubscribes what it saw
+            if (!isOpen())
+                hub_.unsubscribe(topic, shared_from_this());
+            return true;
+        }
+
+        inline bool WebSocket::unsubscribe(const std::string &topic)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                auto it = std::find(topics_.begin(), topics_.end(), topic);
+                if (it == topics_.end())
+                    return false;
+                topics_.erase(it);
+            }
+            hub_.unsubscribe(topic, shared_from_this());
+            return true;
+        }
+
+        inline size_t WebSocket::publish(const std::string &topic, std::string_view message, bool binary)
+        {
+            return hub_.publish(topic, message, binary, this);
+        }
+
+        inline void WebSocket::adopt(int fd, std::string buffered)
+        {
+            auto self = shared_from_this();
+            if (state_ == State::Closed)
+            {
+                ::close(fd); // terminated during open
+                return;
+            }
+
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+#ifdef SO_NOSIGPIPE
+            int on = 1;
+            setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                fd_ = fd;
+                State connecting = State::Connecting;
+                state_.compare_exchange_strong(connecting, State::Open);
+            }
+            adopted_ = true;
+            hub_.connections_++;
+            lastActivity_ = ws_detail::nowMs();
+            loop_.attach(self);
+
+            if (!buffered.empty())
+                consume(&buffered[0], buffered.size());
+            flush();
+        }
+
+        inline void WebSocket::onReadable()
+        {
+            auto &buffer = loop_.scratch_;
+            for (int round = 0; round < 4 && state_ != State::Closed; round++)
+            {
+                ssize_t n = ::recv(fd_, buffer.data(), buffer.size(), 0);
+                if (n > 0)
+                {
+                    lastActivity_ = ws_detail::nowMs();
+                    pingOutstanding_ = false;
+                    if (!readClosed_)
+                        consume(buffer.data(), static_cast<size_t>(n));
+                    if (static_cast<size_t>(n) < buffer.size())
+                        return;
+                    continue;
+                }
+                if (n < 0 && errno == EINTR)
+                    continue;
+                if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+                    return;
+                finish(readClosed_ ? closeCode_ : closeCode::Abnormal, readClosed_ ? closeReason_ : "");
+                return;
+            }
+        }
+
+        // Frames are parsed straight from the read buffer; only a partial
+        // frame at its end is copied into in_
+        inline void WebSocket::consume(char *data, size_t length)
+        {
+            if (in_.empty())
+            {
+                size_t used = parse(data, length);
+                if (state_ != State::Closed && !readClosed_ && used < length)
+                    in_.assign(data + used, length - used);
+                return;
+            }
+
+            in_.append(data, length);
+            size_t used = parse(&in_[0], in_.size());
+            if (state_ == State::Closed || readClosed_)
+                std::string().swap(in_);
+            else
+            {
+                in_.erase(0, used);
+                if (in_.empty() && in_.capacity() > segmentSize * 4)
+                    std::string().swap(in_); // after a large message
+            }
+        }
+
+        inline size_t WebSocket::parse(char *data, size_t length)
+        {
+            size_t offset = 0;
+            while (state_ != State::Closed && !readClosed_)
+            {
+                ws_detail::FrameHeader header;
+                size_t headerSize = ws_detail::parseFrameHeader(data + offset, length - offset, header);
+                if (headerSize == 0)
+                    break;
+
+                bool control = header.opcode & 0x08;
+                const char *error = nullptr;
+                if (!header.masked || header.reserved)
+                    error = "invalid frame header";
+                else if (header.rsv1 && (!deflate_.enabled || control || header.opcode == opcode::Continuation))
+                    error = "unexpected RSV1";
+                else if (control && (!header.fin || header.length > 125))
+                    error = "invalid control frame";
+                else if ((header.opcode > opcode::Binary && header.opcode < opcode::Close) || header.opcode > opcode::Pong)
+                    error = "unknown opcode";
+                if (error)
+                {
+                    fail(closeCode::ProtocolError, error);
+                    break;
+                }
+                if (header.length > options().maxMessageSize ||
+                    (!control && message_.size() + header.length > options().maxMessageSize))
+                {
+                    fail(closeCode::MessageTooBig, "message too big");
+                    break;
+                }
+
+                if (length - offset - headerSize < header.length)
+                    break;
+
+                char *payload = data + offset + headerSize;
+                size_t payloadSize = static_cast<size_t>(header.length);
+                ws_detail::applyMask(payload, payloadSize, header.key);
+                offset += headerSize + payloadSize;
+                onFrame(header, payload, payloadSize);
+            }
+            return offset;
+        }
+
+        inline void WebSocket::onFrame(const ws_detail::FrameHeader &header, char *payload, size_t length)
+        {
+            switch (header.opcode)
+            {
+            case opcode::Ping:
+                sendFrame(opcode::Pong, std::string_view(payload, length), false);
+                return;
+            case opcode::Pong:
+                return;
+            case opcode::Close:
+                onCloseFrame(payload, length);
+                return;
+            case opcode::Continuation:
+                if (!messageOpcode_)
+                    return fail(closeCode::ProtocolError, "unexpected continuation");
+                message_.append(payload, length);
+                if (header.fin)
+                {
+                    deliver(messageOpcode_, messageCompressed_, &message_[0], message_.size());
+                    messageOpcode_ = 0;
+                    if (message_.capacity() > segmentSize * 4)
+                        std::string().swap(message_);
+                    else
+                        message_.clear();
+                }
+                return;
+            default: // Text, Binary
+                if (messageOpcode_)
+                    return fail(closeCode::ProtocolError, "expected continuation");
+                if (header.fin)
+                    return deliver(header.opcode, header.rsv1, payload, length); // in place, no copy
+                messageOpcode_ = header.opcode;
+                messageCompressed_ = header.rsv1;
+                message_.assign(payload, length);
+                return;
+            }
+        }
+
+        inline void WebSocket::deliver(uint8_t op, bool compressed, char *data, size_t length)
+        {
+            std::string_view message(data, length);
+#ifdef XPRESSPP_ZLIB_SUPPORT
+            if (compressed)
+            {
+                if (!inflater_)
+                {
+                    inflater_ = std::make_unique<Inflater>();
+                    if (!inflater_->init(deflate_.clientWindowBits))
+                        return fail(closeCode::InternalError, "inflate unavailable");
+                }
+                auto result = inflater_->decompress(data, length, inflated_, options().maxMessageSize);
+                if (result == Inflater::TooBig)
+                    return fail(closeCode::MessageTooBig, "message too big");
+                if (result == Inflater::Corrupt)
+                    return fail(closeCode::InvalidPayload, "invalid compressed data");
+                if (deflate_.clientNoContextTakeover)
+                    inflater_->reset();
+                message = inflated_;
+            }
+#else
+            (void)compressed;
+#endif
+            if (op == opcode::Text && !ws_detail::isValidUtf8(message.data(), message.size()))
+                return fail(closeCode::InvalidPayload, "invalid UTF-8");
+
+            if (state_ == State::Open && behavior_->message)
+            {
+                try
+                {
+                    behavior_->message(*this, message, op == opcode::Binary);
+                }
+                catch (const std::exception &e)
+                {
+                    std::cerr << "[WebSocket Error] " << remoteAddress_ << " - " << e.what() << std::endl;
+                    close(closeCode::InternalError, "internal error");
+                }
+            }
+
+#ifdef XPRESSPP_ZLIB_SUPPORT
+            if (inflated_.capacity() > segmentSize * 4)
+                std::string().swap(inflated_);
+#endif
+        }
+
+        inline void WebSocket::onCloseFrame(const char *payload, size_t length)
+        {
+            int code = closeCode::NoStatus;
+            std::string_view reason;
+            if (length == 1)
+                return fail(closeCode::ProtocolError, "invalid close frame");
+            if (length >= 2)
+            {
+                code = (static_cast<unsigned char>(payload[0]) << 8) | static_cast<unsigned char>(payload[1]);
+                reason = std::string_view(payload + 2, length - 2);
+                if (!ws_detail::isValidCloseCode(code))
+                    return fail(closeCode::ProtocolError, "invalid close code");
+                if (!ws_detail::isValidUtf8(reason.data(), reason.size()))
+                    return fail(closeCode::InvalidPayload, "invalid close reason");
+            }
+
+            closeCode_ = code;
+            closeReason_ = std::string(reason);
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (state_ == State::Open)
+                {
+                    // Echo the code (an empty close gets an empty one); the
+                    // server closes the TCP connection first
+                    char echo[2] = {};
+                    if (length >= 2)
+                        std::memcpy(echo, payload, 2);
+                    appendFrameLocked(opcode::Close, echo, length >= 2 ? 2 : 0, false);
+                    closeSentAt_ = ws_detail::nowMs();
+                    state_ = State::Closing;
+                }
+            }
+            readClosed_ = true;
+            closeAfterFlush_ = true;
+            flush();
+        }
+
+        // Protocol violation: close with code, without waiting for an answer
+        inline void WebSocket::fail(int code, std::string_view reason)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (state_ == State::Open)
+                {
+                    std::string payload;
+                    payload += static_cast<char>((code >> 8) & 0xff);
+                    payload += static_cast<char>(code & 0xff);
+                    payload.append(reason.substr(0, 123));
+                    appendFrameLocked(opcode::Close, payload.data(), payload.size(), false);
+                    closeSentAt_ = ws_detail::nowMs();
+                    state_ = State::Closing;
+                }
+            }
+            closeCode_ = code;
+            closeReason_ = std::string(reason);
+            readClosed_ = true;
+            closeAfterFlush_ = true;
+            flush();
+        }
+
+        inline void WebSocket::flush()
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            dirty_ = false;
+            if (fd_ < 0 || state_ == State::Closed)
+                return;
+
+            while (!out_.empty())
+            {
+                iovec iov[64];
+                int count = 0;
+                size_t skip = headWritten_;
+                for (auto it = out_.begin(); it != out_.end() && count < 64; ++it, count++)
+                {
+                    iov[count].iov_base = const_cast<char *>(it->data() + skip);
+                    iov[count].iov_len = it->size() - skip;
+                    skip = 0;
+                }
+
+                msghdr msg{};
+                msg.msg_iov = iov;
+                msg.msg_iovlen = count;
+#ifdef MSG_NOSIGNAL
+                ssize_t n = ::sendmsg(fd_, &msg, MSG_NOSIGNAL);
+#else
+                ssize_t n = ::sendmsg(fd_, &msg, 0);
+#endif
+                if (n < 0)
+                {
+                    if (errno == EINTR)
+                        continue;
+                    if (errno == EAGAIN || errno == EWOULDBLOCK)
+                        break;
+                    lock.unlock();
+                    finish(closeCode::Abnormal, "");
+                    return;
+                }
+
+                auto written = static_cast<size_t>(n);
+                outBytes_ -= written;
+                while (written > 0)
+                {
+                    size_t left = out_.front().size() - headWritten_;
+                    if (written < left)
+                    {
+                        headWritten_ += written;
+                        break;
+                    }
+                    written -= left;
+                    headWritten_ = 0;
+                    out_.pop_front();
+                }
+            }
+
+            bool pending = !out_.empty();
+            if (pending != wantWrite_)
+            {
+                wantWrite_ = pending;
+                loop_.watch(fd_, pending);
+            }
+            lock.unlock();
+
+            if (!pending && closeAfterFlush_)
+                finish(closeCode_, closeReason_);
+        }
+
+        // Keepalive and closing-handshake timeouts (from Loop::sweep)
+        inline void WebSocket::sweep(int64_t now)
+        {
+            if (state_ == State::Closing)
+            {
+                if (now - closeSentAt_ >= closeTimeoutMs)
+                    finish(closeCode::Abnormal, "");
+                return;
+            }
+
+            int64_t idleMs = static_cast<int64_t>(options().idleTimeout) * 1000;
+            if (now - lastActivity_ >= idleMs)
+            {
+                close(closeCode::GoingAway, "idle timeout");
+                flush();
+                finish(closeCode::Abnormal, "idle timeout");
+            }
+            else if (!pingOutstanding_)
+            {
+                pingOutstanding_ = true;
+                ping();
+            }
+        }
+
+        inline void WebSocket::finish(int code, std::string_view reason)
+        {
+            auto self = shared_from_this();
+            std::vector<std::string> topics;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (state_ == State::Closed)
+                    return;
+                state_ = State::Closed;
+                topics.swap(topics_);
+                out_.clear();
+                outBytes_ = 0;
+                headWritten_ = 0;
+            }
+            for (auto &topic : topics)
+                hub_.unsubscribe(topic, self);
+
+            if (fd_ >= 0)
+            {
+                loop_.detach(fd_);
+                ::close(fd_);
+                std::lock_guard<std::mutex> lock(mutex_);
+                fd_ = -1;
+            }
+            if (adopted_)
+                hub_.connections_--;
+
+            if (behavior_->close)
+            {
+                try
+                {
+                    behavior_->close(*this, code, reason);
+                }
+                catch (const std::exception &e)
+                {
+                    std::cerr << "[WebSocket Error] " << remoteAddress_ << " - " << e.what() << std::endl;
+                }
+            }
+
+            std::string().swap(in_);
+            std::string().swap(message_);
+#ifdef XPRESSPP_ZLIB_SUPPORT
+            inflater_.reset();
+            std::string().swap(inflated_);
+            std::lock_guard<std::mutex> lock(mutex_);
+            deflater_.reset();
+#endif
+        }
+
+        // 🔥 A connection between its handshake and its loop
+        // Created once the handshake is valid; adopt() moves the socket to
+        // the loop after the 101 is written. If that never happens (the
+        // write failed), the connection is closed on its loop with 1006.
+        struct Handoff
+        {
+            std::shared_ptr<WebSocket> ws;
+            bool adopted = false;
+
+            explicit Handoff(std::shared_ptr<WebSocket> socket) : ws(std::move(socket)) {}
+            Handoff(const Handoff &) = delete;
+            Handoff &operator=(const Handoff &) = delete;
+
+            ~Handoff()
+            {
+                if (adopted)
+                    return;
+                auto socket = ws;
+                socket->loop_.post([socket]
+                                   { socket->finish(closeCode::Abnormal, ""); });
+            }
+
+            void adopt(std::intptr_t fd, std::string buffered)
+            {
+                adopted = true;
+                auto socket = ws;
+                auto handle = static_cast<int>(fd);
+                socket->loop_.post([socket, handle, buffered = std::move(buffered)]() mutable
+                                   { socket->adopt(handle, std::move(buffered)); });
+            }
+        };
+#else
+        // Builds without the event loop (Windows) answer upgrades with 501
+        class WebSocket;
+
+        class Hub
+        {
+        public:
+            void setThreads(size_t) {}
+            size_t publish(const std::string &, std::string_view, bool = false) { return 0; }
+            size_t connections() const { return 0; }
+            size_t subscribers(const std::string &) const { return 0; }
+            void stop() {}
+        };
+#endif
+
+        // 🔥 Runs the opening handshake on a WebSocket route (App::ws)
+        // Valid upgrades get a 101 with the negotiated subprotocol and
+        // permessage-deflate parameters, and the open callback runs here;
+        // plain requests get 426, malformed ones 400.
+        inline void upgrade(Hub &hub, const std::shared_ptr<const Behavior> &behavior, Request &req, Response &res)
+        {
+            if (!ws_detail::hasToken(req.getHeader("Upgrade"), "websocket") ||
+                !ws_detail::hasToken(req.getHeader("Connection"), "upgrade"))
+            {
+                res.setHeader("Upgrade", "websocket");
+                res.error(426, "WebSocket upgrade required");
+                return;
+            }
+            if (req.httpVersion != "HTTP/1.1")
+            {
+                res.error(400, "WebSocket requires HTTP/1.1");
+                return;
+            }
+            if (req.getHeader("Sec-WebSocket-Version") != "13")
+            {
+                res.setHeader("Sec-WebSocket-Version", "13");
+                res.error(426, "Unsupported WebSocket version");
+                return;
+            }
+            auto key = req.getHeader("Sec-WebSocket-Key");
+            if (!ws_detail::isValidKey(key))
+            {
+                res.error(400, "Invalid Sec-WebSocket-Key");
+                return;
+            }
+
+#ifdef XPRESSPP_WEBSOCKET_LOOP
+            const auto &options = behavior->options;
+
+            std::string protocol;
+            ws_detail::forEachElement(req.getHeader("Sec-WebSocket-Protocol"), [&](std::string_view offered)
+                                      {
+                for (auto &supported : behavior->protocols)
+                {
+                    if (offered == supported)
+                    {
+                        protocol = supported;
+                        return false;
+                    }
+                }
+                return true; });
+
+            DeflateSettings deflate;
+            std::string extensions;
+#ifdef XPRESSPP_ZLIB_SUPPORT
+            if (options.compression)
+                negotiateDeflate(req.getHeader("Sec-WebSocket-Extensions"), options.compressionWindowBits, deflate, extensions);
+#else
+            (void)options;
+#endif
+
+            auto ws = std::make_shared<WebSocket>(hub, hub.assign(), behavior, deflate, req.ip, protocol);
+            auto handoff = std::make_shared<Handoff>(ws);
+
+            res.setHeader("Upgrade", "websocket");
+            res.setHeader("Connection", "Upgrade");
+            res.setHeader("Sec-WebSocket-Accept", acceptKey(key));
+            if (!protocol.empty())
+                res.setHeader("Sec-WebSocket-Protocol", protocol);
+            if (!extensions.empty())
+                res.setHeader("Sec-WebSocket-Extensions", extensions);
+
+            if (behavior->open)
+                behavior->open(*ws, req);
+
+            res.upgrade([handoff](std::intptr_t socket, std::string buffered)
+                        { handoff->adopt(socket, std::move(buffered)); });
+#else
+            (void)hub;
+            (void)behavior;
+            res.error(501, "WebSocket is not supported on this platform");
+#endif
+        }
+    }
+}
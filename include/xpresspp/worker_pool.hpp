@@ -0,0 +1,175 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "async.hpp"
+#include "httplib.h"
+
+namespace xpresspp
+{
+    // 🔥 Worker pool that keeps its strength while handlers are parked
+    // httplib serves a connection on one worker from start to finish unless
+    // the response is suspended, so an async handler on an HTTP/2 stream or
+    // HTTPS still holds its thread while it waits. When a worker parks on
+    // one, the pool may start a replacement (up to maxThreads):
+    // threadPoolSize then bounds running handlers, not waiting ones.
+    // Replacements above threadPoolSize exit after idling for a while.
+    class WorkerPool final : public httplib::TaskQueue, public async_detail::Parker
+    {
+    public:
+        WorkerPool(size_t threads, size_t maxThreads)
+            : core_(std::max<size_t>(threads, 1)), max_(std::max(maxThreads, core_))
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (size_t i = 0; i < core_; i++)
+                spawnLocked();
+        }
+
+        WorkerPool(const WorkerPool &) = delete;
+        WorkerPool &operator=(const WorkerPool &) = delete;
+
+        ~WorkerPool() override { shutdown(); }
+
+        bool enqueue(std::function<void()> fn) override
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (shutdown_)
+                    return false;
+                jobs_.push_back(std::move(fn));
+                if (idle_ == 0)
+                    growLocked();
+            }
+            cv_.notify_one();
+            return true;
+        }
+
+        void shutdown() override
+        {
+            std::list<std::thread> threads;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                shutdown_ = true;
+                threads.swap(threads_);
+            }
+            cv_.notify_all();
+
+            // Queued connections are still served; parked handlers finish first
+            for (auto &thread : threads)
+                thread.join();
+        }
+
+        void park() override
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            parked_++;
+            if (!jobs_.empty() && idle_ == 0)
+                growLocked();
+        }
+
+        void unpark() override
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            parked_--;
+        }
+
+        size_t threads() const
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return live_;
+        }
+
+        size_t parked() const
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return parked_;
+        }
+
+    private:
+        static constexpr std::chrono::seconds idleTimeout{10};
+
+        const size_t core_;
+        const size_t max_;
+
+        mutable std::mutex mutex_;
+        std::condition_variable cv_;
+        std::list<std::function<void()>> jobs_;
+        std::list<std::thread> threads_;
+        std::vector<std::thread::id> exited_; // surplus workers waiting to be joined
+        size_t live_ = 0;
+        size_t idle_ = 0;
+        size_t parked_ = 0;
+        bool shutdown_ = false;
+
+        // One more worker while fewer than core_ are free to run handlers
+        void growLocked()
+        {
+            if (live_ - parked_ < core_ && live_ < max_ && !shutdown_)
+                spawnLocked();
+        }
+
+        void spawnLocked()
+        {
+            // Reap replacements that already exited (they no longer hold the lock)
+            for (auto id : exited_)
+            {
+                auto it = std::find_if(threads_.begin(), threads_.end(), [id](const std::thread &t)
+                                       { return t.get_id() == id; });
+                if (it != threads_.end())
+                {
+                    it->join();
+                    threads_.erase(it);
+                }
+            }
+            exited_.clear();
+
+            live_++;
+            threads_.emplace_back([this]
+                                  { work(); });
+        }
+
+        void work()
+        {
+            async_detail::currentParker() = this;
+
+            std::unique_lock<std::mutex> lock(mutex_);
+            for (;;)
+            {
+                idle_++;
+                bool woken = cv_.wait_for(lock, idleTimeout, [this]
+                                          { return !jobs_.empty() || shutdown_; });
+                idle_--;
+
+                if (jobs_.empty())
+                {
+                    if (shutdown_)
+                        break;
+                    if (!woken && live_ - parked_ > core_)
+                    {
+                        exited_.push_back(std::this_thread::get_id());
+                        break; // surplus replacement, idle too long
+                    }
+                    continue;
+                }
+
+                auto fn = std::move(jobs_.front());
+                jobs_.pop_front();
+                lock.unlock();
+                fn();
+                lock.lock();
+            }
+            live_--;
+            lock.unlock();
+
+#if defined(CPPHTTPLIB_OPENSSL_SUPPORT) && !defined(OPENSSL_IS_BORINGSSL) && \
+    !defined(LIBRESSL_VERSION_NUMBER)
+            OPENSSL_thread_stop();
+#endif
+        }
+    };
+}
@@ -0,0 +1,364 @@
+#pragma once
+#include "compression.hpp"
+
+// Dictionary compression needs libzstd (XPRESSPP_ZSTD_SUPPORT, -lzstd)
+#ifdef XPRESSPP_ZSTD_SUPPORT
+#include <zdict.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include "httplib.h"
+
+namespace xpresspp
+{
+    // 🔥 A trained dictionary, ready for compression
+    struct ZstdDictionary
+    {
+        uint32_t id = 0;
+        std::string bytes;
+        ZSTD_CDict *cdict = nullptr;
+
+        ZstdDictionary() = default;
+        ZstdDictionary(const ZstdDictionary &) = delete;
+        ZstdDictionary &operator=(const ZstdDictionary &) = delete;
+
+        ~ZstdDictionary()
+        {
+            ZSTD_freeCDict(cdict);
+        }
+
+        // Only real zstd dictionaries (magic + non-zero ID) are accepted, so
+        // clients can always find the dictionary from the frame header
+        static std::shared_ptr<const ZstdDictionary> create(std::string bytes, int level)
+        {
+            uint32_t id = ZDICT_getDictID(bytes.data(), bytes.size());
+            if (id == 0)
+                return nullptr;
+
+            auto dictionary = std::make_shared<ZstdDictionary>();
+            dictionary->id = id;
+            dictionary->bytes = std::move(bytes);
+            dictionary->cdict = ZSTD_createCDict(dictionary->bytes.data(), dictionary->bytes.size(), level);
+            if (!dictionary->cdict)
+                return nullptr;
+            return dictionary;
+        }
+    };
+
+    // 🔥 Server side: per-route sampling, background training, compression
+    // Small buffered bodies of each route are sampled until sampleCount is
+    // reached, then a dictionary is trained on a background thread. Routes
+    // listed in DictionaryPolicy::files start with an offline-trained one.
+    class ZstdDictionaryStore
+    {
+    public:
+        static constexpr const char *token = "zdict"; // Accept-Encoding / Content-Encoding
+        static constexpr const char *path = "/_xpresspp/dict/";
+
+        explicit ZstdDictionaryStore(const DictionaryPolicy &policy) : policy_(policy) {}
+
+        ~ZstdDictionaryStore()
+        {
+            std::lock_guard<std::mutex> lock(trainersMutex_);
+            for (auto &trainer : trainers_)
+                trainer->thread.join();
+        }
+
+        // Called for every route before serving; the route table is fixed after
+        void addRoute(const std::string &route)
+        {
+            auto &state = routes_[route];
+            if (state)
+                return;
+            state = std::make_unique<RouteState>();
+
+            auto file = policy_.files.find(route);
+            if (file == policy_.files.end())
+                return;
+
+            std::ifstream in(file->second, std::ios::binary);
+            std::ostringstream buffer;
+            buffer << in.rdbuf();
+            auto dictionary = ZstdDictionary::create(buffer.str(), policy_.level);
+            if (!dictionary)
+            {
+                std::cerr << "⚠️  Ignoring zstd dictionary " << file->second << " (not a zstd dictionary)\n";
+                return;
+            }
+            publish(*state, std::move(dictionary));
+        }
+
+        void sample(const std::string &route, const std::string &body)
+        {
+            auto it = routes_.find(route);
+            if (it == routes_.end() || body.empty() || body.size() > policy_.maxBodySize)
+                return;
+
+            auto &state = *it->second;
+            if (state.done.load(std::memory_order_acquire))
+                return;
+
+            std::lock_guard<std::mutex> lock(state.mutex);
+            if (state.training || state.done.load(std::memory_order_relaxed))
+                return;
+
+            state.samples += body;
+            state.sizes.push_back(body.size());
+            if (state.sizes.size() < policy_.sampleCount)
+                return;
+
+            state.training = true;
+            std::string samples;
+            std::vector<size_t> sizes;
+            samples.swap(state.samples);
+            sizes.swap(state.sizes);
+
+            std::lock_guard<std::mutex> trainersLock(trainersMutex_);
+            reapTrainers();
+            auto trainer = std::make_unique<Trainer>();
+            auto *finished = &trainer->finished;
+            trainer->thread = std::thread([this, &state, finished, samples = std::move(samples), sizes = std::move(sizes)]
+                                          {
+                                              train(state, samples, sizes);
+                                              finished->store(true, std::memory_order_release);
+                                          });
+            trainers_.push_back(std::move(trainer));
+        }
+
+        std::shared_ptr<const ZstdDictionary> forRoute(const std::string &route) const
+        {
+            auto it = routes_.find(route);
+            if (it == routes_.end() || !it->second->done.load(std::memory_order_acquire))
+                return nullptr;
+            return std::atomic_load(&it->second->dictionary);
+        }
+
+        std::shared_ptr<const ZstdDictionary> byId(uint32_t id) const
+        {
+            std::lock_guard<std::mutex> lock(idMutex_);
+            auto it = byId_.find(id);
+            return it != byId_.end() ? it->second : nullptr;
+        }
+
+        // Compresses a whole body in place with the route's dictionary
+        static bool compress(const ZstdDictionary &dictionary, std::string &body)
+        {
+            auto &shared = compression_detail::threadZstd();
+            std::unique_ptr<compression_detail::ZstdContext> owned;
+            compression_detail::ZstdContext *context = &shared;
+            if (shared.busy)
+            {
+                owned = std::make_unique<compression_detail::ZstdContext>();
+                context = owned.get();
+            }
+            if (!context->cctx)
+                context->cctx = ZSTD_createCCtx();
+            if (!context->cctx)
+                return false;
+
+            // The CDict carries the level; start from clean parameters
+            ZSTD_CCtx_reset(context->cctx, ZSTD_reset_session_and_parameters);
+
+            std::string compressed;
+            compressed.resize(ZSTD_compressBound(body.size()));
+            size_t n = ZSTD_compress_usingCDict(context->cctx, &compressed[0], compressed.size(),
+                                                body.data(), body.size(), dictionary.cdict);
+            if (ZSTD_isError(n))
+                return false;
+
+            compressed.resize(n);
+            body.swap(compressed);
+            return true;
+        }
+
+    private:
+        static constexpr int maxAttempts = 3;
+
+        struct RouteState
+        {
+            std::mutex mutex;
+            std::string samples;
+            std::vector<size_t> sizes;
+            bool training = false;
+            int attempts = 0;
+            std::atomic<bool> done{false};
+            std::shared_ptr<const ZstdDictionary> dictionary;
+        };
+
+        DictionaryPolicy policy_;
+        std::unordered_map<std::string, std::unique_ptr<RouteState>> routes_;
+
+        mutable std::mutex idMutex_;
+        std::unordered_map<uint32_t, std::shared_ptr<const ZstdDictionary>> byId_;
+
+        struct Trainer
+        {
+            std::thread thread;
+            std::atomic<bool> finished{false};
+        };
+        std::mutex trainersMutex_;
+        std::vector<std::unique_ptr<Trainer>> trainers_; // running, or finished and not yet joined
+
+        // Joins trainers that are done (trainersMutex_ held)
+        void reapTrainers()
+        {
+            trainers_.erase(std::remove_if(trainers_.begin(), trainers_.end(),
+                                           [](const std::unique_ptr<Trainer> &trainer)
+                                           {
+                                               if (!trainer->finished.load(std::memory_order_acquire))
+                                                   return false;
+                                               trainer->thread.join();
+                                               return true;
+                                           }),
+                            trainers_.end());
+        }
+
+        void train(RouteState &state, const std::string &samples, const std::vector<size_t> &sizes)
+        {
+            // zstd wants roughly 10x more sample data than dictionary
+            size_t capacity = std::min(policy_.dictionarySize, std::max<size_t>(samples.size() / 10, 1024));
+            std::string bytes(capacity, '\0');
+            size_t n = ZDICT_trainFromBuffer(&bytes[0], bytes.size(), samples.data(), sizes.data(),
+                                             static_cast<unsigned>(sizes.size()));
+
+            std::shared_ptr<const ZstdDictionary> dictionary;
+            if (!ZDICT_isError(n))
+            {
+                bytes.resize(n);
+                dictionary = ZstdDictionary::create(std::move(bytes), policy_.level);
+            }
+
+            std::lock_guard<std::mutex> lock(state.mutex);
+            state.training = false;
+            if (dictionary)
+            {
+                publish(state, std::move(dictionary));
+                return;
+            }
+
+            // Too little or too uniform data: sample a fresh batch, then give up
+            if (++state.attempts >= maxAttempts)
+                state.done.store(true, std::memory_order_release);
+        }
+
+        void publish(RouteState &state, std::shared_ptr<const ZstdDictionary> dictionary)
+        {
+            {
+                std::lock_guard<std::mutex> lock(idMutex_);
+                byId_[dictionary->id] = dictionary;
+            }
+            std::atomic_store(&state.dictionary, std::move(dictionary));
+            state.done.store(true, std::memory_order_release);
+        }
+    };
+
+    // 🔥 Client side: decodes "zdict" responses, fetching dictionaries by ID
+    class ZstdDictionaryDecoder
+    {
+    public:
+        ZstdDictionaryDecoder() = default;
+        ZstdDictionaryDecoder(const ZstdDictionaryDecoder &) = delete;
+        ZstdDictionaryDecoder &operator=(const ZstdDictionaryDecoder &) = delete;
+
+        ~ZstdDictionaryDecoder()
+        {
+            for (auto &entry : dictionaries_)
+                ZSTD_freeDDict(entry.second);
+            ZSTD_freeDCtx(dctx_);
+        }
+
+        bool addDictionary(const std::string &bytes)
+        {
+            uint32_t id = ZDICT_getDictID(bytes.data(), bytes.size());
+            if (id == 0 || hasDictionary(id))
+                return id != 0;
+
+            ZSTD_DDict *ddict = ZSTD_createDDict(bytes.data(), bytes.size());
+            if (!ddict)
+                return false;
+            dictionaries_[id] = ddict;
+            return true;
+        }
+
+        bool hasDictionary(uint32_t id) const
+        {
+            return dictionaries_.find(id) != dictionaries_.end();
+        }
+
+        // Dictionary a frame was compressed with (0 = none / not a frame)
+        static uint32_t dictionaryId(const std::string &frame)
+        {
+            return ZSTD_getDictID_fromFrame(frame.data(), frame.size());
+        }
+
+        bool decode(const std::string &frame, std::string &out)
+        {
+            auto it = dictionaries_.find(dictionaryId(frame));
+            if (it == dictionaries_.end())
+                return false;
+
+            if (!dctx_)
+                dctx_ = ZSTD_createDCtx();
+            if (!dctx_)
+                return false;
+            ZSTD_DCtx_reset(dctx_, ZSTD_reset_session_only);
+            ZSTD_DCtx_refDDict(dctx_, it->second);
+
+            out.clear();
+            char buffer[16 * 1024];
+            ZSTD_inBuffer in = {frame.data(), frame.size(), 0};
+            size_t ret = 1;
+            while (in.pos < in.size)
+            {
+                ZSTD_outBuffer outBuf = {buffer, sizeof(buffer), 0};
+                ret = ZSTD_decompressStream(dctx_, &outBuf, &in);
+                if (ZSTD_isError(ret))
+                    return false;
+                out.append(buffer, outBuf.pos);
+                if (ret == 0 && in.pos < in.size)
+                    return false; // trailing data after the frame
+            }
+            return ret == 0;
+        }
+
+        // GET through an httplib client, advertising zdict and resolving
+        // unknown dictionaries from the server's /_xpresspp/dict/<id>
+        httplib::Result get(httplib::Client &client, const std::string &target, httplib::Headers headers = {})
+        {
+            headers.emplace("Accept-Encoding", ZstdDictionaryStore::token);
+            client.set_decompress(false);
+
+            auto result = client.Get(target, headers);
+            if (!result || result->get_header_value("Content-Encoding") != ZstdDictionaryStore::token)
+                return result;
+
+            uint32_t id = dictionaryId(result->body);
+            if (!hasDictionary(id))
+            {
+                auto dictionary = client.Get(ZstdDictionaryStore::path + std::to_string(id));
+                if (!dictionary || dictionary->status != 200 || !addDictionary(dictionary->body))
+                    return result;
+            }
+
+            std::string decoded;
+            if (decode(result->body, decoded))
+            {
+                result->body.swap(decoded);
+                result->headers.erase("Content-Encoding");
+                result->headers.erase("Content-Length");
+            }
+            return result;
+        }
+
+    private:
+        ZSTD_DCtx *dctx_ = nullptr;
+        std::unordered_map<uint32_t, ZSTD_DDict *> dictionaries_;
+    };
+}
+#endif
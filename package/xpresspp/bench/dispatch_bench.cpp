@@ -0,0 +1,144 @@
+// 🔥 Handler dispatch benchmark: std::function vs Handler vs static routes
+//
+// Stores the same trivial handler several ways, calls each one in a loop
+// and reports nanoseconds per call and heap allocations spent storing the
+// handler:
+//   std::function: the old Route::handler, holding a 56-byte capture
+//   Handler:       the same 56-byte capture, stored inline
+//   fn pointer:    app.get("/fn", onRequest) - the thunk calls through
+//                  the stored pointer (two indirect calls)
+//   static:        app.get<onRequest>("/static") - onRequest is called
+//                  directly from the thunk and can be inlined
+//
+// Build:
+//   g++ -std=c++17 -O2 package/xpresspp/bench/dispatch_bench.cpp package/xpresspp/src/app.cpp -Iinclude -lpthread -o dispatch_bench
+// Run:
+//   ./dispatch_bench --calls 50000000 --rounds 5
+
+#include <xpresspp/app.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <string>
+#include <vector>
+
+using namespace xpresspp;
+using Clock = std::chrono::steady_clock;
+
+// Every heap allocation in the process is counted. Scalar and array
+// forms, sized and unsized, all replaced so each new pairs with its delete
+static std::atomic<size_t> allocations{0};
+
+static void *counted(size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void *operator new(size_t size) { return counted(size); }
+void *operator new[](size_t size) { return counted(size); }
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+void operator delete[](void *p, size_t) noexcept { std::free(p); }
+
+// Written by every handler so the calls are not optimized away
+static volatile unsigned sink = 0;
+
+static void onRequest(Request &, Response &) { sink = sink + 1; }
+
+// A capture the size of a shared_ptr, a std::string and a reference
+struct Captured
+{
+    char bytes[56];
+};
+
+struct Result
+{
+    double ns = 0;
+    size_t allocations = 0; // to store the handler
+};
+
+template <typename Fn>
+static double best(int rounds, size_t calls, Fn fn)
+{
+    double ns = 1e300;
+    for (int r = 0; r < rounds; r++)
+    {
+        auto start = Clock::now();
+        fn();
+        ns = std::min(ns, std::chrono::duration<double, std::nano>(Clock::now() - start).count() / calls);
+    }
+    return ns;
+}
+
+int main(int argc, char **argv)
+{
+    size_t calls = 50000000;
+    int rounds = 5;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if (!std::strcmp(argv[i], "--calls"))
+            calls = std::strtoul(argv[i + 1], nullptr, 10);
+        else if (!std::strcmp(argv[i], "--rounds"))
+            rounds = std::atoi(argv[i + 1]);
+    }
+
+    Captured captured{};
+    captured.bytes[0] = 1;
+    auto capturing = [captured](Request &, Response &)
+    { sink = sink + captured.bytes[0]; };
+
+    Request req;
+    Response res;
+
+    // The old route table: a vector of std::function
+    std::vector<std::function<void(Request &, Response &)>> functions;
+    functions.reserve(1);
+    size_t reserved = allocations.load();
+    functions.emplace_back(capturing);
+    Result function{0, allocations.load() - reserved};
+    function.ns = best(rounds, calls, [&]
+                       {
+        for (size_t i = 0; i < calls; i++)
+            functions.front()(req, res); });
+
+    App app;
+    app.get("/capture", capturing);
+    app.get("/fn", onRequest);
+    app.get<onRequest>("/static");
+    app.compile();
+
+    auto viaRoute = [&](const Route &route)
+    {
+        return best(rounds, calls, [&]
+                    {
+            for (size_t i = 0; i < calls; i++)
+                route.handler(req, res); });
+    };
+    const auto &routes = app.getRoutes();
+
+    // Handler's storage cost, measured on its own
+    reserved = allocations.load();
+    Handler stored(capturing);
+    Result handler{0, allocations.load() - reserved};
+    handler.ns = viaRoute(routes[0]);
+    Result pointer{viaRoute(routes[1]), 0};
+    Result direct{viaRoute(routes[2]), 0};
+
+    std::printf("%zu calls, best of %d rounds\n", calls, rounds);
+    std::printf("  std::function, 56-byte capture  %5.2f ns/call  %zu allocations to store\n", function.ns, function.allocations);
+    std::printf("  Handler, 56-byte capture        %5.2f ns/call  %zu allocations to store\n", handler.ns, handler.allocations);
+    std::printf("  app.get(path, fn)               %5.2f ns/call\n", pointer.ns);
+    std::printf("  app.get<fn>(path)               %5.2f ns/call\n", direct.ns);
+    std::printf("(%u handler runs)\n", static_cast<unsigned>(sink));
+    return 0;
+}
@@ -0,0 +1,315 @@
+// 🔥 HTTP/2 benchmark: multiplexing vs HTTP/1.1 pipelining on one connection
+//
+// Drives http2::Client against the demo server and runs the same requests
+// pipelined over a keep-alive HTTP/1.1 connection for comparison:
+//   hol: one slow request (/timing, 100 ms) followed by --fast requests
+//        to /health on the same connection; reports when the fast ones
+//        complete. Over HTTP/1.1 they queue behind the slow one.
+//   mux: --connections clients (one thread each) send batches of
+//        --requests GETs alternating / and /health, for --rounds rounds;
+//        reports requests per second and per-request latency. HTTP/1.1
+//        needs a new connection every 100 requests (httplib's keep-alive
+//        limit); --fast is kept below that.
+//
+// Build (Linux):
+//   g++ -std=c++17 -O2 package/xpresspp/bench/http2_bench.cpp -Iinclude -lpthread -o http2_bench
+// Run against the demo server (config.enableHTTP2 = true):
+//   ./http2_bench --mode hol --fast 20
+//   ./http2_bench --mode mux --connections 8 --requests 500 --rounds 20
+
+#include <xpresspp/http2.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace xpresspp;
+using Clock = std::chrono::steady_clock;
+
+struct Options
+{
+    std::string host = "127.0.0.1";
+    int port = 5000;
+    std::string mode = "hol";
+    size_t fast = 20;
+    size_t connections = 8;
+    size_t requests = 500;
+    size_t rounds = 20;
+};
+
+static Options options;
+static constexpr size_t keepAliveMax = CPPHTTPLIB_KEEPALIVE_MAX_COUNT;
+
+static double ms(Clock::duration d) { return std::chrono::duration<double, std::milli>(d).count(); }
+
+static double percentile(std::vector<double> values, double p)
+{
+    if (values.empty())
+        return 0;
+    std::sort(values.begin(), values.end());
+    return values[std::min(values.size() - 1, static_cast<size_t>(p * values.size()))];
+}
+
+// 🔥 Minimal pipelining HTTP/1.1 client (Content-Length and chunked bodies)
+// Writes every request up front, then reads the responses in order and
+// records when each one is complete.
+class PipelinedClient
+{
+public:
+    struct Result
+    {
+        int status = 0; // 0 = lost
+        Clock::duration elapsed{};
+    };
+
+    PipelinedClient(const std::string &host, int port)
+    {
+        httplib::Error error = httplib::Error::Success;
+        sock_ = httplib::detail::create_client_socket(host, std::string(), port, AF_UNSPEC, true, false,
+                                                       nullptr, 30, 0, 30, 0, 30, 0, std::string(), error);
+        host_ = host + ":" + std::to_string(port);
+    }
+
+    ~PipelinedClient()
+    {
+        if (sock_ != INVALID_SOCKET)
+            httplib::detail::close_socket(sock_);
+    }
+
+    std::vector<Result> send(const std::vector<std::string> &paths)
+    {
+        std::vector<Result> results(paths.size());
+        if (sock_ == INVALID_SOCKET)
+            return results;
+
+        std::string out;
+        for (auto &path : paths)
+            out += "GET " + path + " HTTP/1.1\r\nHost: " + host_ + "\r\n\r\n";
+        auto start = Clock::now();
+        for (size_t sent = 0; sent < out.size();)
+        {
+            auto n = ::send(sock_, out.data() + sent, out.size() - sent, MSG_NOSIGNAL);
+            if (n <= 0)
+                return results;
+            sent += static_cast<size_t>(n);
+        }
+
+        for (auto &result : results)
+        {
+            result.status = readResponse();
+            result.elapsed = Clock::now() - start;
+            if (result.status == 0)
+                break;
+        }
+        return results;
+    }
+
+private:
+    socket_t sock_ = INVALID_SOCKET;
+    std::string host_;
+    std::string in_;
+    size_t offset_ = 0;
+
+    bool fill()
+    {
+        if (offset_ > 0 && offset_ == in_.size())
+            in_.clear(), offset_ = 0;
+        char buffer[65536];
+        auto n = ::recv(sock_, buffer, sizeof(buffer), 0);
+        if (n <= 0)
+            return false;
+        in_.append(buffer, static_cast<size_t>(n));
+        return true;
+    }
+
+    // Up to and including the next CRLF
+    bool line(std::string &out)
+    {
+        size_t end;
+        while ((end = in_.find("\r\n", offset_)) == std::string::npos)
+            if (!fill())
+                return false;
+        out.assign(in_, offset_, end - offset_);
+        offset_ = end + 2;
+        return true;
+    }
+
+    bool skip(size_t bytes)
+    {
+        while (in_.size() - offset_ < bytes)
+            if (!fill())
+                return false;
+        offset_ += bytes;
+        return true;
+    }
+
+    int readResponse()
+    {
+        std::string text;
+        if (!line(text) || text.size() < 12)
+            return 0;
+        int status = std::atoi(text.c_str() + 9);
+
+        size_t length = 0;
+        bool chunked = false;
+        while (line(text) && !text.empty())
+        {
+            auto colon = text.find(':');
+            if (colon == std::string::npos)
+                continue;
+            auto name = text.substr(0, colon);
+            auto value = text.c_str() + colon + 1;
+            if (httplib::detail::case_ignore::equal(name, "Content-Length"))
+                length = std::strtoul(value, nullptr, 10);
+            else if (httplib::detail::case_ignore::equal(name, "Transfer-Encoding"))
+                chunked = std::strstr(value, "chunked") != nullptr;
+        }
+        if (!chunked)
+            return skip(length) ? status : 0;
+
+        for (;;)
+        {
+            if (!line(text))
+                return 0;
+            size_t size = std::strtoul(text.c_str(), nullptr, 16);
+            if (!skip(size) || !line(text)) // data, then its CRLF
+                return 0;
+            if (size == 0)
+                return status;
+        }
+    }
+};
+
+static void headOfLine()
+{
+    options.fast = std::min(options.fast, keepAliveMax - 1);
+    std::vector<http2::Client::Request> requests(1 + options.fast);
+    std::vector<std::string> paths(1 + options.fast, "/health");
+    requests[0].path = paths[0] = "/timing";
+    for (size_t i = 1; i < requests.size(); i++)
+        requests[i].path = "/health";
+
+    http2::Client client(options.host, options.port);
+    client.get("/health"); // connection and SETTINGS out of the way
+    auto h2 = client.send(requests);
+
+    PipelinedClient pipelined(options.host, options.port);
+    auto h1 = pipelined.send(paths);
+
+    std::printf("hol: /timing then %zu x /health on one connection\n", options.fast);
+    std::vector<double> fast2, fast1;
+    for (size_t i = 1; i < requests.size(); i++)
+    {
+        fast2.push_back(ms(h2[i].elapsed));
+        fast1.push_back(ms(h1[i].elapsed));
+    }
+    std::printf("  HTTP/2:   /timing %7.1f ms (%d)  /health median %6.1f ms, last %6.1f ms\n",
+                ms(h2[0].elapsed), h2[0].status, percentile(fast2, 0.5), percentile(fast2, 1));
+    std::printf("  HTTP/1.1: /timing %7.1f ms (%d)  /health median %6.1f ms, last %6.1f ms\n",
+                ms(h1[0].elapsed), h1[0].status, percentile(fast1, 0.5), percentile(fast1, 1));
+}
+
+struct MuxResult
+{
+    std::vector<double> latencies; // ms
+    size_t failed = 0;
+};
+
+static void multiplexed(bool http2)
+{
+    std::vector<http2::Client::Request> requests(options.requests);
+    std::vector<std::string> paths(options.requests);
+    for (size_t i = 0; i < requests.size(); i++)
+        requests[i].path = paths[i] = i % 2 ? "/health" : "/";
+
+    std::vector<MuxResult> results(options.connections);
+    std::vector<std::thread> threads;
+    auto start = Clock::now();
+    for (size_t t = 0; t < options.connections; t++)
+        threads.emplace_back([&, t]
+                             {
+            auto &result = results[t];
+            if (http2)
+            {
+                http2::Client client(options.host, options.port);
+                for (size_t r = 0; r < options.rounds; r++)
+                    for (auto &response : client.send(requests))
+                    {
+                        result.latencies.push_back(ms(response.elapsed));
+                        result.failed += response.status != 200;
+                    }
+                return;
+            }
+            // httplib closes a keep-alive connection after 100 requests:
+            // pipeline the batch over as many connections as that takes
+            for (size_t r = 0; r < options.rounds; r++)
+                for (size_t first = 0; first < paths.size(); first += keepAliveMax)
+                {
+                    PipelinedClient client(options.host, options.port);
+                    auto last = std::min(paths.size(), first + keepAliveMax);
+                    for (auto &response : client.send({paths.begin() + first, paths.begin() + last}))
+                    {
+                        result.latencies.push_back(ms(response.elapsed));
+                        result.failed += response.status != 200;
+                    }
+                } });
+    for (auto &thread : threads)
+        thread.join();
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    std::vector<double> latencies;
+    size_t failed = 0;
+    for (auto &result : results)
+    {
+        latencies.insert(latencies.end(), result.latencies.begin(), result.latencies.end());
+        failed += result.failed;
+    }
+    std::printf("  %-9s %9.0f requests/s  latency p50 %6.2f ms  p99 %6.2f ms  %zu not 200\n",
+                http2 ? "HTTP/2:" : "HTTP/1.1:", latencies.size() / seconds,
+                percentile(latencies, 0.5), percentile(latencies, 0.99), failed);
+}
+
+int main(int argc, char **argv)
+{
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if (!std::strcmp(argv[i], "--host"))
+            options.host = argv[i + 1];
+        else if (!std::strcmp(argv[i], "--port"))
+            options.port = std::atoi(argv[i + 1]);
+        else if (!std::strcmp(argv[i], "--mode"))
+            options.mode = argv[i + 1];
+        else if (!std::strcmp(argv[i], "--fast"))
+            options.fast = std::strtoul(argv[i + 1], nullptr, 10);
+        else if (!std::strcmp(argv[i], "--connections"))
+            options.connections = std::strtoul(argv[i + 1], nullptr, 10);
+        else if (!std::strcmp(argv[i], "--requests"))
+            options.requests = std::strtoul(argv[i + 1], nullptr, 10);
+        else if (!std::strcmp(argv[i], "--rounds"))
+            options.rounds = std::strtoul(argv[i + 1], nullptr, 10);
+    }
+
+    http2::Client probe(options.host, options.port);
+    if (probe.get("/health").status != 200)
+    {
+        std::fprintf(stderr, "no HTTP/2 on %s:%d (is the demo running with enableHTTP2?)\n",
+                     options.host.c_str(), options.port);
+        return 1;
+    }
+
+    if (options.mode == "hol")
+        headOfLine();
+    else
+    {
+        std::printf("mux: %zu connections x %zu rounds x %zu requests (/ and /health)\n",
+                    options.connections, options.rounds, options.requests);
+        multiplexed(true);
+        multiplexed(false);
+    }
+    return 0;
+}
@@ -0,0 +1,143 @@
+// 🔥 Response serialization benchmark: res.json(DOM) vs res.jsonDirect
+//
+// Serializes the same payload into a Response body both ways and reports
+// time and heap allocations per response:
+//   dom:    res.json(json(users)) - builds an nlohmann::json DOM, dumps it
+//   direct: res.jsonDirect(users) - XPRESSPP_JSON types written by JsonWriter
+//   pairs:  res.json({{"k", v}, ...}) - the initializer_list overload
+//
+// Build:
+//   g++ -std=c++17 -O2 package/xpresspp/bench/json_bench.cpp -Iinclude -o json_bench
+// Run:
+//   ./json_bench --users 10000 --rounds 20
+
+#include <xpresspp/response.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+
+using namespace xpresspp;
+using Clock = std::chrono::steady_clock;
+
+// Every heap allocation in the process is counted; new[] and the sized
+// deletes are replaced too, so no allocation meets a foreign delete
+static std::atomic<size_t> allocations{0};
+
+static void *counted(size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void *operator new(size_t size) { return counted(size); }
+void *operator new[](size_t size) { return counted(size); }
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+void operator delete[](void *p, size_t) noexcept { std::free(p); }
+
+struct Address
+{
+    std::string street;
+    std::string city;
+    int zip = 0;
+};
+XPRESSPP_JSON(Address, street, city, zip)
+
+struct User
+{
+    int id = 0;
+    std::string name;
+    std::string email;
+    bool active = false;
+    double score = 0;
+    Address address;
+    std::vector<std::string> tags;
+};
+XPRESSPP_JSON(User, id, name, email, active, score, address, tags)
+
+static std::vector<User> makeUsers(size_t count)
+{
+    std::vector<User> users(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        auto &u = users[i];
+        u.id = static_cast<int>(i);
+        u.name = "User \"" + std::to_string(i) + "\"";
+        u.email = "user" + std::to_string(i) + "@example.com";
+        u.active = i % 3 != 0;
+        u.score = static_cast<double>(i) * 1.25 + 0.5;
+        u.address = {std::to_string(i) + " Main Street", "Springfield", 10000 + static_cast<int>(i % 90000)};
+        u.tags = {"alpha", "beta", i % 2 ? "odd" : "even"};
+    }
+    return users;
+}
+
+struct Result
+{
+    double ms = 0;
+    size_t allocations = 0;
+    size_t bytes = 0;
+};
+
+template <typename Fn>
+static Result measure(int rounds, Fn fn)
+{
+    Result best{1e300, 0, 0};
+    for (int r = 0; r < rounds; r++)
+    {
+        Response res;
+        size_t before = allocations.load();
+        auto start = Clock::now();
+        fn(res);
+        double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        size_t allocated = allocations.load() - before;
+        if (ms < best.ms)
+            best = {ms, allocated, res.getBody().size()};
+    }
+    return best;
+}
+
+int main(int argc, char **argv)
+{
+    size_t users = 10000;
+    int rounds = 20;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if (!std::strcmp(argv[i], "--users"))
+            users = std::strtoul(argv[i + 1], nullptr, 10);
+        else if (!std::strcmp(argv[i], "--rounds"))
+            rounds = std::atoi(argv[i + 1]);
+    }
+
+    auto data = makeUsers(users);
+
+    auto dom = measure(rounds, [&](Response &res)
+                       { res.json(json(data)); });
+    auto direct = measure(rounds, [&](Response &res)
+                          { res.jsonDirect(data); });
+    auto pairs = measure(rounds * 1000, [&](Response &res)
+                         { res.json({{"id", 42}, {"name", "Ada"}, {"active", true}, {"score", 9.5}}); });
+
+    Response check;
+    check.json(json(data));
+    std::string viaDom = check.getBody();
+    check.jsonDirect(data);
+    // Same document; the DOM sorts keys, jsonDirect keeps declaration order
+    bool same = json::parse(viaDom) == json::parse(check.getBody());
+
+    std::printf("%zu users, best of %d rounds\n", users, rounds);
+    std::printf("  res.json(json(users))  %8.2f ms  %8zu allocations  %zu bytes\n", dom.ms, dom.allocations, dom.bytes);
+    std::printf("  res.jsonDirect(users)  %8.2f ms  %8zu allocations  %zu bytes\n", direct.ms, direct.allocations, direct.bytes);
+    std::printf("  same document: %s\n", same ? "yes" : "NO");
+    std::printf("small object, res.json({pairs}): %.0f ns  %zu allocations\n", pairs.ms * 1e6, pairs.allocations);
+    return same ? 0 : 1;
+}
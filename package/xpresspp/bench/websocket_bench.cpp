@@ -0,0 +1,416 @@
+// 🔥 WebSocket echo / broadcast benchmark for App::ws routes
+//
+// Opens many connections from one thread (epoll), then either
+//   echo:      every connection sends a message and waits for it to come
+//              back, for --rounds rounds (routes/main.cpp: /ws/echo)
+//   broadcast: one connection per round sends a message that the server
+//              publishes to the whole topic; a round ends when every other
+//              connection has it (routes/main.cpp: /ws/chat/:room)
+//
+// Build (Linux):
+//   g++ -std=c++17 -O2 package/xpresspp/bench/websocket_bench.cpp -Iinclude -o ws_bench
+// Run against the demo server (raise the descriptor limit on both sides):
+//   ulimit -n 120000
+//   ./ws_bench --connections 50000 --mode echo --path /ws/echo
+//   ./ws_bench --connections 50000 --mode broadcast --path /ws/chat/bench
+// Loopback has ~28k ephemeral ports per source address: --sources N binds
+// connections round-robin to 127.0.0.1 .. 127.0.0.N.
+
+#include <xpresspp/websocket.hpp>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <cstring>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace xpresspp;
+using Clock = std::chrono::steady_clock;
+
+struct Options
+{
+    std::string host = "127.0.0.1";
+    int port = 5000;
+    std::string path = "/ws/echo";
+    std::string mode = "echo";
+    size_t connections = 1000;
+    size_t rounds = 10;
+    size_t size = 64;
+    int sources = 2;
+    size_t inflight = 1000; // concurrent handshakes
+    int serverPid = 0;      // report the server's RSS
+};
+
+struct Connection
+{
+    int fd = -1;
+    enum
+    {
+        Connecting,
+        Handshake,
+        Open,
+        Failed
+    } state = Connecting;
+    std::string key;
+    std::string in;
+    std::string out;
+    size_t outOffset = 0;
+    size_t messages = 0; // received this round
+    bool joined = false; // broadcast: the room's welcome message arrived
+    Clock::time_point sentAt;
+};
+
+static int epollFd;
+static Options options;
+static std::vector<Connection> connections;
+static std::vector<double> latencies; // ms
+static size_t open_ = 0, failed = 0, pendingMessages = 0;
+static std::mt19937 rng(42);
+static std::string marker; // counts only this round's messages (rooms also carry join/leave news)
+
+static double ms(Clock::duration d) { return std::chrono::duration<double, std::milli>(d).count(); }
+
+static long rssKb(int pid)
+{
+    std::ifstream status("/proc/" + std::to_string(pid) + "/status");
+    std::string line;
+    while (std::getline(status, line))
+        if (line.rfind("VmRSS:", 0) == 0)
+            return std::atol(line.c_str() + 6);
+    return -1;
+}
+
+static void watch(Connection &c, bool writable)
+{
+    epoll_event ev{};
+    ev.events = EPOLLIN | (writable ? static_cast<uint32_t>(EPOLLOUT) : 0u);
+    ev.data.u32 = static_cast<uint32_t>(&c - connections.data());
+    epoll_ctl(epollFd, EPOLL_CTL_MOD, c.fd, &ev);
+}
+
+static void fail(Connection &c)
+{
+    if (c.state == Connection::Open)
+        open_--;
+    c.state = Connection::Failed;
+    failed++;
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, c.fd, nullptr);
+    ::close(c.fd);
+}
+
+static void flush(Connection &c)
+{
+    while (c.outOffset < c.out.size())
+    {
+        ssize_t n = ::send(c.fd, c.out.data() + c.outOffset, c.out.size() - c.outOffset, MSG_NOSIGNAL);
+        if (n < 0)
+        {
+            if (errno == EAGAIN)
+                break;
+            return fail(c);
+        }
+        c.outOffset += static_cast<size_t>(n);
+    }
+    bool pending = c.outOffset < c.out.size();
+    if (!pending)
+        c.out.clear(), c.outOffset = 0;
+    watch(c, pending || c.state == Connection::Connecting);
+}
+
+// Client frames are masked (RFC 6455 5.3)
+static void sendMessage(Connection &c, const std::string &payload)
+{
+    uint8_t key[4];
+    uint32_t r = rng();
+    std::memcpy(key, &r, 4);
+    websocket::ws_detail::appendFrameHeader(c.out, websocket::opcode::Text, payload.size(), false, key);
+    size_t body = c.out.size();
+    c.out += payload;
+    websocket::ws_detail::applyMask(&c.out[body], payload.size(), key);
+    c.sentAt = Clock::now();
+    flush(c);
+}
+
+static void startConnect(Connection &c, size_t index)
+{
+    c.fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (c.fd < 0)
+    {
+        c.state = Connection::Failed;
+        failed++;
+        return;
+    }
+    int on = 1;
+    setsockopt(c.fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+
+    if (options.sources > 1)
+    {
+        sockaddr_in local{};
+        local.sin_family = AF_INET;
+        local.sin_addr.s_addr = htonl(0x7f000001 + static_cast<uint32_t>(index % options.sources));
+        // let connect() pick the port: bind() would scan the whole range each time
+        setsockopt(c.fd, IPPROTO_IP, IP_BIND_ADDRESS_NO_PORT, &on, sizeof(on));
+        bind(c.fd, reinterpret_cast<sockaddr *>(&local), sizeof(local));
+    }
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(options.port));
+    inet_pton(AF_INET, options.host.c_str(), &addr.sin_addr);
+    ::connect(c.fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr));
+
+    uint8_t raw[16];
+    for (auto &b : raw)
+        b = static_cast<uint8_t>(rng());
+    c.key = websocket::ws_detail::base64Encode(raw, sizeof(raw));
+    c.out = "GET " + options.path + " HTTP/1.1\r\nHost: " + options.host +
+            "\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Version: 13\r\nSec-WebSocket-Key: " +
+            c.key + "\r\n\r\n";
+
+    epoll_event ev{};
+    ev.events = EPOLLIN | EPOLLOUT;
+    ev.data.u32 = static_cast<uint32_t>(index);
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, c.fd, &ev);
+}
+
+static void onMessage(Connection &c, std::string_view payload)
+{
+    if (options.mode == "broadcast" && !c.joined)
+    {
+        c.joined = true; // welcome message from open()
+        open_++;
+        return;
+    }
+    if (payload.find(marker) == std::string_view::npos)
+        return;
+    c.messages++;
+    if (pendingMessages > 0)
+        pendingMessages--;
+    latencies.push_back(ms(Clock::now() - c.sentAt));
+}
+
+static void onReadable(Connection &c)
+{
+    char buffer[64 * 1024];
+    for (;;)
+    {
+        ssize_t n = ::recv(c.fd, buffer, sizeof(buffer), 0);
+        if (n == 0 || (n < 0 && errno != EAGAIN))
+            return fail(c);
+        if (n < 0)
+            break;
+        c.in.append(buffer, static_cast<size_t>(n));
+    }
+
+    if (c.state == Connection::Handshake)
+    {
+        auto end = c.in.find("\r\n\r\n");
+        if (end == std::string::npos)
+            return;
+        if (c.in.compare(0, 12, "HTTP/1.1 101") != 0 ||
+            c.in.find(websocket::acceptKey(c.key)) == std::string::npos)
+            return fail(c);
+        c.in.erase(0, end + 4);
+        c.state = Connection::Open;
+        if (options.mode == "echo")
+            open_++;
+    }
+
+    size_t offset = 0;
+    for (;;)
+    {
+        websocket::ws_detail::FrameHeader header;
+        size_t headerSize = websocket::ws_detail::parseFrameHeader(c.in.data() + offset, c.in.size() - offset, header);
+        if (headerSize == 0 || c.in.size() - offset - headerSize < header.length)
+            break;
+        if (header.opcode == websocket::opcode::Text || header.opcode == websocket::opcode::Binary)
+            onMessage(c, std::string_view(c.in).substr(offset + headerSize, header.length));
+        else if (header.opcode == websocket::opcode::Ping)
+        {
+            uint8_t key[4] = {1, 2, 3, 4};
+            std::string payload = c.in.substr(offset + headerSize, header.length);
+            websocket::ws_detail::appendFrameHeader(c.out, websocket::opcode::Pong, payload.size(), false, key);
+            websocket::ws_detail::applyMask(&payload[0], payload.size(), key);
+            c.out += payload;
+            flush(c);
+        }
+        offset += headerSize + header.length;
+    }
+    c.in.erase(0, offset);
+}
+
+static void poll(int timeoutMs)
+{
+    epoll_event events[1024];
+    int n = epoll_wait(epollFd, events, 1024, timeoutMs);
+    for (int i = 0; i < n; i++)
+    {
+        auto &c = connections[events[i].data.u32];
+        if (c.state == Connection::Failed)
+            continue;
+        if (c.state == Connection::Connecting && (events[i].events & (EPOLLOUT | EPOLLERR)))
+        {
+            int error = 0;
+            socklen_t length = sizeof(error);
+            getsockopt(c.fd, SOL_SOCKET, SO_ERROR, &error, &length);
+            if (error)
+            {
+                fail(c);
+                continue;
+            }
+            c.state = Connection::Handshake;
+        }
+        if (events[i].events & EPOLLOUT)
+            flush(c);
+        if (c.state != Connection::Failed && (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)))
+            onReadable(c);
+    }
+}
+
+static void report(const char *label, double elapsedMs, size_t messages)
+{
+    std::sort(latencies.begin(), latencies.end());
+    auto pct = [](double p)
+    { return latencies.empty() ? 0.0 : latencies[std::min(latencies.size() - 1, static_cast<size_t>(p * latencies.size()))]; };
+    std::printf("%s: %zu messages in %.0f ms = %.0f msg/s, latency p50 %.2f ms, p99 %.2f ms, max %.2f ms\n",
+                label, messages, elapsedMs, messages / (elapsedMs / 1000), pct(0.50), pct(0.99),
+                latencies.empty() ? 0.0 : latencies.back());
+    latencies.clear();
+}
+
+int main(int argc, char **argv)
+{
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string flag = argv[i], value = argv[i + 1];
+        if (flag == "--host")
+            options.host = value;
+        else if (flag == "--port")
+            options.port = std::atoi(value.c_str());
+        else if (flag == "--path")
+            options.path = value;
+        else if (flag == "--mode")
+            options.mode = value;
+        else if (flag == "--connections")
+            options.connections = std::strtoul(value.c_str(), nullptr, 10);
+        else if (flag == "--rounds")
+            options.rounds = std::strtoul(value.c_str(), nullptr, 10);
+        else if (flag == "--size")
+            options.size = std::strtoul(value.c_str(), nullptr, 10);
+        else if (flag == "--sources")
+            options.sources = std::atoi(value.c_str());
+        else if (flag == "--inflight")
+            options.inflight = std::strtoul(value.c_str(), nullptr, 10);
+        else if (flag == "--server-pid")
+            options.serverPid = std::atoi(value.c_str());
+    }
+
+    rlimit limit{};
+    getrlimit(RLIMIT_NOFILE, &limit);
+    if (limit.rlim_cur < options.connections + 16)
+        std::fprintf(stderr, "⚠️  open file limit %lu < %zu connections: raise it with ulimit -n\n",
+                     static_cast<unsigned long>(limit.rlim_cur), options.connections);
+
+    epollFd = epoll_create1(0);
+    connections.resize(options.connections);
+    long rssBefore = options.serverPid ? rssKb(options.serverPid) : -1;
+
+    // ---- Connect + handshake, at most `inflight` at a time
+    auto start = Clock::now();
+    size_t next = 0;
+    while (open_ + failed < options.connections)
+    {
+        while (next < options.connections && next - open_ - failed < options.inflight)
+        {
+            startConnect(connections[next], next);
+            next++;
+        }
+        poll(100);
+        if (ms(Clock::now() - start) > 120000)
+            break;
+    }
+    double connectMs = ms(Clock::now() - start);
+    std::printf("connected %zu/%zu in %.0f ms (%zu failed)\n", open_, options.connections, connectMs, failed);
+    if (rssBefore >= 0)
+    {
+        long rss = rssKb(options.serverPid);
+        std::printf("server RSS %ld KB -> %ld KB (%.1f KB per connection)\n", rssBefore, rss,
+                    open_ ? double(rss - rssBefore) / open_ : 0.0);
+    }
+
+    std::string payload;
+    auto nextRound = [&](size_t round)
+    {
+        marker = "#" + std::to_string(round) + "#";
+        payload = marker + std::string(options.size > marker.size() ? options.size - marker.size() : 0, 'x');
+    };
+    auto deadline = [&](Clock::time_point begin)
+    { return ms(Clock::now() - begin) > 60000; };
+
+    if (options.mode == "echo")
+    {
+        // ---- Every connection sends, all wait for their echo
+        auto begin = Clock::now();
+        size_t total = 0;
+        for (size_t round = 0; round < options.rounds; round++)
+        {
+            nextRound(round);
+            pendingMessages = 0;
+            for (auto &c : connections)
+                if (c.state == Connection::Open)
+                    sendMessage(c, payload), pendingMessages++;
+            total += pendingMessages;
+            while (pendingMessages > 0 && !deadline(begin))
+                poll(100);
+        }
+        report("echo", ms(Clock::now() - begin), total - pendingMessages);
+    }
+    else
+    {
+        // ---- One sender per round, the server fans out to everyone else
+        std::vector<size_t> live;
+        for (size_t i = 0; i < connections.size(); i++)
+            if (connections[i].state == Connection::Open)
+                live.push_back(i);
+        if (live.size() < 2)
+            return 1;
+
+        auto begin = Clock::now();
+        size_t total = 0;
+        std::vector<double> fanout;
+        for (size_t round = 0; round < options.rounds; round++)
+        {
+            nextRound(round);
+            auto &sender = connections[live[round % live.size()]];
+            auto sentAt = Clock::now();
+            for (auto index : live)
+                connections[index].sentAt = sentAt;
+            pendingMessages = live.size() - 1;
+            total += pendingMessages;
+            sendMessage(sender, payload);
+            while (pendingMessages > 0 && !deadline(begin))
+                poll(100);
+            fanout.push_back(ms(Clock::now() - sentAt));
+        }
+        report("broadcast deliveries", ms(Clock::now() - begin), total - pendingMessages);
+        std::sort(fanout.begin(), fanout.end());
+        std::printf("fan-out to %zu subscribers: median %.1f ms, worst %.1f ms per message\n",
+                    live.size() - 1, fanout[fanout.size() / 2], fanout.back());
+    }
+
+    if (options.serverPid)
+        std::printf("server RSS %ld KB\n", rssKb(options.serverPid));
+    return 0;
+}
@@ -3,46 +3,124 @@
 namespace xpresspp
 {
 
-    App::App() {}
+    App::App() : hub(std::make_shared<websocket::Hub>()) {}
 
-    void App::addRoute(const std::string &method, const std::string &path, Handler handler)
+    void App::addRoute(const std::string &method, const std::string &path, Handler handler, bool async)
     {
-        routes.push_back({method, path, handler});
+        routes.push_back({method, path, std::move(handler), {}, async}); // chain: filled by compile()
     }
 
     void App::get(const std::string &path, Handler handler)
     {
-        addRoute("GET", path, handler);
+        addRoute("GET", path, std::move(handler));
     }
 
     void App::post(const std::string &path, Handler handler)
     {
-        addRoute("POST", path, handler);
+        addRoute("POST", path, std::move(handler));
     }
 
     void App::put(const std::string &path, Handler handler)
     {
-        addRoute("PUT", path, handler);
+        addRoute("PUT", path, std::move(handler));
     }
 
     void App::patch(const std::string &path, Handler handler)
     {
-        addRoute("PATCH", path, handler);
+        addRoute("PATCH", path, std::move(handler));
     }
 
     void App::del(const std::string &path, Handler handler)
     {
-        addRoute("DELETE", path, handler);
+        addRoute("DELETE", path, std::move(handler));
     }
 
     void App::all(const std::string &path, Handler handler)
     {
-        addRoute("ALL", path, handler);
+        addRoute("ALL", path, std::move(handler));
     }
 
     void App::options(const std::string &path, Handler handler)
     {
-        addRoute("OPTIONS", path, handler);
+        addRoute("OPTIONS", path, std::move(handler));
+    }
+
+    void App::get(const std::string &path, AsyncHandler handler)
+    {
+        addRoute("GET", path, fromAsync(std::move(handler)), true);
+    }
+
+    void App::post(const std::string &path, AsyncHandler handler)
+    {
+        addRoute("POST", path, fromAsync(std::move(handler)), true);
+    }
+
+    void App::put(const std::string &path, AsyncHandler handler)
+    {
+        addRoute("PUT", path, fromAsync(std::move(handler)), true);
+    }
+
+    void App::patch(const std::string &path, AsyncHandler handler)
+    {
+        addRoute("PATCH", path, fromAsync(std::move(handler)), true);
+    }
+
+    void App::del(const std::string &path, AsyncHandler handler)
+    {
+        addRoute("DELETE", path, fromAsync(std::move(handler)), true);
+    }
+
+    void App::all(const std::string &path, AsyncHandler handler)
+    {
+        addRoute("ALL", path, fromAsync(std::move(handler)), true);
+    }
+
+    void App::options(const std::string &path, AsyncHandler handler)
+    {
+        addRoute("OPTIONS", path, fromAsync(std::move(handler)), true);
+    }
+
+    void App::ws(const std::string &path, WebSocketBehavior behavior)
+    {
+        auto shared = std::make_shared<const WebSocketBehavior>(std::move(behavior));
+        auto sockets = hub;
+        addRoute("GET", path, [shared, sockets](Request &req, Response &res)
+                 { websocket::upgrade(*sockets, shared, req, res); });
+    }
+
+    size_t App::publish(const std::string &topic, std::string_view message, bool binary)
+    {
+        return hub->publish(topic, message, binary);
+    }
+
+    void App::use(Middleware middleware)
+    {
+        layers.push_back({"", std::move(middleware)});
+    }
+
+    void App::use(const std::string &prefix, Middleware middleware)
+    {
+        std::string normalized = prefix;
+        while (normalized.size() > 1 && normalized.back() == '/')
+            normalized.pop_back();
+        layers.push_back({normalized == "/" ? "" : normalized, std::move(middleware)});
+    }
+
+    void App::compile()
+    {
+        for (auto &route : routes)
+        {
+            route.chain.clear();
+            for (auto &layer : layers)
+            {
+                const auto &prefix = layer.prefix;
+                bool matches = prefix.empty() ||
+                               (route.path.compare(0, prefix.size(), prefix) == 0 &&
+                                (route.path.size() == prefix.size() || route.path[prefix.size()] == '/'));
+                if (matches)
+                    route.chain.push_back(&layer.middleware);
+            }
+        }
     }
 
     void App::listen(int port, std::function<void()> callback)
@@ -52,6 +130,7 @@ namespace xpresspp
         if (callback)
             callback();
 
+        compile();
         handleRequest("GET", "/");
     }
 
@@ -63,7 +142,8 @@ namespace xpresspp
             {
                 Request req;
                 Response res;
-                route.handler(req, res);
+                Next next(route, req, res);
+                next();
                 return;
             }
         }
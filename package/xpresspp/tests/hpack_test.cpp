@@ -0,0 +1,258 @@
+// 🔥 HPACK checks against RFC 7541 Appendix C
+//
+// Decodes every header block of Appendix C (C.2 - C.6) with hpack::Decoder,
+// in order and on one decoder per section, so the later blocks also check
+// the dynamic table the earlier ones built (C.5 and C.6 run at a 256-byte
+// table and evict). The integers of C.1 and every Huffman string of C.4 and
+// C.6 are encoded and decoded against the RFC bytes; malformed input must be
+// rejected, and Encoder output must decode back to what was encoded.
+//
+// Build:
+//   g++ -std=c++17 -O2 package/xpresspp/tests/hpack_test.cpp -Iinclude -o hpack_test
+// Run:
+//   ./hpack_test    (exit status 0 = all checks passed)
+
+#include <xpresspp/hpack.hpp>
+
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace xpresspp;
+
+static int checks = 0;
+static int failures = 0;
+
+static void check(bool ok, const std::string &what)
+{
+    checks++;
+    if (!ok)
+    {
+        failures++;
+        std::printf("FAIL: %s\n", what.c_str());
+    }
+}
+
+// "8286 84be" -> bytes; spaces are ignored
+static std::string bytes(const char *hex)
+{
+    std::string out;
+    int high = -1;
+    for (const char *p = hex; *p; p++)
+    {
+        int digit = *p >= '0' && *p <= '9' ? *p - '0' : *p >= 'a' && *p <= 'f' ? *p - 'a' + 10 : -1;
+        if (digit < 0)
+            continue;
+        if (high < 0)
+            high = digit;
+        else
+            out += static_cast<char>(high << 4 | digit), high = -1;
+    }
+    return out;
+}
+
+static void decodes(hpack::Decoder &decoder, const std::string &name, const char *hex, const hpack::HeaderList &expected)
+{
+    hpack::HeaderList headers;
+    bool tooLarge = false;
+    check(decoder.decode(bytes(hex), headers, 1 << 20, tooLarge), name + ": decodes");
+    check(!tooLarge, name + ": within the list size");
+    check(headers == expected, name + ": fields");
+}
+
+static void rejects(hpack::Decoder &decoder, const std::string &name, const std::string &block)
+{
+    hpack::HeaderList headers;
+    bool tooLarge = false;
+    check(!decoder.decode(block, headers, 1 << 20, tooLarge), name + ": rejected");
+}
+
+static void integer(uint64_t value, int prefixBits, const char *hex)
+{
+    std::string name = "C.1 " + std::to_string(value) + " with a " + std::to_string(prefixBits) + "-bit prefix";
+    std::string encoded;
+    hpack::encodeInteger(value, prefixBits, 0, encoded);
+    check(encoded == bytes(hex), name + ": encoded");
+
+    auto p = reinterpret_cast<const uint8_t *>(encoded.data());
+    uint64_t decoded = 0;
+    check(hpack::decodeInteger(p, p + encoded.size(), prefixBits, decoded) && decoded == value, name + ": decoded");
+}
+
+static void huffman(const std::string &text, const char *hex)
+{
+    std::string encoded;
+    hpack::huffmanEncode(text, encoded);
+    check(encoded == bytes(hex), "Huffman \"" + text + "\": encoded");
+    check(hpack::huffmanLength(text) == encoded.size(), "Huffman \"" + text + "\": length");
+
+    std::string decoded;
+    check(hpack::huffmanDecode(bytes(hex), decoded) && decoded == text, "Huffman \"" + text + "\": decoded");
+}
+
+int main()
+{
+    // C.1 Integer representation
+    integer(10, 5, "0a");
+    integer(1337, 5, "1f9a0a");
+    integer(42, 8, "2a");
+
+    // C.2 Header field representation, each on an empty table
+    {
+        hpack::Decoder decoder;
+        decodes(decoder, "C.2.1 literal with indexing",
+                "400a 6375 7374 6f6d 2d6b 6579 0d63 7573 746f 6d2d 6865 6164 6572",
+                {{"custom-key", "custom-header"}});
+        // The field went into the dynamic table: index 62
+        decodes(decoder, "C.2.1 then its dynamic entry", "be", {{"custom-key", "custom-header"}});
+    }
+    {
+        hpack::Decoder decoder;
+        decodes(decoder, "C.2.2 literal without indexing", "040c 2f73 616d 706c 652f 7061 7468", {{":path", "/sample/path"}});
+        rejects(decoder, "C.2.2 then index 62 (table still empty)", bytes("be"));
+    }
+    {
+        hpack::Decoder decoder;
+        decodes(decoder, "C.2.3 literal never indexed", "1008 7061 7373 776f 7264 0673 6563 7265 74", {{"password", "secret"}});
+        rejects(decoder, "C.2.3 then index 62 (table still empty)", bytes("be"));
+    }
+    {
+        hpack::Decoder decoder;
+        decodes(decoder, "C.2.4 indexed", "82", {{":method", "GET"}});
+    }
+
+    // C.3 Requests without Huffman coding
+    {
+        hpack::Decoder decoder;
+        decodes(decoder, "C.3.1", "8286 8441 0f77 7777 2e65 7861 6d70 6c65 2e63 6f6d",
+                {{":method", "GET"}, {":scheme", "http"}, {":path", "/"}, {":authority", "www.example.com"}});
+        decodes(decoder, "C.3.2", "8286 84be 5808 6e6f 2d63 6163 6865",
+                {{":method", "GET"}, {":scheme", "http"}, {":path", "/"}, {":authority", "www.example.com"},
+                 {"cache-control", "no-cache"}});
+        decodes(decoder, "C.3.3", "8287 85bf 400a 6375 7374 6f6d 2d6b 6579 0c63 7573 746f 6d2d 7661 6c75 65",
+                {{":method", "GET"}, {":scheme", "https"}, {":path", "/index.html"}, {":authority", "www.example.com"},
+                 {"custom-key", "custom-value"}});
+    }
+
+    // C.4 Requests with Huffman coding
+    {
+        hpack::Decoder decoder;
+        decodes(decoder, "C.4.1", "8286 8441 8cf1 e3c2 e5f2 3a6b a0ab 90f4 ff",
+                {{":method", "GET"}, {":scheme", "http"}, {":path", "/"}, {":authority", "www.example.com"}});
+        decodes(decoder, "C.4.2", "8286 84be 5886 a8eb 1064 9cbf",
+                {{":method", "GET"}, {":scheme", "http"}, {":path", "/"}, {":authority", "www.example.com"},
+                 {"cache-control", "no-cache"}});
+        decodes(decoder, "C.4.3", "8287 85bf 4088 25a8 49e9 5ba9 7d7f 8925 a849 e95b b8e8 b4bf",
+                {{":method", "GET"}, {":scheme", "https"}, {":path", "/index.html"}, {":authority", "www.example.com"},
+                 {"custom-key", "custom-value"}});
+    }
+
+    const hpack::HeaderList response1 = {
+        {":status", "302"}, {"cache-control", "private"}, {"date", "Mon, 21 Oct 2013 20:13:21 GMT"}, {"location", "https://www.example.com"}};
+    const hpack::HeaderList response2 = {
+        {":status", "307"}, {"cache-control", "private"}, {"date", "Mon, 21 Oct 2013 20:13:21 GMT"}, {"location", "https://www.example.com"}};
+    const hpack::HeaderList response3 = {
+        {":status", "200"}, {"cache-control", "private"}, {"date", "Mon, 21 Oct 2013 20:13:22 GMT"}, {"location", "https://www.example.com"},
+        {"content-encoding", "gzip"}, {"set-cookie", "foo=ASDJKHQKBZXOQWEOPIUAXQWEOIU; max-age=3600; version=1"}};
+
+    // C.5 Responses without Huffman coding (256-byte table: entries are evicted)
+    {
+        hpack::Decoder decoder(256);
+        decodes(decoder, "C.5.1",
+                "4803 3330 3258 0770 7269 7661 7465 611d 4d6f 6e2c 2032 3120 4f63 7420 3230 3133"
+                "2032 303a 3133 3a32 3120 474d 546e 1768 7474 7073 3a2f 2f77 7777 2e65 7861 6d70"
+                "6c65 2e63 6f6d",
+                response1);
+        decodes(decoder, "C.5.2", "4803 3330 37c1 c0bf", response2);
+        decodes(decoder, "C.5.3",
+                "88c1 611d 4d6f 6e2c 2032 3120 4f63 7420 3230 3133 2032 303a 3133 3a32 3220 474d"
+                "54c0 5a04 677a 6970 7738 666f 6f3d 4153 444a 4b48 514b 425a 584f 5157 454f 5049"
+                "5541 5851 5745 4f49 553b 206d 6178 2d61 6765 3d33 3630 303b 2076 6572 7369 6f6e"
+                "3d31",
+                response3);
+    }
+
+    // C.6 Responses with Huffman coding
+    {
+        hpack::Decoder decoder(256);
+        decodes(decoder, "C.6.1",
+                "4882 6402 5885 aec3 771a 4b61 96d0 7abe 9410 54d4 44a8 2005 9504 0b81 66e0 82a6"
+                "2d1b ff6e 919d 29ad 1718 63c7 8f0b 97c8 e9ae 82ae 43d3",
+                response1);
+        decodes(decoder, "C.6.2", "4883 640e ffc1 c0bf", response2);
+        decodes(decoder, "C.6.3",
+                "88c1 6196 d07a be94 1054 d444 a820 0595 040b 8166 e084 a62d 1bff c05a 839b d9ab"
+                "77ad 94e7 821d d7f2 e6c7 b335 dfdf cd5b 3960 d5af 2708 7f36 72c1 ab27 0fb5 291f"
+                "9587 3160 65c0 03ed 4ee5 b106 3d50 07",
+                response3);
+    }
+
+    // The Huffman strings of C.4 and C.6
+    huffman("www.example.com", "f1e3 c2e5 f23a 6ba0 ab90 f4ff");
+    huffman("no-cache", "a8eb 1064 9cbf");
+    huffman("custom-key", "25a8 49e9 5ba9 7d7f");
+    huffman("custom-value", "25a8 49e9 5bb8 e8b4 bf");
+    huffman("302", "6402");
+    huffman("307", "640e ff");
+    huffman("private", "aec3 771a 4b");
+    huffman("Mon, 21 Oct 2013 20:13:21 GMT", "d07a be94 1054 d444 a820 0595 040b 8166 e082 a62d 1bff");
+    huffman("Mon, 21 Oct 2013 20:13:22 GMT", "d07a be94 1054 d444 a820 0595 040b 8166 e084 a62d 1bff");
+    huffman("https://www.example.com", "9d29 ad17 1863 c78f 0b97 c8e9 ae82 ae43 d3");
+    huffman("gzip", "9bd9 ab");
+    huffman("foo=ASDJKHQKBZXOQWEOPIUAXQWEOIU; max-age=3600; version=1",
+            "94e7 821d d7f2 e6c7 b335 dfdf cd5b 3960 d5af 2708 7f36 72c1 ab27 0fb5 291f 9587 3160 65c0 03ed 4ee5 b106 3d50 07");
+
+    // Malformed Huffman data (5.2)
+    std::string ignored;
+    check(!hpack::huffmanDecode(bytes("ffff fffc"), ignored), "Huffman EOS in the data: rejected");
+    check(!hpack::huffmanDecode(bytes("f1e3 ff"), ignored), "Huffman padding of 8 bits or more: rejected");
+    check(!hpack::huffmanDecode(bytes("18"), ignored), "Huffman padding not all ones: rejected");
+
+    // Malformed header blocks
+    {
+        hpack::Decoder decoder;
+        rejects(decoder, "index 0", bytes("80"));
+    }
+    {
+        hpack::Decoder decoder;
+        rejects(decoder, "index past the static table", bytes("be"));
+    }
+    {
+        hpack::Decoder decoder;
+        rejects(decoder, "table size above SETTINGS_HEADER_TABLE_SIZE", bytes("3fe2 1f")); // 4097
+    }
+    {
+        hpack::Decoder decoder;
+        rejects(decoder, "table size update after a field", bytes("82 20"));
+    }
+    {
+        hpack::Decoder decoder;
+        rejects(decoder, "string longer than the block", bytes("400a 6375 7374"));
+    }
+    {
+        hpack::Decoder decoder;
+        rejects(decoder, "integer cut short", bytes("1f9a"));
+    }
+
+    // Encoder -> Decoder, twice on the same pair (the second block indexes
+    // what the first added)
+    {
+        hpack::Encoder encoder;
+        hpack::Decoder decoder;
+        hpack::HeaderList headers = {{":status", "200"}, {"content-type", "application/json"}, {"x-request-id", "abc123"},
+                                     {"authorization", "Bearer secret"}, {"date", "Mon, 21 Oct 2013 20:13:21 GMT"}};
+        for (int round = 1; round <= 2; round++)
+        {
+            std::string block;
+            encoder.encode(headers, block);
+            hpack::HeaderList decoded;
+            bool tooLarge = false;
+            check(decoder.decode(block, decoded, 1 << 20, tooLarge) && decoded == headers,
+                  "Encoder round trip " + std::to_string(round));
+        }
+    }
+
+    std::printf("%d checks, %d failed\n", checks, failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,165 @@
+// 🔥 http::parseRequestHead checks
+//
+// Valid heads are parsed whole and from every prefix (each prefix must ask
+// for more bytes, never fail or succeed early); each prefix is copied to a
+// buffer of exactly its size, so under -fsanitize=address a read past the
+// bytes received is caught. Malformed heads (bare LF, control bytes,
+// whitespace before the colon, line folding) must be rejected. Field values
+// are long enough to cross the 16/32-byte SIMD scans.
+//
+// Build:
+//   g++ -std=c++17 -O2 package/xpresspp/tests/http_parser_test.cpp -Iinclude -o http_parser_test
+//   (add -mavx2 for the AVX2 path, -fsanitize=address for overreads)
+// Run:
+//   ./http_parser_test    (exit status 0 = all checks passed)
+
+#include <xpresspp/http_parser.hpp>
+
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+using namespace xpresspp;
+
+static int checks = 0;
+static int failures = 0;
+
+static void check(bool ok, const std::string &what)
+{
+    checks++;
+    if (!ok)
+    {
+        failures++;
+        std::printf("FAIL: %s\n", what.c_str());
+    }
+}
+
+// Parses a copy of `text` in a buffer that ends where the text ends; the
+// views in head point into `buffer`
+static long parse(std::unique_ptr<char[]> &buffer, std::string_view text, http::RequestHead &head)
+{
+    buffer.reset(new char[text.size() ? text.size() : 1]);
+    std::memcpy(buffer.get(), text.data(), text.size());
+    return http::parseRequestHead(buffer.get(), text.size(), head);
+}
+
+struct Expected
+{
+    std::string method, target, version;
+    std::vector<std::pair<std::string, std::string>> headers;
+};
+
+static void valid(const std::string &name, const std::string &text, const Expected &expected,
+                  const std::string &trailing = "")
+{
+    std::unique_ptr<char[]> buffer;
+    http::RequestHead head;
+    long length = parse(buffer, text + trailing, head);
+    check(length == static_cast<long>(text.size()), name + ": head length");
+    if (length > 0)
+    {
+        check(head.method == expected.method, name + ": method");
+        check(head.target == expected.target, name + ": target");
+        check(head.version == expected.version, name + ": version");
+        check(head.headerCount == expected.headers.size(), name + ": header count");
+        for (size_t i = 0; i < head.headerCount && i < expected.headers.size(); i++)
+        {
+            check(head.headers[i].name == expected.headers[i].first, name + ": name of header " + std::to_string(i));
+            check(head.headers[i].value == expected.headers[i].second, name + ": value of header " + std::to_string(i));
+        }
+    }
+
+    // Split anywhere: the head is incomplete until its last byte
+    for (size_t split = 0; split < text.size(); split++)
+    {
+        long result = parse(buffer, std::string_view(text).substr(0, split), head);
+        if (result != http::parseIncomplete)
+        {
+            check(false, name + ": prefix of " + std::to_string(split) + " bytes returned " + std::to_string(result));
+            break;
+        }
+    }
+}
+
+static void invalid(const std::string &name, const std::string &text, long expected = http::parseError)
+{
+    std::unique_ptr<char[]> buffer;
+    http::RequestHead head;
+    check(parse(buffer, text, head) == expected, name + ": rejected");
+
+    // No prefix may be accepted either
+    for (size_t split = 0; split < text.size(); split++)
+    {
+        long result = parse(buffer, std::string_view(text).substr(0, split), head);
+        if (result >= 0)
+        {
+            check(false, name + ": prefix of " + std::to_string(split) + " bytes accepted");
+            break;
+        }
+    }
+}
+
+int main()
+{
+    valid("simple GET",
+          "GET /index.html HTTP/1.1\r\nHost: example.com\r\n\r\n",
+          {"GET", "/index.html", "HTTP/1.1", {{"Host", "example.com"}}});
+
+    valid("no headers", "GET / HTTP/1.0\r\n\r\n", {"GET", "/", "HTTP/1.0", {}});
+
+    std::string longTarget = "/search?q=" + std::string(100, 'x') + "&page=2";
+    std::string longValue = "Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) \xc3\xa9t\xc3\xa9";
+    valid("long target and values, OWS trimmed, HT inside a value",
+          "POST " + longTarget + " HTTP/1.1\r\n"
+          "Host:example.com\r\n"
+          "User-Agent: \t " + longValue + " \t\r\n"
+          "X-Tabbed: a\tb\r\n"
+          "Empty:\r\n"
+          "Content-Length: 5\r\n\r\n",
+          {"POST", longTarget, "HTTP/1.1",
+           {{"Host", "example.com"}, {"User-Agent", longValue}, {"X-Tabbed", "a\tb"}, {"Empty", ""}, {"Content-Length", "5"}}},
+          "hello");
+
+    valid("empty lines before the request line",
+          "\r\n\r\nGET / HTTP/1.1\r\nA: 1\r\n\r\n",
+          {"GET", "/", "HTTP/1.1", {{"A", "1"}}});
+
+    valid("pipelined: only the first head",
+          "GET /a HTTP/1.1\r\nHost: x\r\n\r\n",
+          {"GET", "/a", "HTTP/1.1", {{"Host", "x"}}},
+          "GET /b HTTP/1.1\r\nHost: x\r\n\r\n");
+
+    std::string many = "GET / HTTP/1.1\r\n";
+    Expected manyExpected{"GET", "/", "HTTP/1.1", {}};
+    for (size_t i = 0; i < http::RequestHead::maxHeaders; i++)
+    {
+        many += "X-" + std::to_string(i) + ": " + std::to_string(i) + "\r\n";
+        manyExpected.headers.emplace_back("X-" + std::to_string(i), std::to_string(i));
+    }
+    valid("maxHeaders fields", many + "\r\n", manyExpected);
+    invalid("one field too many", many + "X-Last: 1\r\n\r\n", http::parseTooManyHeaders);
+
+    // Bare LF wherever CRLF belongs
+    invalid("bare LF after the request line", "GET / HTTP/1.1\nHost: x\r\n\r\n");
+    invalid("bare LF after a field", "GET / HTTP/1.1\r\nHost: x\nA: 1\r\n\r\n");
+    invalid("bare LF ending the head", "GET / HTTP/1.1\r\nHost: x\r\n\n");
+    invalid("bare LF only", "GET / HTTP/1.1\n\n");
+    invalid("bare CR in a value", "GET / HTTP/1.1\r\nHost: x\ry\r\n\r\n");
+
+    invalid("control byte in a value", "GET / HTTP/1.1\r\nA: " + std::string(40, 'a') + "\x01\r\n\r\n");
+    invalid("DEL in a value", "GET / HTTP/1.1\r\nA: b\x7f\r\n\r\n");
+    invalid("control byte in the target", "GET /a\x02 HTTP/1.1\r\n\r\n");
+    invalid("whitespace before the colon", "GET / HTTP/1.1\r\nHost : x\r\n\r\n");
+    invalid("obsolete line folding", "GET / HTTP/1.1\r\nA: 1\r\n 2\r\n\r\n");
+    invalid("no colon", "GET / HTTP/1.1\r\nHost\r\n\r\n");
+    invalid("empty method", " / HTTP/1.1\r\n\r\n");
+    invalid("empty target", "GET  HTTP/1.1\r\n\r\n");
+    invalid("no version", "GET /\r\n\r\n");
+
+    std::printf("%d checks, %d failed\n", checks, failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,207 @@
+// 🔥 MultipartParser checks: delimiters split across reads
+//
+// Feeds one multipart/form-data body to MultipartParser cut into two reads
+// at every offset, into three reads at every pair of offsets, and a byte at
+// a time; every run must produce the same fields and files. The file part
+// holds near-misses of the delimiter (its prefixes, "--boundary" without
+// the CRLF, a CRLF right before the real delimiter) and is long enough for
+// the 16/32-byte scans. File parts go to a sink, plus one run through temp
+// files. Bodies cut short or with a malformed delimiter must fail.
+//
+// Build:
+//   g++ -std=c++17 -O2 package/xpresspp/tests/multipart_test.cpp -Iinclude -o multipart_test
+//   (add -mavx2 for the AVX2 path)
+// Run:
+//   ./multipart_test    (exit status 0 = all checks passed)
+
+#include <xpresspp/multipart.hpp>
+
+#include <cstdio>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace xpresspp;
+
+static int checks = 0;
+static int failures = 0;
+
+static void check(bool ok, const std::string &what)
+{
+    checks++;
+    if (!ok)
+    {
+        failures++;
+        std::printf("FAIL: %s\n", what.c_str());
+    }
+}
+
+static const std::string boundary = "----XpressBoundary7MA4YWxkTrZu0gW";
+
+static std::string fileContent()
+{
+    std::string data = "start\r\n--" + boundary.substr(0, 10) + "\r\n";
+    data += "x--" + boundary + " without the CRLF in front\r\n";
+    data += std::string(100, 'a');
+    data += "\r\n-" + boundary + "\r\n";
+    data += "\r\n--" + boundary.substr(0, boundary.size() - 1) + "\r";
+    data += std::string("\0\xff\r\n\x01", 5);
+    data += "\r\n"; // right before the delimiter
+    return data;
+}
+
+static std::string body()
+{
+    return "preamble, ignored\r\n"
+           "--" + boundary + "\r\n"
+           "Content-Disposition: form-data; name=\"title\"\r\n\r\n"
+           "hello\r\n"
+           "--" + boundary + " \t\r\n" // transport padding
+           "Content-Disposition: form-data; name=\"upload\"; filename=\"a.bin\"\r\n"
+           "Content-Type: application/octet-stream\r\n\r\n" +
+           fileContent() + "\r\n"
+           "--" + boundary + "\r\n"
+           "Content-Disposition: form-data; name=\"empty\"\r\n\r\n"
+           "\r\n"
+           "--" + boundary + "\r\n"
+           "Content-Disposition: form-data; name=\"doc\"; filename*=UTF-8''na%C3%AFve.txt\r\n\r\n"
+           "x\r\n"
+           "--" + boundary + "--\r\n"
+           "epilogue, ignored";
+}
+
+struct Run
+{
+    bool ok = false;
+    MultipartForm form;
+    std::map<std::string, std::string> sunk; // field -> bytes given to the sink
+    std::map<std::string, int> ended;        // field -> end calls
+};
+
+// Feeds `data` in reads that end at `cuts` (ascending offsets)
+static void parse(Run &run, const std::string &data, const std::vector<size_t> &cuts, bool useSink = true)
+{
+    MultipartOptions options;
+    options.uploadDir = std::filesystem::temp_directory_path().string();
+    if (useSink)
+        options.sink = [&run](const std::string &, const UploadedFile &file) -> UploadSink
+        {
+            auto field = file.field;
+            return [&run, field](const char *bytes, size_t size)
+            {
+                if (bytes)
+                    run.sunk[field].append(bytes, size);
+                else
+                    run.ended[field]++;
+                return true;
+            };
+        };
+
+    MultipartParser parser(boundary, options, "/upload", run.form);
+    size_t offset = 0;
+    bool fed = true;
+    for (size_t cut : cuts)
+    {
+        fed = fed && parser.feed(data.data() + offset, cut - offset);
+        offset = cut;
+    }
+    fed = fed && parser.feed(data.data() + offset, data.size() - offset);
+    run.ok = fed && parser.finish();
+}
+
+static bool matches(const Run &run)
+{
+    const auto &form = run.form;
+    if (!run.ok || form.fields.size() != 2 || form.files.size() != 2)
+        return false;
+    if (form.fields.at("title") != "hello" || form.fields.at("empty") != "")
+        return false;
+    auto upload = form.file("upload");
+    auto doc = form.file("doc");
+    return upload && upload->filename == "a.bin" && upload->contentType == "application/octet-stream" &&
+           upload->size == fileContent().size() && doc && doc->filename == "na\xc3\xafve.txt" && doc->size == 1 &&
+           run.sunk.count("upload") && run.sunk.at("upload") == fileContent() && run.sunk.count("doc") &&
+           run.sunk.at("doc") == "x" && run.ended.at("upload") == 1 && run.ended.at("doc") == 1;
+}
+
+int main()
+{
+    const std::string data = body();
+
+    {
+        Run run;
+        parse(run, data, {});
+        check(matches(run), "one read");
+    }
+
+    std::string failedAt;
+    for (size_t cut = 1; cut < data.size() && failedAt.empty(); cut++)
+    {
+        Run run;
+        parse(run, data, {cut});
+        if (!matches(run))
+            failedAt = std::to_string(cut);
+    }
+    check(failedAt.empty(), "two reads at every offset (failed at " + failedAt + ")");
+
+    failedAt.clear();
+    for (size_t first = 1; first < data.size() && failedAt.empty(); first++)
+        for (size_t second = first + 1; second < data.size() && failedAt.empty(); second++)
+        {
+            Run run;
+            parse(run, data, {first, second});
+            if (!matches(run))
+                failedAt = std::to_string(first) + " and " + std::to_string(second);
+        }
+    check(failedAt.empty(), "three reads at every pair of offsets (failed at " + failedAt + ")");
+
+    {
+        std::vector<size_t> everyByte;
+        for (size_t cut = 1; cut < data.size(); cut++)
+            everyByte.push_back(cut);
+        Run run;
+        parse(run, data, everyByte);
+        check(matches(run), "a byte per read");
+    }
+
+    // Temp files instead of a sink: same bytes on disk, removed with the form
+    {
+        std::string path;
+        {
+            Run run;
+            parse(run, data, {data.size() / 2}, false);
+            auto upload = run.form.file("upload");
+            check(run.ok && upload && !upload->path.empty() && upload->read() == fileContent(), "temp file content");
+            if (upload)
+                path = upload->path;
+        }
+        check(!path.empty() && !std::filesystem::exists(path), "temp file removed with the form");
+    }
+
+    // Cut short: no prefix up to the closing "--" is a complete body
+    size_t complete = data.find("--" + boundary + "--") + boundary.size() + 4;
+    {
+        Run run;
+        parse(run, data.substr(0, complete), {});
+        check(matches(run), "body ending at the closing \"--\"");
+    }
+    failedAt.clear();
+    for (size_t length = 0; length < complete && failedAt.empty(); length++)
+    {
+        Run run;
+        parse(run, data.substr(0, length), {});
+        if (run.ok)
+            failedAt = std::to_string(length);
+    }
+    check(failedAt.empty(), "bodies cut short rejected (accepted at " + failedAt + ")");
+
+    {
+        Run run;
+        parse(run, "--" + boundary + "\r\nContent-Disposition: form-data; name=\"a\"\r\n\r\n1\r\n--" + boundary + "x\r\n", {});
+        check(!run.ok, "text after a delimiter rejected");
+    }
+
+    std::printf("%d checks, %d failed\n", checks, failures);
+    return failures ? 1 : 0;
+}
@@ -3,10 +3,37 @@
 #include <nlohmann/json.hpp>
 #include <thread>
 #include <chrono>
+#include <algorithm>
+#include <charconv>
 
 using json = nlohmann::json;
 using namespace xpresspp;
 
+// Plain struct serialized/bound without a json DOM (see /api/users/direct, /api/users/bind)
+struct DemoUser
+{
+        int id;
+        std::string name;
+        std::string email;
+};
+XPRESSPP_JSON(DemoUser, id, name, email)
+
+// A numeric query parameter, clamped: sizes from the client must not
+// throw (std::stoi) or pick how much the server allocates
+static int queryInt(const Request &req, const std::string &key, int def, int min, int max)
+{
+        auto text = req.getQuery(key);
+        int value = def;
+        std::from_chars(text.data(), text.data() + text.size(), value);
+        return std::clamp(value, min, max);
+}
+
+// Plain function registered as a static route (see /ping)
+static void ping(Request &req, Response &res)
+{
+        res.text("pong");
+}
+
 int main()
 {
 #ifdef _WIN32
@@ -14,6 +41,32 @@ int main()
 #endif
         App app;
 
+        // Server-side response cache, shared with handlers that purge it
+        auto responseCache = std::make_shared<ResponseCache>();
+
+        // ============================================
+        // 🧩 MIDDLEWARE
+        // ============================================
+
+        // Global: wraps every route; code after next() is post-processing
+        app.use([](Request &req, Response &res, Next &next)
+                {
+        auto start = std::chrono::steady_clock::now();
+        next();
+        auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        res.setHeader("Server-Timing", "app;dur=" + std::to_string(elapsed)); });
+
+        // Prefix: guards /admin and everything below it; returning without
+        // next() short-circuits the route
+        app.use("/admin", [](Request &req, Response &res, Next &next)
+                {
+        if (req.getBearerToken() != "secret-token-123")
+        {
+            res.error(401, "Admin token required");
+            return;
+        }
+        next(); });
+
         // ============================================
         // 🎯 BASIC ROUTES
         // ============================================
@@ -89,16 +142,36 @@ int main()
                     <span class="method get">GET</span>
                     <a href="/etag-demo">/etag-demo</a> - ETag Support
                 </div>
+                <div class="endpoint">
+                    <span class="method get">GET</span>
+                    <a href="/api/report">/api/report</a> - Server-side Cached Report
+                </div>
+                <div class="endpoint">
+                    <span class="method post">POST</span>
+                    /api/report/refresh - Purge Cached Report
+                </div>
                 
                 <h2>📊 API Features</h2>
                 <div class="endpoint">
                     <span class="method get">GET</span>
                     <a href="/api/users?page=1&limit=10">/api/users</a> - Paginated Response
                 </div>
+                <div class="endpoint">
+                    <span class="method get">GET</span>
+                    <a href="/api/users/stream?count=1000">/api/users/stream</a> - Streamed JSON (add format=ndjson)
+                </div>
+                <div class="endpoint">
+                    <span class="method get">GET</span>
+                    <a href="/api/users/direct?limit=10">/api/users/direct</a> - Struct to JSON (no DOM)
+                </div>
                 <div class="endpoint">
                     <span class="method post">POST</span>
                     /api/validate - JSON Validation
                 </div>
+                <div class="endpoint">
+                    <span class="method post">POST</span>
+                    /api/users/bind - Typed Body Binding (JSON / MessagePack / CBOR)
+                </div>
                 <div class="endpoint">
                     <span class="method get">GET</span>
                     <a href="/api/error-demo">/api/error-demo</a> - Error Handling
@@ -131,6 +204,9 @@ int main()
             </html>
         )"); });
 
+        // Static route: ping is called directly, not through a stored pointer
+        app.get<ping>("/ping");
+
         // ============================================
         // 🔐 AUTHENTICATION & SECURITY
         // ============================================
@@ -158,6 +234,16 @@ int main()
             {"authenticated", true}
         }, "Authentication successful"); });
 
+        app.get("/admin/stats", [](Request &req, Response &res)
+                {
+        // Only reached through the /admin middleware, which also runs
+        // before cache hits; the same for every admin, so shared
+        res.serverCache(10, {"admin"}, true);
+        res.json({
+            {"admin", true},
+            {"uptime", "ok"}
+        }); });
+
         app.get("/auth/check", [](Request &req, Response &res)
                 {
         bool authenticated = req.isAuthenticated();
@@ -246,14 +332,10 @@ int main()
                 {
         std::string etag = "v1.0.0";
         
-        // Check if client has fresh copy
-        if (req.isFresh(etag))
-        {
-            res.notModified();
+        // Client already has this version: 304 before building anything
+        if (res.version(etag))
             return;
-        }
         
-        res.etag(etag);
         res.cache(3600);
         
         res.json({
@@ -262,14 +344,32 @@ int main()
             {"data", "Some expensive computed data"}
         }); });
 
+        app.get("/api/report", [](Request &req, Response &res)
+                {
+        // Expensive payload; hits within 30s are replayed without running this,
+        // and concurrent misses are coalesced into a single run
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        
+        res.serverCache(30, {"report"});
+        res.json({
+            {"generatedAt", std::time(nullptr)},
+            {"region", req.getQuery("region", "all")},
+            {"total", 12345}
+        }); });
+
+        app.post("/api/report/refresh", [responseCache](Request &req, Response &res)
+                 {
+        size_t purged = responseCache->purge("report");
+        res.json({{"purged", purged}}); });
+
         // ============================================
         // 📊 API FEATURES
         // ============================================
 
         app.get("/api/users", [](Request &req, Response &res)
                 {
-        int page = std::stoi(req.getQuery("page", "1"));
-        int limit = std::stoi(req.getQuery("limit", "10"));
+        int page = queryInt(req, "page", 1, 1, 1000);
+        int limit = queryInt(req, "limit", 10, 1, 100);
         
         // Simulate data
         json users = json::array();
@@ -287,6 +387,37 @@ int main()
         
         res.paginate(users, page, limit, total); });
 
+        app.get("/api/users/stream", [](Request &req, Response &res)
+                {
+        int count = queryInt(req, "count", 1000, 0, 1000000);
+        auto mode = req.getQuery("format") == "ndjson" ? JsonStreamMode::NDJSON : JsonStreamMode::Array;
+        
+        // Rows are generated and serialized one at a time
+        int i = 0;
+        res.jsonStream([i, count](json &next) mutable
+                       {
+            if (i >= count)
+                return false;
+            i++;
+            next = {
+                {"id", i},
+                {"name", "User " + std::to_string(i)},
+                {"email", "user" + std::to_string(i) + "@example.com"}
+            };
+            return true; },
+                       mode); });
+
+        app.get("/api/users/direct", [](Request &req, Response &res)
+                {
+        int limit = queryInt(req, "limit", 10, 0, 1000);
+        
+        std::vector<DemoUser> users;
+        users.reserve(limit);
+        for (int i = 0; i < limit; i++)
+            users.push_back({i + 1, "User " + std::to_string(i + 1), "user" + std::to_string(i + 1) + "@example.com"});
+        
+        res.jsonDirect(users); });
+
         app.post("/api/validate", [](Request &req, Response &res)
                  {
         // Validate required fields
@@ -315,19 +446,25 @@ int main()
             {"age", age}
         }, "User created successfully"); });
 
+        app.post("/api/users/bind", [](Request &req, Response &res)
+                 {
+        // Parsed straight into the struct; errors become 400 with a JSON pointer.
+        // Accepts JSON, MessagePack or CBOR and answers in the Accept'ed format.
+        auto user = req.bind<DemoUser>();
+        
+        res.encode(201, user); });
+
         app.get("/api/error-demo", [](Request &req, Response &res)
                 { res.error(500, "Something went wrong", "This is a demo error response"); });
 
         app.get("/api/rate-limit", [](Request &req, Response &res)
                 {
-        // Simulate rate limiting
-        res.rateLimit(100, 75, std::time(nullptr) + 3600);
-        
+        // Limited by config.rateLimit (5 requests / 10s per client IP):
+        // X-RateLimit-* are filled in, the 6th request gets 429 + Retry-After
         res.json({
-            {"message", "Rate limit headers set"},
-            {"limit", 100},
-            {"remaining", 75},
-            {"reset_in", "1 hour"}
+            {"message", "Within rate limit"},
+            {"limit", 5},
+            {"window", "10s"}
         }); });
 
         // ============================================
@@ -383,6 +520,7 @@ int main()
                             {"fullUrl", req.fullUrl()},
                             {"baseUrl", req.baseUrl()},
                             {"protocol", req.protocol},
+                            {"httpVersion", req.httpVersion},
                             {"secure", req.secure},
                             {"ip", req.ip},
                             {"realIP", req.getRealIP()},
@@ -396,7 +534,9 @@ int main()
                             {"isXHR", req.isXHR()},
                             {"isAuthenticated", req.isAuthenticated()},
                             {"headers", req.headers},
-                            {"query", req.query}}); });
+                            {"query", req.query},
+                            {"peer", req.peer ? json{{"pid", req.peer->pid}, {"uid", req.peer->uid}, {"gid", req.peer->gid}}
+                                              : json(nullptr)}}); });
 
         app.get("/debug", [](Request &req, Response &res)
                 { res.text(req.debug()); });
@@ -490,10 +630,26 @@ int main()
 
         app.post("/upload-simulation", [](Request &req, Response &res)
                  { res.json({{"message", "File upload received"},
-                             {"body_size", req.body.size()},
+                             {"body_size", req.bodyView().size()},
+                             {"spilled_to_disk", req.bodySpilled()},
                              {"content_length", req.contentLength},
                              {"content_type", req.contentType()}}); });
 
+        // curl -F title=report -F file=@notes.txt http://localhost:5000/upload
+        app.post("/upload", [](Request &req, Response &res)
+                 {
+        // Parsed while it streamed in: fields in memory, files already on disk
+        json files = json::array();
+        for (auto &file : req.form.files)
+        {
+            files.push_back({{"field", file.field},
+                             {"filename", file.filename},
+                             {"content_type", file.contentType},
+                             {"size", file.size}});
+        }
+        // file.moveTo("uploads/...") keeps one; the rest are removed with the request
+        res.json({{"fields", req.form.fields}, {"files", files}}); });
+
         app.get("/timing", [](Request &req, Response &res)
                 {
         // Simulate processing time
@@ -508,6 +664,30 @@ int main()
             {"total_duration", req.getDuration()}
         }); });
 
+        app.get("/timing/async", [](Request &req, Response &res, Done done)
+                {
+        // Same 100ms wait as /timing, on a timer: the worker goes back to the
+        // pool while it runs, and a worker writes the response after done()
+        TimerService::shared().after(std::chrono::milliseconds(100), [&req, &res, done]
+        {
+            res.json({
+                {"message", "Finished from a timer callback"},
+                {"total_duration", req.getDuration()}
+            });
+            done();
+        }); });
+
+#ifdef XPRESSPP_COROUTINES
+        app.get("/timing/co", co([](Request &req, Response &res) -> Task
+                                 {
+        co_await sleepFor(std::chrono::milliseconds(100));
+        
+        res.json({
+            {"message", "Finished after co_await"},
+            {"total_duration", req.getDuration()}
+        }); }));
+#endif
+
         app.get("/all-data", [](Request &req, Response &res)
                 {
         // Get all data (params + query + body)
@@ -519,6 +699,46 @@ int main()
             {"query", req.query}
         }); });
 
+        // ============================================
+        // 🔌 WEBSOCKETS
+        // ============================================
+
+        // Echo: messages come back on the same connection
+        WebSocketBehavior echo;
+        echo.message = [](WebSocket &ws, std::string_view message, bool binary)
+        { ws.send(message, binary); };
+        app.ws("/ws/echo", echo);
+
+        // Chat rooms: /ws/chat/lobby?name=ada joins topic "chat/lobby"; each
+        // message goes out to the room once (compressed once for everyone)
+        WebSocketBehavior chat;
+        chat.open = [](WebSocket &ws, Request &req)
+        {
+            std::string room = "chat/" + req.params["room"];
+            std::string name = req.query.count("name") ? req.query["name"] : "guest";
+            ws.data = std::make_pair(room, name);
+            ws.subscribe(room);
+            ws.send(json{{"joined", room}, {"as", name}}.dump());
+        };
+        chat.message = [](WebSocket &ws, std::string_view message, bool)
+        {
+            auto &who = std::any_cast<std::pair<std::string, std::string> &>(ws.data);
+            ws.publish(who.first, json{{"from", who.second}, {"text", message}}.dump());
+        };
+        chat.close = [&app](WebSocket &ws, int, std::string_view)
+        {
+            auto &who = std::any_cast<std::pair<std::string, std::string> &>(ws.data);
+            app.publish(who.first, json{{"left", who.second}}.dump());
+        };
+        chat.options.idleTimeout = 60; // ping after 30s of silence
+        app.ws("/ws/chat/:room", chat);
+
+        // Server-side broadcast to every chat room subscriber
+        app.post("/ws/chat/:room/announce", [&app](Request &req, Response &res)
+                 {
+        size_t reached = app.publish("chat/" + req.params["room"], json{{"announcement", req.body}}.dump());
+        res.json({{"reached", reached}}); });
+
         // ============================================
         // 🎯 PATTERN MATCHING
         // ============================================
@@ -650,6 +870,26 @@ int main()
         config.readTimeout = 30;
         config.writeTimeout = 30;
         config.maxRequestSize = 5 * 1024 * 1024; // 5MB
+        config.bodySpillThreshold = 1024 * 1024; // larger bodies: temp file + mmap (POST /upload-simulation)
+        config.multipart.maxFileSize = 4 * 1024 * 1024; // per file part of POST /upload (413 above)
+        config.maxHeaderSize = 16 * 1024;        // request line + headers; larger heads get 431
+        config.autoETag = true;                  // hashed ETags + 304s on every GET (curl -H 'If-None-Match: ...')
+        config.enableHTTP2 = true;               // curl --http2-prior-knowledge http://localhost:5000/request-info
+        config.webSocketThreads = 1;             // event loops for /ws/* connections
+        config.handleSignals = true;             // opt-in: the two lines below need it
+        config.drainTimeout = 10;                // Ctrl-C / SIGTERM: in-flight requests get 10s to finish
+        config.hotRestart = true;                // kill -HUP <pid>: a new process takes over the port
+        config.processes = 1;                    // > 1 (Linux): prefork workers; /metrics sums them all
+        config.listeners = {Listener::tcp(config.host, config.port), // also: curl --unix-socket /tmp/xpresspp.sock http://x/request-info
+                            Listener::unixSocket("/tmp/xpresspp.sock", 0666)};
+        config.peerCredentials = true;           // req.peer on Unix-socket requests
+        config.compression.dictionary.enabled = true; // zstd builds: per-route dictionaries
+        config.responseCache = responseCache;
+        config.coalescing.routes = {"/api/report"}; // concurrent misses share one run
+        config.rateLimit.enabled = true;
+        config.rateLimit.limit = 5;
+        config.rateLimit.windowSeconds = 10;
+        config.rateLimit.routes = {"/api/rate-limit"};
 
         Server server(app, config);
 